@@ -1103,6 +1103,157 @@ slurm_load_jobs (time_t update_time, job_info_msg_t **job_info_msg_pptr,
 	return SLURM_PROTOCOL_SUCCESS;
 }
 
+/*
+ * slurm_load_jobs_delta - issue RPC to get information about jobs changed,
+ *	added or purged since update_time
+ * IN update_time - time of current job data, zero to load all jobs
+ * OUT job_delta_pptr - place to store a job delta pointer
+ * IN show_flags - job filtering options
+ * RET 0 or -1 on error
+ * NOTE: free the response using slurm_free_job_info_delta_msg
+ */
+extern int slurm_load_jobs_delta(time_t update_time,
+				 job_info_delta_msg_t **job_delta_pptr,
+				 uint16_t show_flags)
+{
+	int rc;
+	slurm_msg_t resp_msg;
+	slurm_msg_t req_msg;
+	job_info_request_msg_t req;
+
+	slurm_msg_t_init(&req_msg);
+	slurm_msg_t_init(&resp_msg);
+
+	req.last_update  = update_time;
+	req.show_flags   = show_flags;
+	req_msg.msg_type = REQUEST_JOB_INFO_DELTA;
+	req_msg.data     = &req;
+
+	if (slurm_send_recv_controller_msg(&req_msg, &resp_msg) < 0)
+		return SLURM_ERROR;
+
+	switch (resp_msg.msg_type) {
+	case RESPONSE_JOB_INFO_DELTA:
+		*job_delta_pptr = (job_info_delta_msg_t *)resp_msg.data;
+		break;
+	case RESPONSE_SLURM_RC:
+		rc = ((return_code_msg_t *) resp_msg.data)->return_code;
+		slurm_free_return_code_msg(resp_msg.data);
+		if (rc)
+			slurm_seterrno_ret(rc);
+		break;
+	default:
+		slurm_seterrno_ret(SLURM_UNEXPECTED_MSG_ERROR);
+		break;
+	}
+
+	return SLURM_PROTOCOL_SUCCESS;
+}
+
+static int _cmp_job_id(const void *a, const void *b)
+{
+	uint32_t id_a = *(uint32_t *) a, id_b = *(uint32_t *) b;
+
+	if (id_a < id_b)
+		return -1;
+	if (id_a > id_b)
+		return 1;
+	return 0;
+}
+
+/*
+ * slurm_merge_jobs_delta - merge job information delta into job information
+ *	previously loaded with slurm_load_jobs or slurm_merge_jobs_delta
+ * IN/OUT job_info_msg_pptr - current job information, replaced by a newly
+ *	allocated message (the old one is freed). May point to NULL if
+ *	no job information was loaded yet.
+ * IN job_delta_ptr - job delta loaded by slurm_load_jobs_delta, its job
+ *	records are moved into the new message. It must still be freed
+ *	using slurm_free_job_info_delta_msg
+ * RET 0 or -1 on error
+ * NOTE: free the response using slurm_free_job_info_msg
+ */
+extern int slurm_merge_jobs_delta(job_info_msg_t **job_info_msg_pptr,
+				  job_info_delta_msg_t *job_delta_ptr)
+{
+	job_info_msg_t *old_ptr = *job_info_msg_pptr, *new_ptr;
+	uint32_t *changed_inx, *purged, *key;
+	bool *merged;
+	int i, j;
+
+	if (!job_delta_ptr)
+		slurm_seterrno_ret(EINVAL);
+
+	new_ptr = xmalloc(sizeof(job_info_msg_t));
+	new_ptr->last_update = job_delta_ptr->last_update;
+	if (!old_ptr || (job_delta_ptr->flags & JOB_DELTA_FULL)) {
+		new_ptr->record_count = job_delta_ptr->record_count;
+		new_ptr->job_array = job_delta_ptr->job_array;
+		job_delta_ptr->record_count = 0;
+		job_delta_ptr->job_array = NULL;
+		slurm_free_job_info_msg(old_ptr);
+		*job_info_msg_pptr = new_ptr;
+		return SLURM_SUCCESS;
+	}
+
+	/* Sorted (job ID, delta index) pairs and purged job IDs */
+	changed_inx = xmalloc(sizeof(uint32_t) * 2 *
+			      (job_delta_ptr->record_count + 1));
+	for (i = 0; i < job_delta_ptr->record_count; i++) {
+		changed_inx[i * 2] = job_delta_ptr->job_array[i].job_id;
+		changed_inx[i * 2 + 1] = i;
+	}
+	qsort(changed_inx, job_delta_ptr->record_count,
+	      sizeof(uint32_t) * 2, _cmp_job_id);
+	purged = xmalloc(sizeof(uint32_t) * (job_delta_ptr->purged_count + 1));
+	memcpy(purged, job_delta_ptr->purged_job_id,
+	       sizeof(uint32_t) * job_delta_ptr->purged_count);
+	qsort(purged, job_delta_ptr->purged_count, sizeof(uint32_t),
+	      _cmp_job_id);
+	merged = xmalloc(sizeof(bool) * (job_delta_ptr->record_count + 1));
+
+	/* Keep the order of existing jobs, replacing changed ones and
+	 * dropping purged ones, then add new jobs */
+	new_ptr->job_array = xmalloc(sizeof(job_info_t) *
+				     (old_ptr->record_count +
+				      job_delta_ptr->record_count));
+	j = 0;
+	for (i = 0; i < old_ptr->record_count; i++) {
+		key = bsearch(&old_ptr->job_array[i].job_id, changed_inx,
+			      job_delta_ptr->record_count,
+			      sizeof(uint32_t) * 2, _cmp_job_id);
+		if (key) {
+			slurm_free_job_info_members(&old_ptr->job_array[i]);
+			merged[key[1]] = true;
+			new_ptr->job_array[j++] =
+				job_delta_ptr->job_array[key[1]];
+		} else if (bsearch(&old_ptr->job_array[i].job_id, purged,
+				   job_delta_ptr->purged_count,
+				   sizeof(uint32_t), _cmp_job_id)) {
+			slurm_free_job_info_members(&old_ptr->job_array[i]);
+		} else {
+			new_ptr->job_array[j++] = old_ptr->job_array[i];
+		}
+	}
+	for (i = 0; i < job_delta_ptr->record_count; i++) {
+		if (!merged[i])
+			new_ptr->job_array[j++] = job_delta_ptr->job_array[i];
+	}
+	new_ptr->record_count = j;
+
+	/* Job records now belong to new_ptr */
+	xfree(old_ptr->job_array);
+	xfree(old_ptr);
+	job_delta_ptr->record_count = 0;
+	xfree(job_delta_ptr->job_array);
+	xfree(changed_inx);
+	xfree(purged);
+	xfree(merged);
+
+	*job_info_msg_pptr = new_ptr;
+	return SLURM_SUCCESS;
+}
+
 /*
  * slurm_load_job_user - issue RPC to get slurm information about all jobs
  *	to be run as the specified user
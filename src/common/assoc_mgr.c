@@ -38,6 +38,7 @@
 
 #include "assoc_mgr.h"
 
+#include <ctype.h>
 #include <sys/types.h>
 #include <pwd.h>
 #include <fcntl.h>
@@ -52,6 +53,7 @@
 slurmdb_association_rec_t *assoc_mgr_root_assoc = NULL;
 uint32_t g_qos_max_priority = 0;
 uint32_t g_qos_count = 0;
+uint32_t assoc_mgr_assoc_update_cnt = 0;
 List assoc_mgr_association_list = NULL;
 List assoc_mgr_qos_list = NULL;
 List assoc_mgr_user_list = NULL;
@@ -70,6 +72,280 @@ void (*update_resvs) () = NULL;
 static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
 
+/* Hash indexes of the association, user and QOS lists. Each is an open
+ * addressing table of record pointers, at most half full, probed linearly
+ * from the slot of the record's hash. Several records may have the same
+ * key (e.g. associations of a user and account in several partitions), a
+ * lookup checks every record until an empty slot. The indexes are kept in
+ * sync with the lists under the same assoc_mgr locks. */
+typedef struct {
+	uint32_t (*hash)(void *rec);
+	bool (*skip)(void *rec);	/* records not to index, may be NULL */
+	uint32_t count;
+	uint32_t size;		/* zero or a power of two */
+	void **slot;
+} rec_index_t;
+
+#define REC_INDEX_MIN_SIZE 64
+
+static uint32_t _hash_int(uint32_t val)
+{
+	return (uint32_t) (((uint64_t) val * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+/* hash ignoring case, names are compared with strcasecmp() */
+static uint32_t _hash_name(char *name)
+{
+	uint32_t hash = 2166136261U;	/* FNV-1a */
+
+	if (name) {
+		for ( ; *name; name++)
+			hash = (hash ^ (uint8_t) tolower((int) *name)) *
+				16777619U;
+	}
+	return _hash_int(hash);
+}
+
+static uint32_t _assoc_id_hash(void *rec)
+{
+	return _hash_int(((slurmdb_association_rec_t *) rec)->id);
+}
+
+/* associations with no account are hashed as account "" */
+static uint32_t _assoc_user_acct_hash_key(uint32_t uid, char *acct)
+{
+	return _hash_int(uid) ^ _hash_name(acct ? acct : "");
+}
+
+static uint32_t _assoc_user_hash(void *rec)
+{
+	slurmdb_association_rec_t *assoc = (slurmdb_association_rec_t *) rec;
+	return _assoc_user_acct_hash_key(assoc->uid, assoc->acct);
+}
+
+static uint32_t _user_uid_hash(void *rec)
+{
+	return _hash_int(((slurmdb_user_rec_t *) rec)->uid);
+}
+
+static bool _user_no_uid(void *rec)
+{
+	return (((slurmdb_user_rec_t *) rec)->uid == NO_VAL);
+}
+
+static uint32_t _user_name_hash(void *rec)
+{
+	return _hash_name(((slurmdb_user_rec_t *) rec)->name);
+}
+
+static uint32_t _qos_id_hash(void *rec)
+{
+	return _hash_int(((slurmdb_qos_rec_t *) rec)->id);
+}
+
+static uint32_t _qos_name_hash(void *rec)
+{
+	return _hash_name(((slurmdb_qos_rec_t *) rec)->name);
+}
+
+/* associations by id and by uid and account */
+static rec_index_t assoc_id_index   = { _assoc_id_hash, NULL };
+static rec_index_t assoc_user_index = { _assoc_user_hash, NULL };
+/* users by uid (if they have one) and by name */
+static rec_index_t user_uid_index   = { _user_uid_hash, _user_no_uid };
+static rec_index_t user_name_index  = { _user_name_hash, NULL };
+/* QOS by id and by name */
+static rec_index_t qos_id_index     = { _qos_id_hash, NULL };
+static rec_index_t qos_name_index   = { _qos_name_hash, NULL };
+
+static void _index_free(rec_index_t *index)
+{
+	xfree(index->slot);
+	index->count = 0;
+	index->size = 0;
+}
+
+static void _index_add(rec_index_t *index, void *rec)
+{
+	uint32_t i, mask;
+
+	if (index->skip && index->skip(rec))
+		return;
+	if (((index->count + 1) * 2) > index->size) {
+		void **old_slot = index->slot;
+		uint32_t old_size = index->size;
+
+		index->size = MAX(REC_INDEX_MIN_SIZE, index->size * 2);
+		index->slot = xmalloc(sizeof(void *) * index->size);
+		index->count = 0;
+		for (i = 0; i < old_size; i++) {
+			if (old_slot[i])
+				_index_add(index, old_slot[i]);
+		}
+		xfree(old_slot);
+	}
+
+	mask = index->size - 1;
+	for (i = index->hash(rec) & mask; index->slot[i]; i = (i + 1) & mask)
+		;
+	index->slot[i] = rec;
+	index->count++;
+}
+
+static void _index_remove(rec_index_t *index, void *rec)
+{
+	uint32_t i, j, home, mask;
+
+	if (!index->size || (index->skip && index->skip(rec)))
+		return;
+	mask = index->size - 1;
+	for (i = index->hash(rec) & mask; index->slot[i]; i = (i + 1) & mask) {
+		if (index->slot[i] == rec)
+			break;
+	}
+	if (index->slot[i] != rec) {
+		/* its key changed since it was added, look everywhere */
+		for (i = 0; i < index->size; i++) {
+			if (index->slot[i] == rec)
+				break;
+		}
+		if (i >= index->size)
+			return;
+	}
+
+	/* move back any later records of the probe sequence which may
+	 * not be found once this slot is empty */
+	for (j = (i + 1) & mask; index->slot[j]; j = (j + 1) & mask) {
+		home = index->hash(index->slot[j]) & mask;
+		if (((j > i) && ((home <= i) || (home > j))) ||
+		    ((j < i) && (home <= i) && (home > j))) {
+			index->slot[i] = index->slot[j];
+			i = j;
+		}
+	}
+	index->slot[i] = NULL;
+	index->count--;
+}
+
+/* rebuild an index of all records in list, which may be NULL */
+static void _index_build(rec_index_t *index, List list)
+{
+	ListIterator itr;
+	void *rec;
+	uint32_t cnt = list ? list_count(list) : 0;
+
+	_index_free(index);
+	index->size = REC_INDEX_MIN_SIZE;
+	while (index->size < (cnt * 2))
+		index->size *= 2;
+	index->slot = xmalloc(sizeof(void *) * index->size);
+	if (!list)
+		return;
+	itr = list_iterator_create(list);
+	while ((rec = list_next(itr)))
+		_index_add(index, rec);
+	list_iterator_destroy(itr);
+}
+
+/* locks should be put in place before calling these functions */
+static slurmdb_association_rec_t *_find_assoc_id(uint32_t id)
+{
+	slurmdb_association_rec_t *assoc;
+	uint32_t i, mask;
+
+	if (!assoc_id_index.size)
+		return NULL;
+	mask = assoc_id_index.size - 1;
+	for (i = _hash_int(id) & mask; (assoc = assoc_id_index.slot[i]);
+	     i = (i + 1) & mask) {
+		if (assoc->id == id)
+			return assoc;
+	}
+	return NULL;
+}
+
+static slurmdb_user_rec_t *_find_user_uid(uint32_t uid)
+{
+	slurmdb_user_rec_t *user;
+	uint32_t i, mask;
+
+	if (!user_uid_index.size)
+		return NULL;
+	mask = user_uid_index.size - 1;
+	for (i = _hash_int(uid) & mask; (user = user_uid_index.slot[i]);
+	     i = (i + 1) & mask) {
+		if (user->uid == uid)
+			return user;
+	}
+	return NULL;
+}
+
+static slurmdb_user_rec_t *_find_user_name(char *name)
+{
+	slurmdb_user_rec_t *user;
+	uint32_t i, mask;
+
+	if (!user_name_index.size)
+		return NULL;
+	mask = user_name_index.size - 1;
+	for (i = _hash_name(name) & mask; (user = user_name_index.slot[i]);
+	     i = (i + 1) & mask) {
+		if (user->name && !strcasecmp(name, user->name))
+			return user;
+	}
+	return NULL;
+}
+
+static slurmdb_qos_rec_t *_find_qos_id(uint32_t id)
+{
+	slurmdb_qos_rec_t *qos;
+	uint32_t i, mask;
+
+	if (!qos_id_index.size)
+		return NULL;
+	mask = qos_id_index.size - 1;
+	for (i = _hash_int(id) & mask; (qos = qos_id_index.slot[i]);
+	     i = (i + 1) & mask) {
+		if (qos->id == id)
+			return qos;
+	}
+	return NULL;
+}
+
+static slurmdb_qos_rec_t *_find_qos_name(char *name)
+{
+	slurmdb_qos_rec_t *qos;
+	uint32_t i, mask;
+
+	if (!qos_name_index.size)
+		return NULL;
+	mask = qos_name_index.size - 1;
+	for (i = _hash_name(name) & mask; (qos = qos_name_index.slot[i]);
+	     i = (i + 1) & mask) {
+		if (qos->name && !strcasecmp(name, qos->name))
+			return qos;
+	}
+	return NULL;
+}
+
+static void _build_assoc_index(void)
+{
+	_index_build(&assoc_id_index, assoc_mgr_association_list);
+	_index_build(&assoc_user_index, assoc_mgr_association_list);
+}
+
+static void _build_user_index(void)
+{
+	_index_build(&user_uid_index, assoc_mgr_user_list);
+	_index_build(&user_name_index, assoc_mgr_user_list);
+}
+
+static void _build_qos_index(void)
+{
+	_index_build(&qos_id_index, assoc_mgr_qos_list);
+	_index_build(&qos_name_index, assoc_mgr_qos_list);
+}
+
 /* you should check for assoc == NULL before this function */
 static void _normalize_assoc_shares(slurmdb_association_rec_t *assoc)
 {
@@ -213,6 +489,7 @@ static int _change_user_name(slurmdb_user_rec_t *user)
 			}
 		}
 		list_iterator_destroy(itr);
+		_index_build(&assoc_user_index, assoc_mgr_association_list);
 	}
 
 	if (assoc_mgr_wckey_list) {
@@ -330,22 +607,14 @@ static void _set_user_default_acct(slurmdb_association_rec_t *assoc)
 
 	/* set up the default if this is it */
 	if ((assoc->is_def == 1) && (assoc->uid != NO_VAL)) {
-		slurmdb_user_rec_t *user = NULL;
-		ListIterator user_itr =
-			list_iterator_create(assoc_mgr_user_list);
-		while ((user = list_next(user_itr))) {
-			if (user->uid != assoc->uid)
-				continue;
-			if (!user->default_acct
-			    || strcmp(user->default_acct, assoc->acct)) {
-				xfree(user->default_acct);
-				user->default_acct = xstrdup(assoc->acct);
-				debug2("user %s default acct is %s",
-				       user->name, user->default_acct);
-			}
-			break;
+		slurmdb_user_rec_t *user = _find_user_uid(assoc->uid);
+		if (user && (!user->default_acct
+			     || strcmp(user->default_acct, assoc->acct))) {
+			xfree(user->default_acct);
+			user->default_acct = xstrdup(assoc->acct);
+			debug2("user %s default acct is %s",
+			       user->name, user->default_acct);
 		}
-		list_iterator_destroy(user_itr);
 	}
 }
 
@@ -358,22 +627,14 @@ static void _set_user_default_wckey(slurmdb_wckey_rec_t *wckey)
 
 	/* set up the default if this is it */
 	if ((wckey->is_def == 1) && (wckey->uid != NO_VAL)) {
-		slurmdb_user_rec_t *user = NULL;
-		ListIterator user_itr =
-			list_iterator_create(assoc_mgr_user_list);
-		while ((user = list_next(user_itr))) {
-			if (user->uid != wckey->uid)
-				continue;
-			if (!user->default_wckey
-			    || strcmp(user->default_wckey, wckey->name)) {
-				xfree(user->default_wckey);
-				user->default_wckey = xstrdup(wckey->name);
-				debug2("user %s default wckey is %s",
-				       user->name, user->default_wckey);
-			}
-			break;
+		slurmdb_user_rec_t *user = _find_user_uid(wckey->uid);
+		if (user && (!user->default_wckey
+			     || strcmp(user->default_wckey, wckey->name))) {
+			xfree(user->default_wckey);
+			user->default_wckey = xstrdup(wckey->name);
+			debug2("user %s default wckey is %s",
+			       user->name, user->default_wckey);
 		}
-		list_iterator_destroy(user_itr);
 	}
 }
 
@@ -415,19 +676,15 @@ static int _set_assoc_parent_and_user(slurmdb_association_rec_t *assoc,
 			   && assoc->parent_id == last_acct_parent->id) {
 			assoc->usage->parent_assoc_ptr = last_acct_parent;
 		} else {
-			slurmdb_association_rec_t *assoc2 = NULL;
-			ListIterator itr = list_iterator_create(assoc_list);
-			while ((assoc2 = list_next(itr))) {
-				if (assoc2->id == assoc->parent_id) {
-					assoc->usage->parent_assoc_ptr = assoc2;
-					if (assoc->user)
-						last_parent = assoc2;
-					else
-						last_acct_parent = assoc2;
-					break;
-				}
+			slurmdb_association_rec_t *assoc2 =
+				_find_assoc_id(assoc->parent_id);
+			if (assoc2) {
+				assoc->usage->parent_assoc_ptr = assoc2;
+				if (assoc->user)
+					last_parent = assoc2;
+				else
+					last_acct_parent = assoc2;
 			}
-			list_iterator_destroy(itr);
 		}
 		if (assoc->usage->parent_assoc_ptr && setup_children) {
 			if (!assoc->usage->parent_assoc_ptr->usage)
@@ -534,6 +791,10 @@ static int _post_association_list(List assoc_list)
 	if (!assoc_list)
 		return SLURM_ERROR;
 
+	/* parents are found by id, the uids are only known after */
+	_index_build(&assoc_id_index, assoc_list);
+	assoc_mgr_assoc_update_cnt++;
+
 	itr = list_iterator_create(assoc_list);
 
 	//START_TIMER;
@@ -541,6 +802,7 @@ static int _post_association_list(List assoc_list)
 		_set_assoc_parent_and_user(assoc, assoc_list, reset);
 		reset = 0;
 	}
+	_index_build(&assoc_user_index, assoc_list);
 
 	if (setup_children) {
 		slurmdb_association_rec_t *assoc2 = NULL;
@@ -699,6 +961,8 @@ static int _get_assoc_mgr_association_list(void *db_conn, int enforce)
 		   isn't anything there */
 		assoc_mgr_association_list =
 			list_create(slurmdb_destroy_association_rec);
+		_build_assoc_index();
+		assoc_mgr_assoc_update_cnt++;
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("_get_assoc_mgr_association_list: "
@@ -728,6 +992,7 @@ static int _get_assoc_mgr_qos_list(void *db_conn, int enforce)
 	if (assoc_mgr_qos_list)
 		list_destroy(assoc_mgr_qos_list);
 	assoc_mgr_qos_list = acct_storage_g_get_qos(db_conn, uid, NULL);
+	_build_qos_index();
 
 	if (!assoc_mgr_qos_list) {
 		assoc_mgr_unlock(&locks);
@@ -761,6 +1026,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	assoc_mgr_user_list = acct_storage_g_get_users(db_conn, uid, &user_q);
 
 	if (!assoc_mgr_user_list) {
+		_build_user_index();
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("_get_assoc_mgr_user_list: "
@@ -772,6 +1038,7 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 	}
 
 	_post_user_list(assoc_mgr_user_list);
+	_build_user_index();
 
 	assoc_mgr_unlock(&locks);
 	return SLURM_SUCCESS;
@@ -837,7 +1104,6 @@ static int _refresh_assoc_mgr_association_list(void *db_conn, int enforce)
 	List current_assocs = NULL;
 	uid_t uid = getuid();
 	ListIterator curr_itr = NULL;
-	ListIterator assoc_mgr_itr = NULL;
 	slurmdb_association_rec_t *curr_assoc = NULL, *assoc = NULL;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
 				   NO_LOCK, WRITE_LOCK, NO_LOCK };
@@ -882,17 +1148,13 @@ static int _refresh_assoc_mgr_association_list(void *db_conn, int enforce)
 	}
 
 	curr_itr = list_iterator_create(current_assocs);
-	assoc_mgr_itr = list_iterator_create(assoc_mgr_association_list);
 
 	/* add used limits We only look for the user associations to
 	 * do the parents since a parent may have moved */
 	while ((curr_assoc = list_next(curr_itr))) {
 		if (!curr_assoc->user)
 			continue;
-		while ((assoc = list_next(assoc_mgr_itr))) {
-			if (assoc->id == curr_assoc->id)
-				break;
-		}
+		assoc = _find_assoc_id(curr_assoc->id);
 
 		while (assoc) {
 			_addto_used_info(assoc, curr_assoc);
@@ -900,11 +1162,9 @@ static int _refresh_assoc_mgr_association_list(void *db_conn, int enforce)
 			   different than the one we are updating from */
 			assoc = assoc->usage->parent_assoc_ptr;
 		}
-		list_iterator_reset(assoc_mgr_itr);
 	}
 
 	list_iterator_destroy(curr_itr);
-	list_iterator_destroy(assoc_mgr_itr);
 
 	assoc_mgr_unlock(&locks);
 
@@ -939,6 +1199,7 @@ static int _refresh_assoc_mgr_qos_list(void *db_conn, int enforce)
 		list_destroy(assoc_mgr_qos_list);
 
 	assoc_mgr_qos_list = current_qos;
+	_build_qos_index();
 
 	assoc_mgr_unlock(&locks);
 
@@ -974,6 +1235,7 @@ static int _refresh_assoc_mgr_user_list(void *db_conn, int enforce)
 		list_destroy(assoc_mgr_user_list);
 
 	assoc_mgr_user_list = current_users;
+	_build_user_index();
 
 	assoc_mgr_unlock(&locks);
 
@@ -1195,6 +1457,12 @@ extern int assoc_mgr_fini(char *state_save_location)
 	assoc_mgr_qos_list = NULL;
 	assoc_mgr_user_list = NULL;
 	assoc_mgr_wckey_list = NULL;
+	_index_free(&assoc_id_index);
+	_index_free(&assoc_user_index);
+	_index_free(&user_uid_index);
+	_index_free(&user_name_index);
+	_index_free(&qos_id_index);
+	_index_free(&qos_name_index);
 
 	assoc_mgr_unlock(&locks);
 
@@ -1357,9 +1625,9 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 				   int enforce,
 				   slurmdb_association_rec_t **assoc_pptr)
 {
-	ListIterator itr = NULL;
 	slurmdb_association_rec_t * found_assoc = NULL;
 	slurmdb_association_rec_t * ret_assoc = NULL;
+	uint32_t i, mask;
 	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
 
@@ -1432,15 +1700,20 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 /* 	     assoc->user, assoc->uid, assoc->acct, */
 /* 	     assoc->cluster, assoc->partition); */
 	assoc_mgr_lock(&locks);
-	itr = list_iterator_create(assoc_mgr_association_list);
-	while ((found_assoc = list_next(itr))) {
-		if (assoc->id) {
-			if (assoc->id == found_assoc->id) {
-				ret_assoc = found_assoc;
-				break;
-			}
-			continue;
-		} else {
+	if (assoc->id)
+		ret_assoc = _find_assoc_id(assoc->id);
+	else if (assoc_user_index.size) {
+		char *acct = assoc->acct ? assoc->acct : "";
+		char *key_acct = acct;
+		bool exact = false;
+
+		/* check every association hashed with this user and
+		 * account, which are all in this probe sequence, then
+		 * those with no account, which match any account */
+		mask = assoc_user_index.size - 1;
+probe:		i = _assoc_user_acct_hash_key(assoc->uid, key_acct) & mask;
+		for ( ; (found_assoc = assoc_user_index.slot[i]);
+		      i = (i + 1) & mask) {
 			if (assoc->uid == NO_VAL
 			    && found_assoc->uid != NO_VAL) {
 				debug3("we are looking for a "
@@ -1453,9 +1726,9 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 			}
 
 			if (found_assoc->acct
-			    && strcasecmp(assoc->acct, found_assoc->acct)) {
+			    && strcasecmp(acct, found_assoc->acct)) {
 				debug4("not the right account %s != %s",
-				       assoc->acct, found_assoc->acct);
+				       acct, found_assoc->acct);
 				continue;
 			}
 
@@ -1483,11 +1756,15 @@ extern int assoc_mgr_fill_in_assoc(void *db_conn,
 				       "looking for one without.");
 				continue;
 			}
+			ret_assoc = found_assoc;
+			exact = true;
+			break;
+		}
+		if (!exact && key_acct[0]) {
+			key_acct = "";
+			goto probe;
 		}
-		ret_assoc = found_assoc;
-		break;
 	}
-	list_iterator_destroy(itr);
 
 	if (!ret_assoc) {
 		assoc_mgr_unlock(&locks);
@@ -1589,7 +1866,6 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 				  int enforce,
 				  slurmdb_user_rec_t **user_pptr)
 {
-	ListIterator itr = NULL;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK,
 				   NO_LOCK, READ_LOCK, NO_LOCK };
@@ -1607,16 +1883,10 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (user->uid != NO_VAL) {
-			if (user->uid == found_user->uid)
-				break;
-		} else if (user->name
-			   && !strcasecmp(user->name, found_user->name))
-			break;
-	}
-	list_iterator_destroy(itr);
+	if (user->uid != NO_VAL)
+		found_user = _find_user_uid(user->uid);
+	else if (user->name)
+		found_user = _find_user_name(user->name);
 
 	if (!found_user) {
 		assoc_mgr_unlock(&locks);
@@ -1659,7 +1929,6 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 				 int enforce,
 				 slurmdb_qos_rec_t **qos_pptr)
 {
-	ListIterator itr = NULL;
 	slurmdb_qos_rec_t * found_qos = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK,
 				   READ_LOCK, NO_LOCK, NO_LOCK };
@@ -1677,14 +1946,9 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_qos_list);
-	while ((found_qos = list_next(itr))) {
-		if (qos->id == found_qos->id)
-			break;
-		else if (qos->name && !strcasecmp(qos->name, found_qos->name))
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_qos = _find_qos_id(qos->id);
+	if (!found_qos && qos->name)
+		found_qos = _find_qos_name(qos->name);
 
 	if (!found_qos) {
 		assoc_mgr_unlock(&locks);
@@ -1932,7 +2196,6 @@ extern int assoc_mgr_fill_in_wckey(void *db_conn, slurmdb_wckey_rec_t *wckey,
 extern slurmdb_admin_level_t assoc_mgr_get_admin_level(void *db_conn,
 						       uint32_t uid)
 {
-	ListIterator itr = NULL;
 	slurmdb_user_rec_t * found_user = NULL;
 	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK,
 				   NO_LOCK, READ_LOCK, NO_LOCK };
@@ -1947,12 +2210,7 @@ extern slurmdb_admin_level_t assoc_mgr_get_admin_level(void *db_conn,
 		return SLURMDB_ADMIN_NOTSET;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (uid == found_user->uid)
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_user = _find_user_uid(uid);
 	assoc_mgr_unlock(&locks);
 
 	if (found_user)
@@ -1984,13 +2242,7 @@ extern bool assoc_mgr_is_user_acct_coord(void *db_conn,
 		return false;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
-	while ((found_user = list_next(itr))) {
-		if (uid == found_user->uid)
-			break;
-	}
-	list_iterator_destroy(itr);
-
+	found_user = _find_user_uid(uid);
 	if (!found_user || !found_user->coord_accts) {
 		assoc_mgr_unlock(&locks);
 		return false;
@@ -2281,13 +2533,10 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 		}
 
 		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			if (object->id) {
-				if (object->id == rec->id) {
-					break;
-				}
-				continue;
-			} else {
+		if (object->id)
+			rec = _find_assoc_id(object->id);
+		else {
+			while ((rec = list_next(itr))) {
 				if (!object->user && rec->user) {
 					debug4("we are looking for a "
 					       "nonuser association");
@@ -2494,6 +2743,8 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 			if (object->is_def != 1)
 				object->is_def = 0;
 			list_append(assoc_mgr_association_list, object);
+			_index_add(&assoc_id_index, object);
+			_index_add(&assoc_user_index, object);
 			object = NULL;
 			parents_changed = 1; /* set since we need to
 						set the parent
@@ -2515,6 +2766,14 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 							set the shares
 							of surrounding children
 						     */
+			_index_remove(&assoc_id_index, rec);
+			_index_remove(&assoc_user_index, rec);
+			if (object->id) {
+				/* found in the index, move to it */
+				list_iterator_reset(itr);
+				while (list_next(itr) != rec)
+					;
+			}
 			if (remove_assoc_notify) {
 				/* since there are some deadlock
 				   issues while inside our lock here
@@ -2573,6 +2832,8 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 				object, assoc_mgr_association_list, reset);
 			reset = 0;
 		}
+		/* the uids of added associations are set just now */
+		_index_build(&assoc_user_index, assoc_mgr_association_list);
 		/* Now that we have set up the parents correctly we
 		   can update the used limits
 		*/
@@ -2626,6 +2887,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update)
 			assoc_mgr_association_list);
 
 	list_iterator_destroy(itr);
+	assoc_mgr_assoc_update_cnt++;
 	assoc_mgr_unlock(&locks);
 
 	/* This needs to happen outside of the
@@ -2791,16 +3053,10 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 
 	itr = list_iterator_create(assoc_mgr_user_list);
 	while ((object = list_pop(update->objects))) {
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			char *name;
-			if (object->old_name)
-				name = object->old_name;
-			else
-				name = object->name;
-			if (!strcasecmp(name, rec->name))
-				break;
-		}
+		if (object->old_name)
+			rec = _find_user_name(object->old_name);
+		else
+			rec = _find_user_name(object->name);
 
 		//info("%d user %s", update->type, object->name);
 		switch(update->type) {
@@ -2817,11 +3073,15 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 					      rec->name);
 					break;
 				}
+				_index_remove(&user_uid_index, rec);
+				_index_remove(&user_name_index, rec);
 				xfree(rec->old_name);
 				rec->old_name = rec->name;
 				rec->name = object->name;
 				object->name = NULL;
 				rc = _change_user_name(rec);
+				_index_add(&user_uid_index, rec);
+				_index_add(&user_name_index, rec);
 			}
 
 			if (object->default_acct) {
@@ -2852,6 +3112,8 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 			} else
 				object->uid = pw_uid;
 			list_append(assoc_mgr_user_list, object);
+			_index_add(&user_uid_index, object);
+			_index_add(&user_name_index, object);
 			object = NULL;
 			break;
 		case SLURMDB_REMOVE_USER:
@@ -2859,6 +3121,11 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update)
 				//rc = SLURM_ERROR;
 				break;
 			}
+			_index_remove(&user_uid_index, rec);
+			_index_remove(&user_name_index, rec);
+			list_iterator_reset(itr);
+			while (list_next(itr) != rec)
+				;
 			list_delete_item(itr);
 			break;
 		case SLURMDB_ADD_COORD:
@@ -3169,6 +3436,8 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update)
 		_post_qos_list(assoc_mgr_qos_list);
 
 	list_iterator_destroy(itr);
+	/* there are few QOS, just index them again */
+	_build_qos_index();
 
 	assoc_mgr_unlock(&locks);
 
@@ -3197,7 +3466,6 @@ extern int assoc_mgr_validate_assoc_id(void *db_conn,
 				       uint32_t assoc_id,
 				       int enforce)
 {
-	ListIterator itr = NULL;
 	slurmdb_association_rec_t * found_assoc = NULL;
 	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
@@ -3218,12 +3486,7 @@ extern int assoc_mgr_validate_assoc_id(void *db_conn,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_association_list);
-	while ((found_assoc = list_next(itr))) {
-		if (assoc_id == found_assoc->id)
-			break;
-	}
-	list_iterator_destroy(itr);
+	found_assoc = _find_assoc_id(assoc_id);
 	assoc_mgr_unlock(&locks);
 
 	if (found_assoc || !(enforce & ACCOUNTING_ENFORCE_ASSOCS))
@@ -3574,7 +3837,6 @@ extern int load_assoc_usage(char *state_save_location)
 	char *data = NULL, *state_file;
 	Buf buffer;
 	time_t buf_time;
-	ListIterator itr = NULL;
 	assoc_mgr_lock_t locks = { WRITE_LOCK, READ_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
 
@@ -3629,7 +3891,6 @@ extern int load_assoc_usage(char *state_save_location)
 
 	safe_unpack_time(&buf_time, buffer);
 
-	itr = list_iterator_create(assoc_mgr_association_list);
 	while (remaining_buf(buffer) > 0) {
 		uint32_t assoc_id = 0;
 		uint32_t grp_used_wall = 0;
@@ -3639,9 +3900,7 @@ extern int load_assoc_usage(char *state_save_location)
 		safe_unpack32(&assoc_id, buffer);
 		safe_unpack64(&usage_raw, buffer);
 		safe_unpack32(&grp_used_wall, buffer);
-		while ((assoc = list_next(itr)))
-			if (assoc->id == assoc_id)
-				break;
+		assoc = _find_assoc_id(assoc_id);
 
 		/* We want to do this all the way up to and including
 		   root.  This way we can keep track of how much usage
@@ -3654,9 +3913,8 @@ extern int load_assoc_usage(char *state_save_location)
 
 			assoc = assoc->usage->parent_assoc_ptr;
 		}
-		list_iterator_reset(itr);
 	}
-	list_iterator_destroy(itr);
+	assoc_mgr_assoc_update_cnt++;
 	assoc_mgr_unlock(&locks);
 
 	free_buf(buffer);
@@ -3665,8 +3923,6 @@ extern int load_assoc_usage(char *state_save_location)
 unpack_error:
 	if (buffer)
 		free_buf(buffer);
-	if (itr)
-		list_iterator_destroy(itr);
 	assoc_mgr_unlock(&locks);
 	return SLURM_ERROR;
 }
@@ -3868,6 +4124,7 @@ extern int load_assoc_mgr_state(char *state_save_location)
 				list_destroy(assoc_mgr_user_list);
 			assoc_mgr_user_list = msg->my_list;
 			_post_user_list(assoc_mgr_user_list);
+			_build_user_index();
 			debug("Recovered %u users",
 			      list_count(assoc_mgr_user_list));
 			msg->my_list = NULL;
@@ -3886,6 +4143,7 @@ extern int load_assoc_mgr_state(char *state_save_location)
 				list_destroy(assoc_mgr_qos_list);
 			assoc_mgr_qos_list = msg->my_list;
 			_post_qos_list(assoc_mgr_qos_list);
+			_build_qos_index();
 			debug("Recovered %u qos",
 			      list_count(assoc_mgr_qos_list));
 			msg->my_list = NULL;
@@ -3986,6 +4244,7 @@ extern int assoc_mgr_set_missing_uids()
 			}
 		}
 		list_iterator_destroy(itr);
+		_index_build(&assoc_user_index, assoc_mgr_association_list);
 	}
 
 	if (assoc_mgr_wckey_list) {
@@ -4020,6 +4279,7 @@ extern int assoc_mgr_set_missing_uids()
 			}
 		}
 		list_iterator_destroy(itr);
+		_build_user_index();
 	}
 	assoc_mgr_unlock(&locks);
 
@@ -171,6 +171,9 @@ extern slurmdb_association_rec_t *assoc_mgr_root_assoc;
 
 extern uint32_t g_qos_max_priority; /* max priority in all qos's */
 extern uint32_t g_qos_count; /* count used for generating qos bitstr's */
+extern uint32_t assoc_mgr_assoc_update_cnt; /* incremented when associations
+					     * or their usage are loaded or
+					     * updated, under the assoc lock */
 
 
 extern int assoc_mgr_init(void *db_conn, assoc_init_args_t *args,
@@ -88,14 +88,28 @@
 	assert((bit) < _bitstr_bits(name)); 	\
 } while (0)
 
-/*
- * external macros
- */
+/* unsigned type of a bitstring word, for word at a time operations */
+#ifdef USE_64BIT_BITSTR
+typedef uint64_t bitword_t;
+#else
+typedef uint32_t bitword_t;
+#endif
 
-/* allocate a bitstring on the stack */
-/* XXX bit_decl does not check if nbits overflows word 1 */
-#define	bit_decl(name, nbits) \
-	(name)[_bitstr_words(nbits)] = { BITSTR_MAGIC_STACK, (nbits) }
+/* bits in a bitstring word */
+#define	BITSTR_WORD_BITS	(BITSTR_MAXPOS + 1)
+
+/* mask for bits 0 ... n-1 within a word, 0 < n < BITSTR_WORD_BITS */
+#ifdef SLURM_BIGENDIAN
+#define	_bit_nmask(n)	((bitword_t) ~((~(bitword_t) 0) >> (n)))
+#else
+#define	_bit_nmask(n)	((((bitword_t) 1) << (n)) - 1)
+#endif
+
+/* mask for the valid bits in the last word of a bitstring, 0 if all of the
+ * last word's bits are valid */
+#define	_bit_tail_mask(name) \
+	((_bitstr_bits(name) & BITSTR_MAXPOS) ? \
+	 _bit_nmask(_bitstr_bits(name) & BITSTR_MAXPOS) : 0)
 
 /*
  * Define slurm-specific aliases for use by plugins, see slurm_xlator.h
@@ -113,6 +127,7 @@ strong_alias(bit_free,		slurm_bit_free);
 strong_alias(bit_realloc,	slurm_bit_realloc);
 strong_alias(bit_size,		slurm_bit_size);
 strong_alias(bit_and,		slurm_bit_and);
+strong_alias(bit_and_not,	slurm_bit_and_not);
 strong_alias(bit_not,		slurm_bit_not);
 strong_alias(bit_or,		slurm_bit_or);
 strong_alias(bit_set_count,	slurm_bit_set_count);
@@ -132,7 +147,9 @@ strong_alias(bit_fls,		slurm_bit_fls);
 strong_alias(bit_fill_gaps,	slurm_bit_fill_gaps);
 strong_alias(bit_super_set,	slurm_bit_super_set);
 strong_alias(bit_overlap,	slurm_bit_overlap);
+strong_alias(bit_overlap_any,	slurm_bit_overlap_any);
 strong_alias(bit_equal,		slurm_bit_equal);
+strong_alias(bit_hash,		slurm_bit_hash);
 strong_alias(bit_copy,		slurm_bit_copy);
 strong_alias(bit_pick_cnt,	slurm_bit_pick_cnt);
 strong_alias(bit_nffc,		slurm_bit_nffc);
@@ -298,6 +315,80 @@ bit_nclear(bitstr_t *b, bitoff_t start, bitoff_t stop)
 	}
 }
 
+/*
+ * Word primitives. Use the compiler's bit scan and population count
+ * builtins where available, these compile to single instructions on CPUs
+ * which have them (e.g. when built with -mpopcnt or a suitable -march).
+ */
+#if defined(__GNUC__)
+#  ifdef USE_64BIT_BITSTR
+#    define _bit_popcount(w)	__builtin_popcountll(w)
+#    define _bit_ctz(w)		__builtin_ctzll(w)
+#    define _bit_clz(w)		__builtin_clzll(w)
+#  else
+#    define _bit_popcount(w)	__builtin_popcount(w)
+#    define _bit_ctz(w)		__builtin_ctz(w)
+#    define _bit_clz(w)		__builtin_clz(w)
+#  endif
+#endif
+
+/*
+ * Returns the hamming weight (i.e. the number of bits set) in a word.
+ */
+static inline int
+_word_popcount(bitword_t w)
+{
+#ifdef _bit_popcount
+	return _bit_popcount(w);
+#else
+	int cnt;
+
+	for (cnt = 0; w; cnt++)
+		w &= (w - 1);		/* clear lowest bit set */
+	return cnt;
+#endif
+}
+
+/*
+ * Returns position within its word of the first (lowest numbered) bit set
+ * in a word, w must not be zero.
+ */
+static inline int
+_word_ffs(bitword_t w)
+{
+#if defined(_bit_ctz) && defined(SLURM_BIGENDIAN)
+	return _bit_clz(w);
+#elif defined(_bit_ctz)
+	return _bit_ctz(w);
+#else
+	int pos;
+
+	for (pos = 0; !(w & (bitword_t) _bit_mask(pos)); pos++)
+		;
+	return pos;
+#endif
+}
+
+/*
+ * Returns position within its word of the last (highest numbered) bit set
+ * in a word, w must not be zero.
+ */
+static inline int
+_word_fls(bitword_t w)
+{
+#if defined(_bit_clz) && defined(SLURM_BIGENDIAN)
+	return BITSTR_MAXPOS - _bit_ctz(w);
+#elif defined(_bit_clz)
+	return BITSTR_MAXPOS - _bit_clz(w);
+#else
+	int pos;
+
+	for (pos = BITSTR_MAXPOS; !(w & (bitword_t) _bit_mask(pos)); pos--)
+		;
+	return pos;
+#endif
+}
+
 /*
  * Find first bit clear in bitstring.
  *   b (IN)		bitstring to search
@@ -307,26 +398,21 @@ bit_nclear(bitstr_t *b, bitoff_t start, bitoff_t stop)
 bitoff_t
 bit_ffc(bitstr_t *b)
 {
-	bitoff_t bit = 0, value = -1;
+	bitoff_t bit, nbits, word, words;
+	bitword_t w;
 
 	_assert_bitstr_valid(b);
 
-	while (bit < _bitstr_bits(b) && value == -1) {
-		int32_t word = _bit_word(bit);
-
-		if (b[word] == BITSTR_MAXPOS) {
-			bit += sizeof(bitstr_t)*8;
+	nbits = _bitstr_bits(b);
+	words = _bitstr_words(nbits);
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		w = ~((bitword_t) b[word]);
+		if (w == 0)
 			continue;
-		}
-		while (bit < _bitstr_bits(b) && _bit_word(bit) == word) {
-			if (!bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit++;
-		}
+		bit = ((word - BITSTR_OVERHEAD) << BITSTR_SHIFT) + _word_ffs(w);
+		return (bit < nbits) ? bit : -1;
 	}
-	return value;
+	return -1;
 }
 
 /* Find the first n contiguous bits clear in b.
@@ -446,26 +532,20 @@ bit_nffs(bitstr_t *b, int32_t n)
 bitoff_t
 bit_ffs(bitstr_t *b)
 {
-	bitoff_t bit = 0, value = -1;
+	bitoff_t bit, nbits, word, words;
 
 	_assert_bitstr_valid(b);
 
-	while (bit < _bitstr_bits(b) && value == -1) {
-		int32_t word = _bit_word(bit);
-
-		if (b[word] == 0) {
-			bit += sizeof(bitstr_t)*8;
+	nbits = _bitstr_bits(b);
+	words = _bitstr_words(nbits);
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		if (b[word] == 0)
 			continue;
-		}
-		while (bit < _bitstr_bits(b) && _bit_word(bit) == word) {
-			if (bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit++;
-		}
+		bit = ((word - BITSTR_OVERHEAD) << BITSTR_SHIFT) +
+		      _word_ffs((bitword_t) b[word]);
+		return (bit < nbits) ? bit : -1;
 	}
-	return value;
+	return -1;
 }
 
 /*
@@ -476,39 +556,29 @@ bit_ffs(bitstr_t *b)
 bitoff_t
 bit_fls(bitstr_t *b)
 {
-	bitoff_t bit, value = -1;
-	int32_t word;
+	bitoff_t word;
+	bitword_t w, tail_mask;
 
 	_assert_bitstr_valid(b);
 
 	if (_bitstr_bits(b) == 0)	/* empty bitstring */
 		return -1;
 
-	bit = _bitstr_bits(b) - 1;	/* zero origin */
-
-	while (bit >= 0 && 		/* test partitial words */
-		(_bit_word(bit) == _bit_word(bit + 1))) {
-		if (bit_test(b, bit)) {
-			value = bit;
-			break;
-		}
-		bit--;
-	}
-	while (bit >= 0 && value == -1) {	/* test whole words */
-		word = _bit_word(bit);
-		if (b[word] == 0) {
-			bit -= sizeof(bitstr_t) * 8;
-			continue;
-		}
-		while (bit >= 0) {
-			if (bit_test(b, bit)) {
-				value = bit;
-				break;
-			}
-			bit--;
+	word = _bitstr_words(_bitstr_bits(b)) - 1;
+	tail_mask = _bit_tail_mask(b);
+	w = (bitword_t) b[word];
+	if (tail_mask)			/* ignore bits past the end */
+		w &= tail_mask;
+	while (1) {
+		if (w) {
+			return ((word - BITSTR_OVERHEAD) << BITSTR_SHIFT) +
+			       _word_fls(w);
 		}
+		if (--word < BITSTR_OVERHEAD)
+			break;
+		w = (bitword_t) b[word];
 	}
-	return value;
+	return -1;
 }
 
 /*
@@ -538,15 +608,15 @@ bit_fill_gaps(bitstr_t *b)
 int
 bit_super_set(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != (b1[_bit_word(bit)] &
-		                           b2[_bit_word(bit)]))
+	words = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		if (b1[word] & ~b2[word])
 			return 0;
 	}
 
@@ -559,7 +629,7 @@ bit_super_set(bitstr_t *b1, bitstr_t *b2)
 extern int
 bit_equal(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
@@ -567,14 +637,45 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 	if (_bitstr_bits(b1) != _bitstr_bits(b2))
 		return 0;
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8) {
-		if (b1[_bit_word(bit)] != b2[_bit_word(bit)])
+	words = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		if (b1[word] != b2[word])
 			return 0;
 	}
 
 	return 1;
 }
 
+/*
+ * return a hash of the size and contents of b, equal bitstrings (see
+ * bit_equal) have equal hashes
+ */
+extern uint32_t
+bit_hash(bitstr_t *b)
+{
+	bitoff_t word, words;
+	uint64_t val;
+	uint32_t hash = 2166136261U;	/* FNV-1a */
+
+	_assert_bitstr_valid(b);
+
+	hash = (hash ^ (uint32_t) _bitstr_bits(b)) * 16777619U;
+	words = _bitstr_words(_bitstr_bits(b));
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		val = (uint64_t) b[word];
+		hash = (hash ^ (uint32_t) val) * 16777619U;
+		hash = (hash ^ (uint32_t) (val >> 32)) * 16777619U;
+	}
+	/* mix the high bits into the low bits used to index hash tables */
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bU;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35U;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
 
 
 /*
@@ -585,14 +686,34 @@ bit_equal(bitstr_t *b1, bitstr_t *b2)
 void
 bit_and(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] &= b2[_bit_word(bit)];
+	words = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		b1[word] &= b2[word];
+}
+
+/*
+ * b1 &= ~b2, without modifying b2 or a temporary copy of it
+ *   b1 (IN/OUT)	first string
+ *   b2 (IN)		second bitstring
+ */
+void
+bit_and_not(bitstr_t *b1, bitstr_t *b2)
+{
+	bitoff_t word, words;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	words = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		b1[word] &= ~b2[word];
 }
 
 /*
@@ -602,12 +723,13 @@ bit_and(bitstr_t *b1, bitstr_t *b2)
 void
 bit_not(bitstr_t *b)
 {
-	bitoff_t bit;
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b);
 
-	for (bit = 0; bit < _bitstr_bits(b); bit += sizeof(bitstr_t)*8)
-		b[_bit_word(bit)] = ~b[_bit_word(bit)];
+	words = _bitstr_words(_bitstr_bits(b));
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		b[word] = ~b[word];
 }
 
 /*
@@ -618,14 +740,15 @@ bit_not(bitstr_t *b)
 void
 bit_or(bitstr_t *b1, bitstr_t *b2)
 {
-	bitoff_t bit;
+	bitoff_t word, words;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	for (bit = 0; bit < _bitstr_bits(b1); bit += sizeof(bitstr_t)*8)
-		b1[_bit_word(bit)] |= b2[_bit_word(bit)];
+	words = _bitstr_words(_bitstr_bits(b1));
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		b1[word] |= b2[word];
 }
 
 
@@ -664,44 +787,6 @@ bit_copybits(bitstr_t *dest, bitstr_t *src)
 	memcpy(&dest[BITSTR_OVERHEAD], &src[BITSTR_OVERHEAD], len);
 }
 
-#if !defined(USE_64BIT_BITSTR)
-/*
- * Returns the hamming weight (i.e. the number of bits set) in a word.
- * NOTE: This routine borrowed from Linux 2.4.9 <linux/bitops.h>.
- */
-static uint32_t
-hweight(uint32_t w)
-{
-	uint32_t res;
-
-	res = (w   & 0x55555555) + ((w >> 1)    & 0x55555555);
-	res = (res & 0x33333333) + ((res >> 2)  & 0x33333333);
-	res = (res & 0x0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F);
-	res = (res & 0x00FF00FF) + ((res >> 8)  & 0x00FF00FF);
-	res = (res & 0x0000FFFF) + ((res >> 16) & 0x0000FFFF);
-
-	return res;
-}
-#else
-/*
- * A 64 bit version crafted from 32-bit one borrowed above.
- */
-static uint64_t
-hweight(uint64_t w)
-{
-	uint64_t res;
-
-	res = (w   & 0x5555555555555555) + ((w >> 1)    & 0x5555555555555555);
-	res = (res & 0x3333333333333333) + ((res >> 2)  & 0x3333333333333333);
-	res = (res & 0x0F0F0F0F0F0F0F0F) + ((res >> 4)  & 0x0F0F0F0F0F0F0F0F);
-	res = (res & 0x00FF00FF00FF00FF) + ((res >> 8)  & 0x00FF00FF00FF00FF);
-	res = (res & 0x0000FFFF0000FFFF) + ((res >> 16) & 0x0000FFFF0000FFFF);
-	res = (res & 0x00000000FFFFFFFF) + ((res >> 32) & 0x00000000FFFFFFFF);
-
-	return res;
-}
-#endif /* !USE_64BIT_BITSTR */
-
 /*
  * Count the number of bits set in bitstring.
  *   b (IN)		bitstring to check
@@ -711,19 +796,19 @@ int32_t
 bit_set_count(bitstr_t *b)
 {
 	int32_t count = 0;
-	bitoff_t bit, bit_cnt;
-	int32_t word_size = sizeof(bitstr_t) * 8;
+	bitoff_t word, words;
+	bitword_t tail_mask;
 
 	_assert_bitstr_valid(b);
 
-	bit_cnt = _bitstr_bits(b);
-	for (bit = 0; (bit + word_size) <= bit_cnt; bit += word_size) {
-		count += hweight(b[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
-		if (bit_test(b, bit))
-			count++;
-	}
+	words = _bitstr_words(_bitstr_bits(b));
+	tail_mask = _bit_tail_mask(b);
+	if (tail_mask)
+		words--;
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		count += _word_popcount((bitword_t) b[word]);
+	if (tail_mask)
+		count += _word_popcount((bitword_t) b[word] & tail_mask);
 	return count;
 }
 
@@ -737,26 +822,29 @@ bit_set_count(bitstr_t *b)
 int32_t
 bit_set_count_range(bitstr_t *b, int32_t start, int32_t end)
 {
-	int32_t count = 0, eow;
-	bitoff_t bit;
-	const int32_t word_size = sizeof(bitstr_t) * 8;
+	int32_t count = 0;
+	bitoff_t word, end_word;
+	bitword_t w;
 
 	_assert_bitstr_valid(b);
 	_assert_bit_valid(b,start);
 
 	end = MIN(end, _bitstr_bits(b));
-	eow = ((start+word_size-1)/word_size) * word_size;  /* end of word */
-	for ( bit = start; bit < end && bit < eow; bit++) {
-		if (bit_test(b, bit))
-			count++;
-	}
-	for (; (bit + word_size) <= end ; bit += word_size) {
-		count += hweight(b[_bit_word(bit)]);
-	}
-	for ( ; bit < end; bit++) {
-		if (bit_test(b, bit))
-			count++;
+	if (end <= start)
+		return 0;
+
+	word = _bit_word(start);
+	end_word = _bit_word(end - 1);
+	w = (bitword_t) b[word];
+	if (start & BITSTR_MAXPOS)	/* skip bits before start */
+		w &= ~_bit_nmask(start & BITSTR_MAXPOS);
+	while (word < end_word) {
+		count += _word_popcount(w);
+		w = (bitword_t) b[++word];
 	}
+	if (end & BITSTR_MAXPOS)	/* skip bits from end on */
+		w &= _bit_nmask(end & BITSTR_MAXPOS);
+	count += _word_popcount(w);
 
 	return count;
 }
@@ -768,27 +856,55 @@ extern int32_t
 bit_overlap(bitstr_t *b1, bitstr_t *b2)
 {
 	int32_t count = 0;
-	bitoff_t bit, bit_cnt;
-	int32_t word_size = sizeof(bitstr_t) * 8;
+	bitoff_t word, words;
+	bitword_t tail_mask;
 
 	_assert_bitstr_valid(b1);
 	_assert_bitstr_valid(b2);
 	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
 
-	bit_cnt = _bitstr_bits(b1);
-	for (bit = 0; bit < bit_cnt; bit += word_size) {
-		if ((bit + word_size - 1) >= bit_cnt)
-			break;
-		count += hweight(b1[_bit_word(bit)] & b2[_bit_word(bit)]);
-	}
-	for ( ; bit < bit_cnt; bit++) {
-		if (bit_test(b1, bit) && bit_test(b2, bit))
-			count++;
+	words = _bitstr_words(_bitstr_bits(b1));
+	tail_mask = _bit_tail_mask(b1);
+	if (tail_mask)
+		words--;
+	for (word = BITSTR_OVERHEAD; word < words; word++)
+		count += _word_popcount((bitword_t) (b1[word] & b2[word]));
+	if (tail_mask) {
+		count += _word_popcount((bitword_t) (b1[word] & b2[word]) &
+					tail_mask);
 	}
 
 	return count;
 }
 
+/*
+ * return 1 if any bit set in b1 is also set in b2, 0 if no overlap.
+ * Faster than bit_overlap() when the count is not needed.
+ */
+extern int
+bit_overlap_any(bitstr_t *b1, bitstr_t *b2)
+{
+	bitoff_t word, words;
+	bitword_t tail_mask;
+
+	_assert_bitstr_valid(b1);
+	_assert_bitstr_valid(b2);
+	assert(_bitstr_bits(b1) == _bitstr_bits(b2));
+
+	words = _bitstr_words(_bitstr_bits(b1));
+	tail_mask = _bit_tail_mask(b1);
+	if (tail_mask)
+		words--;
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		if (b1[word] & b2[word])
+			return 1;
+	}
+	if (tail_mask && ((bitword_t) (b1[word] & b2[word]) & tail_mask))
+		return 1;
+
+	return 0;
+}
+
 /*
  * Count the number of bits clear in bitstring.
  *   b (IN)		bitstring to check
@@ -930,7 +1046,7 @@ bit_pick_cnt(bitstr_t *b, bitoff_t nbits)
 			continue;
 		}
 
-		new_bits = hweight(b[word]);
+		new_bits = _word_popcount((bitword_t) b[word]);
 		if (((count + new_bits) <= nbits) &&
 		    ((bit + word_size - 1) < _bitstr_bits(b))) {
 			new[word] = b[word];
@@ -1300,26 +1416,33 @@ void bit_unfmt_binmask(bitstr_t * bitmap, const char* str)
 bitoff_t
 bit_get_bit_num(bitstr_t *b, int32_t pos)
 {
-	bitoff_t bit;
-	int32_t cnt = 0;
-	bitoff_t bit_cnt;
+	bitoff_t word, words, bit;
+	int32_t cnt = 0, word_cnt;
+	bitword_t w;
 
 	_assert_bitstr_valid(b);
-	bit_cnt = _bitstr_bits(b);
-	assert(pos <= bit_cnt);
-
-	for (bit = 0; bit < bit_cnt; bit++) {
-		if (bit_test(b, bit)) {	/* we got one */
+	assert(pos <= _bitstr_bits(b));
+
+	words = _bitstr_words(_bitstr_bits(b));
+	for (word = BITSTR_OVERHEAD; word < words; word++) {
+		w = (bitword_t) b[word];
+		word_cnt = _word_popcount(w);
+		if ((cnt + word_cnt) <= pos) {	/* skip whole word */
+			cnt += word_cnt;
+			continue;
+		}
+		while (1) {
+			bit = _word_ffs(w);
 			if (cnt == pos)
 				break;
+			w &= ~((bitword_t) _bit_mask(bit));
 			cnt++;
 		}
+		bit += (word - BITSTR_OVERHEAD) << BITSTR_SHIFT;
+		return (bit < _bitstr_bits(b)) ? bit : -1;
 	}
 
-	if (bit >= bit_cnt)
-		bit = -1;
-
-	return bit;
+	return -1;
 }
 
 /* Find want nth the bit pos is set in bitstr b.
@@ -1331,13 +1454,8 @@ bit_get_bit_num(bitstr_t *b, int32_t pos)
 int32_t
 bit_get_pos_num(bitstr_t *b, bitoff_t pos)
 {
-	bitoff_t bit;
-	int32_t cnt = -1;
-	bitoff_t bit_cnt;
-
 	_assert_bitstr_valid(b);
-	bit_cnt = _bitstr_bits(b);
-	assert(pos <= bit_cnt);
+	assert(pos <= _bitstr_bits(b));
 
 	if (!bit_test(b, pos)) {
 #ifdef	USE_64BIT_BITSTR
@@ -1345,14 +1463,8 @@ bit_get_pos_num(bitstr_t *b, bitoff_t pos)
 #else
 		error("bit %d not set", pos);
 #endif
-		return cnt;
-	}
-	for (bit = 0; bit <= pos; bit++) {
-		if (bit_test(b, bit)) {	/* we got one */
-			cnt++;
-		}
+		return -1;
 	}
 
-	return cnt;
+	return bit_set_count_range(b, 0, pos + 1) - 1;
 }
-
@@ -94,7 +94,8 @@ void _destroy_tree_fwd(fwd_tree_t *fwd_tree)
 void *_forward_thread(void *arg)
 {
 	forward_msg_t *fwd_msg = (forward_msg_t *)arg;
-	Buf buffer = init_buf(fwd_msg->buf_len);
+	Buf buffer = init_buf(BUF_SIZE);	/* header only */
+	struct iovec iov[2];
 	List ret_list = NULL;
 	slurm_fd_t fd = -1;
 	ret_data_info_t *ret_data_info = NULL;
@@ -148,26 +149,21 @@ void *_forward_thread(void *arg)
 		} else
 			debug3("forward: send to %s ", name);
 
+		set_buf_offset(buffer, 0);
 		pack_header(&fwd_msg->header, buffer);
 
-		/* add forward data to buffer */
-		if (remaining_buf(buffer) < fwd_msg->buf_len) {
-			buffer->size += (fwd_msg->buf_len + BUF_SIZE);
-			xrealloc(buffer->head, buffer->size);
-		}
-		if (fwd_msg->buf_len) {
-			memcpy(&buffer->head[buffer->processed],
-			       fwd_msg->buf, fwd_msg->buf_len);
-			buffer->processed += fwd_msg->buf_len;
-		}
-
 		/*
-		 * forward message
+		 * forward message, the data shared by all forward threads
+		 * is sent after this hop's header rather than copied
 		 */
-		if (_slurm_msg_sendto(fd,
-				     get_buf_data(buffer),
-				     get_buf_offset(buffer),
-				     SLURM_PROTOCOL_NO_SEND_RECV_FLAGS ) < 0) {
+		iov[0].iov_base = get_buf_data(buffer);
+		iov[0].iov_len  = get_buf_offset(buffer);
+		iov[1].iov_base = fwd_msg->buf;
+		iov[1].iov_len  = fwd_msg->buf_len;
+		if (_slurm_msg_sendv_timeout(fd, iov, 2,
+					     SLURM_PROTOCOL_NO_SEND_RECV_FLAGS,
+					     (slurm_get_msg_timeout() * 1000))
+		    < 0) {
 			error("forward_thread: slurm_msg_sendto: %m");
 
 			slurm_mutex_lock(fwd_msg->forward_mutex);
@@ -175,8 +171,6 @@ void *_forward_thread(void *arg)
 					       errno);
 			free(name);
 			if (hostlist_count(hl) > 0) {
-				free_buf(buffer);
-				buffer = init_buf(fwd_msg->buf_len);
 				slurm_mutex_unlock(fwd_msg->forward_mutex);
 				slurm_close_accepted_conn(fd);
 				fd = -1;
@@ -230,8 +224,6 @@ void *_forward_thread(void *arg)
 			if (ret_list)
 				list_destroy(ret_list);
 			if (hostlist_count(hl) > 0) {
-				free_buf(buffer);
-				buffer = init_buf(fwd_msg->buf_len);
 				slurm_mutex_unlock(fwd_msg->forward_mutex);
 				slurm_close_accepted_conn(fd);
 				fd = -1;
@@ -515,7 +507,8 @@ extern int forward_msg(forward_struct_t *forward_struct,
 		       sizeof(slurm_addr_t));
 
 		forward_msg->header.version = header->version;
-		forward_msg->header.flags = header->flags;
+		/* Only the first hop of a message may be kept open */
+		forward_msg->header.flags = header->flags & ~SLURM_PERSIST_REQ;
 		forward_msg->header.msg_type = header->msg_type;
 		forward_msg->header.body_length = header->body_length;
 		forward_msg->header.ret_list = NULL;
@@ -742,7 +735,7 @@ void destroy_forward(forward_t *forward)
 void destroy_forward_struct(forward_struct_t *forward_struct)
 {
 	if (forward_struct) {
-		xfree(forward_struct->buf);
+		xfree(forward_struct->buf_head);
 		xfree(forward_struct->forward_msg);
 		slurm_mutex_destroy(&forward_struct->forward_mutex);
 		pthread_cond_destroy(&forward_struct->notify);
@@ -70,11 +70,15 @@ extern void forward_init(forward_t *forward, forward_t *from);
 // Set up the forward_struct using the remainder of the buffer being received,
 // right after header has been removed form the original buffer
 
+// The message body is not copied: buf points into the received buffer,
+// whose data is then owned (and freed) by the forward_struct through
+// buf_head. The receive buffer must be freed without its data, see
+// _free_recv_buf().
+
 forward_struct = xmalloc(sizeof(forward_struct_t));
 forward_struct->buf_len = remaining_buf(buffer);
-forward_struct->buf = xmalloc(sizeof(char) * forward_struct->buf_len);
-memcpy(forward_struct->buf, &buffer->head[buffer->processed],
-       forward_struct->buf_len);
+forward_struct->buf = &buffer->head[buffer->processed];
+forward_struct->buf_head = buffer->head;
 forward_struct->ret_list = ret_list;
 
 forward_struct->timeout = timeout - header.forward.timeout;
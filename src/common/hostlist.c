@@ -258,6 +258,12 @@ struct hostlist {
 	/* list of iterators */
 	struct hostlist_iterator *ilist;
 
+	/* hostlist_find() index: 1 if the ranges are in sorted order with no
+	 * overlap and find_cnt holds the count of hosts before each range,
+	 * -1 if not, 0 if not yet known */
+	int find_state;
+	int *find_cnt;
+
 };
 
 
@@ -1345,6 +1351,8 @@ static hostlist_t hostlist_new(void)
 	new->nranges = 0;
 	new->nhosts = 0;
 	new->ilist = NULL;
+	new->find_state = 0;
+	new->find_cnt = NULL;
 	return new;
 
 fail2:
@@ -1354,6 +1362,14 @@ fail1:
 }
 
 
+/* Forget the hostlist_find() index once the ranges of hl are changed.
+ * Assumes that hostlist hl is locked by caller
+ */
+static inline void hostlist_find_reset(hostlist_t hl)
+{
+	hl->find_state = 0;
+}
+
 /* Resize the internal array used to store the list of hostrange objects.
  *
  * returns 1 for a successful resize,
@@ -1379,12 +1395,14 @@ static int hostlist_resize(hostlist_t hl, size_t newsize)
 	return 1;
 }
 
-/* Resize hostlist by one HOSTLIST_CHUNK
+/* Resize hostlist by at least one HOSTLIST_CHUNK
  * Assumes that hostlist hl is locked by caller
  */
 static int hostlist_expand(hostlist_t hl)
 {
-	if (!hostlist_resize(hl, hl->size + HOSTLIST_CHUNK))
+	/* Grow geometrically so that pushing many ranges one at a time
+	 * does not copy the array each HOSTLIST_CHUNK ranges */
+	if (!hostlist_resize(hl, hl->size + MAX(hl->size, HOSTLIST_CHUNK)))
 		return 0;
 	else
 		return 1;
@@ -1401,6 +1419,7 @@ static int hostlist_push_range(hostlist_t hl, hostrange_t hr)
 
 	assert(hr != NULL);
 	LOCK_HOSTLIST(hl);
+	hostlist_find_reset(hl);
 
 	tail = (hl->nranges > 0) ? hl->hr[hl->nranges-1] : hl->hr[0];
 
@@ -1464,6 +1483,7 @@ static int hostlist_insert_range(hostlist_t hl, hostrange_t hr, int n)
 	if (hl->size == hl->nranges && !hostlist_expand(hl))
 		return 0;
 
+	hostlist_find_reset(hl);
 	/* copy new hostrange into slot "n" in array */
 	tmp = hl->hr[n];
 	hl->hr[n] = hostrange_copy(hr);
@@ -1497,6 +1517,7 @@ static void hostlist_delete_range(hostlist_t hl, int n)
 	assert(hl->magic == HOSTLIST_MAGIC);
 	assert(n < hl->nranges && n >= 0);
 
+	hostlist_find_reset(hl);
 	old = hl->hr[n];
 	for (i = n; i < hl->nranges - 1; i++)
 		hl->hr[i] = hl->hr[i + 1];
@@ -1814,6 +1835,22 @@ static int _parse_range_list(char *str, struct _range *ranges,
 	return count;
 }
 
+/* Return the number of ranges to allow for when parsing str with
+ * _parse_range_list(). Each comma starts at most one range, except that
+ * a multi-dimensional box expands into many. */
+static int _max_ranges(const char *str, int dims)
+{
+	int cnt = 1;
+
+	if (dims > 1)
+		return MAX_RANGES;
+	for ( ; *str; str++) {
+		if ((*str == ',') && (++cnt == MAX_RANGES))
+			break;
+	}
+	return cnt;
+}
+
 /* Validate prefix and push with the numeric suffix onto the hostlist
  * The prefix can contain a up to one range expresseion (e.g. "rack[1-4]_").
  * RET 0 on success, -1 on failure (invalid prefix) */
@@ -1821,7 +1858,7 @@ static int
 _push_range_list(hostlist_t hl, char *prefix, struct _range *range,
 		 int n, int dims)
 {
-	int i, k, nr;
+	int i, k, nr, max_ranges;
 	char *p, *q;
 	char new_prefix[1024], tmp_prefix[1024];
 
@@ -1835,8 +1872,9 @@ _push_range_list(hostlist_t hl, char *prefix, struct _range *range,
 		*q++ = '\0';
 		if (strrchr(tmp_prefix, '[') != NULL)
 			return -1;	/* third range is illegal */
-		prefix_range = xmalloc(sizeof(struct _range) * MAX_RANGES);
-		nr = _parse_range_list(p, prefix_range, MAX_RANGES, dims);
+		max_ranges = _max_ranges(p, dims);
+		prefix_range = xmalloc(sizeof(struct _range) * max_ranges);
+		nr = _parse_range_list(p, prefix_range, max_ranges, dims);
 		if (nr < 0) {
 			xfree(prefix_range);
 			return -1;	/* bad numeric expression */
@@ -1886,7 +1924,7 @@ _hostlist_create_bracketed(const char *hostlist, char *sep,
 {
 	hostlist_t new = hostlist_new();
 	struct _range *ranges;
-	int nr, err;
+	int nr, err, max_ranges;
 	char *p, *tok, *str, *orig;
 	char cur_tok[1024];
 
@@ -1898,7 +1936,8 @@ _hostlist_create_bracketed(const char *hostlist, char *sep,
 		return NULL;
 	}
 
-	ranges = xmalloc(sizeof(struct _range) * MAX_RANGES);
+	max_ranges = _max_ranges(hostlist, dims);
+	ranges = xmalloc(sizeof(struct _range) * max_ranges);
 	while ((tok = _next_tok(sep, &str)) != NULL) {
 		strncpy(cur_tok, tok, 1024);
 		if ((p = strrchr(tok, '[')) != NULL) {
@@ -1910,7 +1949,7 @@ _hostlist_create_bracketed(const char *hostlist, char *sep,
 					goto error;
 				*q = '\0';
 				nr = _parse_range_list(p, ranges,
-						       MAX_RANGES, dims);
+						       max_ranges, dims);
 				if (nr < 0)
 					goto error;
 				if (_push_range_list(
@@ -2002,6 +2041,7 @@ void hostlist_destroy(hostlist_t hl)
 	for (i = 0; i < hl->nranges; i++)
 		hostrange_destroy(hl->hr[i]);
 	free(hl->hr);
+	free(hl->find_cnt);
 	assert(hl->magic = 0x1);
 	UNLOCK_HOSTLIST(hl);
 	mutex_destroy(&hl->mutex);
@@ -2086,6 +2126,7 @@ char *hostlist_pop(hostlist_t hl)
 	}
 
 	LOCK_HOSTLIST(hl);
+	hostlist_find_reset(hl);
 	if (hl->nhosts > 0) {
 		hostrange_t hr = hl->hr[hl->nranges - 1];
 		host = hostrange_pop(hr);
@@ -2133,6 +2174,7 @@ char *hostlist_shift(hostlist_t hl)
 		return NULL;
 	}
 	LOCK_HOSTLIST(hl);
+	hostlist_find_reset(hl);
 
 	if (hl->nhosts > 0) {
 		hostrange_t hr = hl->hr[0];
@@ -2168,6 +2210,7 @@ char *hostlist_pop_range(hostlist_t hl)
 		return NULL;
 	}
 
+	hostlist_find_reset(hl);
 	i = hl->nranges - 2;
 	tail = hl->hr[hl->nranges - 1];
 	while (i >= 0 && hostrange_within_range(tail, hl->hr[i]))
@@ -2204,6 +2247,7 @@ char *hostlist_shift_range(hostlist_t hl)
 		return NULL;
 	}
 
+	hostlist_find_reset(hl);
 	i = 0;
 	do {
 		hostlist_push_range(hltmp, hl->hr[i]);
@@ -2331,6 +2375,7 @@ int hostlist_delete_nth(hostlist_t hl, int n)
 		return -1;
 	LOCK_HOSTLIST(hl);
 	assert(n >= 0 && n <= hl->nhosts);
+	hostlist_find_reset(hl);
 
 	count = 0;
 
@@ -2374,31 +2419,127 @@ int hostlist_count(hostlist_t hl)
 	return retval;
 }
 
-int hostlist_find(hostlist_t hl, const char *hostname)
+/* Order two ranges of a hostlist for hostlist_find_index(), returns < 0 if
+ * all hosts of h1 sort before all those of h2, > 0 if after, 0 if the
+ * order cannot be told (e.g. the ranges overlap) */
+static int hostrange_find_cmp(hostrange_t h1, hostrange_t h2)
 {
-	int i, count, ret = -1;
-	hostname_t hn;
+	int retval;
 
-	if (!hostname || !hl)
+	if ((retval = strnatcmp(h1->prefix, h2->prefix)))
+		return retval;
+	if (strcmp(h1->prefix, h2->prefix))
+		return 0;
+	if (h1->singlehost != h2->singlehost)
+		return h1->singlehost ? -1 : 1;
+	if (h1->singlehost)
+		return 0;
+	if (h1->hi < h2->lo)
 		return -1;
+	if (h1->lo > h2->hi)
+		return 1;
+	return 0;
+}
 
-	hn = hostname_create(hostname);
+/* Build the index used by hostlist_find() to search a hostlist whose ranges
+ * are in order and do not overlap (e.g. once sorted) by bisection.
+ * Returns 1 if hl can be searched so, 0 if it needs a linear scan.
+ * Assumes that hostlist hl is locked by caller */
+static int hostlist_find_index(hostlist_t hl)
+{
+	int i, len, *cnt;
 
-	LOCK_HOSTLIST(hl);
+	if (hl->find_state)
+		return (hl->find_state > 0);
+
+	hl->find_state = -1;
+	/* Ranges are only compared as prefix and suffix here, so skip the
+	 * multi-dimensional names and the prefixes with trailing digits
+	 * (e.g. "nid0000[2-7]") matched by hostrange_hn_within() */
+	if (slurmdb_setup_cluster_name_dims() != 1)
+		return 0;
+	for (i = 0; i < hl->nranges; i++) {
+		len = strlen(hl->hr[i]->prefix);
+		if (len && isdigit((int) hl->hr[i]->prefix[len - 1]))
+			return 0;
+		if (i && (hostrange_find_cmp(hl->hr[i - 1], hl->hr[i]) >= 0))
+			return 0;
+	}
+
+	if (!(cnt = realloc(hl->find_cnt, (hl->nranges + 1) * sizeof(int))))
+		return 0;
+	hl->find_cnt = cnt;
+	hl->find_cnt[0] = 0;
+	for (i = 0; i < hl->nranges; i++)
+		hl->find_cnt[i + 1] = hl->find_cnt[i] + hostrange_count(hl->hr[i]);
+	hl->find_state = 1;
+	return 1;
+}
+
+/* Return the position of hostname hn in hostlist hl, -1 if not found.
+ * Assumes that hostlist hl is locked by caller */
+static int hostlist_find_hn(hostlist_t hl, hostname_t hn)
+{
+	int i, count, lo, hi, retval;
+	int singlehost = !hostname_suffix_is_valid(hn);
+	hostrange_t hr;
+
+	if (hostlist_find_index(hl)) {
+		lo = 0;
+		hi = hl->nranges - 1;
+		while (lo <= hi) {
+			i = (lo + hi) / 2;
+			hr = hl->hr[i];
+			if (!(retval = strnatcmp(hr->prefix, hn->prefix))) {
+				if (hr->singlehost != singlehost)
+					retval = hr->singlehost ? -1 : 1;
+				else if (singlehost)
+					retval = 0;
+				else if (hr->hi < hn->num)
+					retval = -1;
+				else if (hr->lo > hn->num)
+					retval = 1;
+			}
+			if (retval < 0)
+				lo = i + 1;
+			else if (retval > 0)
+				hi = i - 1;
+			else if (!hostrange_hn_within(hr, hn))
+				return -1;
+			else if (singlehost)
+				return hl->find_cnt[i];
+			else
+				return hl->find_cnt[i] + hn->num - hr->lo;
+		}
+		return -1;
+	}
 
 	for (i = 0, count = 0; i < hl->nranges; i++) {
 		if (hostrange_hn_within(hl->hr[i], hn)) {
 			if (hostname_suffix_is_valid(hn))
-				ret = count + hn->num - hl->hr[i]->lo;
+				return count + hn->num - hl->hr[i]->lo;
 			else
-				ret = count;
-			goto done;
+				return count;
 		} else
 			count += hostrange_count(hl->hr[i]);
 	}
+	return -1;
+}
 
-done:
+int hostlist_find(hostlist_t hl, const char *hostname)
+{
+	int ret;
+	hostname_t hn;
+
+	if (!hostname || !hl)
+		return -1;
+
+	hn = hostname_create(hostname);
+
+	LOCK_HOSTLIST(hl);
+	ret = hostlist_find_hn(hl, hn);
 	UNLOCK_HOSTLIST(hl);
+
 	hostname_destroy(hn);
 	return ret;
 }
@@ -2425,6 +2566,7 @@ void hostlist_sort(hostlist_t hl)
 	}
 
 	qsort(hl->hr, hl->nranges, sizeof(hostrange_t), &_cmp);
+	hostlist_find_reset(hl);
 
 	/* reset all iterators */
 	for (i = hl->ilist; i; i = i->next)
@@ -2445,6 +2587,7 @@ static void hostlist_collapse(hostlist_t hl)
 	int i;
 
 	LOCK_HOSTLIST(hl);
+	hostlist_find_reset(hl);
 	for (i = hl->nranges - 1; i > 0; i--) {
 		hostrange_t hprev = hl->hr[i - 1];
 		hostrange_t hnext = hl->hr[i];
@@ -2468,6 +2611,7 @@ static void hostlist_coalesce(hostlist_t hl)
 	hostrange_t new;
 
 	LOCK_HOSTLIST(hl);
+	hostlist_find_reset(hl);
 
 	for (i = hl->nranges - 1; i > 0; i--) {
 
@@ -2541,6 +2685,7 @@ void hostlist_uniq(hostlist_t hl)
 		return;
 	}
 	qsort(hl->hr, hl->nranges, sizeof(hostrange_t), &_cmp);
+	hostlist_find_reset(hl);
 
 	while (i < hl->nranges) {
 		if (_attempt_range_join(hl, i) < 0) /* No range join occurred */
@@ -3079,9 +3224,33 @@ _test_box(int *start, int *end, int dims)
 	return _test_box_in_grid(0, 0, start, end, dims);
 }
 
+/* Return an upper bound on the length of the ranged string of hl,
+ * including the NUL, so that it can be built without retrying */
+static int hostlist_ranged_string_size(hostlist_t hl)
+{
+	int i, digits, size = 1;
+	unsigned long num;
+	hostrange_t hr;
+
+	LOCK_HOSTLIST(hl);
+	for (i = 0; i < hl->nranges; i++) {
+		hr = hl->hr[i];
+		/* prefix, brackets, dash and comma */
+		size += strlen(hr->prefix) + 4;
+		if (hr->singlehost)
+			continue;
+		for (digits = 1, num = hr->hi; num >= 10; num /= 10)
+			digits++;
+		size += 2 * MAX(digits, hr->width);
+	}
+	UNLOCK_HOSTLIST(hl);
+
+	return size;
+}
+
 char *hostlist_ranged_string_malloc(hostlist_t hl)
 {
-	int buf_size = 8192;
+	int buf_size = MAX(8192, hostlist_ranged_string_size(hl));
 	char *buf = malloc(buf_size);
 	while (buf && (hostlist_ranged_string(hl, buf_size, buf) < 0)) {
 		buf_size *= 2;
@@ -3095,7 +3264,7 @@ char *hostlist_ranged_string_malloc(hostlist_t hl)
 char *hostlist_ranged_string_xmalloc_dims(
 	hostlist_t hl, int dims, int brackets)
 {
-	int buf_size = 8192;
+	int buf_size = MAX(8192, hostlist_ranged_string_size(hl));
 	char *buf = xmalloc(buf_size);
 	while (hostlist_ranged_string_dims(
 		       hl, buf_size, buf, dims, brackets) < 0) {
@@ -3454,6 +3623,7 @@ int hostlist_remove(hostlist_iterator_t i)
 	assert(i != NULL);
 	assert(i->magic == HOSTLIST_MAGIC);
 	LOCK_HOSTLIST(i->hl);
+	hostlist_find_reset(i->hl);
 	new = hostrange_delete_host(i->hr, i->hr->lo + i->depth);
 	if (new) {
 		hostlist_insert_range(i->hl, new, i->idx + 1);
@@ -3535,6 +3705,7 @@ static int hostset_insert_range(hostset_t set, hostrange_t hr)
 	if (hl->size == hl->nranges && !hostlist_expand(hl))
 		return 0;
 
+	hostlist_find_reset(hl);
 	nhosts = hostrange_count(hr);
 
 	for (i = 0; i < hl->nranges; i++) {
@@ -3591,22 +3762,16 @@ int hostset_insert(hostset_t set, const char *hosts)
 }
 
 
-/* linear search through N ranges for hostname "host"
+/* search through the ranges of set for hostname "host"
  * */
 static int hostset_find_host(hostset_t set, const char *host)
 {
-	int i;
 	int retval = 0;
 	hostname_t hn;
 	LOCK_HOSTLIST(set->hl);
 	hn = hostname_create(host);
-	for (i = 0; i < set->hl->nranges; i++) {
-		if (hostrange_hn_within(set->hl->hr[i], hn)) {
-			retval = 1;
-			goto done;
-		}
-	}
-done:
+	if (hostlist_find_hn(set->hl, hn) >= 0)
+		retval = 1;
 	UNLOCK_HOSTLIST(set->hl);
 	hostname_destroy(hn);
 	return retval;
@@ -148,6 +148,20 @@ static void * lsd_nomem_error(char *file, int line, char *mesg)
 #else
 #  define LIST_ALLOC 128
 #endif
+
+/*
+ * Each thread keeps its own cache of free lists, nodes and iterators so that
+ * most allocations and frees do not take list_free_lock. Objects move between
+ * a thread's cache and the global freelists LIST_CACHE at a time, and the
+ * whole cache is returned to the global freelists when the thread exits.
+ */
+#if defined(WITH_PTHREADS) && !defined(MEMORY_LEAK_DEBUG)
+#  define LIST_CACHE 32
+#endif
+#define LIST_CACHE_LIST 0
+#define LIST_CACHE_NODE 1
+#define LIST_CACHE_ITER 2
+#define LIST_CACHE_CNT  3
 #define LIST_MAGIC 0xDEADBEEF
 
 
@@ -199,8 +213,8 @@ static ListNode list_node_alloc (void);
 static void list_node_free (ListNode p);
 static ListIterator list_iterator_alloc (void);
 static void list_iterator_free (ListIterator i);
-static void * list_alloc_aux (int size, void *pfreelist);
-static void list_free_aux (void *x, void *pfreelist);
+static void * list_alloc_aux (int size, void *pfreelist, int cache_inx);
+static void list_free_aux (void *x, void *pfreelist, int cache_inx);
 static void *_list_pop_locked(List l);
 static void *_list_append_locked(List l, void *x);
 
@@ -216,6 +230,17 @@ static ListIterator list_free_iterators = NULL;
 static pthread_mutex_t list_free_lock = PTHREAD_MUTEX_INITIALIZER;
 #endif /* WITH_PTHREADS */
 
+#ifdef LIST_CACHE
+struct list_cache {
+	void *free[LIST_CACHE_CNT];	/* thread's freelist of each type */
+	int   count[LIST_CACHE_CNT];	/* objects in each freelist */
+	void *global[LIST_CACHE_CNT];	/* global freelist of each type */
+};
+
+static pthread_key_t  list_cache_key;
+static pthread_once_t list_cache_once = PTHREAD_ONCE_INIT;
+#endif /* LIST_CACHE */
+
 
 /************
  *  Macros  *
@@ -1010,7 +1035,8 @@ list_node_destroy (List l, ListNode *pp)
 static List
 list_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct list), &list_free_lists));
+	return(list_alloc_aux(sizeof(struct list), &list_free_lists,
+			      LIST_CACHE_LIST));
 }
 
 /* list_free()
@@ -1018,7 +1044,7 @@ list_alloc (void)
 static void
 list_free (List l)
 {
-	list_free_aux(l, &list_free_lists);
+	list_free_aux(l, &list_free_lists, LIST_CACHE_LIST);
 }
 
 /* list_node_alloc()
@@ -1026,7 +1052,8 @@ list_free (List l)
 static ListNode
 list_node_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct listNode), &list_free_nodes));
+	return(list_alloc_aux(sizeof(struct listNode), &list_free_nodes,
+			      LIST_CACHE_NODE));
 }
 
 /* list_node_free()
@@ -1034,7 +1061,7 @@ list_node_alloc (void)
 static void
 list_node_free (ListNode p)
 {
-	list_free_aux(p, &list_free_nodes);
+	list_free_aux(p, &list_free_nodes, LIST_CACHE_NODE);
 }
 
 /* list_iterator_alloc()
@@ -1042,7 +1069,8 @@ list_node_free (ListNode p)
 static ListIterator
 list_iterator_alloc (void)
 {
-	return(list_alloc_aux(sizeof(struct listIterator), &list_free_iterators));
+	return(list_alloc_aux(sizeof(struct listIterator), &list_free_iterators,
+			      LIST_CACHE_ITER));
 }
 
 /* list_iterator_free()
@@ -1050,21 +1078,105 @@ list_iterator_alloc (void)
 static void
 list_iterator_free (ListIterator i)
 {
-	list_free_aux(i, &list_free_iterators);
+	list_free_aux(i, &list_free_iterators, LIST_CACHE_ITER);
+}
+
+#ifdef LIST_CACHE
+/* list_cache_move()
+ */
+static int
+list_cache_move (void **pfrom, void **pto, int cnt)
+{
+/*  Moves up to [cnt] objects from freelist [*pfrom] to freelist [*pto].
+ *  Returns the number of objects moved.
+ */
+	void **px;
+	int i;
+
+	for (i = 0; (i < cnt) && (px = *pfrom); i++) {
+		*pfrom = *px;
+		*px = *pto;
+		*pto = px;
+	}
+	return i;
+}
+
+/* list_cache_destroy()
+ */
+static void
+list_cache_destroy (void *arg)
+{
+/*  Returns the exiting thread's cached objects to the global freelists.
+ */
+	struct list_cache *c = arg;
+	int i;
+
+	list_mutex_lock(&list_free_lock);
+	for (i = 0; i < LIST_CACHE_CNT; i++) {
+		if (c->global[i])
+			(void) list_cache_move(&c->free[i], c->global[i],
+					       c->count[i]);
+	}
+	list_mutex_unlock(&list_free_lock);
+	free(c);
+}
+
+/* list_cache_key_init()
+ */
+static void
+list_cache_key_init (void)
+{
+	int e;
+
+	if ((e = pthread_key_create(&list_cache_key, list_cache_destroy))) {
+		errno = e;
+		lsd_fatal_error(__FILE__, __LINE__, "list cache key create");
+		abort();
+	}
 }
 
+/* list_cache_get()
+ */
+static struct list_cache *
+list_cache_get (void)
+{
+/*  Returns the calling thread's cache, creating it if needed.
+ */
+	struct list_cache *c;
+
+	pthread_once(&list_cache_once, list_cache_key_init);
+	if ((c = pthread_getspecific(list_cache_key)))
+		return c;
+	if (!(c = calloc(1, sizeof(struct list_cache))))
+		return(lsd_nomem_error(__FILE__, __LINE__, "list cache"));
+	pthread_setspecific(list_cache_key, c);
+	return c;
+}
+#endif /* LIST_CACHE */
+
 /* list_alloc_aux()
  */
 static void *
-list_alloc_aux (int size, void *pfreelist)
+list_alloc_aux (int size, void *pfreelist, int cache_inx)
 {
-/*  Allocates an object of [size] bytes from the freelist [*pfreelist].
+/*  Allocates an object of [size] bytes from the calling thread's cache
+ *  [cache_inx], refilling it from the freelist [*pfreelist] when empty.
  *  Memory is added to the freelist in chunks of size LIST_ALLOC.
  *  Returns a ptr to the object, or NULL if the memory request fails.
  */
 	void **px;
 	void **pfree = pfreelist;
 	void **plast;
+#ifdef LIST_CACHE
+	struct list_cache *c = list_cache_get();
+
+	c->global[cache_inx] = pfreelist;
+	if ((px = c->free[cache_inx])) {
+		c->free[cache_inx] = *px;
+		c->count[cache_inx]--;
+		return px;
+	}
+#endif
 
 	assert(sizeof(char) == 1);
 	assert(size >= sizeof(void *));
@@ -1085,6 +1197,10 @@ list_alloc_aux (int size, void *pfreelist)
 		*pfree = *px;
 	else
 		errno = ENOMEM;
+#ifdef LIST_CACHE
+	c->count[cache_inx] = list_cache_move(pfree, &c->free[cache_inx],
+					      LIST_CACHE);
+#endif
 	list_mutex_unlock(&list_free_lock);
 
 	return px;
@@ -1093,18 +1209,35 @@ list_alloc_aux (int size, void *pfreelist)
 /* list_free_aux()
  */
 static void
-list_free_aux (void *x, void *pfreelist)
+list_free_aux (void *x, void *pfreelist, int cache_inx)
 {
-/*  Frees the object [x], returning it to the freelist [*pfreelist].
+/*  Frees the object [x], returning it to the calling thread's cache
+ *  [cache_inx]. Objects beyond 2 * LIST_CACHE in the cache are returned
+ *  to the freelist [*pfreelist].
  */
 #ifdef MEMORY_LEAK_DEBUG
 	xfree(x);
 #else
 	void **px = x;
 	void **pfree = pfreelist;
+#ifdef LIST_CACHE
+	struct list_cache *c = list_cache_get();
+#endif
 
 	assert(x != NULL);
 	assert(pfreelist != NULL);
+#ifdef LIST_CACHE
+	c->global[cache_inx] = pfreelist;
+	*px = c->free[cache_inx];
+	c->free[cache_inx] = px;
+	if (++c->count[cache_inx] <= (2 * LIST_CACHE))
+		return;
+
+	list_mutex_lock(&list_free_lock);
+	c->count[cache_inx] -= list_cache_move(&c->free[cache_inx], pfree,
+					       LIST_CACHE);
+	list_mutex_unlock(&list_free_lock);
+#else
 	list_mutex_lock(&list_free_lock);
 
 	*px = *pfree;
@@ -1112,6 +1245,7 @@ list_free_aux (void *x, void *pfreelist)
 
 	list_mutex_unlock(&list_free_lock);
 #endif
+#endif
 }
 
 #ifdef WITH_PTHREADS
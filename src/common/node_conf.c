@@ -55,6 +55,7 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -79,6 +80,19 @@
 
 #define _DEBUG 0
 
+/* Cache of node name strings built by bitmap2node_name_sortable(), two way
+ * set associative by bitmap hash. Cleared when the node table changes. */
+#define NODE_NAME_CACHE_SIZE 128	/* entries, two per set */
+typedef struct node_name_cache {
+	bitstr_t *bitmap;
+	uint32_t last_use;
+	char *node_names;
+	bool sort;
+} node_name_cache_t;
+static node_name_cache_t node_name_cache[NODE_NAME_CACHE_SIZE];
+static uint32_t node_name_cache_use = 0;
+static pthread_mutex_t node_name_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
 /* Global variables */
 List config_list  = NULL;	/* list of config_record entries */
 List feature_list = NULL;	/* list of features_record entries */
@@ -105,6 +119,7 @@ static void	_list_delete_config (void *config_entry);
 static void	_list_delete_feature (void *feature_entry);
 static int	_list_find_config (void *config_entry, void *key);
 static int	_list_find_feature (void *feature_entry, void *key);
+static void	_node_name_cache_purge (void);
 
 
 static void _add_config_feature(char *feature, bitstr_t *node_bitmap)
@@ -487,12 +502,14 @@ static int _list_find_config (void *config_entry, void *key)
  * RET pointer to node list or NULL on error
  * globals: node_record_table_ptr - pointer to node table
  * NOTE: the caller must xfree the memory at node_list when no longer required
+ * NOTE: recently built lists are cached until the node table changes
  */
 char * bitmap2node_name_sortable (bitstr_t *bitmap, bool sort)
 {
 	int i, first, last;
 	hostlist_t hl;
 	char *buf;
+	node_name_cache_t *cache_ptr;
 
 	if (bitmap == NULL)
 		return xstrdup("");
@@ -501,21 +518,60 @@ char * bitmap2node_name_sortable (bitstr_t *bitmap, bool sort)
 	if (first == -1)
 		return xstrdup("");
 
+	cache_ptr = &node_name_cache[(bit_hash(bitmap) %
+				      (NODE_NAME_CACHE_SIZE / 2)) * 2];
+	slurm_mutex_lock(&node_name_cache_lock);
+	for (i = 0; i < 2; i++) {
+		if (cache_ptr[i].bitmap && (cache_ptr[i].sort == sort) &&
+		    bit_equal(cache_ptr[i].bitmap, bitmap)) {
+			cache_ptr[i].last_use = ++node_name_cache_use;
+			buf = xstrdup(cache_ptr[i].node_names);
+			slurm_mutex_unlock(&node_name_cache_lock);
+			return buf;
+		}
+	}
+	slurm_mutex_unlock(&node_name_cache_lock);
+
 	last  = bit_fls(bitmap);
 	hl = hostlist_create("");
 	for (i = first; i <= last; i++) {
 		if (bit_test(bitmap, i) == 0)
 			continue;
-		hostlist_push(hl, node_record_table_ptr[i].name);
+		hostlist_push_host(hl, node_record_table_ptr[i].name);
 	}
 	if (sort)
 		hostlist_sort(hl);
 	buf = hostlist_ranged_string_xmalloc(hl);
 	hostlist_destroy(hl);
 
+	slurm_mutex_lock(&node_name_cache_lock);
+	if (cache_ptr[1].last_use < cache_ptr[0].last_use)
+		cache_ptr++;	/* replace the least recently used entry */
+	FREE_NULL_BITMAP(cache_ptr->bitmap);
+	xfree(cache_ptr->node_names);
+	cache_ptr->bitmap = bit_copy(bitmap);
+	cache_ptr->last_use = ++node_name_cache_use;
+	cache_ptr->node_names = xstrdup(buf);
+	cache_ptr->sort = sort;
+	slurm_mutex_unlock(&node_name_cache_lock);
+
 	return buf;
 }
 
+/* Clear the bitmap2node_name_sortable() cache, the node table has changed */
+static void _node_name_cache_purge (void)
+{
+	int i;
+
+	slurm_mutex_lock(&node_name_cache_lock);
+	for (i = 0; i < NODE_NAME_CACHE_SIZE; i++) {
+		FREE_NULL_BITMAP(node_name_cache[i].bitmap);
+		node_name_cache[i].last_use = 0;
+		xfree(node_name_cache[i].node_names);
+	}
+	slurm_mutex_unlock(&node_name_cache_lock);
+}
+
 /*
  * bitmap2node_name - given a bitmap, build a list of sorted, comma
  *	separated node names. names may include regular expressions
@@ -778,6 +834,7 @@ extern struct node_record *create_node_record (
 	last_node_update = time (NULL);
 	xassert(config_ptr);
 	xassert(node_name);
+	_node_name_cache_purge();
 
 	/* round up the buffer size to reduce overhead of xrealloc */
 	old_buffer_size = (node_record_count) * sizeof (struct node_record);
@@ -894,6 +951,7 @@ extern int init_node_conf (void)
 	node_record_count = 0;
 	xfree(node_record_table_ptr);
 	xfree(node_hash_table);
+	_node_name_cache_purge();
 
 	if (config_list)	/* delete defunct configuration entries */
 		(void) _delete_config_record ();
@@ -929,6 +987,7 @@ extern void node_fini2 (void)
 	xfree(node_record_table_ptr);
 	xfree(node_hash_table);
 	node_record_count = 0;
+	_node_name_cache_purge();
 }
 
 
@@ -1017,6 +1076,7 @@ extern void rehash_node (void)
 	xfree (node_hash_table);
 	node_hash_table = xmalloc (sizeof (struct node_record *) *
 				   node_record_count);
+	_node_name_cache_purge();	/* node table may have been reordered */
 
 	for (i = 0; i < node_record_count; i++, node_ptr++) {
 		if ((node_ptr->name == NULL) ||
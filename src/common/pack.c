@@ -71,6 +71,7 @@
 strong_alias(create_buf,	slurm_create_buf);
 strong_alias(free_buf,		slurm_free_buf);
 strong_alias(grow_buf,		slurm_grow_buf);
+strong_alias(reserve_buf,	slurm_reserve_buf);
 strong_alias(init_buf,		slurm_init_buf);
 strong_alias(xfer_buf_data,	slurm_xfer_buf_data);
 strong_alias(pack_time,		slurm_pack_time);
@@ -99,6 +100,20 @@ strong_alias(unpackstr_array,	slurm_unpackstr_array);
 strong_alias(packmem_array,	slurm_packmem_array);
 strong_alias(unpackmem_array,	slurm_unpackmem_array);
 
+/* Allocate memory for unpacked data, from the buffer's arena if it has one.
+ * Memory from xmalloc() is always zeroed, arena memory only if clear is set */
+static void *_unpack_alloc(Buf buffer, size_t size, bool clear)
+{
+	void *mem;
+
+	if (!buffer->arena)
+		return xmalloc(size);
+	mem = xarena_alloc(buffer->arena, size);
+	if (clear)
+		memset(mem, 0, size);
+	return mem;
+}
+
 /* Basic buffer management routines */
 /* create_buf - create a buffer with the supplied contents, contents must
  * be xalloc'ed */
@@ -129,6 +144,30 @@ void free_buf(Buf my_buf)
 	xfree(my_buf);
 }
 
+/* Grow a buffer so at least size more bytes can be packed into it. Unless
+ * that needs more, grow it by half its size (at least BUF_SIZE) so that
+ * packing a large amount of data a little at a time needs few reallocs.
+ * RET SLURM_SUCCESS or SLURM_ERROR if the buffer would be too large */
+static int _grow_buf(Buf buffer, uint32_t size)
+{
+	uint32_t new_size, grow;
+
+	if (size > (MAX_BUF_SIZE - buffer->processed))
+		return SLURM_ERROR;
+	new_size = buffer->processed + size;
+
+	grow = MAX(buffer->size / 2, BUF_SIZE);
+	if (buffer->size > (MAX_BUF_SIZE - grow))
+		new_size = MAX_BUF_SIZE;
+	else if (new_size < (buffer->size + grow))
+		new_size = buffer->size + grow;
+
+	/* Only the packed data is used, no need to zero the new memory */
+	buffer->size = new_size;
+	xrealloc_nz(buffer->head, buffer->size);
+	return SLURM_SUCCESS;
+}
+
 /* Grow a buffer by the specified amount */
 void grow_buf (Buf buffer, int size)
 {
@@ -141,6 +180,22 @@ void grow_buf (Buf buffer, int size)
 	xrealloc(buffer->head, buffer->size);
 }
 
+/* Reserve space in a buffer so at least size more bytes can be packed
+ * into it without growing it. Use when the size of the data to be packed
+ * is known or can be estimated, to avoid reallocs. */
+void reserve_buf(Buf buffer, uint32_t size)
+{
+	if (remaining_buf(buffer) >= size)
+		return;
+	if (size > (MAX_BUF_SIZE - buffer->processed)) {
+		error("reserve_buf: buffer size too large");
+		return;
+	}
+
+	buffer->size = buffer->processed + size;
+	xrealloc_nz(buffer->head, buffer->size);
+}
+
 /* init_buf - create an empty buffer of the given size */
 Buf init_buf(int size)
 {
@@ -181,12 +236,10 @@ void pack_time(time_t val, Buf buffer)
 	int64_t n64 = HTON_int64((int64_t) val);
 
 	if (remaining_buf(buffer) < sizeof(n64)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
+		if (_grow_buf(buffer, sizeof(n64))) {
 			error("pack_time: buffer size too large");
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &n64, sizeof(n64));
@@ -225,12 +278,10 @@ void 	packdouble(double val, Buf buffer)
 	uval.d =  (val * FLOAT_MULT);
 	nl =  HTON_uint64(uval.u);
 	if (remaining_buf(buffer) < sizeof(nl)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
+		if (_grow_buf(buffer, sizeof(nl))) {
 			error("packdouble: buffer size too large");
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
@@ -271,12 +322,10 @@ void pack64(uint64_t val, Buf buffer)
 	uint64_t nl =  HTON_uint64(val);
 
 	if (remaining_buf(buffer) < sizeof(nl)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
+		if (_grow_buf(buffer, sizeof(nl))) {
 			error("pack64: buffer size too large");
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
@@ -308,12 +357,10 @@ void pack32(uint32_t val, Buf buffer)
 	uint32_t nl = htonl(val);
 
 	if (remaining_buf(buffer) < sizeof(nl)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
+		if (_grow_buf(buffer, sizeof(nl))) {
 			error("pack32: buffer size too large");
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &nl, sizeof(nl));
@@ -357,7 +404,7 @@ int unpack16_array(uint16_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 if (*size_val > 4000000) abort();
-	*valp = xmalloc((*size_val) * sizeof(uint16_t));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(uint16_t), false);
 	for (i = 0; i < *size_val; i++) {
 		if (unpack16((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -386,7 +433,7 @@ int unpack32_array(uint32_t ** valp, uint32_t * size_val, Buf buffer)
 	if (unpack32(size_val, buffer))
 		return SLURM_ERROR;
 
-	*valp = xmalloc((*size_val) * sizeof(uint32_t));
+	*valp = _unpack_alloc(buffer, (*size_val) * sizeof(uint32_t), false);
 	for (i = 0; i < *size_val; i++) {
 		if (unpack32((*valp) + i, buffer))
 			return SLURM_ERROR;
@@ -403,12 +450,10 @@ void pack16(uint16_t val, Buf buffer)
 	uint16_t ns = htons(val);
 
 	if (remaining_buf(buffer) < sizeof(ns)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
+		if (_grow_buf(buffer, sizeof(ns))) {
 			error("pack16: buffer size too large");
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
@@ -439,12 +484,10 @@ int unpack16(uint16_t * valp, Buf buffer)
 void pack8(uint8_t val, Buf buffer)
 {
 	if (remaining_buf(buffer) < sizeof(uint8_t)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
+		if (_grow_buf(buffer, sizeof(uint8_t))) {
 			error("pack8: buffer size too large");
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &val, sizeof(uint8_t));
@@ -475,12 +518,11 @@ void packmem(char *valp, uint32_t size_val, Buf buffer)
 	uint32_t ns = htonl(size_val);
 
 	if (remaining_buf(buffer) < (sizeof(ns) + size_val)) {
-		if (buffer->size > (MAX_BUF_SIZE -  size_val - BUF_SIZE)) {
+		if ((size_val > (MAX_BUF_SIZE - sizeof(ns))) ||
+		    _grow_buf(buffer, sizeof(ns) + size_val)) {
 			error("packmem: buffer size too large");
 			return;
 		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc(buffer->head, buffer->size);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
@@ -581,7 +623,7 @@ int unpackmem_xmalloc(char **valp, uint32_t * size_valp, Buf buffer)
 	else if (*size_valp > 0) {
 		if (remaining_buf(buffer) < *size_valp)
 			return SLURM_ERROR;
-		*valp = xmalloc(*size_valp);
+		*valp = _unpack_alloc(buffer, *size_valp, false);
 		memcpy(*valp, &buffer->head[buffer->processed],
 		       *size_valp);
 		buffer->processed += *size_valp;
@@ -638,12 +680,10 @@ void packstr_array(char **valp, uint32_t size_val, Buf buffer)
 	uint32_t ns = htonl(size_val);
 
 	if (remaining_buf(buffer) < sizeof(ns)) {
-		if (buffer->size > (MAX_BUF_SIZE - BUF_SIZE)) {
+		if (_grow_buf(buffer, sizeof(ns))) {
 			error("packstr_array: buffer size too large");
 			return;
 		}
-		buffer->size += BUF_SIZE;
-		xrealloc(buffer->head, buffer->size);
 	}
 
 	memcpy(&buffer->head[buffer->processed], &ns, sizeof(ns));
@@ -679,7 +719,8 @@ int unpackstr_array(char ***valp, uint32_t * size_valp, Buf buffer)
 	if (*size_valp > MAX_PACK_ARRAY_LEN)
 		return SLURM_ERROR;
 	else if (*size_valp > 0) {
-		*valp = xmalloc(sizeof(char *) * (*size_valp + 1));
+		*valp = _unpack_alloc(buffer,
+				      sizeof(char *) * (*size_valp + 1), true);
 		for (i = 0; i < *size_valp; i++) {
 			if (unpackmem_xmalloc(&(*valp)[i], &uint32_tmp, buffer))
 				return SLURM_ERROR;
@@ -698,12 +739,10 @@ int unpackstr_array(char ***valp, uint32_t * size_valp, Buf buffer)
 void packmem_array(char *valp, uint32_t size_val, Buf buffer)
 {
 	if (remaining_buf(buffer) < size_val) {
-		if (buffer->size > (MAX_BUF_SIZE - size_val - BUF_SIZE)) {
+		if (_grow_buf(buffer, size_val)) {
 			error("packmem_array: buffer size too large");
 			return;
 		}
-		buffer->size += (size_val + BUF_SIZE);
-		xrealloc(buffer->head, buffer->size);
 	}
 
 	memcpy(&buffer->head[buffer->processed], valp, size_val);
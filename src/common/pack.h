@@ -68,6 +68,7 @@ struct slurm_buf {
 	char *head;
 	uint32_t size;
 	uint32_t processed;
+	struct xarena *arena;	/* if set, unpack memory from this arena */
 };
 
 typedef struct slurm_buf * Buf;
@@ -82,6 +83,7 @@ Buf	create_buf (char *data, int size);
 void	free_buf(Buf my_buf);
 Buf	init_buf(int size);
 void    grow_buf (Buf my_buf, int size);
+void	reserve_buf(Buf my_buf, uint32_t size);
 void	*xfer_buf_data(Buf my_buf);
 
 void	pack_time(time_t val, Buf buffer);
@@ -81,6 +81,9 @@ typedef struct sbcast_cred sbcast_cred_t;		/* opaque data type */
 #define EXTREME_DEBUG   0
 #define MAX_TIME 0x7fffffff
 
+/* Number of verified credential signatures cached, see _sig_cache_find() */
+#define SIG_CACHE_SIZE 64
+
 /*
  * slurm job credential state
  *
@@ -221,16 +224,29 @@ static const char *syms[] = {
 	"crypto_str_error"
 };
 
-struct sbcast_cache {
-	time_t       expire;	/* Time that the cred was created	*/
-	uint32_t     value;	/* SLURM job id for this credential	*/
-};
+/*
+ * Recently verified credential signature. The signed data is kept so that
+ * a cached signature is only accepted for the same credential contents.
+ */
+typedef struct {
+	time_t       expire;	/* Time at which entry is no longer good */
+	char        *signature;	/* credential signature			*/
+	unsigned int siglen;	/* signature length in bytes		*/
+	char        *data;	/* packed credential which was signed	*/
+	uint32_t     data_len;	/* length of data in bytes		*/
+} sig_cache_t;
 
 static slurm_crypto_ops_t ops;
 static plugin_context_t *g_context = NULL;
 static pthread_mutex_t g_context_lock = PTHREAD_MUTEX_INITIALIZER;
 static bool init_run = false;
 static time_t crypto_restart_time = (time_t) 0;
+static sig_cache_t sig_cache[SIG_CACHE_SIZE];
+static pthread_mutex_t sig_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t sig_cache_hits = 0, sig_cache_misses = 0;
+/* sbcast signatures must stay on file until the credential expires, since
+ * only the first block's signature can be verified (see
+ * extract_sbcast_cred), so they are never evicted from a shared slot */
 static List sbcast_cache_list = NULL;
 
 /*
@@ -278,8 +294,15 @@ static void _cred_state_pack(slurm_cred_ctx_t ctx, Buf buffer);
 static void _job_state_pack_one(job_state_t *j, Buf buffer);
 static void _cred_state_pack_one(cred_state_t *s, Buf buffer);
 
-static void _sbast_cache_add(sbcast_cred_t *sbcast_cred);
-static void _sbcast_cache_del(void *x);
+static bool _sig_cache_find(char *signature, unsigned int siglen,
+			    Buf buffer);
+static void _sig_cache_add(char *signature, unsigned int siglen,
+			   Buf buffer, time_t expire);
+static void _sig_cache_purge(void);
+static bool _sbcast_cache_find(char *signature, unsigned int siglen,
+			       Buf buffer);
+static void _sbcast_cache_add(char *signature, unsigned int siglen,
+			      Buf buffer, time_t expire);
 
 #ifndef DISABLE_LOCALTIME
 static char * timestr (const time_t *tp, char *buf, size_t n);
@@ -309,7 +332,6 @@ static int _slurm_crypto_init(void)
 		retval = SLURM_ERROR;
 		goto done;
 	}
-	sbcast_cache_list = list_create(_sbcast_cache_del);
 	init_run = true;
 
 done:
@@ -327,8 +349,7 @@ static int _slurm_crypto_fini(void)
 		return SLURM_SUCCESS;
 
 	init_run = false;
-	list_destroy(sbcast_cache_list);
-	sbcast_cache_list = NULL;
+	_sig_cache_purge();
 	rc = plugin_context_destroy(g_context);
 	g_context = NULL;
 	return rc;
@@ -1580,6 +1601,11 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 	buffer = init_buf(4096);
 	_pack_cred(cred, buffer);
 
+	if (_sig_cache_find(cred->signature, cred->siglen, buffer)) {
+		free_buf(buffer);
+		return SLURM_SUCCESS;
+	}
+
 	rc = (*(ops.crypto_verify_sign))(ctx->key,
 					 get_buf_data(buffer),
 					 get_buf_offset(buffer),
@@ -1592,6 +1618,10 @@ _slurm_cred_verify_signature(slurm_cred_ctx_t ctx, slurm_cred_t *cred)
 						 cred->signature,
 						 cred->siglen);
 	}
+	if (rc == 0) {
+		_sig_cache_add(cred->signature, cred->siglen, buffer,
+			       cred->ctime + ctx->expiry_window);
+	}
 	free_buf(buffer);
 
 	if (rc) {
@@ -2137,28 +2167,161 @@ void delete_sbcast_cred(sbcast_cred_t *sbcast_cred)
 	}
 }
 
-static void _sbast_cache_add(sbcast_cred_t *sbcast_cred)
+static int _sig_cache_inx(char *signature, unsigned int siglen)
 {
-	int i;
-	uint32_t sig_num = 0;
-	struct sbcast_cache *new_cache_rec;
-
-	/* Using two bytes at a time gives us a larger number
-	 * and reduces the possibility of a duplicate value */
-	for (i = 0; i < sbcast_cred->siglen; i += 2) {
-		sig_num += (sbcast_cred->signature[i] << 8) +
-			   sbcast_cred->signature[i+1];
+	uint32_t hash = 2166136261U;
+	unsigned int i;
+
+	for (i = 0; i < siglen; i++) {
+		hash ^= (unsigned char) signature[i];
+		hash *= 16777619;
+	}
+	return hash % SIG_CACHE_SIZE;
+}
+
+/* Return true if cache holds an unexpired signature for the credential
+ * packed in buffer */
+static bool _sig_cache_match(sig_cache_t *cache, char *signature,
+			     unsigned int siglen, Buf buffer, time_t now)
+{
+	return (cache->signature && (cache->expire >= now) &&
+		(cache->siglen == siglen) &&
+		(cache->data_len == get_buf_offset(buffer)) &&
+		!memcmp(cache->signature, signature, siglen) &&
+		!memcmp(cache->data, get_buf_data(buffer), cache->data_len));
+}
+
+/* Copy the signature and the credential packed in buffer into cache */
+static void _sig_cache_set(sig_cache_t *cache, char *signature,
+			   unsigned int siglen, Buf buffer, time_t expire)
+{
+	xfree(cache->signature);
+	xfree(cache->data);
+	cache->expire = expire;
+	cache->siglen = siglen;
+	cache->signature = xmalloc(siglen);
+	memcpy(cache->signature, signature, siglen);
+	cache->data_len = get_buf_offset(buffer);
+	cache->data = xmalloc(cache->data_len);
+	memcpy(cache->data, get_buf_data(buffer), cache->data_len);
+}
+
+static void _sig_cache_free(void *x)
+{
+	sig_cache_t *cache = (sig_cache_t *) x;
+
+	if (cache) {
+		xfree(cache->signature);
+		xfree(cache->data);
+		xfree(cache);
 	}
+}
+
+/* Return true if this signature was recently verified for the credential
+ * packed in buffer, so the signature check can be skipped. Any replay or
+ * revocation checks must still be made by the caller. */
+static bool _sig_cache_find(char *signature, unsigned int siglen, Buf buffer)
+{
+	bool found = false;
+
+	if (!signature || !siglen)
+		return false;
 
-	new_cache_rec = xmalloc(sizeof(struct sbcast_cache));
-	new_cache_rec->expire = sbcast_cred->expiration;
-	new_cache_rec->value  = sig_num;
-	list_append(sbcast_cache_list, new_cache_rec);
+	slurm_mutex_lock(&sig_cache_lock);
+	if (_sig_cache_match(&sig_cache[_sig_cache_inx(signature, siglen)],
+			     signature, siglen, buffer, time(NULL))) {
+		found = true;
+		sig_cache_hits++;
+	} else
+		sig_cache_misses++;
+	slurm_mutex_unlock(&sig_cache_lock);
+
+	return found;
 }
 
-static void _sbcast_cache_del(void *x)
+/* Record a signature verified for the credential packed in buffer until
+ * the credential expires, replacing any entry in the same slot */
+static void _sig_cache_add(char *signature, unsigned int siglen,
+			   Buf buffer, time_t expire)
 {
-	xfree(x);
+	if (!signature || !siglen)
+		return;
+
+	slurm_mutex_lock(&sig_cache_lock);
+	_sig_cache_set(&sig_cache[_sig_cache_inx(signature, siglen)],
+		       signature, siglen, buffer, expire);
+	debug2("credential signature cache: %u hits, %u misses",
+	       sig_cache_hits, sig_cache_misses);
+	slurm_mutex_unlock(&sig_cache_lock);
+}
+
+/* Return true if this sbcast signature was verified for the credential
+ * packed in buffer. Expired entries are purged as the list is scanned. */
+static bool _sbcast_cache_find(char *signature, unsigned int siglen,
+			       Buf buffer)
+{
+	ListIterator iter;
+	sig_cache_t *cache;
+	time_t now = time(NULL);
+	bool found = false;
+
+	if (!signature || !siglen)
+		return false;
+
+	slurm_mutex_lock(&sig_cache_lock);
+	if (sbcast_cache_list) {
+		iter = list_iterator_create(sbcast_cache_list);
+		while ((cache = (sig_cache_t *) list_next(iter))) {
+			if (cache->expire < now) {
+				list_delete_item(iter);
+				continue;
+			}
+			if (_sig_cache_match(cache, signature, siglen,
+					     buffer, now)) {
+				found = true;
+				break;
+			}
+		}
+		list_iterator_destroy(iter);
+	}
+	slurm_mutex_unlock(&sig_cache_lock);
+
+	return found;
+}
+
+/* Record an sbcast signature verified for the credential packed in buffer.
+ * The entry is kept until the credential expires. */
+static void _sbcast_cache_add(char *signature, unsigned int siglen,
+			      Buf buffer, time_t expire)
+{
+	sig_cache_t *cache;
+
+	if (!signature || !siglen)
+		return;
+
+	cache = xmalloc(sizeof(sig_cache_t));
+	_sig_cache_set(cache, signature, siglen, buffer, expire);
+	slurm_mutex_lock(&sig_cache_lock);
+	if (!sbcast_cache_list)
+		sbcast_cache_list = list_create(_sig_cache_free);
+	list_append(sbcast_cache_list, cache);
+	slurm_mutex_unlock(&sig_cache_lock);
+}
+
+static void _sig_cache_purge(void)
+{
+	int i;
+
+	slurm_mutex_lock(&sig_cache_lock);
+	for (i = 0; i < SIG_CACHE_SIZE; i++) {
+		xfree(sig_cache[i].signature);
+		xfree(sig_cache[i].data);
+	}
+	if (sbcast_cache_list) {
+		list_destroy(sbcast_cache_list);
+		sbcast_cache_list = NULL;
+	}
+	slurm_mutex_unlock(&sig_cache_lock);
 }
 
 /* Extract contents of an sbcast credential verifying the digital signature.
@@ -2172,9 +2335,7 @@ int extract_sbcast_cred(slurm_cred_ctx_t ctx,
 			sbcast_cred_t *sbcast_cred, uint16_t block_no,
 			uint32_t *job_id, char **nodes)
 {
-	struct sbcast_cache *next_cache_rec;
-	uint32_t sig_num = 0;
-	int i, rc;
+	int rc;
 	time_t now = time(NULL);
 	Buf buffer;
 
@@ -2188,66 +2349,49 @@ int extract_sbcast_cred(slurm_cred_ctx_t ctx,
 	if (now > sbcast_cred->expiration)
 		return -1;
 
+	buffer = init_buf(4096);
+	_pack_sbcast_cred(sbcast_cred, buffer);
+	if (_sbcast_cache_find(sbcast_cred->signature, sbcast_cred->siglen,
+			       buffer))
+		goto verified;
+
 	if (block_no == 1) {
-		buffer = init_buf(4096);
-		_pack_sbcast_cred(sbcast_cred, buffer);
 		/* NOTE: the verification checks that the credential was
 		 * created by SlurmUser or root */
 		rc = (*(ops.crypto_verify_sign)) (
 			ctx->key, get_buf_data(buffer), get_buf_offset(buffer),
 			sbcast_cred->signature, sbcast_cred->siglen);
-		free_buf(buffer);
-
 		if (rc) {
 			error("sbcast_cred verify: %s",
 			      (*(ops.crypto_str_error))(rc));
+			free_buf(buffer);
 			return -1;
 		}
-		_sbast_cache_add(sbcast_cred);
-
 	} else {
 		char *err_str = NULL;
-		bool cache_match_found = false;
-		ListIterator sbcast_iter;
-		for (i = 0; i < sbcast_cred->siglen; i += 2) {
-			sig_num += (sbcast_cred->signature[i] << 8) +
-				   sbcast_cred->signature[i+1];
-		}
 
-		sbcast_iter = list_iterator_create(sbcast_cache_list);
-		while ((next_cache_rec = 
-			(struct sbcast_cache *) list_next(sbcast_iter))) {
-			if ((next_cache_rec->expire == sbcast_cred->expiration) &&
-			    (next_cache_rec->value  == sig_num)) {
-				cache_match_found = true;
-				break;
-			}
-			if (next_cache_rec->expire <= now)
-				list_delete_item(sbcast_iter);
+		error("sbcast_cred verify: signature not in cache");
+		if (SLURM_DIFFTIME(now, crypto_restart_time) > 60) {
+			free_buf(buffer);
+			return -1;	/* restarted >60 secs ago */
 		}
-		list_iterator_destroy(sbcast_iter);
-
-		if (!cache_match_found) {
-			error("sbcast_cred verify: signature not in cache");
-			if (SLURM_DIFFTIME(now, crypto_restart_time) > 60)
-				return -1;	/* restarted >60 secs ago */
-			buffer = init_buf(4096);
-			_pack_sbcast_cred(sbcast_cred, buffer);
-			rc = (*(ops.crypto_verify_sign)) (
-				ctx->key, get_buf_data(buffer),
-				get_buf_offset(buffer),
-				sbcast_cred->signature, sbcast_cred->siglen);
+		rc = (*(ops.crypto_verify_sign)) (
+			ctx->key, get_buf_data(buffer), get_buf_offset(buffer),
+			sbcast_cred->signature, sbcast_cred->siglen);
+		if (rc)
+			err_str = (char *)(*(ops.crypto_str_error))(rc);
+		if (err_str && strcmp(err_str, "Credential replayed")) {
+			error("sbcast_cred verify: %s", err_str);
 			free_buf(buffer);
-			if (rc)
-				err_str = (char *)(*(ops.crypto_str_error))(rc);
-			if (err_str && strcmp(err_str, "Credential replayed")) {
-				error("sbcast_cred verify: %s", err_str);
-				return -1;
-			}
-			info("sbcast_cred verify: signature revalidated");
-			_sbast_cache_add(sbcast_cred);
+			return -1;
 		}
+		info("sbcast_cred verify: signature revalidated");
 	}
+	_sbcast_cache_add(sbcast_cred->signature, sbcast_cred->siglen, buffer,
+			  sbcast_cred->expiration);
+
+verified:
+	free_buf(buffer);
 
 	*job_id = sbcast_cred->jobid;
 	*nodes  = xstrdup(sbcast_cred->nodes);
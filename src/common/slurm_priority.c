@@ -51,6 +51,7 @@ typedef struct slurm_priority_ops {
 	List	 (*get_priority_factors)
 	(priority_factors_request_msg_t *req_msg, uid_t uid);
 	void     (*job_end)        (struct job_record *job_ptr);
+	void     (*job_changed)    (struct job_record *job_ptr);
 } slurm_priority_ops_t;
 
 /*
@@ -63,6 +64,7 @@ static const char *syms[] = {
 	"priority_p_calc_fs_factor",
 	"priority_p_get_priority_factors_list",
 	"priority_p_job_end",
+	"priority_p_job_changed",
 };
 
 static slurm_priority_ops_t ops;
@@ -172,3 +174,11 @@ extern void priority_g_job_end(struct job_record *job_ptr)
 	(*(ops.job_end))(job_ptr);
 }
 
+extern void priority_g_job_changed(struct job_record *job_ptr)
+{
+	if (slurm_priority_init() < 0)
+		return;
+
+	(*(ops.job_changed))(job_ptr);
+}
+
@@ -73,4 +73,8 @@ extern List priority_g_get_priority_factors_list(
  */
 extern void priority_g_job_end(struct job_record *job_ptr);
 
+/* Call when a job is held, started or ended, or its priority is changed
+ * other than by priority_g_set() */
+extern void priority_g_job_changed(struct job_record *job_ptr);
+
 #endif /*_SLURM_PRIORIY_H */
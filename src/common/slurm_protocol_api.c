@@ -57,6 +57,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <poll.h>
 
 /* PROJECT INCLUDES */
 #include "src/common/fd.h"
@@ -81,6 +82,7 @@
 /* #DEFINES */
 #define _DEBUG	0
 #define MAX_SHUTDOWN_RETRY 5
+#define PERSIST_CONN_HASH_SIZE 1024
 
 /* STATIC VARIABLES */
 /* static pthread_mutex_t config_lock = PTHREAD_MUTEX_INITIALIZER; */
@@ -89,10 +91,27 @@ static slurm_protocol_config_t *proto_conf = &proto_conf_default;
 /* static slurm_ctl_conf_t slurmctld_conf; */
 static int message_timeout = -1;
 
+/* Idle connections to slurmd which it agreed to keep open, one per address,
+ * see slurm_persist_conn_enable() */
+typedef struct persist_conn {
+	slurm_addr_t addr;
+	slurm_fd_t fd;
+	time_t last_used;
+	struct persist_conn *next;
+} persist_conn_t;
+static persist_conn_t *persist_conn_hash[PERSIST_CONN_HASH_SIZE];
+static pthread_mutex_t persist_conn_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool persist_conn_enabled = false;
+static int  persist_conn_ttl = 0;
+
 /* STATIC FUNCTIONS */
 static char *_get_auth_info(void);
 static char *_global_auth_key(void);
 static void  _remap_slurmctld_errno(void);
+static List  _receive_msgs(slurm_fd_t fd, int steps, int timeout,
+			   uint16_t *resp_flags);
+static List  _send_recv_msgs_open(slurm_fd_t fd, slurm_msg_t *req,
+				  int timeout, uint16_t *resp_flags);
 static int   _unpack_msg_uid(Buf buffer);
 
 #if _DEBUG
@@ -2440,10 +2459,6 @@ int slurm_receive_msg(slurm_fd_t fd, slurm_msg_t *msg, int timeout)
 {
 	char *buf = NULL;
 	size_t buflen = 0;
-	header_t header;
-	int rc;
-	void *auth_cred = NULL;
-	Buf buffer;
 
 	xassert(fd >= 0);
 
@@ -2469,11 +2484,40 @@ int slurm_receive_msg(slurm_fd_t fd, slurm_msg_t *msg, int timeout)
 	 *  the message.
 	 */
 	if (_slurm_msg_recvfrom_timeout(fd, &buf, &buflen, 0, timeout) < 0) {
-		forward_init(&header.forward, NULL);
-		rc = errno;
-		goto total_return;
+		int rc = errno;
+		slurm_seterrno(rc);
+		msg->auth_cred = (void *) NULL;
+		error("slurm_receive_msg: %s", slurm_strerror(rc));
+		usleep(10000);	/* Discourage brute force attack */
+		return -1;
 	}
 
+	return slurm_unpack_received_msg(msg, fd, buf, buflen, NULL);
+}
+
+/*
+ * slurm_unpack_received_msg - unpack a message already read from a
+ *	connection as by slurm_receive_msg()
+ * OUT msg	- a slurm_msg struct to be filled in by the function
+ * IN fd	- file descriptor the message was read from
+ * IN buf	- message data following its length, xfreed by this function
+ * IN buflen	- size of buf in bytes
+ * IN arena	- if not NULL, arena to unpack the data of some message
+ *		  types into
+ * RET int	- returns 0 on success, -1 on failure and sets errno
+ */
+int slurm_unpack_received_msg(slurm_msg_t *msg, slurm_fd_t fd, char *buf,
+			      size_t buflen, struct xarena *arena)
+{
+	header_t header;
+	int rc;
+	void *auth_cred = NULL;
+	Buf buffer;
+
+	slurm_msg_t_init(msg);
+	msg->conn_fd = fd;
+	msg->arena = arena;
+
 #if	_DEBUG
 	_print_data (buf, buflen);
 #endif
@@ -2591,6 +2635,14 @@ total_return:
  *		  (ret_data_info_t).
  */
 List slurm_receive_msgs(slurm_fd_t fd, int steps, int timeout)
+{
+	return _receive_msgs(fd, steps, timeout, NULL);
+}
+
+/* As slurm_receive_msgs(), also returning the response header's flags
+ * in resp_flags if not NULL */
+static List _receive_msgs(slurm_fd_t fd, int steps, int timeout,
+			  uint16_t *resp_flags)
 {
 	char *buf = NULL;
 	size_t buflen = 0;
@@ -2738,6 +2790,8 @@ List slurm_receive_msgs(slurm_fd_t fd, int steps, int timeout)
 	g_slurm_auth_destroy(auth_cred);
 
 	free_buf(buffer);
+	if (resp_flags)
+		*resp_flags = header.flags;
 	rc = SLURM_SUCCESS;
 
 total_return:
@@ -2785,6 +2839,16 @@ static int _unpack_msg_uid(Buf buffer)
 	return uid;
 }
 
+/* Free a received message buffer whose data may be shared with a
+ * forward_struct, which then frees the data itself */
+static void _free_recv_buf(Buf buffer, forward_struct_t *forward_struct)
+{
+	if (forward_struct && (forward_struct->buf_head == buffer->head))
+		buffer->head = NULL;
+	free_buf(buffer);
+}
+
+
 /*
  * NOTE: memory is allocated for the returned msg and the returned list
  *       both must be freed at some point using the slurm_free_functions
@@ -2916,12 +2980,12 @@ int slurm_receive_msg_and_forward(slurm_fd_t fd, slurm_addr_t *orig_addr,
 		msg->forward_struct->forward_msg =
 			xmalloc(sizeof(forward_msg_t) * header.forward.cnt);
 
+		/* The forward threads send the rest of the received
+		 * message as is, so share it rather than copy it. The
+		 * forward_struct frees it, see _free_recv_buf() */
 		msg->forward_struct->buf_len = remaining_buf(buffer);
-		msg->forward_struct->buf =
-			xmalloc(sizeof(char) * msg->forward_struct->buf_len);
-		memcpy(msg->forward_struct->buf,
-		       &buffer->head[buffer->processed],
-		       msg->forward_struct->buf_len);
+		msg->forward_struct->buf = &buffer->head[buffer->processed];
+		msg->forward_struct->buf_head = buffer->head;
 
 		msg->forward_struct->ret_list = msg->ret_list;
 		/* take out the amount of timeout from this hop */
@@ -2942,7 +3006,7 @@ int slurm_receive_msg_and_forward(slurm_fd_t fd, slurm_addr_t *orig_addr,
 	if ((auth_cred = g_slurm_auth_unpack(buffer)) == NULL) {
 		error( "authentication: %s ",
 		       g_slurm_auth_errstr(g_slurm_auth_errno(NULL)));
-		free_buf(buffer);
+		_free_recv_buf(buffer, msg->forward_struct);
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
 		goto total_return;
 	}
@@ -2958,7 +3022,7 @@ int slurm_receive_msg_and_forward(slurm_fd_t fd, slurm_addr_t *orig_addr,
 		error( "authentication: %s ",
 		       g_slurm_auth_errstr(g_slurm_auth_errno(auth_cred)));
 		(void) g_slurm_auth_destroy(auth_cred);
-		free_buf(buffer);
+		_free_recv_buf(buffer, msg->forward_struct);
 		rc = SLURM_PROTOCOL_AUTHENTICATION_ERROR;
 		goto total_return;
 	}
@@ -2973,14 +3037,14 @@ int slurm_receive_msg_and_forward(slurm_fd_t fd, slurm_addr_t *orig_addr,
 	if ( (header.body_length > remaining_buf(buffer)) ||
 	     (unpack_msg(msg, buffer) != SLURM_SUCCESS) ) {
 		(void) g_slurm_auth_destroy(auth_cred);
-		free_buf(buffer);
+		_free_recv_buf(buffer, msg->forward_struct);
 		rc = ESLURM_PROTOCOL_INCOMPLETE_PACKET;
 		goto total_return;
 	}
 
 	msg->auth_cred = (void *) auth_cred;
 
-	free_buf(buffer);
+	_free_recv_buf(buffer, msg->forward_struct);
 	rc = SLURM_SUCCESS;
 
 total_return:
@@ -3029,12 +3093,28 @@ _pack_msg(slurm_msg_t *msg, header_t *hdr, Buf buffer)
 }
 
 /*
- *  Send a slurm message over an open file descriptor `fd'
- *    Returns the size of the message sent in bytes, or -1 on failure.
+ *  Update hdr for a message whose data is sent unchanged after it
+ *  and repack hdr into buffer
  */
-int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
+static void
+_pack_header_only(slurm_msg_t *msg, header_t *hdr, Buf buffer)
+{
+	unsigned int tmplen;
+
+	update_header(hdr, msg->data_size);
+
+	tmplen = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack_header(hdr, buffer);
+	set_buf_offset(buffer, tmplen);
+}
+
+/*
+ *  Pack the header and auth credential of msg into a new buffer
+ *    Returns the buffer, or NULL on failure with errno set.
+ */
+static Buf _init_msg_buf(slurm_msg_t *msg, header_t *header)
 {
-	header_t header;
 	Buf      buffer;
 	int      rc;
 	void *   auth_cred;
@@ -3050,7 +3130,8 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	if (auth_cred == NULL) {
 		error("authentication: %s",
 		      g_slurm_auth_errstr(g_slurm_auth_errno(NULL)) );
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
 	}
 
 	if (msg->forward.init != FORWARD_INIT) {
@@ -3059,13 +3140,13 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 	}
 	forward_wait(msg);
 
-	init_header(&header, msg, msg->flags);
+	init_header(header, msg, msg->flags);
 
 	/*
 	 * Pack header into buffer for transmission
 	 */
 	buffer = init_buf(BUF_SIZE);
-	pack_header(&header, buffer);
+	pack_header(header, buffer);
 
 	/*
 	 * Pack auth credential
@@ -3076,23 +3157,73 @@ int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
 		error("authentication: %s",
 		      g_slurm_auth_errstr(g_slurm_auth_errno(auth_cred)));
 		free_buf(buffer);
-		slurm_seterrno_ret(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		slurm_seterrno(SLURM_PROTOCOL_AUTHENTICATION_ERROR);
+		return NULL;
 	}
 
-	/*
-	 * Pack message into buffer
-	 */
+	return buffer;
+}
+
+/*
+ *  Pack a slurm message as sent by slurm_send_node_msg()
+ *    Returns the buffer, or NULL on failure with errno set.
+ */
+Buf slurm_pack_node_msg(slurm_msg_t *msg)
+{
+	header_t header;
+	Buf      buffer;
+
+	if (!(buffer = _init_msg_buf(msg, &header)))
+		return NULL;
 	_pack_msg(msg, &header, buffer);
+	return buffer;
+}
+
+/*
+ *  Send a slurm message over an open file descriptor `fd'
+ *    Returns the size of the message sent in bytes, or -1 on failure.
+ */
+int slurm_send_node_msg(slurm_fd_t fd, slurm_msg_t * msg)
+{
+	header_t header;
+	Buf      buffer;
+	int      rc;
+
+	if (!(buffer = _init_msg_buf(msg, &header)))
+		return SLURM_ERROR;
+
+	if (pack_msg_is_data(msg)) {
+		struct iovec iov[2];
+
+		/*
+		 * Message data is already packed (e.g. job information
+		 * from slurmctld), send it after the header rather than
+		 * copying it into the buffer
+		 */
+		_pack_header_only(msg, &header, buffer);
+		iov[0].iov_base = get_buf_data(buffer);
+		iov[0].iov_len  = get_buf_offset(buffer);
+		iov[1].iov_base = msg->data;
+		iov[1].iov_len  = msg->data_size;
+		rc = _slurm_msg_sendv_timeout(
+			fd, iov, 2, SLURM_PROTOCOL_NO_SEND_RECV_FLAGS,
+			(slurm_get_msg_timeout() * 1000));
+	} else {
+		/*
+		 * Pack message into buffer
+		 */
+		_pack_msg(msg, &header, buffer);
 
 #if	_DEBUG
-	_print_data (get_buf_data(buffer),get_buf_offset(buffer));
+		_print_data (get_buf_data(buffer),get_buf_offset(buffer));
 #endif
-	/*
-	 * Send message
-	 */
-	rc = _slurm_msg_sendto( fd, get_buf_data(buffer),
-				get_buf_offset(buffer),
-				SLURM_PROTOCOL_NO_SEND_RECV_FLAGS );
+		/*
+		 * Send message
+		 */
+		rc = _slurm_msg_sendto( fd, get_buf_data(buffer),
+					get_buf_offset(buffer),
+					SLURM_PROTOCOL_NO_SEND_RECV_FLAGS );
+	}
 
 	if ((rc < 0) && (errno == ENOTCONN)) {
 		debug3("slurm_msg_sendto: peer has disappeared for msg_type=%u",
@@ -3551,6 +3682,30 @@ static List
 _send_and_recv_msgs(slurm_fd_t fd, slurm_msg_t *req, int timeout)
 {
 	int retry = 0;
+	List ret_list;
+
+	ret_list = _send_recv_msgs_open(fd, req, timeout, NULL);
+
+	/*
+	 *  Attempt to close an open connection
+	 */
+	while ((slurm_shutdown_msg_conn(fd) < 0) && (errno == EINTR) ) {
+		if (retry++ > MAX_SHUTDOWN_RETRY) {
+			break;
+		}
+	}
+
+	return ret_list;
+}
+
+/*
+ * As _send_and_recv_msgs(), but leave the connection open and return the
+ * response header's flags in resp_flags if not NULL
+ */
+static List
+_send_recv_msgs_open(slurm_fd_t fd, slurm_msg_t *req, int timeout,
+		     uint16_t *resp_flags)
+{
 	List ret_list = NULL;
 	int steps = 0;
 	int width;
@@ -3578,17 +3733,7 @@ _send_and_recv_msgs(slurm_fd_t fd, slurm_msg_t *req, int timeout)
 
 			timeout += (req->forward.timeout*steps);
 		}
-		ret_list = slurm_receive_msgs(fd, steps, timeout);
-	}
-
-
-	/*
-	 *  Attempt to close an open connection
-	 */
-	while ((slurm_shutdown_msg_conn(fd) < 0) && (errno == EINTR) ) {
-		if (retry++ > MAX_SHUTDOWN_RETRY) {
-			break;
-		}
+		ret_list = _receive_msgs(fd, steps, timeout, resp_flags);
 	}
 
 	return ret_list;
@@ -3808,6 +3953,120 @@ List slurm_send_recv_msgs(const char *nodelist, slurm_msg_t *msg,
 	return ret_list;
 }
 
+/*
+ * slurm_persist_msg_type - return true if a connection on which this type
+ *	of message was sent may be kept open for another message of the
+ *	same kind. These are the frequent, short and idempotent requests
+ *	sent to every slurmd which reply only once processing is done.
+ */
+extern bool slurm_persist_msg_type(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_PING:
+	case REQUEST_ACCT_GATHER_UPDATE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * slurm_persist_conn_enable - keep connections opened by
+ *	slurm_send_addr_recv_msgs() for slurm_persist_msg_type() messages
+ *	open for reuse when the slurmd agrees to it
+ * IN enable - false closes any open connections
+ * IN idle_secs - how long slurmd keeps an idle connection open
+ */
+extern void slurm_persist_conn_enable(bool enable, int idle_secs)
+{
+	persist_conn_t *conn;
+	int i;
+
+	slurm_mutex_lock(&persist_conn_lock);
+	persist_conn_enabled = enable;
+	persist_conn_ttl = idle_secs;
+	if (!enable) {
+		for (i = 0; i < PERSIST_CONN_HASH_SIZE; i++) {
+			while ((conn = persist_conn_hash[i])) {
+				persist_conn_hash[i] = conn->next;
+				slurm_close_stream(conn->fd);
+				xfree(conn);
+			}
+		}
+	}
+	slurm_mutex_unlock(&persist_conn_lock);
+}
+
+static int _persist_conn_hash(slurm_addr_t *addr)
+{
+	return (addr->sin_addr.s_addr ^ addr->sin_port) %
+	       PERSIST_CONN_HASH_SIZE;
+}
+
+/* Remove and return an idle connection to addr, -1 if none.
+ * Connections that are closing or near slurmd's idle timeout are closed. */
+static slurm_fd_t _persist_conn_get(slurm_addr_t *addr)
+{
+	persist_conn_t *conn, **conn_pp;
+	struct pollfd pfd;
+	slurm_fd_t fd = -1;
+	time_t last_used, now = time(NULL);
+
+	slurm_mutex_lock(&persist_conn_lock);
+	conn_pp = &persist_conn_hash[_persist_conn_hash(addr)];
+	while ((conn = *conn_pp)) {
+		if ((conn->addr.sin_addr.s_addr != addr->sin_addr.s_addr) ||
+		    (conn->addr.sin_port != addr->sin_port)) {
+			conn_pp = &conn->next;
+			continue;
+		}
+		*conn_pp = conn->next;
+		fd = conn->fd;
+		last_used = conn->last_used;
+		xfree(conn);
+		/* Nothing should be readable on an idle connection, so
+		 * anything here is slurmd closing it */
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		if ((difftime(now, last_used) >= (persist_conn_ttl / 2)) ||
+		    (poll(&pfd, 1, 0) != 0)) {
+			slurm_close_stream(fd);
+			fd = -1;
+		}
+		break;
+	}
+	slurm_mutex_unlock(&persist_conn_lock);
+
+	return fd;
+}
+
+/* Keep an open connection to addr for reuse, or close it if disabled or
+ * one is already kept */
+static void _persist_conn_put(slurm_addr_t *addr, slurm_fd_t fd)
+{
+	persist_conn_t *conn;
+	int inx = _persist_conn_hash(addr);
+
+	slurm_mutex_lock(&persist_conn_lock);
+	for (conn = persist_conn_hash[inx]; conn; conn = conn->next) {
+		if ((conn->addr.sin_addr.s_addr == addr->sin_addr.s_addr) &&
+		    (conn->addr.sin_port == addr->sin_port))
+			break;
+	}
+	if (!persist_conn_enabled || conn) {
+		slurm_mutex_unlock(&persist_conn_lock);
+		slurm_close_stream(fd);
+		return;
+	}
+	conn = xmalloc(sizeof(persist_conn_t));
+	memcpy(&conn->addr, addr, sizeof(slurm_addr_t));
+	conn->fd = fd;
+	conn->last_used = time(NULL);
+	conn->next = persist_conn_hash[inx];
+	persist_conn_hash[inx] = conn;
+	slurm_mutex_unlock(&persist_conn_lock);
+}
+
 /*
  *  Send a message to msg->address
  *    Then return List containing type (ret_data_info_t).
@@ -3824,31 +4083,70 @@ List slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout)
 	slurm_fd_t fd = -1;
 	ret_data_info_t *ret_data_info = NULL;
 	ListIterator itr;
+	uint16_t resp_flags = 0;
+	bool persist = false;
 	int i;
 
-	if (conn_timeout == (uint16_t) NO_VAL)
-		conn_timeout = MIN(slurm_get_msg_timeout(), 10);
-	/* This connect retry logic permits Slurm hierarchical communications
-	 * to better survive slurmd restarts */
-	for (i = 0; i <= conn_timeout; i++) {
-		if (i > 0)
-			sleep(1);
-		fd = slurm_open_msg_conn(&msg->address);
-		if ((fd >= 0) || (errno != ECONNREFUSED))
-			break;
-		if (i == 0)
-			debug3("connect refused, retrying");
+	msg->ret_list = NULL;
+	msg->forward_struct = NULL;
+	if (persist_conn_enabled && slurm_persist_msg_type(msg->msg_type)) {
+		persist = true;
+		msg->flags |= SLURM_PERSIST_REQ;
+		if ((fd = _persist_conn_get(&msg->address)) >= 0) {
+			ret_list = _send_recv_msgs_open(fd, msg, timeout,
+							&resp_flags);
+			if (!ret_list) {
+				/* slurmd may have just closed it, retry
+				 * with a new connection */
+				debug3("%s: persistent connection to %s "
+				       "failed, reconnecting", __func__, name);
+				slurm_close_stream(fd);
+				fd = -1;
+			}
+		}
 	}
-	if (fd < 0) {
-		mark_as_failed_forward(&ret_list, name,
-				       SLURM_COMMUNICATIONS_CONNECTION_ERROR);
-		errno = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
-		return ret_list;
+
+	if (!ret_list) {
+		if (conn_timeout == (uint16_t) NO_VAL)
+			conn_timeout = MIN(slurm_get_msg_timeout(), 10);
+		/* This connect retry logic permits Slurm hierarchical
+		 * communications to better survive slurmd restarts */
+		for (i = 0; i <= conn_timeout; i++) {
+			if (i > 0)
+				sleep(1);
+			fd = slurm_open_msg_conn(&msg->address);
+			if ((fd >= 0) || (errno != ECONNREFUSED))
+				break;
+			if (i == 0)
+				debug3("connect refused, retrying");
+		}
+		if (fd < 0) {
+			mark_as_failed_forward(
+				&ret_list, name,
+				SLURM_COMMUNICATIONS_CONNECTION_ERROR);
+			errno = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
+			return ret_list;
+		}
+
+		if (persist) {
+			ret_list = _send_recv_msgs_open(fd, msg, timeout,
+							&resp_flags);
+		} else {
+			ret_list = _send_and_recv_msgs(fd, msg, timeout);
+			fd = -1;
+		}
 	}
 
-	msg->ret_list = NULL;
-	msg->forward_struct = NULL;
-	if (!(ret_list = _send_and_recv_msgs(fd, msg, timeout))) {
+	if (fd >= 0) {
+		int save_errno = errno;
+		if (ret_list && (resp_flags & SLURM_PERSIST_ACK))
+			_persist_conn_put(&msg->address, fd);
+		else
+			slurm_close_stream(fd);
+		errno = save_errno;
+	}
+
+	if (!ret_list) {
 		mark_as_failed_forward(&ret_list, name, errno);
 		errno = SLURM_COMMUNICATIONS_CONNECTION_ERROR;
 		return ret_list;
@@ -785,6 +785,22 @@ extern int slurm_shutdown_msg_engine(slurm_fd_t open_fd);
  */
 int slurm_receive_msg(slurm_fd_t fd, slurm_msg_t *msg, int timeout);
 
+/*
+ * slurm_unpack_received_msg - unpack a message already read from a
+ *    connection (its data following the message length), as done by
+ *    slurm_receive_msg(). Memory is allocated as by slurm_receive_msg().
+ *
+ * OUT msg	- a slurm_msg struct to be filled in by the function
+ * IN fd	- file descriptor the message was read from
+ * IN buf	- message data, xfreed by this function
+ * IN buflen	- size of buf in bytes
+ * IN arena	- if not NULL, arena to unpack the data of some message
+ *		  types into, see slurm_msg_t
+ * RET int	- returns 0 on success, -1 on failure and sets errno
+ */
+int slurm_unpack_received_msg(slurm_msg_t *msg, slurm_fd_t fd, char *buf,
+			      size_t buflen, struct xarena *arena);
+
 /*
  *  Receive a slurm message on the open slurm descriptor "fd" waiting
  *    at most "timeout" seconds for the message data. If timeout is
@@ -834,6 +850,16 @@ int slurm_receive_msg_and_forward(slurm_fd_t fd, slurm_addr_t *orig_addr,
  */
 int slurm_send_node_msg(slurm_fd_t open_fd, slurm_msg_t *msg);
 
+/* packs a message as sent by slurm_send_node_msg(), so that it can be
+ * written to several connections. The message length (the buffer's offset
+ * in network byte order) must be written before the buffer's data.
+ *
+ * IN msg		- a slurm msg struct to be packed
+ * RET Buf		- packed message, free with free_buf(), or NULL on
+ *			  error with errno set
+ */
+Buf slurm_pack_node_msg(slurm_msg_t *msg);
+
 /**********************************************************************\
  * msg connection establishment functions used by msg clients
 \**********************************************************************/
@@ -1138,6 +1164,27 @@ List slurm_send_recv_msgs(const char *nodelist, slurm_msg_t *msg, int timeout,
  */
 List slurm_send_addr_recv_msgs(slurm_msg_t *msg, char *name, int timeout);
 
+/* Seconds slurmd keeps an idle persistent connection open if SlurmdTimeout
+ * is zero, otherwise it keeps it for twice SlurmdTimeout so that it outlasts
+ * the interval between pings */
+#define PERSIST_CONN_IDLE	300
+
+/*
+ * slurm_persist_msg_type - return true if a connection on which this type
+ *	of message was sent may be kept open for another message of the
+ *	same kind
+ */
+extern bool slurm_persist_msg_type(uint16_t msg_type);
+
+/*
+ * slurm_persist_conn_enable - keep connections opened by
+ *	slurm_send_addr_recv_msgs() for slurm_persist_msg_type() messages
+ *	open for reuse when the slurmd agrees to it
+ * IN enable - false closes any open connections
+ * IN idle_secs - how long slurmd keeps an idle connection open
+ */
+extern void slurm_persist_conn_enable(bool enable, int idle_secs);
+
 /*
  *  Same as above, but only to one node
  *  returns 0 on success, -1 on failure and sets errno
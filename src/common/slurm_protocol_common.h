@@ -64,6 +64,10 @@
  * this may need to be increased to 350k-512k */
 #define SLURM_PROTOCOL_MAX_MESSAGE_BUFFER_SIZE (512*1024)
 
+/* Maximum message size. Messages larger than this value (in bytes)
+ * will not be received. */
+#define SLURM_PROTOCOL_MAX_MSG_SIZE (1024*1024*1024)
+
 /* slurm protocol header defines, based upon config.h, 16 bits */
 /* A new SLURM_PROTOCOL_VERSION needs to be made each time the version
  * changes so the slurmdbd can talk all versions for update messages.
@@ -86,6 +90,8 @@
 /* used to set flags to empty */
 #define SLURM_PROTOCOL_NO_FLAGS 0
 #define SLURM_GLOBAL_AUTH_KEY   0x0001
+#define SLURM_PERSIST_REQ       0x0004	/* sender can reuse the connection */
+#define SLURM_PERSIST_ACK       0x0008	/* receiver keeps the connection */
 
 #include "src/common/slurm_protocol_socket_common.h"
 
@@ -953,7 +953,25 @@ extern void slurm_free_suspend_int_msg(suspend_int_msg_t *msg)
 
 extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 {
-	xfree(msg);
+	int i;
+
+	if (msg) {
+		/* counts may be set without records if unpacking failed */
+		for (i = 0; msg->lock_stats && (i < msg->lock_stats_cnt); i++)
+			xfree(msg->lock_stats[i].name);
+		xfree(msg->lock_stats);
+		for (i = 0; msg->lock_site_stats && (i < msg->lock_site_cnt);
+		     i++) {
+			xfree(msg->lock_site_stats[i].caller);
+			xfree(msg->lock_site_stats[i].lock_name);
+			xfree(msg->lock_site_stats[i].wait_hist);
+			xfree(msg->lock_site_stats[i].hold_hist);
+		}
+		xfree(msg->lock_site_stats);
+		xfree(msg->dbd_agent_batch_hist);
+		xfree(msg->dbd_agent_rtt_hist);
+		xfree(msg);
+	}
 }
 
 extern void slurm_free_spank_env_request_msg(spank_env_request_msg_t *msg)
@@ -2147,6 +2165,28 @@ extern void slurm_free_job_info_msg(job_info_msg_t * job_buffer_ptr)
 	}
 }
 
+/*
+ * slurm_free_job_info_delta_msg - free the job information delta message
+ * IN msg - pointer to job information delta message
+ * NOTE: buffer is loaded by slurm_load_jobs_delta.
+ */
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t * job_delta_ptr)
+{
+	int i;
+
+	if (job_delta_ptr) {
+		if (job_delta_ptr->job_array) {
+			for (i = 0; i < job_delta_ptr->record_count; i++) {
+				slurm_free_job_info_members(
+					&job_delta_ptr->job_array[i]);
+			}
+			xfree(job_delta_ptr->job_array);
+		}
+		xfree(job_delta_ptr->purged_job_id);
+		xfree(job_delta_ptr);
+	}
+}
+
 static void _free_all_job_info(job_info_msg_t *msg)
 {
 	int i;
@@ -2603,6 +2643,7 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 		slurm_free_last_update_msg(data);
 		break;
 	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_DELTA:
 		slurm_free_job_info_request_msg(data);
 		break;
 	case REQUEST_NODE_INFO:
@@ -239,6 +239,8 @@ typedef enum {
 	RESPONSE_STATS_RESET,
 	REQUEST_JOB_USER_INFO,
 	REQUEST_NODE_INFO_SINGLE,
+	REQUEST_JOB_INFO_DELTA,
+	RESPONSE_JOB_INFO_DELTA,
 
 	REQUEST_UPDATE_JOB = 3001,
 	REQUEST_UPDATE_NODE,
@@ -401,8 +403,10 @@ typedef struct forward_struct {
 	pthread_mutex_t forward_mutex;
 	pthread_cond_t notify;
 	forward_msg_t *forward_msg;
-	char *buf;
+	char *buf;		/* message body to forward, shared by all
+				 * forward_msg and not modified */
 	int buf_len;
+	char *buf_head;		/* received message holding buf */
 	List ret_list;
 } forward_struct_t;
 
@@ -429,6 +433,9 @@ typedef struct slurm_msg {
 	forward_struct_t *forward_struct;
 	slurm_addr_t orig_addr;
 	List ret_list;
+	struct xarena *arena; /* DON'T PACK! If set, data of some message
+			       * types is unpacked into this arena. The data
+			       * must not be used after the arena is reset. */
 } slurm_msg_t;
 
 typedef struct ret_data_info {
@@ -1194,6 +1201,7 @@ extern void slurm_free_submit_response_response_msg(
 		submit_response_msg_t * msg);
 extern void slurm_free_ctl_conf(slurm_ctl_conf_info_msg_t * config_ptr);
 extern void slurm_free_job_info_msg(job_info_msg_t * job_buffer_ptr);
+extern void slurm_free_job_info_delta_msg(job_info_delta_msg_t * job_delta_ptr);
 extern void slurm_free_job_step_info_response_msg(
 		job_step_info_response_msg_t * msg);
 extern void slurm_free_job_step_info_members (job_step_info_t * msg);
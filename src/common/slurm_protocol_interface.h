@@ -56,6 +56,7 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 
 
 #if HAVE_SYS_SOCKET_H
@@ -166,6 +167,15 @@ ssize_t _slurm_msg_sendto ( slurm_fd_t open_fd, char *buffer ,
 ssize_t _slurm_msg_sendto_timeout ( slurm_fd_t open_fd, char *buffer,
 				    size_t size, uint32_t flags, int timeout );
 
+/* _slurm_msg_sendv_timeout is identical to _slurm_msg_sendto_timeout except
+ * the message is sent from a list of buffers rather than being copied into
+ * one buffer first
+ * IN iov - buffers to transmit, in order
+ * IN iov_cnt - number of buffers in iov
+ * RET number of bytes written */
+ssize_t _slurm_msg_sendv_timeout ( slurm_fd_t open_fd, struct iovec *iov,
+				   int iov_cnt, uint32_t flags, int timeout );
+
 /* _slurm_accept_msg_conn
  * In the bsd implmentation maps directly to a accept call
  * IN open_fd		- file descriptor to accept connection on
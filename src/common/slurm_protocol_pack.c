@@ -431,6 +431,8 @@ static void _pack_job_desc_msg(job_desc_msg_t * job_desc_ptr, Buf buffer,
 static int _unpack_job_desc_msg(job_desc_msg_t ** job_desc_buffer_ptr,
 				Buf buffer,
 				uint16_t protocol_version);
+static int _unpack_job_info_delta_msg(job_info_delta_msg_t ** msg, Buf buffer,
+				      uint16_t protocol_version);
 static int _unpack_job_info_msg(job_info_msg_t ** msg, Buf buffer,
 				uint16_t protocol_version);
 
@@ -793,6 +795,7 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 					 msg->protocol_version);
 		break;
 	case RESPONSE_JOB_INFO:
+	case RESPONSE_JOB_INFO_DELTA:
 		_pack_job_info_msg((slurm_msg_t *) msg, buffer);
 		break;
 	case RESPONSE_PARTITION_INFO:
@@ -965,6 +968,7 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 					    msg->protocol_version);
 		break;
 	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_DELTA:
 		_pack_job_info_request_msg((job_info_request_msg_t *)
 					   msg->data, buffer,
 					   msg->protocol_version);
@@ -1326,6 +1330,62 @@ pack_msg(slurm_msg_t const *msg, Buf buffer)
 	return SLURM_SUCCESS;
 }
 
+/* pack_msg_is_data
+ * IN msg - the message to be sent
+ * RET true if pack_msg() copies the message's data (msg->data_size bytes
+ *	at msg->data) into the buffer unchanged. The data can then be sent
+ *	directly after the header without being packed.
+ */
+bool
+pack_msg_is_data(slurm_msg_t const *msg)
+{
+	switch (msg->msg_type) {
+	case RESPONSE_JOB_INFO:
+	case RESPONSE_JOB_INFO_DELTA:
+	case RESPONSE_PARTITION_INFO:
+	case RESPONSE_NODE_INFO:
+	case RESPONSE_RESERVATION_INFO:
+	case RESPONSE_JOB_STEP_INFO:
+	case RESPONSE_BLOCK_INFO:
+	case RESPONSE_FRONT_END_INFO:
+	case RESPONSE_STATS_INFO:
+	case RESPONSE_LICENSE_INFO:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* _unpack_msg_arena_ok
+ * RET true if the data of messages of this type may be allocated from
+ *	the message's arena. The receivers of these messages do not keep
+ *	any pointer into the message data after it is freed.
+ */
+static bool _unpack_msg_arena_ok(uint16_t msg_type)
+{
+	switch (msg_type) {
+	case REQUEST_BUILD_INFO:
+	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_DELTA:
+	case REQUEST_JOB_USER_INFO:
+	case REQUEST_JOB_INFO_SINGLE:
+	case REQUEST_JOB_STEP_INFO:
+	case REQUEST_NODE_INFO:
+	case REQUEST_NODE_INFO_SINGLE:
+	case REQUEST_PARTITION_INFO:
+	case REQUEST_RESERVATION_INFO:
+	case REQUEST_LICENSE_INFO:
+	case REQUEST_STATS_INFO:
+	case REQUEST_COMPLETE_BATCH_SCRIPT:
+	case REQUEST_COMPLETE_JOB_ALLOCATION:
+	case REQUEST_STEP_COMPLETE:
+	case MESSAGE_EPILOG_COMPLETE:
+		return true;
+	default:
+		return false;
+	}
+}
+
 /* unpack_msg
  * unpacks a generic slurm protocol message body
  * OUT msg - the body structure to unpack (note: includes message type)
@@ -1339,6 +1399,9 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 	int rc = SLURM_SUCCESS;
 	msg->data = NULL;	/* Initialize to no data for now */
 
+	if (msg->arena && _unpack_msg_arena_ok(msg->msg_type))
+		buffer->arena = msg->arena;
+
 	switch (msg->msg_type) {
 	case REQUEST_NODE_INFO:
 		rc = _unpack_node_info_request_msg((node_info_request_msg_t **)
@@ -1377,6 +1440,11 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 					  buffer,
 					  msg->protocol_version);
 		break;
+	case RESPONSE_JOB_INFO_DELTA:
+		rc = _unpack_job_info_delta_msg(
+			(job_info_delta_msg_t **) & (msg->data), buffer,
+			msg->protocol_version);
+		break;
 	case RESPONSE_PARTITION_INFO:
 		rc = _unpack_partition_info_msg((partition_info_msg_t **) &
 						(msg->data), buffer,
@@ -1562,6 +1630,7 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 		break;
 		/********  job_step_id_t Messages  ********/
 	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_DELTA:
 		rc = _unpack_job_info_request_msg((job_info_request_msg_t**)
 						  & (msg->data), buffer,
 						  msg->protocol_version);
@@ -1956,6 +2025,7 @@ unpack_msg(slurm_msg_t * msg, Buf buffer)
 		break;
 	}
 
+	buffer->arena = NULL;
 	if (rc)
 		error("Malformed RPC of type %u received", msg->msg_type);
 	return rc;
@@ -4360,6 +4430,44 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static int
+_unpack_job_info_delta_msg(job_info_delta_msg_t ** msg, Buf buffer,
+			   uint16_t protocol_version)
+{
+	int i;
+	uint32_t uint32_tmp;
+	job_info_t *job = NULL;
+
+	xassert(msg != NULL);
+	*msg = xmalloc(sizeof(job_info_delta_msg_t));
+
+	if (protocol_version >= SLURM_14_03_PROTOCOL_VERSION) {
+		safe_unpack32(&((*msg)->record_count), buffer);
+		safe_unpack_time(&((*msg)->last_update), buffer);
+		job = (*msg)->job_array =
+			xmalloc(sizeof(job_info_t) * (*msg)->record_count);
+		for (i = 0; i < (*msg)->record_count; i++) {
+			if (_unpack_job_info_members(&job[i], buffer,
+						     protocol_version))
+				goto unpack_error;
+		}
+		safe_unpack16(&((*msg)->flags), buffer);
+		safe_unpack32_array(&((*msg)->purged_job_id), &uint32_tmp,
+				    buffer);
+		(*msg)->purged_count = uint32_tmp;
+	} else {
+		error("_unpack_job_info_delta_msg: protocol_version "
+		      "%hu not supported", protocol_version);
+		goto unpack_error;
+	}
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_info_delta_msg(*msg);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 /* _unpack_job_info_members
  * unpacks a set of slurm job info for one job
  * OUT job - pointer to the job info buffer
@@ -11366,6 +11474,7 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 				       Buf buffer, uint16_t protocol_version)
 {
 	stats_info_response_msg_t * msg;
+	uint32_t i, uint32_tmp;
 	xassert ( msg_ptr != NULL );
 
 	msg = xmalloc ( sizeof (stats_info_response_msg_t) );
@@ -11406,6 +11515,109 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 			safe_unpack32(&msg->bf_depth_try_sum,	buffer);
 			safe_unpack32(&msg->bf_queue_len_sum,	buffer);
 			safe_unpack32(&msg->bf_active,		buffer);
+
+			if (protocol_version >=
+			    SLURM_14_03_PROTOCOL_VERSION) {
+				safe_unpack32(&msg->job_info_cache_hits,
+					      buffer);
+				safe_unpack32(&msg->job_info_cache_misses,
+					      buffer);
+				safe_unpack32(&msg->job_save_cnt, buffer);
+				safe_unpack32(&msg->job_save_last, buffer);
+				safe_unpack32(&msg->job_save_max, buffer);
+				safe_unpack64(&msg->job_save_sum, buffer);
+				safe_unpack32(&msg->job_save_lock_last, buffer);
+				safe_unpack32(&msg->job_save_lock_max, buffer);
+				safe_unpack32(&msg->bf_last_threads, buffer);
+				safe_unpack64(&msg->bf_last_work_time, buffer);
+				safe_unpack32(&msg->bf_last_reused, buffer);
+				safe_unpack32(&msg->lock_stats_cnt, buffer);
+				/* each record packs well over one byte */
+				if (msg->lock_stats_cnt > remaining_buf(buffer))
+					goto unpack_error;
+				msg->lock_stats = xmalloc(
+					sizeof(lock_stats_info_t) *
+					msg->lock_stats_cnt);
+				for (i = 0; i < msg->lock_stats_cnt; i++) {
+					lock_stats_info_t *lock_ptr =
+						&msg->lock_stats[i];
+					safe_unpackstr_xmalloc(&lock_ptr->name,
+							       &uint32_tmp,
+							       buffer);
+					safe_unpack32(&lock_ptr->read_cnt,
+						      buffer);
+					safe_unpack32(&lock_ptr->write_cnt,
+						      buffer);
+					safe_unpack64(&lock_ptr->read_wait,
+						      buffer);
+					safe_unpack64(&lock_ptr->write_wait,
+						      buffer);
+					safe_unpack64(&lock_ptr->read_hold,
+						      buffer);
+					safe_unpack64(&lock_ptr->write_hold,
+						      buffer);
+					safe_unpack32(&lock_ptr->site_drops,
+						      buffer);
+				}
+				safe_unpack32(&msg->lock_site_cnt, buffer);
+				if (msg->lock_site_cnt > remaining_buf(buffer))
+					goto unpack_error;
+				msg->lock_site_stats = xmalloc(
+					sizeof(lock_site_stats_info_t) *
+					msg->lock_site_cnt);
+				for (i = 0; i < msg->lock_site_cnt; i++) {
+					lock_site_stats_info_t *site_ptr =
+						&msg->lock_site_stats[i];
+					safe_unpackstr_xmalloc(
+						&site_ptr->caller,
+						&uint32_tmp, buffer);
+					safe_unpackstr_xmalloc(
+						&site_ptr->lock_name,
+						&uint32_tmp, buffer);
+					safe_unpack16(&site_ptr->write_lock,
+						      buffer);
+					safe_unpack32(&site_ptr->count,
+						      buffer);
+					safe_unpack64(&site_ptr->wait_total,
+						      buffer);
+					safe_unpack64(&site_ptr->wait_max,
+						      buffer);
+					safe_unpack64(&site_ptr->hold_total,
+						      buffer);
+					safe_unpack64(&site_ptr->hold_max,
+						      buffer);
+					safe_unpack32_array(
+						&site_ptr->wait_hist,
+						&site_ptr->hist_cnt, buffer);
+					safe_unpack32_array(
+						&site_ptr->hold_hist,
+						&uint32_tmp, buffer);
+					if (uint32_tmp != site_ptr->hist_cnt)
+						goto unpack_error;
+				}
+
+				safe_unpack32(&msg->dbd_agent_queue_size,
+					      buffer);
+				safe_unpack32(&msg->dbd_agent_queue_max,
+					      buffer);
+				safe_unpack32(&msg->dbd_agent_batch_cnt,
+					      buffer);
+				safe_unpack32(&msg->dbd_agent_batch_max,
+					      buffer);
+				safe_unpack32(&msg->dbd_agent_inflight_max,
+					      buffer);
+				safe_unpack32(&msg->dbd_agent_msg_cnt, buffer);
+				safe_unpack64(&msg->dbd_agent_rtt_total,
+					      buffer);
+				safe_unpack64(&msg->dbd_agent_rtt_max, buffer);
+				safe_unpack32_array(&msg->dbd_agent_batch_hist,
+						    &msg->dbd_agent_hist_cnt,
+						    buffer);
+				safe_unpack32_array(&msg->dbd_agent_rtt_hist,
+						    &uint32_tmp, buffer);
+				if (uint32_tmp != msg->dbd_agent_hist_cnt)
+					goto unpack_error;
+			}
 		}
 	} else {
 		error("_unpack_stats_response_msg: protocol_version "
@@ -91,6 +91,12 @@ extern int unpack_header ( header_t * header , Buf buffer );
  */
 extern int pack_msg ( slurm_msg_t const * msg , Buf buffer );
 
+/* pack_msg_is_data
+ * IN msg - the message to be sent
+ * RET true if pack_msg() copies msg->data into the buffer unchanged
+ */
+extern bool pack_msg_is_data ( slurm_msg_t const * msg );
+
 /* unpack_msg
  * unpacks a generic slurm protocol message body
  * OUT msg - the body structure to unpack (note: includes message type)
@@ -84,12 +84,6 @@
 #define RANDOM_USER_PORT ((uint16_t) ((lrand48() % \
 		(MAX_USER_PORT - MIN_USER_PORT + 1)) + MIN_USER_PORT))
 
-/*
- *  Maximum message size. Messages larger than this value (in bytes)
- *  will not be received.
- */
-#define MAX_MSG_SIZE     (1024*1024*1024)
-
 /****************************************************************
  * MIDDLE LAYER MSG FUNCTIONS
  ****************************************************************/
@@ -183,7 +177,7 @@ ssize_t _slurm_msg_recvfrom_timeout(slurm_fd_t fd, char **pbuf, size_t *lenp,
 
 	msglen = ntohl(msglen);
 
-	if (msglen > MAX_MSG_SIZE)
+	if (msglen > SLURM_PROTOCOL_MAX_MSG_SIZE)
 		slurm_seterrno_ret(SLURM_PROTOCOL_INSANE_MSG_LENGTH);
 
 	/*
@@ -238,6 +232,53 @@ ssize_t _slurm_msg_sendto_timeout(slurm_fd_t fd, char *buffer, size_t size,
 	return len;
 }
 
+ssize_t _slurm_msg_sendv_timeout(slurm_fd_t fd, struct iovec *iov,
+				 int iov_cnt, uint32_t flags, int timeout)
+{
+	int   i, len;
+	size_t size = 0, head_size = sizeof(uint32_t), offset;
+	uint32_t usize;
+	char *head;
+	SigFunc *ohandler;
+
+	for (i = 0; i < iov_cnt; i++) {
+		size += iov[i].iov_len;
+		if (i < (iov_cnt - 1))
+			head_size += iov[i].iov_len;
+	}
+
+	/*
+	 *  Send the length and all but the last buffer (normally just a
+	 *    message header) together, so that the message takes the same
+	 *    two writes as with _slurm_msg_sendto_timeout()
+	 */
+	head = xmalloc(head_size);
+	usize = htonl(size);
+	memcpy(head, &usize, sizeof(usize));
+	offset = sizeof(usize);
+	for (i = 0; i < (iov_cnt - 1); i++) {
+		memcpy(head + offset, iov[i].iov_base, iov[i].iov_len);
+		offset += iov[i].iov_len;
+	}
+
+	ohandler = xsignal(SIGPIPE, SIG_IGN);
+
+	if ((len = _slurm_send_timeout(fd, head, head_size, 0, timeout)) < 0)
+		goto done;
+
+	if ((iov_cnt > 0) &&
+	    ((len = _slurm_send_timeout(fd, iov[iov_cnt - 1].iov_base,
+					iov[iov_cnt - 1].iov_len, 0,
+					timeout)) < 0))
+		goto done;
+	len = size;
+
+     done:
+	xsignal(SIGPIPE, ohandler);
+	xfree(head);
+	return len;
+}
+
 /* Send slurm message with timeout
  * RET message size (as specified in argument) or SLURM_ERROR on error */
 int _slurm_send_timeout(slurm_fd_t fd, char *buf, size_t size,
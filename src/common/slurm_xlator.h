@@ -90,6 +90,7 @@
 #define	bit_realloc		slurm_bit_realloc
 #define	bit_size		slurm_bit_size
 #define	bit_and			slurm_bit_and
+#define	bit_and_not		slurm_bit_and_not
 #define	bit_not			slurm_bit_not
 #define	bit_or			slurm_bit_or
 #define	bit_set_count		slurm_bit_set_count
@@ -109,6 +110,7 @@
 #define	bit_fls			slurm_bit_fls
 #define	bit_fill_gaps		slurm_bit_fill_gaps
 #define	bit_super_set		slurm_bit_super_set
+#define	bit_overlap_any		slurm_bit_overlap_any
 #define	bit_copy		slurm_bit_copy
 #define	bit_pick_cnt		slurm_bit_pick_cnt
 #define bit_nffc		slurm_bit_nffc
@@ -232,6 +234,7 @@
 #define	create_buf		slurm_create_buf
 #define	free_buf		slurm_free_buf
 #define grow_buf		slurm_grow_buf
+#define reserve_buf		slurm_reserve_buf
 #define	init_buf		slurm_init_buf
 #define	xfer_buf_data		slurm_xfer_buf_data
 #define	pack_time		slurm_pack_time
@@ -50,13 +50,18 @@
 #endif				/*  HAVE_CONFIG_H */
 
 #include <arpa/inet.h>
+#include <ctype.h>
+#include <dirent.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <syslog.h>
 #include <sys/poll.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -85,6 +90,20 @@ strong_alias(slurmdbd_free_id_rc_msg,	slurmdb_slurmdbd_free_id_rc_msg);
 
 #define DBD_MAGIC		0xDEAD3219
 #define MAX_AGENT_QUEUE		10000
+#define MAX_AGENT_BATCH_MSGS	1000	/* messages in a DBD_SEND_MULT_MSG */
+#define MAX_AGENT_BATCH_SIZE	(4 * 1024 * 1024) /* bytes in a batch */
+#define MAX_AGENT_BATCHES	4	/* batches awaiting the SlurmDBD's
+					 * reply at once */
+#define AGENT_COALESCE_MSGS	100	/* wait up to AGENT_COALESCE_USEC
+					 * after the last batch was sent for
+					 * this many messages to be queued */
+#define AGENT_COALESCE_USEC	100000
+#define MAX_AGENT_MEM_MSGS	10000	/* queued messages kept in memory,
+					 * others are read back from the spool
+					 * as the queue drains */
+#define DBD_SPOOL_MAGIC		0xDEAD3220
+#define DBD_SPOOL_SEG_SIZE	(16 * 1024 * 1024) /* start a new spool
+					 * segment beyond this size */
 #define MAX_DBD_MSG_LEN		16384
 #define SLURMDBD_TIMEOUT	900	/* Seconds SlurmDBD for response */
 
@@ -97,6 +116,68 @@ static pthread_cond_t  agent_cond = PTHREAD_COND_INITIALIZER;
 static List      agent_list     = (List) NULL;
 static pthread_t agent_tid      = 0;
 static time_t    agent_shutdown = 0;
+static int       agent_sent_cnt = 0;	/* messages at the head of agent_list
+					 * sent and awaiting a reply */
+static struct timeval agent_batch_time;	/* when the last batch was sent */
+static slurmdbd_agent_stats_t agent_stats;
+
+/* Batch of messages from agent_list sent to the SlurmDBD */
+typedef struct {
+	Buf buffer;		/* DBD_SEND_MULT_MSG, or the only message */
+	bool mult;		/* buffer is a DBD_SEND_MULT_MSG */
+	int msg_cnt;
+	struct timeval sent;
+} agent_batch_t;
+
+/* The agent's queue is appended to a spool as messages are queued, so it
+ * survives a crash of slurmctld. The spool is a directory of segment files
+ * named by increasing numbers, each holding a spool_seg_hdr_t followed by
+ * the records of the messages, and a "head" file recording how many
+ * records of the oldest segment were processed. Older segments are removed
+ * as the queue drains. */
+typedef struct {
+	uint32_t magic;		/* DBD_SPOOL_MAGIC */
+	uint16_t rpc_version;	/* of the messages in the segment */
+	uint16_t pad;
+} spool_seg_hdr_t;
+
+typedef struct {
+	uint32_t magic;		/* DBD_SPOOL_MAGIC */
+	uint32_t size;		/* bytes of message following */
+	uint32_t sum;		/* _spool_sum() of the message */
+} spool_rec_hdr_t;
+
+typedef struct {
+	uint32_t magic;		/* DBD_SPOOL_MAGIC */
+	uint32_t seg_no;	/* oldest segment */
+	uint32_t rec_cnt;	/* its records processed */
+} spool_head_t;
+
+typedef struct {
+	uint32_t seg_no;
+	uint32_t rec_cnt;	/* valid records in the segment */
+	off_t    size;		/* bytes of the header and valid records */
+	uint16_t rpc_version;
+	bool     old;		/* written before the spool was opened */
+} spool_seg_t;
+
+static char *    spool_dir      = NULL;	/* NULL if not spooling */
+static List      spool_segs     = NULL;	/* spool_seg_t, oldest first */
+static spool_seg_t *spool_write_seg = NULL; /* newest segment */
+static int       spool_fd       = -1;	/* appending to spool_write_seg */
+static List      spool_sync_list = NULL; /* fds of complete segments for
+					 * the agent to sync and close */
+static int       spool_head_fd  = -1;
+static uint32_t  spool_head_recs = 0;	/* records of the oldest segment
+					 * processed */
+static uint32_t  spool_seg_no   = 0;	/* of the newest segment */
+static spool_seg_t *spool_read_seg = NULL; /* where records not read back
+					 * into agent_list follow, NULL if
+					 * at the start of the oldest one */
+static int       spool_read_fd  = -1;
+static off_t     spool_read_offset = 0;
+static uint32_t  spool_read_recs = 0;	/* records of spool_read_seg read */
+static int       spool_unloaded = 0;	/* queued messages only spooled */
 
 static pthread_mutex_t slurmdbd_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  slurmdbd_cond = PTHREAD_COND_INITIALIZER;
@@ -111,10 +192,12 @@ static bool      from_ctld           = 0;
 static bool      need_to_register    = 0;
 
 static void * _agent(void *x);
+static void   _agent_enqueue(Buf buffer);
 static void   _close_slurmdbd_fd(void);
+static Buf    _convert_dbd_rec(Buf buffer, uint16_t rpc_version);
 static void   _create_agent(void);
 static bool   _fd_readable(slurm_fd_t fd, int read_timeout);
-static int    _fd_writeable(slurm_fd_t fd);
+static int    _fd_writeable(slurm_fd_t fd, int write_timeout);
 static int    _get_return_code(uint16_t rpc_version, int read_timeout);
 static Buf    _load_dbd_rec(int fd);
 static void   _load_dbd_state(void);
@@ -127,8 +210,15 @@ static void   _save_dbd_state(void);
 static int    _send_init_msg(void);
 static int    _send_fini_msg(void);
 static int    _send_msg(Buf buffer);
+static int    _send_msg_timeout(Buf buffer, bool reopen, int write_timeout);
 static void   _sig_handler(int signal);
 static void   _shutdown_agent(void);
+static void   _spool_ack(int acked);
+static int    _spool_append(Buf buffer);
+static void   _spool_close(bool remove);
+static void   _spool_load(int max_cnt);
+static void   _spool_open(void);
+static void   _spool_sync(void);
 static void   _slurmdbd_packstr(void *str, uint16_t rpc_version, Buf buffer);
 static int    _slurmdbd_unpackstr(void **str, uint16_t rpc_version, Buf buffer);
 static int    _tot_wait (struct timeval *start_time);
@@ -386,7 +476,7 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 			return SLURM_ERROR;
 		}
 	}
-	cnt = list_count(agent_list);
+	cnt = list_count(agent_list) + spool_unloaded;
 	if ((cnt >= (max_agent_queue / 2)) &&
 	    (difftime(time(NULL), syslog_time) > 120)) {
 		/* Record critical error every 120 seconds */
@@ -399,12 +489,13 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 	if (cnt == (max_agent_queue - 1))
 		cnt -= _purge_job_start_req();
 	if (cnt < max_agent_queue) {
-		if (list_enqueue(agent_list, buffer) == NULL)
-			fatal("list_enqueue: memory allocation failure");
+		_agent_enqueue(buffer);
+		agent_stats.queue_max = MAX(agent_stats.queue_max, cnt + 1);
 	} else {
 		error("slurmdbd: agent queue is full, discarding request");
 		if (callbacks_requested)
 			(callback.acct_full)();
+		free_buf(buffer);
 		rc = SLURM_ERROR;
 	}
 
@@ -413,6 +504,22 @@ extern int slurm_send_slurmdbd_msg(uint16_t rpc_version, slurmdbd_msg_t *req)
 	return rc;
 }
 
+extern void slurmdbd_get_agent_stats(slurmdbd_agent_stats_t *stats)
+{
+	slurm_mutex_lock(&agent_lock);
+	memcpy(stats, &agent_stats, sizeof(slurmdbd_agent_stats_t));
+	stats->queue_len = agent_list ?
+			   (list_count(agent_list) + spool_unloaded) : 0;
+	slurm_mutex_unlock(&agent_lock);
+}
+
+extern void slurmdbd_reset_agent_stats(void)
+{
+	slurm_mutex_lock(&agent_lock);
+	memset(&agent_stats, 0, sizeof(slurmdbd_agent_stats_t));
+	slurm_mutex_unlock(&agent_lock);
+}
+
 /* Open a connection to the Slurm DBD and set slurmdbd_fd */
 static void _open_slurmdbd_fd(bool need_db)
 {
@@ -1528,7 +1635,7 @@ static int _send_fini_msg(void)
 
 	/* If the connection is already gone, we don't need to send a
 	   fini. */
-	if (_fd_writeable(slurmdbd_fd) == -1)
+	if (_fd_writeable(slurmdbd_fd, 5000) == -1)
 		return SLURM_SUCCESS;
 
 	buffer = init_buf(1024);
@@ -1561,6 +1668,15 @@ static void _reopen_slurmdbd_fd(void)
 }
 
 static int _send_msg(Buf buffer)
+{
+	return _send_msg_timeout(buffer, true, 5000);
+}
+
+/* Send a message to the SlurmDBD, waiting up to write_timeout msec for the
+ * connection to accept more data. Reopen the connection if it was closed
+ * and reopen is set, which must not be done while the replies to messages
+ * already sent are awaited. */
+static int _send_msg_timeout(Buf buffer, bool reopen, int write_timeout)
 {
 	uint32_t msg_size, nw_size;
 	char *msg;
@@ -1570,17 +1686,17 @@ static int _send_msg(Buf buffer)
 	if (slurmdbd_fd < 0)
 		return EAGAIN;
 
-	rc =_fd_writeable(slurmdbd_fd);
+	rc =_fd_writeable(slurmdbd_fd, write_timeout);
 	if (rc == -1) {
 	re_open:	/* SlurmDBD shutdown, try to reopen a connection now */
-		if (retry_cnt++ > 3)
+		if (!reopen || (retry_cnt++ > 3))
 			return EAGAIN;
 		/* if errno is ACCESS_DENIED do not try to reopen to
 		   connection just return that */
 		if (errno == ESLURM_ACCESS_DENIED)
 			return ESLURM_ACCESS_DENIED;
 		_reopen_slurmdbd_fd();
-		rc = _fd_writeable(slurmdbd_fd);
+		rc = _fd_writeable(slurmdbd_fd, write_timeout);
 	}
 	if (rc < 1)
 		return EAGAIN;
@@ -1593,7 +1709,7 @@ static int _send_msg(Buf buffer)
 
 	msg = get_buf_data(buffer);
 	while (msg_size > 0) {
-		rc = _fd_writeable(slurmdbd_fd);
+		rc = _fd_writeable(slurmdbd_fd, write_timeout);
 		if (rc == -1)
 			goto re_open;
 		if (rc < 1)
@@ -1683,94 +1799,6 @@ static int _get_return_code(uint16_t rpc_version, int read_timeout)
 	return rc;
 }
 
-static int _handle_mult_rc_ret(uint16_t rpc_version, int read_timeout)
-{
-	Buf buffer;
-	uint16_t msg_type;
-	dbd_rc_msg_t *msg;
-	dbd_list_msg_t *list_msg;
-	int rc = SLURM_ERROR;
-	Buf out_buf = NULL;
-
-	buffer = _recv_msg(read_timeout);
-	if (buffer == NULL)
-		return rc;
-
-	safe_unpack16(&msg_type, buffer);
-	switch(msg_type) {
-	case DBD_GOT_MULT_MSG:
-		if (slurmdbd_unpack_list_msg(
-			    &list_msg, rpc_version, DBD_GOT_MULT_MSG, buffer)
-		    != SLURM_SUCCESS) {
-			error("slurmdbd: unpack message error");
-			break;
-		}
-
-		slurm_mutex_lock(&agent_lock);
-		if (agent_list) {
-			ListIterator itr =
-				list_iterator_create(list_msg->my_list);
-			while ((out_buf = list_next(itr))) {
-				Buf b;
-				if ((rc = _unpack_return_code(
-					    rpc_version, out_buf))
-				    != SLURM_SUCCESS)
-					break;
-
-				if ((b = list_dequeue(agent_list))) {
-					free_buf(b);
-				} else {
-					error("slurmdbd: DBD_GOT_MULT_MSG "
-					      "unpack message error");
-				}
-			}
-			list_iterator_destroy(itr);
-		}
-		slurm_mutex_unlock(&agent_lock);
-		slurmdbd_free_list_msg(list_msg);
-		break;
-	case DBD_RC:
-		if (slurmdbd_unpack_rc_msg(&msg, rpc_version, buffer)
-		    == SLURM_SUCCESS) {
-			rc = msg->return_code;
-			if (rc != SLURM_SUCCESS) {
-				if (msg->sent_type == DBD_REGISTER_CTLD &&
-				    slurm_get_accounting_storage_enforce()) {
-					error("slurmdbd: DBD_RC is %d from "
-					      "%s(%u): %s",
-					      rc,
-					      slurmdbd_msg_type_2_str(
-						      msg->sent_type, 1),
-					      msg->sent_type,
-					      msg->comment);
-					fatal("You need to add this cluster "
-					      "to accounting if you want to "
-					      "enforce associations, or no "
-					      "jobs will ever run.");
-				} else
-					debug("slurmdbd: DBD_RC is %d from "
-					      "%s(%u): %s",
-					      rc,
-					      slurmdbd_msg_type_2_str(
-						      msg->sent_type, 1),
-					      msg->sent_type,
-					      msg->comment);
-			} else if (msg->sent_type == DBD_REGISTER_CTLD)
-				need_to_register = 0;
-
-			slurmdbd_free_rc_msg(msg);
-		} else
-			error("slurmdbd: unpack message error");
-		break;
-	default:
-		error("slurmdbd: bad message type %d != DBD_RC", msg_type);
-	}
-
-unpack_error:
-	free_buf(buffer);
-	return rc;
-}
-
 static Buf _recv_msg(int read_timeout)
 {
 	uint32_t msg_size, nw_size;
@@ -1884,10 +1912,9 @@ static bool _fd_readable(slurm_fd_t fd, int read_timeout)
  *     0 if can not be written to within 5 seconds
  *     -1 if file has been closed POLLHUP
  */
-static int _fd_writeable(slurm_fd_t fd)
+static int _fd_writeable(slurm_fd_t fd, int write_timeout)
 {
 	struct pollfd ufds;
-	int write_timeout = 5000;
 	int rc, time_left;
 	struct timeval tstart;
 	char temp[2];
@@ -1911,9 +1938,11 @@ static int _fd_writeable(slurm_fd_t fd)
 		 * If not then exit out and notify the sender.  This
  		 * is here since a write doesn't always tell you the
 		 * socket is gone, but getting 0 back from a
-		 * nonblocking read means just that.
+		 * nonblocking read means just that. Only peek, the
+		 * reply to a message sent earlier may be waiting.
 		 */
-		if (ufds.revents & POLLHUP || (recv(fd, &temp, 1, 0) == 0)) {
+		if (ufds.revents & POLLHUP ||
+		    (recv(fd, &temp, 1, MSG_PEEK) == 0)) {
 			debug2("SlurmDBD connection is closed");
 			if (callbacks_requested)
 				(callback.dbd_fail)();
@@ -1944,6 +1973,38 @@ static int _fd_writeable(slurm_fd_t fd)
 /****************************************************************************
  * Functions for agent to manage queue of pending message for the Slurm DBD
  ****************************************************************************/
+/* Append a message to the agent's queue and spool, keeping it only in the
+ * spool if MAX_AGENT_MEM_MSGS are already in memory or others are waiting
+ * there. agent_lock must be locked. */
+static void _agent_enqueue(Buf buffer)
+{
+	if (spool_dir && (_spool_append(buffer) != SLURM_SUCCESS)) {
+		error("slurmdbd: unable to spool queued messages, they are "
+		      "only saved at shutdown");
+		_spool_load(INT_MAX);
+		_spool_close(true);
+	}
+	if (spool_dir && (spool_unloaded ||
+			  (list_count(agent_list) >= MAX_AGENT_MEM_MSGS))) {
+		spool_unloaded++;
+		free_buf(buffer);
+		return;
+	}
+	if (spool_dir) {
+		/* Every spooled message is in memory now */
+		if ((spool_read_seg != spool_write_seg) &&
+		    (spool_read_fd >= 0)) {
+			(void) close(spool_read_fd);
+			spool_read_fd = -1;
+		}
+		spool_read_seg = spool_write_seg;
+		spool_read_offset = spool_write_seg->size;
+		spool_read_recs = spool_write_seg->rec_cnt;
+	}
+	if (list_enqueue(agent_list, buffer) == NULL)
+		fatal("list_enqueue: memory allocation failure");
+}
+
 static void _create_agent(void)
 {
 	/* this needs to be set because the agent thread will do
@@ -2006,21 +2067,310 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+/* Histogram bucket of a value, see DBD_AGENT_HIST_CNT */
+static int _agent_hist_inx(uint64_t value)
+{
+	int inx = 0;
+
+	while ((value >= 10) && (inx < (DBD_AGENT_HIST_CNT - 1))) {
+		value /= 10;
+		inx++;
+	}
+	return inx;
+}
+
+/* Put the queued messages following those already sent into a new batch,
+ * up to MAX_AGENT_BATCH_MSGS messages and MAX_AGENT_BATCH_SIZE bytes.
+ * IN mult - pack a DBD_SEND_MULT_MSG even for a single message
+ * agent_lock must be locked.
+ * RET false if there is no message to send */
+static bool _agent_pack_batch(agent_batch_t *batch, bool mult)
+{
+	slurmdbd_msg_t list_req;
+	dbd_list_msg_t list_msg;
+	ListIterator itr;
+	Buf buffer;
+	int skip = agent_sent_cnt, size = 0;
+
+	memset(batch, 0, sizeof(agent_batch_t));
+	if (agent_list && spool_unloaded &&
+	    (list_count(agent_list) < (MAX_AGENT_MEM_MSGS / 2)))
+		_spool_load(MAX_AGENT_MEM_MSGS);
+	if (!agent_list || (list_count(agent_list) <= agent_sent_cnt))
+		return false;
+
+	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
+	list_msg.my_list = list_create(NULL);
+	itr = list_iterator_create(agent_list);
+	while ((buffer = list_next(itr))) {
+		if (skip) {
+			skip--;
+			continue;
+		}
+		if (batch->msg_cnt &&
+		    ((batch->msg_cnt >= MAX_AGENT_BATCH_MSGS) ||
+		     ((size + get_buf_offset(buffer)) > MAX_AGENT_BATCH_SIZE)))
+			break;
+		list_enqueue(list_msg.my_list, buffer);
+		size += get_buf_offset(buffer);
+		batch->msg_cnt++;
+	}
+	list_iterator_destroy(itr);
+
+	if ((batch->msg_cnt == 1) && !mult) {
+		/* Send the message itself, it stays on agent_list */
+		batch->buffer = (Buf) list_peek(list_msg.my_list);
+	} else {
+		batch->mult = true;
+		list_req.msg_type = DBD_SEND_MULT_MSG;
+		list_req.data = &list_msg;
+		batch->buffer = pack_slurmdbd_msg(&list_req,
+						  SLURM_PROTOCOL_VERSION);
+	}
+	list_destroy(list_msg.my_list);
+	agent_sent_cnt += batch->msg_cnt;
+
+	return true;
+}
+
+static void _agent_free_batch(agent_batch_t *batch)
+{
+	if (batch->mult)
+		free_buf(batch->buffer);
+	batch->buffer = NULL;
+}
+
+/* Read the SlurmDBD's reply to a batch.
+ * OUT rc - SLURM_SUCCESS if every message of the batch was processed, else
+ *	the error of the first one which failed
+ * RET count of leading messages of the batch processed, or -1 if no reply
+ *	was received */
+static int _agent_recv_batch_rc(agent_batch_t *batch, int read_timeout,
+				int *rc)
+{
+	dbd_list_msg_t *list_msg;
+	ListIterator itr;
+	Buf buffer, rc_buf;
+	uint16_t msg_type;
+	int acked = 0;
+
+	*rc = SLURM_ERROR;
+	if (!(buffer = _recv_msg(read_timeout)))
+		return -1;
+
+	if (!batch->mult) {
+		*rc = _unpack_return_code(SLURM_PROTOCOL_VERSION, buffer);
+		free_buf(buffer);
+		return (*rc == SLURM_SUCCESS) ? 1 : 0;
+	}
+
+	safe_unpack16(&msg_type, buffer);
+	if (msg_type != DBD_GOT_MULT_MSG) {
+		/* The whole batch was refused */
+		set_buf_offset(buffer, 0);
+		*rc = _unpack_return_code(SLURM_PROTOCOL_VERSION, buffer);
+		if (*rc == SLURM_SUCCESS)
+			*rc = SLURM_ERROR;
+	} else if (slurmdbd_unpack_list_msg(&list_msg, SLURM_PROTOCOL_VERSION,
+					    DBD_GOT_MULT_MSG, buffer)
+		   != SLURM_SUCCESS) {
+		error("slurmdbd: unpack message error");
+	} else {
+		*rc = SLURM_SUCCESS;
+		itr = list_iterator_create(list_msg->my_list);
+		while ((rc_buf = list_next(itr))) {
+			*rc = _unpack_return_code(SLURM_PROTOCOL_VERSION,
+						  rc_buf);
+			if (*rc != SLURM_SUCCESS)
+				break;
+			acked++;
+		}
+		list_iterator_destroy(itr);
+		slurmdbd_free_list_msg(list_msg);
+		if (acked > batch->msg_cnt) {
+			error("slurmdbd: DBD_GOT_MULT_MSG has %d replies for "
+			      "%d messages", acked, batch->msg_cnt);
+			acked = batch->msg_cnt;
+		} else if ((*rc == SLURM_SUCCESS) &&
+			   (acked < batch->msg_cnt))
+			*rc = SLURM_ERROR;
+	}
+
+unpack_error:
+	free_buf(buffer);
+	return acked;
+}
+
+/* Remove the acked leading messages of a batch from agent_list, the batch
+ * following the skip messages at the head of the list which failed.
+ * agent_lock must be locked. */
+static void _agent_ack(int skip, int acked)
+{
+	ListIterator itr;
+	bool in_order = (skip == 0);
+	int removed = 0;
+
+	if (!agent_list || !acked)
+		return;
+
+	itr = list_iterator_create(agent_list);
+	while ((removed < acked) && list_next(itr)) {
+		if (skip) {
+			skip--;
+			continue;
+		}
+		list_delete_item(itr);
+		removed++;
+	}
+	list_iterator_destroy(itr);
+
+	/* Messages acked out of order stay in the spool until the queue
+	 * drains, see _spool_ack() */
+	if (spool_dir)
+		_spool_ack(in_order ? removed : 0);
+}
+
+/* Send the queued messages to the SlurmDBD in batches, with up to
+ * MAX_AGENT_BATCHES of them awaiting a reply, until none is left to send,
+ * a synchronous request is waiting for the connection or a failure occurs.
+ * Processed messages are removed from agent_list, others are left at its
+ * head to be sent again. slurmdbd_lock must be locked.
+ *
+ * Batches sent while others await a reply are DBD_SEND_MULT_MSG, which the
+ * SlurmDBD refuses on a connection once one failed, so no message is
+ * processed before an earlier one which failed. The connection is closed
+ * after a failure for the messages to be sent again in order on a new one.
+ * RET SLURM_SUCCESS or the error of the first batch which failed */
+static int _agent_send_batches(int read_timeout)
+{
+	agent_batch_t batch[MAX_AGENT_BATCHES], *batch_ptr;
+	int first = 0, batch_cnt = 0, skip = 0, acked, msg_rc;
+	int rc = SLURM_SUCCESS;
+	bool sending = true, have_batch, resync = false;
+	struct timeval now;
+	uint64_t rtt;
+
+	while (1) {
+		/* Only a DBD_SEND_MULT_MSG can be followed by other batches
+		 * before its reply, see above */
+		if (sending && (batch_cnt < MAX_AGENT_BATCHES) &&
+		    ((batch_cnt == 0) ||
+		     batch[(first + batch_cnt - 1) % MAX_AGENT_BATCHES].mult) &&
+		    !halt_agent && !agent_shutdown) {
+			batch_ptr = &batch[(first + batch_cnt) %
+					   MAX_AGENT_BATCHES];
+			slurm_mutex_lock(&agent_lock);
+			have_batch = _agent_pack_batch(batch_ptr,
+						       (batch_cnt > 0));
+			slurm_mutex_unlock(&agent_lock);
+			if (have_batch) {
+				/* NOTE: agent_lock is clear here, so we can
+				 * add more requests to the queue while
+				 * waiting for this RPC to complete. The
+				 * SlurmDBD reads the next batch once it
+				 * replied to the previous one. */
+				if (batch_cnt == 0)
+					msg_rc = _send_msg(batch_ptr->buffer);
+				else
+					msg_rc = _send_msg_timeout(
+						batch_ptr->buffer, false,
+						read_timeout);
+				gettimeofday(&batch_ptr->sent, NULL);
+				slurm_mutex_lock(&agent_lock);
+				if (msg_rc == SLURM_SUCCESS) {
+					batch_cnt++;
+					agent_batch_time = batch_ptr->sent;
+					agent_stats.batch_cnt++;
+					agent_stats.batch_max =
+						MAX(agent_stats.batch_max,
+						    batch_ptr->msg_cnt);
+					agent_stats.batch_hist[_agent_hist_inx(
+						batch_ptr->msg_cnt)]++;
+					agent_stats.inflight_max =
+						MAX(agent_stats.inflight_max,
+						    batch_cnt);
+				} else
+					agent_sent_cnt -= batch_ptr->msg_cnt;
+				slurm_mutex_unlock(&agent_lock);
+				if (msg_rc == SLURM_SUCCESS)
+					continue;
+
+				_agent_free_batch(batch_ptr);
+				if (!agent_shutdown) {
+					error("slurmdbd: Failure sending "
+					      "message: %d: %m", msg_rc);
+				}
+				rc = msg_rc;
+				sending = false;
+				/* The message may be partly written, so no
+				 * reply to the batches sent before can be
+				 * trusted */
+				if (batch_cnt)
+					_close_slurmdbd_fd();
+			}
+		}
+		if (batch_cnt == 0)
+			break;
+
+		/* Wait for the reply to the oldest batch */
+		batch_ptr = &batch[first];
+		acked = _agent_recv_batch_rc(batch_ptr, read_timeout, &msg_rc);
+		gettimeofday(&now, NULL);
+		slurm_mutex_lock(&agent_lock);
+		if (acked > 0) {
+			_agent_ack(skip, acked);
+			agent_sent_cnt -= acked;
+			agent_stats.msg_cnt += acked;
+		}
+		if (acked >= 0) {
+			rtt = (now.tv_sec - batch_ptr->sent.tv_sec) * 1000000 +
+			      now.tv_usec - batch_ptr->sent.tv_usec;
+			agent_stats.rtt_total += rtt;
+			agent_stats.rtt_max = MAX(agent_stats.rtt_max, rtt);
+			agent_stats.rtt_hist[_agent_hist_inx(rtt)]++;
+		}
+		skip += batch_ptr->msg_cnt - MAX(acked, 0);
+		slurm_mutex_unlock(&agent_lock);
+		_agent_free_batch(batch_ptr);
+		first = (first + 1) % MAX_AGENT_BATCHES;
+		batch_cnt--;
+
+		if (msg_rc != SLURM_SUCCESS) {
+			if ((msg_rc == EAGAIN) && !agent_shutdown) {
+				error("slurmdbd: Failure with "
+				      "message need to resend: %d: %m", msg_rc);
+			}
+			if (rc == SLURM_SUCCESS)
+				rc = msg_rc;
+			sending = false;
+			/* A late reply would be taken for the reply to
+			 * the next batch */
+			if (acked < 0)
+				_close_slurmdbd_fd();
+			else if (batch_ptr->mult)
+				resync = true;
+		}
+	}
+	/* The SlurmDBD refuses further batches on this connection */
+	if (resync && (slurmdbd_fd >= 0))
+		_close_slurmdbd_fd();
+
+	/* Messages not processed are sent again on the next attempt */
+	slurm_mutex_lock(&agent_lock);
+	agent_sent_cnt = 0;
+	slurm_mutex_unlock(&agent_lock);
+
+	return rc;
+}
+
 static void *_agent(void *x)
 {
 	int cnt, rc;
-	Buf buffer;
 	struct timespec abs_time;
+	struct timeval now, coalesce_end;
 	static time_t fail_time = 0;
 	int sigarray[] = {SIGUSR1, 0};
 	int read_timeout = SLURMDBD_TIMEOUT * 1000;
-	slurmdbd_msg_t list_req;
-	dbd_list_msg_t list_msg;
-
-	list_req.msg_type = DBD_SEND_MULT_MSG;
-	list_req.data = &list_msg;
-	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
-	/* DEF_TIMERS; */
 
 	/* Prepare to catch SIGUSR1 to interrupt pending
 	 * I/O and terminate in a timely fashion. */
@@ -2028,7 +2378,7 @@ static void *_agent(void *x)
 	xsignal_unblock(sigarray);
 
 	while (agent_shutdown == 0) {
-		/* START_TIMER; */
+		_spool_sync();
 		slurm_mutex_lock(&slurmdbd_lock);
 		if (halt_agent)
 			pthread_cond_wait(&slurmdbd_cond, &slurmdbd_lock);
@@ -2043,7 +2393,7 @@ static void *_agent(void *x)
 
 		slurm_mutex_lock(&agent_lock);
 		if (agent_list && slurmdbd_fd)
-			cnt = list_count(agent_list);
+			cnt = list_count(agent_list) + spool_unloaded;
 		else
 			cnt = 0;
 		if ((cnt == 0) || (slurmdbd_fd < 0) ||
@@ -2057,105 +2407,40 @@ static void *_agent(void *x)
 			continue;
 		} else if ((cnt > 0) && ((cnt % 50) == 0))
 			info("slurmdbd: agent queue size %u", cnt);
-		/* Leave item on the queue until processing complete */
-		if (agent_list) {
-			int handle_agent_count = 1000;
-			if (cnt > handle_agent_count) {
-				int agent_count = 0;
-				ListIterator agent_itr =
-					list_iterator_create(agent_list);
-				list_msg.my_list = list_create(NULL);
-				while ((buffer = list_next(agent_itr))) {
-					list_enqueue(list_msg.my_list, buffer);
-					agent_count++;
-					if (agent_count > handle_agent_count)
-						break;
-				}
-				list_iterator_destroy(agent_itr);
-				buffer = pack_slurmdbd_msg(&list_req,
-							   SLURM_PROTOCOL_VERSION);
-			} else if (cnt > 1) {
-				list_msg.my_list = agent_list;
-				buffer = pack_slurmdbd_msg(&list_req,
-							   SLURM_PROTOCOL_VERSION);
-			} else
-				buffer = (Buf) list_peek(agent_list);
-		} else
-			buffer = NULL;
-		slurm_mutex_unlock(&agent_lock);
-		if (buffer == NULL) {
-			slurm_mutex_unlock(&slurmdbd_lock);
-
-			slurm_mutex_lock(&assoc_cache_mutex);
-			if (slurmdbd_fd >= 0 && running_cache)
-				pthread_cond_signal(&assoc_cache_cond);
-			slurm_mutex_unlock(&assoc_cache_mutex);
 
+		/* While messages keep coming, let a few more of them be
+		 * queued to send them in one batch */
+		coalesce_end = agent_batch_time;
+		coalesce_end.tv_usec += AGENT_COALESCE_USEC;
+		coalesce_end.tv_sec += coalesce_end.tv_usec / 1000000;
+		coalesce_end.tv_usec %= 1000000;
+		gettimeofday(&now, NULL);
+		if ((cnt < AGENT_COALESCE_MSGS) && !halt_agent &&
+		    timercmp(&now, &agent_batch_time, >=) &&
+		    timercmp(&now, &coalesce_end, <)) {
+			slurm_mutex_unlock(&slurmdbd_lock);
+			abs_time.tv_sec  = coalesce_end.tv_sec;
+			abs_time.tv_nsec = coalesce_end.tv_usec * 1000;
+			rc = pthread_cond_timedwait(&agent_cond, &agent_lock,
+						    &abs_time);
+			slurm_mutex_unlock(&agent_lock);
 			continue;
 		}
+		slurm_mutex_unlock(&agent_lock);
 
-		/* NOTE: agent_lock is clear here, so we can add more
-		 * requests to the queue while waiting for this RPC to
-		 * complete. */
-		rc = _send_msg(buffer);
-		if (rc != SLURM_SUCCESS) {
-			if (agent_shutdown) {
-				slurm_mutex_unlock(&slurmdbd_lock);
-				break;
-			}
-			error("slurmdbd: Failure sending message: %d: %m", rc);
-		} else if (list_msg.my_list) {
-			rc = _handle_mult_rc_ret(SLURM_PROTOCOL_VERSION,
-						 read_timeout);
-		} else {
-			rc = _get_return_code(SLURM_PROTOCOL_VERSION, read_timeout);
-			if (rc == EAGAIN) {
-				if (agent_shutdown) {
-					slurm_mutex_unlock(&slurmdbd_lock);
-					break;
-				}
-				error("slurmdbd: Failure with "
-				      "message need to resend: %d: %m", rc);
-			}
-		}
+		rc = _agent_send_batches(read_timeout);
 		slurm_mutex_unlock(&slurmdbd_lock);
+
 		slurm_mutex_lock(&assoc_cache_mutex);
 		if (slurmdbd_fd >= 0 && running_cache)
 			pthread_cond_signal(&assoc_cache_cond);
 		slurm_mutex_unlock(&assoc_cache_mutex);
 
-		slurm_mutex_lock(&agent_lock);
-		if (agent_list && (rc == SLURM_SUCCESS)) {
-			/* If we sent a mult_msg we just need to free
-			   buffer, we don't need to requeue, just mark
-			   list_msg.my_list as NULL as that is the
-			   sign we sent a mult_msg.
-			*/
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					list_destroy(list_msg.my_list);
-				list_msg.my_list = NULL;
-			} else
-				buffer = (Buf) list_dequeue(agent_list);
-
-			free_buf(buffer);
+		if (rc == SLURM_SUCCESS)
 			fail_time = 0;
-		} else {
-			/* We still need to free a mult_msg even if we
-			   got a failure.
-			*/
-			if (list_msg.my_list) {
-				if (list_msg.my_list != agent_list)
-					list_destroy(list_msg.my_list);
-				list_msg.my_list = NULL;
-				free_buf(buffer);
-			}
-
+		else
 			fail_time = time(NULL);
-		}
-		slurm_mutex_unlock(&agent_lock);
-		/* END_TIMER; */
-		/* info("at the end with %s", TIME_STR); */
+
 		if (need_to_register) {
 			need_to_register = 0;
 			/* This is going to be always using the
@@ -2185,6 +2470,14 @@ static void _save_dbd_state(void)
 	uint16_t msg_type;
 	uint32_t offset;
 
+	if (spool_dir) {
+		/* Every queued message is in the spool already */
+		verbose("slurmdbd: left %d pending RPCs in %s",
+			list_count(agent_list) + spool_unloaded, spool_dir);
+		_spool_close(false);
+		return;
+	}
+
 	dbd_fname = slurm_get_state_save_location();
 	xstrcat(dbd_fname, "/dbd.messages");
 	(void) unlink(dbd_fname);	/* clear save state */
@@ -2245,6 +2538,10 @@ static void _load_dbd_state(void)
 	int fd, recovered = 0;
 	uint16_t rpc_version = 0;
 
+	if (!spool_dir)
+		_spool_open();
+
+	/* Messages saved at shutdown without a spool are moved to it */
 	dbd_fname = slurm_get_state_save_location();
 	xstrcat(dbd_fname, "/dbd.messages");
 	fd = open(dbd_fname, O_RDONLY);
@@ -2291,47 +2588,13 @@ static void _load_dbd_state(void)
 				buffer = _load_dbd_rec(fd);
 			if (buffer == NULL)
 				break;
-			if (rpc_version != SLURM_PROTOCOL_VERSION) {
-				slurmdbd_msg_t msg;
-				int rc;
-				set_buf_offset(buffer, 0);
-				if (rpc_version == 0) {
-					/* This should only happen for
-					   pre 2.2.0.rc4 and 2.1
-					   machines so no real need to
-					   keep it add more to it.
-					*/
-					rc = unpack_slurmdbd_msg(
-						&msg, SLURM_PROTOCOL_VERSION, buffer);
-					if ((rc == SLURM_SUCCESS)
-					    && !remaining_buf(buffer))
-						goto got_it;
-
-					/* If the current version
-					   failed lets try the last
-					   version.
-					*/
-					set_buf_offset(buffer, 0);
-					rc = unpack_slurmdbd_msg(
-						&msg, SLURMDBD_VERSION_MIN,
-						buffer);
-				} else
-					rc = unpack_slurmdbd_msg(
-						&msg, rpc_version, buffer);
-			got_it:
-				free_buf(buffer);
-				if (rc == SLURM_SUCCESS)
-					buffer = pack_slurmdbd_msg(
-						&msg, SLURM_PROTOCOL_VERSION);
-				else
-					buffer = NULL;
-			}
+			if (rpc_version != SLURM_PROTOCOL_VERSION)
+				buffer = _convert_dbd_rec(buffer, rpc_version);
 			if (!buffer) {
 				error("no buffer given");
 				continue;
 			}
-			if (!list_enqueue(agent_list, buffer))
-				fatal("slurmdbd: list_enqueue, no memory");
+			_agent_enqueue(buffer);
 			recovered++;
 			buffer = NULL;
 		}
@@ -2339,10 +2602,46 @@ static void _load_dbd_state(void)
 	end_it:
 		verbose("slurmdbd: recovered %d pending RPCs", recovered);
 		(void) close(fd);
+		if (spool_dir && (fsync(spool_fd) == 0))
+			(void) unlink(dbd_fname);
 	}
 	xfree(dbd_fname);
 }
 
+/* Repack a saved message with the current protocol version, rpc_version
+ * being zero if unknown. The buffer given is freed.
+ * RET the new buffer or NULL on error */
+static Buf _convert_dbd_rec(Buf buffer, uint16_t rpc_version)
+{
+	slurmdbd_msg_t msg;
+	int rc;
+
+	set_buf_offset(buffer, 0);
+	if (rpc_version == 0) {
+		/* This should only happen for
+		   pre 2.2.0.rc4 and 2.1
+		   machines so no real need to
+		   keep it add more to it.
+		*/
+		rc = unpack_slurmdbd_msg(&msg, SLURM_PROTOCOL_VERSION, buffer);
+		if ((rc == SLURM_SUCCESS) && !remaining_buf(buffer))
+			goto got_it;
+
+		/* If the current version
+		   failed lets try the last
+		   version.
+		*/
+		set_buf_offset(buffer, 0);
+		rc = unpack_slurmdbd_msg(&msg, SLURMDBD_VERSION_MIN, buffer);
+	} else
+		rc = unpack_slurmdbd_msg(&msg, rpc_version, buffer);
+got_it:
+	free_buf(buffer);
+	if (rc != SLURM_SUCCESS)
+		return (Buf) NULL;
+	return pack_slurmdbd_msg(&msg, SLURM_PROTOCOL_VERSION);
+}
+
 static int _save_dbd_rec(int fd, Buf buffer)
 {
 	ssize_t size, wrote;
@@ -2434,11 +2733,540 @@ static void _sig_handler(int signal)
 {
 }
 
+/****************************************************************************
+ * Functions for the spool of the agent's queue, agent_lock must be locked
+ ****************************************************************************/
+/* FNV-1a hash of a spooled message, to detect torn or corrupt records */
+static uint32_t _spool_sum(char *data, uint32_t size)
+{
+	uint32_t sum = 2166136261U;
+
+	while (size--) {
+		sum ^= (unsigned char) *data++;
+		sum *= 16777619;
+	}
+	return sum;
+}
+
+static char *_spool_seg_path(uint32_t seg_no)
+{
+	return xstrdup_printf("%s/%u", spool_dir, seg_no);
+}
+
+static int _spool_sort_seg(void *x, void *y)
+{
+	spool_seg_t *seg1 = *(spool_seg_t **) x;
+	spool_seg_t *seg2 = *(spool_seg_t **) y;
+
+	if (seg1->seg_no < seg2->seg_no)
+		return -1;
+	return (seg1->seg_no > seg2->seg_no);
+}
+
+static bool _spool_pread(int fd, void *buf, size_t size, off_t offset)
+{
+	ssize_t rd_size;
+
+	while (size) {
+		rd_size = pread(fd, buf, size, offset);
+		if (rd_size > 0) {
+			buf = (char *) buf + rd_size;
+			size -= rd_size;
+			offset += rd_size;
+		} else if ((rd_size == -1) && (errno == EINTR))
+			continue;
+		else
+			return false;
+	}
+	return true;
+}
+
+/* Read the record of a spool segment at *offset, before end, and move
+ * *offset past it.
+ * RET the message, NULL at the end of the segment or if the record is not
+ *	valid */
+static Buf _spool_read_rec(int fd, off_t *offset, off_t end)
+{
+	spool_rec_hdr_t hdr;
+	Buf buffer;
+
+	if (((*offset + sizeof(hdr)) > end) ||
+	    !_spool_pread(fd, &hdr, sizeof(hdr), *offset) ||
+	    (hdr.magic != DBD_SPOOL_MAGIC) || (hdr.size > MAX_BUF_SIZE) ||
+	    ((*offset + sizeof(hdr) + hdr.size) > end))
+		return (Buf) NULL;
+
+	buffer = init_buf(hdr.size);
+	if (!_spool_pread(fd, get_buf_data(buffer), hdr.size,
+			  *offset + sizeof(hdr)) ||
+	    (_spool_sum(get_buf_data(buffer), hdr.size) != hdr.sum)) {
+		free_buf(buffer);
+		return (Buf) NULL;
+	}
+	/* Like a message just packed, ready to send */
+	set_buf_offset(buffer, hdr.size);
+	*offset += sizeof(hdr) + hdr.size;
+	return buffer;
+}
+
+static void _spool_write_head(void)
+{
+	spool_head_t head;
+	spool_seg_t *seg = list_peek(spool_segs);
+
+	head.magic = DBD_SPOOL_MAGIC;
+	head.seg_no = seg->seg_no;
+	head.rec_cnt = spool_head_recs;
+	if (pwrite(spool_head_fd, &head, sizeof(head), 0) != sizeof(head))
+		error("slurmdbd: writing %s/head: %m", spool_dir);
+}
+
+/* Start a new spool segment. The previous one is left for the agent to
+ * sync to disk, so callers holding slurmctld locks do not wait for it */
+static int _spool_new_seg(void)
+{
+	spool_seg_hdr_t hdr;
+	spool_seg_t *seg;
+	char *path;
+	int fd;
+
+	path = _spool_seg_path(spool_seg_no + 1);
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0600);
+	if (fd < 0) {
+		error("slurmdbd: creating %s: %m", path);
+		xfree(path);
+		return SLURM_ERROR;
+	}
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = DBD_SPOOL_MAGIC;
+	hdr.rpc_version = SLURM_PROTOCOL_VERSION;
+	if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+		error("slurmdbd: writing %s: %m", path);
+		(void) close(fd);
+		(void) unlink(path);
+		xfree(path);
+		return SLURM_ERROR;
+	}
+	fd_set_close_on_exec(fd);
+	xfree(path);
+
+	if (spool_fd >= 0) {
+		int *fd_ptr = xmalloc(sizeof(int));
+		*fd_ptr = spool_fd;
+		if (!spool_sync_list)
+			spool_sync_list = list_create(NULL);
+		list_append(spool_sync_list, fd_ptr);
+	}
+	spool_fd = fd;
+	seg = xmalloc(sizeof(spool_seg_t));
+	seg->seg_no = ++spool_seg_no;
+	seg->size = sizeof(hdr);
+	seg->rpc_version = SLURM_PROTOCOL_VERSION;
+	list_append(spool_segs, seg);
+	spool_write_seg = seg;
+	return SLURM_SUCCESS;
+}
+
+/* Remove the oldest spool segment */
+static void _spool_pop_seg(void)
+{
+	spool_seg_t *seg = list_pop(spool_segs);
+	char *path = _spool_seg_path(seg->seg_no);
+
+	if (seg == spool_read_seg) {
+		if (spool_read_fd >= 0)
+			(void) close(spool_read_fd);
+		spool_read_fd = -1;
+		spool_read_seg = NULL;
+	}
+	(void) unlink(path);
+	xfree(path);
+	xfree(seg);
+}
+
+/* Read the header and count the valid records of a spool segment found
+ * when opening the spool, also finding the offset following its first skip
+ * records.
+ * RET SLURM_SUCCESS or SLURM_ERROR if the segment is unusable */
+static int _spool_scan_seg(spool_seg_t *seg, uint32_t skip,
+			   off_t *skip_offset)
+{
+	spool_seg_hdr_t hdr;
+	struct stat stat_buf;
+	off_t offset;
+	Buf buffer;
+	char *path = _spool_seg_path(seg->seg_no);
+	int fd, rc = SLURM_ERROR;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		error("slurmdbd: opening %s: %m", path);
+		goto fini;
+	}
+	if (fstat(fd, &stat_buf) ||
+	    !_spool_pread(fd, &hdr, sizeof(hdr), 0) ||
+	    (hdr.magic != DBD_SPOOL_MAGIC)) {
+		error("slurmdbd: %s is not a spool segment", path);
+		goto fini;
+	}
+
+	seg->rpc_version = hdr.rpc_version;
+	offset = *skip_offset = sizeof(hdr);
+	while ((buffer = _spool_read_rec(fd, &offset, stat_buf.st_size))) {
+		free_buf(buffer);
+		if (++seg->rec_cnt == skip)
+			*skip_offset = offset;
+	}
+	if (seg->rec_cnt < skip)
+		*skip_offset = offset;
+	if (offset < stat_buf.st_size) {
+		/* Most likely the last record written before a crash */
+		error("slurmdbd: %s is truncated or corrupt at offset %"PRIu64
+		      ", ignoring the rest of it", path, (uint64_t) offset);
+	}
+	seg->size = offset;
+	rc = SLURM_SUCCESS;
+
+fini:
+	if (fd >= 0)
+		(void) close(fd);
+	xfree(path);
+	return rc;
+}
+
+/* Open the spool, queueing the messages in it which were not processed
+ * yet. Messages are only saved at shutdown if it can not be opened. */
+static void _spool_open(void)
+{
+	spool_head_t head;
+	spool_seg_t *seg;
+	ListIterator itr;
+	DIR *dir;
+	struct dirent *ent;
+	char *path, *end;
+	unsigned long seg_no;
+	off_t skip_offset = 0;
+	int recs = 0;
+
+	spool_dir = slurm_get_state_save_location();
+	xstrcat(spool_dir, "/dbd.spool");
+	if ((mkdir(spool_dir, 0700) < 0) && (errno != EEXIST)) {
+		error("slurmdbd: creating %s: %m", spool_dir);
+		xfree(spool_dir);
+		return;
+	}
+	path = xstrdup_printf("%s/head", spool_dir);
+	spool_head_fd = open(path, O_RDWR | O_CREAT, 0600);
+	if (spool_head_fd < 0)
+		error("slurmdbd: opening %s: %m", path);
+	xfree(path);
+	if ((spool_head_fd < 0) || !(dir = opendir(spool_dir))) {
+		if (spool_head_fd >= 0)
+			error("slurmdbd: opendir(%s): %m", spool_dir);
+		_spool_close(false);
+		return;
+	}
+	fd_set_close_on_exec(spool_head_fd);
+
+	if (!_spool_pread(spool_head_fd, &head, sizeof(head), 0) ||
+	    (head.magic != DBD_SPOOL_MAGIC))
+		memset(&head, 0, sizeof(head));
+	spool_seg_no = head.seg_no;
+
+	spool_segs = list_create(NULL);
+	while ((ent = readdir(dir))) {
+		if (!isdigit(ent->d_name[0]))
+			continue;
+		seg_no = strtoul(ent->d_name, &end, 10);
+		if (end[0] || (seg_no > UINT32_MAX))
+			continue;
+		seg = xmalloc(sizeof(spool_seg_t));
+		seg->seg_no = seg_no;
+		seg->old = true;
+		list_append(spool_segs, seg);
+		spool_seg_no = MAX(spool_seg_no, seg_no);
+	}
+	closedir(dir);
+	list_sort(spool_segs, _spool_sort_seg);
+
+	itr = list_iterator_create(spool_segs);
+	while ((seg = list_next(itr))) {
+		if ((seg->seg_no < head.seg_no) ||
+		    (_spool_scan_seg(seg, (seg->seg_no == head.seg_no) ?
+				     head.rec_cnt : 0, &skip_offset)
+		     != SLURM_SUCCESS)) {
+			/* Processed or unusable */
+			path = _spool_seg_path(seg->seg_no);
+			(void) unlink(path);
+			xfree(path);
+			list_delete_item(itr);
+			xfree(seg);
+			continue;
+		}
+		if (seg->seg_no == head.seg_no) {
+			spool_head_recs = MIN(head.rec_cnt, seg->rec_cnt);
+			spool_read_seg = seg;
+			spool_read_offset = skip_offset;
+			spool_read_recs = spool_head_recs;
+		}
+		recs += seg->rec_cnt;
+	}
+	list_iterator_destroy(itr);
+
+	if (_spool_new_seg() != SLURM_SUCCESS) {
+		_spool_close(false);
+		return;
+	}
+	spool_unloaded = recs - spool_head_recs;
+	if (spool_unloaded) {
+		verbose("slurmdbd: recovered %d pending RPCs from %s",
+			spool_unloaded, spool_dir);
+		_spool_load(MAX_AGENT_MEM_MSGS);
+	}
+	_spool_ack(0);	/* remove the segments processed */
+}
+
+/* Sync complete spool segments to disk and close them. Called by the agent
+ * without agent_lock */
+static void _spool_sync(void)
+{
+	List sync_list;
+	int *fd_ptr;
+
+	slurm_mutex_lock(&agent_lock);
+	sync_list = spool_sync_list;
+	spool_sync_list = NULL;
+	slurm_mutex_unlock(&agent_lock);
+	if (!sync_list)
+		return;
+
+	while ((fd_ptr = list_pop(sync_list))) {
+		(void) fsync(*fd_ptr);
+		(void) close(*fd_ptr);
+		xfree(fd_ptr);
+	}
+	list_destroy(sync_list);
+}
+
+/* Close the spool, removing its files if remove is set */
+static void _spool_close(bool remove)
+{
+	spool_seg_t *seg;
+	char *path;
+	int *fd_ptr;
+
+	if (spool_sync_list) {
+		while ((fd_ptr = list_pop(spool_sync_list))) {
+			if (!remove)
+				(void) fsync(*fd_ptr);
+			(void) close(*fd_ptr);
+			xfree(fd_ptr);
+		}
+		list_destroy(spool_sync_list);
+		spool_sync_list = NULL;
+	}
+	if (spool_fd >= 0) {
+		if (!remove)
+			(void) fsync(spool_fd);
+		(void) close(spool_fd);
+		spool_fd = -1;
+	}
+	if (spool_read_fd >= 0) {
+		(void) close(spool_read_fd);
+		spool_read_fd = -1;
+	}
+	if (spool_head_fd >= 0) {
+		(void) close(spool_head_fd);
+		spool_head_fd = -1;
+	}
+	if (spool_segs) {
+		while ((seg = list_pop(spool_segs))) {
+			if (remove) {
+				path = _spool_seg_path(seg->seg_no);
+				(void) unlink(path);
+				xfree(path);
+			}
+			xfree(seg);
+		}
+		list_destroy(spool_segs);
+		spool_segs = NULL;
+	}
+	if (remove) {
+		path = xstrdup_printf("%s/head", spool_dir);
+		(void) unlink(path);
+		xfree(path);
+	}
+	spool_write_seg = NULL;
+	spool_read_seg = NULL;
+	spool_head_recs = 0;
+	spool_unloaded = 0;
+	xfree(spool_dir);
+}
+
+/* Append a message to the spool, starting a new segment once this one is
+ * DBD_SPOOL_SEG_SIZE. Segments are synced to disk by the agent once
+ * complete, so the messages survive a crash of slurmctld, not necessarily
+ * one of the node.
+ * RET SLURM_SUCCESS or SLURM_ERROR on write error */
+static int _spool_append(Buf buffer)
+{
+	spool_rec_hdr_t hdr;
+	struct iovec iov[2];
+	ssize_t wrote, size;
+	int i;
+
+	hdr.magic = DBD_SPOOL_MAGIC;
+	hdr.size = get_buf_offset(buffer);
+	hdr.sum = _spool_sum(get_buf_data(buffer), hdr.size);
+	iov[0].iov_base = &hdr;
+	iov[0].iov_len = sizeof(hdr);
+	iov[1].iov_base = get_buf_data(buffer);
+	iov[1].iov_len = hdr.size;
+	size = sizeof(hdr) + hdr.size;
+
+	while (iov[0].iov_len || iov[1].iov_len) {
+		wrote = writev(spool_fd, iov, 2);
+		if (wrote < 0) {
+			if (errno == EINTR)
+				continue;
+			error("slurmdbd: writing to spool: %m");
+			/* Leave no partial record to append to */
+			(void) ftruncate(spool_fd, spool_write_seg->size);
+			return SLURM_ERROR;
+		}
+		for (i = 0; (i < 2) && wrote; i++) {
+			size_t len = MIN((size_t) wrote, iov[i].iov_len);
+			iov[i].iov_base = (char *) iov[i].iov_base + len;
+			iov[i].iov_len -= len;
+			wrote -= len;
+		}
+	}
+	spool_write_seg->size += size;
+	spool_write_seg->rec_cnt++;
+
+	if (spool_write_seg->size >= DBD_SPOOL_SEG_SIZE)
+		return _spool_new_seg();
+	return SLURM_SUCCESS;
+}
+
+/* Read messages only spooled back into agent_list, until it holds max_cnt
+ * of them or none is left */
+static void _spool_load(int max_cnt)
+{
+	spool_seg_t *seg;
+	ListIterator itr;
+	Buf buffer;
+	uint16_t msg_type;
+	uint32_t offset;
+	char *path;
+
+	while (spool_unloaded && (list_count(agent_list) < max_cnt)) {
+		if (!spool_read_seg) {
+			spool_read_seg = list_peek(spool_segs);
+			spool_read_offset = sizeof(spool_seg_hdr_t);
+			spool_read_recs = 0;
+		}
+		seg = spool_read_seg;
+		if (spool_read_recs >= seg->rec_cnt) {
+			/* Move on to the next segment */
+			itr = list_iterator_create(spool_segs);
+			while ((seg = list_next(itr)) &&
+			       (seg != spool_read_seg))
+				;
+			seg = list_next(itr);
+			list_iterator_destroy(itr);
+			if (!seg) {
+				error("slurmdbd: %d spooled messages not "
+				      "found", spool_unloaded);
+				spool_unloaded = 0;
+				break;
+			}
+			if (spool_read_fd >= 0)
+				(void) close(spool_read_fd);
+			spool_read_fd = -1;
+			spool_read_seg = seg;
+			spool_read_offset = sizeof(spool_seg_hdr_t);
+			spool_read_recs = 0;
+			continue;
+		}
+
+		if (spool_read_fd < 0) {
+			path = _spool_seg_path(seg->seg_no);
+			spool_read_fd = open(path, O_RDONLY);
+			if (spool_read_fd < 0)
+				error("slurmdbd: opening %s: %m", path);
+			else
+				fd_set_close_on_exec(spool_read_fd);
+			xfree(path);
+		}
+		if ((spool_read_fd < 0) ||
+		    !(buffer = _spool_read_rec(spool_read_fd,
+					       &spool_read_offset,
+					       seg->size))) {
+			error("slurmdbd: unable to read spool segment %u, "
+			      "%u queued messages lost", seg->seg_no,
+			      seg->rec_cnt - spool_read_recs);
+			spool_unloaded -= seg->rec_cnt - spool_read_recs;
+			spool_read_recs = seg->rec_cnt;
+			continue;
+		}
+		spool_read_recs++;
+		spool_unloaded--;
+
+		if (seg->rpc_version != SLURM_PROTOCOL_VERSION)
+			buffer = _convert_dbd_rec(buffer, seg->rpc_version);
+		if (!buffer)
+			continue;
+		if (seg->old) {
+			/* Registration messages are not sent again after a
+			 * restart, see _save_dbd_state() */
+			offset = get_buf_offset(buffer);
+			if (offset < 2) {
+				free_buf(buffer);
+				continue;
+			}
+			set_buf_offset(buffer, 0);
+			unpack16(&msg_type, buffer);
+			set_buf_offset(buffer, offset);
+			if (msg_type == DBD_REGISTER_CTLD) {
+				free_buf(buffer);
+				continue;
+			}
+		}
+		if (list_enqueue(agent_list, buffer) == NULL)
+			fatal("list_enqueue: memory allocation failure");
+	}
+}
+
+/* Record the acked messages at the head of agent_list as processed,
+ * removing the spool segments no longer needed. Messages removed from
+ * elsewhere in the queue are not counted, they are only forgotten by the
+ * spool once the queue is empty and would be sent again after a crash of
+ * slurmctld until then. */
+static void _spool_ack(int acked)
+{
+	spool_seg_t *seg;
+
+	if (!list_count(agent_list) && !spool_unloaded) {
+		while ((seg = list_peek(spool_segs)) != spool_write_seg)
+			_spool_pop_seg();
+		spool_head_recs = spool_write_seg->rec_cnt;
+	} else {
+		spool_head_recs += acked;
+		while (((seg = list_peek(spool_segs)) != spool_write_seg) &&
+		       (spool_head_recs >= seg->rec_cnt)) {
+			spool_head_recs -= seg->rec_cnt;
+			_spool_pop_seg();
+		}
+	}
+	_spool_write_head();
+}
+
 /* Purge queued job/step start records from the agent queue
  * RET number of records purged */
 static int _purge_job_start_req(void)
 {
-	int purged = 0;
+	int purged = 0, skip = agent_sent_cnt;
 	ListIterator iter;
 	uint16_t msg_type;
 	uint32_t offset;
@@ -2446,6 +3274,11 @@ static int _purge_job_start_req(void)
 
 	iter = list_iterator_create(agent_list);
 	while ((buffer = list_next(iter))) {
+		/* Leave the messages being sent */
+		if (skip) {
+			skip--;
+			continue;
+		}
 		offset = get_buf_offset(buffer);
 		if (offset < 2)
 			continue;
@@ -390,6 +390,25 @@ extern uint16_t running_cache;
 extern pthread_mutex_t assoc_cache_mutex; /* assoc cache mutex */
 extern pthread_cond_t assoc_cache_cond; /* assoc cache condition */
 
+/* Buckets of the slurmdbd_agent_stats_t histograms: bucket i counts values
+ * under 10^(i+1), the last bucket counts all larger values */
+#define DBD_AGENT_HIST_CNT	8
+
+/* Statistics of the agent sending queued messages to the SlurmDBD,
+ * times in microseconds */
+typedef struct {
+	uint32_t queue_len;	/* messages queued, sent or not */
+	uint32_t queue_max;	/* largest queue_len */
+	uint32_t batch_cnt;	/* batches of messages sent */
+	uint32_t batch_max;	/* messages in the largest batch */
+	uint32_t inflight_max;	/* most batches awaiting a reply at once */
+	uint32_t msg_cnt;	/* messages acknowledged */
+	uint64_t rtt_total;	/* time from sending batches to their reply */
+	uint64_t rtt_max;
+	uint32_t batch_hist[DBD_AGENT_HIST_CNT];	/* messages per batch */
+	uint32_t rtt_hist[DBD_AGENT_HIST_CNT];
+} slurmdbd_agent_stats_t;
+
 /*****************************************************************************\
  * Slurm DBD message processing functions
 \*****************************************************************************/
@@ -422,6 +441,11 @@ extern int slurm_close_slurmdbd_conn();
 extern int slurm_send_slurmdbd_msg(uint16_t rpc_version,
 				   slurmdbd_msg_t *req);
 
+/* Get or clear the statistics of the agent sending the messages queued by
+ * slurm_send_slurmdbd_msg() */
+extern void slurmdbd_get_agent_stats(slurmdbd_agent_stats_t *stats);
+extern void slurmdbd_reset_agent_stats(void);
+
 /* Send an RPC to the SlurmDBD and wait for an arbitrary reply message.
  * The RPC will not be queued if an error occurs.
  * The "resp" message must be freed by the caller.
@@ -135,8 +135,9 @@ void *slurm_try_xmalloc(size_t size, const char *file, int line,
  * the object to be realloced instead of the object itself.
  *   item (IN/OUT)	double-pointer to allocated space
  *   newsize (IN)	requested size
+ *   clear (IN)		initialize to zero any memory added
  */
-void * slurm_xrealloc(void **item, size_t newsize,
+void * slurm_xrealloc(void **item, size_t newsize, bool clear,
 	              const char *file, int line, const char *func)
 {
 	int *p = NULL;
@@ -144,7 +145,25 @@ void * slurm_xrealloc(void **item, size_t newsize,
 	/* xmalloc_assert(*item != NULL, file, line, func); */
 	xmalloc_assert(newsize >= 0 && (int)newsize <= INT_MAX);
 
-	if (*item != NULL) {
+	if ((*item != NULL) && (((int *)*item)[-2] == XMALLOC_ARENA_MAGIC)) {
+		/* move memory from an arena to the heap */
+		int old_size = ((int *)*item)[-1];
+
+		MALLOC_LOCK();
+		p = (int *)malloc(newsize + 2*sizeof(int));
+		MALLOC_UNLOCK();
+
+		if (p == NULL)
+			goto error;
+
+		memcpy(&p[2], *item, MIN(old_size, newsize));
+		if (clear && (old_size < newsize)) {
+			char *p_new = (char *)(&p[2]) + old_size;
+			memset(p_new, 0, (int)(newsize-old_size));
+		}
+		p[0] = XMALLOC_MAGIC;
+
+	} else if (*item != NULL) {
 		int old_size;
 		p = (int *)*item - 2;
 
@@ -159,7 +178,7 @@ void * slurm_xrealloc(void **item, size_t newsize,
 		if (p == NULL)
 			goto error;
 
-		if (old_size < newsize) {
+		if (clear && (old_size < newsize)) {
 			char *p_new = (char *)(&p[2]) + old_size;
 			memset(p_new, 0, (int)(newsize-old_size));
 		}
@@ -174,7 +193,8 @@ void * slurm_xrealloc(void **item, size_t newsize,
 		if (p == NULL)
 			goto error;
 
-		memset(&p[2], 0, newsize);
+		if (clear)
+			memset(&p[2], 0, newsize);
 		p[0] = XMALLOC_MAGIC;
 	}
 
@@ -199,7 +219,25 @@ int slurm_try_xrealloc(void **item, size_t newsize,
 	/* xmalloc_assert(*item != NULL, file, line, func); */
 	xmalloc_assert(newsize >= 0 && (int)newsize <= INT_MAX);
 
-	if (*item != NULL) {
+	if ((*item != NULL) && (((int *)*item)[-2] == XMALLOC_ARENA_MAGIC)) {
+		/* move memory from an arena to the heap */
+		int old_size = ((int *)*item)[-1];
+
+		MALLOC_LOCK();
+		p = (int *)malloc(newsize + 2*sizeof(int));
+		MALLOC_UNLOCK();
+
+		if (p == NULL)
+			return 0;
+
+		memcpy(&p[2], *item, MIN(old_size, newsize));
+		if (old_size < newsize) {
+			char *p_new = (char *)(&p[2]) + old_size;
+			memset(p_new, 0, (int)(newsize-old_size));
+		}
+		p[0] = XMALLOC_MAGIC;
+
+	} else if (*item != NULL) {
 		int old_size;
 		p = (int *)*item - 2;
 
@@ -247,7 +285,8 @@ int slurm_xsize(void *item, const char *file, int line, const char *func)
 {
 	int *p = (int *)item - 2;
 	xmalloc_assert(item != NULL);
-	xmalloc_assert(p[0] == XMALLOC_MAGIC); /* CLANG false positive here */
+	xmalloc_assert((p[0] == XMALLOC_MAGIC) ||	/* CLANG false positive */
+		       (p[0] == XMALLOC_ARENA_MAGIC));
 	return p[1];
 }
 
@@ -260,6 +299,11 @@ void slurm_xfree(void **item, const char *file, int line, const char *func)
 {
 	if (*item != NULL) {
 		int *p = (int *)*item - 2;
+		if (p[0] == XMALLOC_ARENA_MAGIC) {
+			/* released with its arena */
+			*item = NULL;
+			return;
+		}
 		/* magic cookie still there? */
 		xmalloc_assert(p[0] == XMALLOC_MAGIC);
 		p[0] = 0;	/* make sure xfree isn't called twice */
@@ -270,6 +314,147 @@ void slurm_xfree(void **item, const char *file, int line, const char *func)
 	}
 }
 
+/*
+ * Arena of memory chunks, allocations are made from the first chunk.
+ * Allocations larger than a chunk get a chunk of their own.
+ */
+typedef struct xarena_chunk {
+	struct xarena_chunk *next;
+	size_t size;			/* bytes of data in the chunk */
+	size_t used;			/* bytes of data allocated */
+} xarena_chunk_t;
+
+struct xarena {
+	xarena_chunk_t *chunk;
+	size_t chunk_size;
+};
+
+/* Chunk data and allocations are aligned for any data type */
+#define XARENA_ALIGN(__sz)	(((__sz) + 15) & ~((size_t) 15))
+#define XARENA_DATA(__chunk)	\
+	((char *)(__chunk) + XARENA_ALIGN(sizeof(xarena_chunk_t)))
+
+static xarena_chunk_t *_xarena_chunk(size_t size)
+{
+	xarena_chunk_t *chunk;
+
+	MALLOC_LOCK();
+	chunk = malloc(XARENA_ALIGN(sizeof(xarena_chunk_t)) + size);
+	MALLOC_UNLOCK();
+	if (!chunk) {
+		log_oom(__FILE__, __LINE__, __CURRENT_FUNC__);
+		abort();
+	}
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+/*
+ * Create an arena.
+ *   chunk_size (IN)	bytes of memory to allocate at a time
+ *   RETURN		arena, release using xarena_destroy()
+ */
+xarena_t *xarena_create(size_t chunk_size)
+{
+	xarena_t *arena = xmalloc(sizeof(xarena_t));
+
+	arena->chunk_size = XARENA_ALIGN(chunk_size);
+	return arena;
+}
+
+/*
+ * Allocate memory from an arena. The memory is not zeroed.
+ *   arena (IN)		arena to allocate from
+ *   size (IN)		number of bytes to allocate
+ *   RETURN		pointer to allocated space, may be passed to xfree(),
+ *			xrealloc() and xsize()
+ */
+void *slurm_xarena_alloc(xarena_t *arena, size_t size,
+			 const char *file, int line, const char *func)
+{
+	xarena_chunk_t *chunk = arena->chunk;
+	size_t need;
+	int *p;
+
+	xmalloc_assert(size >= 0 && size <= INT_MAX);
+	/* keep the returned pointer aligned as by malloc() */
+	need = XARENA_ALIGN(size + 4*sizeof(int));
+
+	if (!chunk || (chunk->used + need > chunk->size)) {
+		if (need > arena->chunk_size) {
+			/* dedicated chunk, keep using the current one */
+			xarena_chunk_t *big = _xarena_chunk(need);
+			if (chunk) {
+				big->next = chunk->next;
+				chunk->next = big;
+			} else
+				arena->chunk = big;
+			chunk = big;
+		} else {
+			chunk = _xarena_chunk(arena->chunk_size);
+			chunk->next = arena->chunk;
+			arena->chunk = chunk;
+		}
+	}
+
+	p = (int *)(XARENA_DATA(chunk) + chunk->used);
+	chunk->used += need;
+	p[2] = XMALLOC_ARENA_MAGIC;
+	p[3] = (int)size;
+	return &p[4];
+}
+
+/*
+ * Release all memory allocated from an arena, keeping one chunk for reuse.
+ *   arena (IN)		arena to reset
+ */
+void xarena_reset(xarena_t *arena)
+{
+	xarena_chunk_t *chunk, *next;
+
+	if (!arena || !arena->chunk)
+		return;
+
+	chunk = arena->chunk;
+	next = chunk->next;
+	chunk->next = NULL;
+	chunk->used = 0;
+	if (chunk->size != arena->chunk_size) {
+		next = chunk;
+		arena->chunk = NULL;
+	}
+
+	MALLOC_LOCK();
+	while (next) {
+		chunk = next;
+		next = chunk->next;
+		free(chunk);
+	}
+	MALLOC_UNLOCK();
+}
+
+/*
+ * Release an arena and all memory allocated from it.
+ *   arena (IN)		arena to destroy
+ */
+void xarena_destroy(xarena_t *arena)
+{
+	xarena_chunk_t *chunk;
+
+	if (!arena)
+		return;
+
+	MALLOC_LOCK();
+	while ((chunk = arena->chunk)) {
+		arena->chunk = chunk->next;
+		free(chunk);
+	}
+	MALLOC_UNLOCK();
+	xfree(arena);
+}
+
 #ifndef NDEBUG
 static void malloc_assert_failed(char *expr, const char *file,
 		                 int line, const char *caller, const char *func)
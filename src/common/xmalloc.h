@@ -45,6 +45,7 @@
  * void *xmalloc(size_t size);
  * void *try_xmalloc(size_t size);
  * void xrealloc(void *p, size_t newsize);
+ * void xrealloc_nz(void *p, size_t newsize);
  * int  try_xrealloc(void *p, size_t newsize);
  * void xfree(void *p);
  * int  xsize(void *p);
@@ -62,6 +63,9 @@
  * is not NULL, it is required to have been initialized with a call to
  * [try_]xmalloc() or [try_]xrealloc().
  *
+ * xrealloc_nz(p, newsize) is the same as xrealloc(), but newly allocated
+ * memory is not zeroed.
+ *
  * try_xrealloc(p, newsize) is the same as above, but returns <= 0 if the
  * there is an error allocating the requested memory.
  *
@@ -69,8 +73,21 @@
  * initialized with a call to [try_]xmalloc() or [try_]xrealloc().
  *
  * xsize(p) returns the current size of the memory allocation pointed to by
- * p. The memory must have been allocated with [try_]xmalloc() or
- * [try_]xrealloc().
+ * p. The memory must have been allocated with [try_]xmalloc(),
+ * [try_]xrealloc() or xarena_alloc().
+ *
+ * xarena_t *xarena_create(size_t chunk_size);
+ * void *xarena_alloc(xarena_t *arena, size_t size);
+ * void xarena_reset(xarena_t *arena);
+ * void xarena_destroy(xarena_t *arena);
+ *
+ * An arena hands out memory from large chunks so that many small allocations
+ * which are all released at the same time (e.g. the data of an RPC) cost
+ * one malloc() and one free() per chunk. xarena_alloc(arena, size) returns
+ * size bytes of memory, which is NOT zeroed. xfree() of arena memory only
+ * clears the pointer, the memory is released by xarena_reset(), which keeps
+ * the first chunk for reuse, or xarena_destroy(). xrealloc() of arena memory
+ * moves it to the heap. An arena must only be used by one thread at a time.
  *
 \*****************************************************************************/
 
@@ -93,7 +110,11 @@
 	slurm_xfree((void **)&(__p), __FILE__, __LINE__, __CURRENT_FUNC__)
 
 #define xrealloc(__p, __sz) \
-        slurm_xrealloc((void **)&(__p), __sz, \
+        slurm_xrealloc((void **)&(__p), __sz, true, \
+                       __FILE__, __LINE__, __CURRENT_FUNC__)
+
+#define xrealloc_nz(__p, __sz) \
+        slurm_xrealloc((void **)&(__p), __sz, false, \
                        __FILE__, __LINE__, __CURRENT_FUNC__)
 
 #define try_xrealloc(__p, __sz) \
@@ -103,13 +124,24 @@
 #define xsize(__p) \
 	slurm_xsize((void *)__p, __FILE__, __LINE__, __CURRENT_FUNC__)
 
+#define xarena_alloc(__a, __sz) \
+	slurm_xarena_alloc(__a, __sz, __FILE__, __LINE__, __CURRENT_FUNC__)
+
 void *slurm_xmalloc(size_t, const char *, int, const char *);
 void *slurm_try_xmalloc(size_t , const char *, int , const char *);
 void slurm_xfree(void **, const char *, int, const char *);
-void *slurm_xrealloc(void **, size_t, const char *, int, const char *);
+void *slurm_xrealloc(void **, size_t, bool, const char *, int, const char *);
 int  slurm_try_xrealloc(void **, size_t, const char *, int, const char *);
 int  slurm_xsize(void *, const char *, int, const char *);
 
+typedef struct xarena xarena_t;
+
+xarena_t *xarena_create(size_t chunk_size);
+void *slurm_xarena_alloc(xarena_t *, size_t, const char *, int, const char *);
+void xarena_reset(xarena_t *arena);
+void xarena_destroy(xarena_t *arena);
+
 #define XMALLOC_MAGIC 0x42
+#define XMALLOC_ARENA_MAGIC 0x43
 
 #endif /* !_XMALLOC_H */
@@ -219,3 +219,8 @@ extern void priority_p_job_end(struct job_record *job_ptr)
 
 	return;
 }
+
+extern void priority_p_job_changed(struct job_record *job_ptr)
+{
+	return;
+}
@@ -64,6 +64,7 @@
 
 #include <sys/stat.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 
 #include <math.h>
@@ -154,6 +155,61 @@ static uint32_t max_tickets; /* Maximum number of tickets given to a
 			      * user. Protected by assoc_mgr lock. */
 static time_t g_last_ran = 0; /* when the last poll ran */
 static double decay_factor = 1; /* The decay factor when decaying time. */
+static bool usage_changed = 1; /* usage added or reset since the effective
+				* usage was set, protected by assoc_mgr lock */
+static uint32_t usage_assoc_update_cnt = 0; /* assoc_mgr_assoc_update_cnt
+					     * when the effective usage
+					     * was set */
+
+/* Priorities of pending jobs are computed by up to PRIO_MAX_THREADS
+ * threads, each given at least PRIO_THREAD_JOBS jobs */
+#define PRIO_MAX_THREADS	8
+#define PRIO_THREAD_JOBS	4096
+
+/* Priority of a pending job computed while holding read locks, to be set
+ * once the job write lock is taken */
+typedef struct {
+	uint32_t job_id;
+	struct job_record *job_ptr;	/* only valid under the read locks */
+	uint32_t old_priority;		/* job's priority when computed */
+	priority_factors_object_t old_factors;
+	uint32_t priority;
+	priority_factors_object_t factors;
+	uint32_t *priority_array;	/* per partition if several */
+} prio_calc_t;
+
+typedef struct {
+	time_t start_time;
+	prio_calc_t *calc;
+	uint32_t calc_cnt;
+} prio_thread_t;
+
+/* Priority factors of a pending job, as reported to sprio */
+typedef struct {
+	uint32_t job_id;
+	uint32_t user_id;
+	char *account;
+	time_t begin_time;
+	priority_factors_object_t factors;
+} prio_snapshot_job_t;
+
+/* Immutable copy of the priority factors of all pending jobs, shared by
+ * the threads answering priority factors requests so they need no
+ * slurmctld locks. Built after each calculation of the pending job
+ * priorities, or by the next request once a job's priority is set. */
+typedef struct {
+	uint32_t version;		/* prio_snapshot_version when built */
+	int ref_cnt;			/* prio_snapshot plus readers */
+	uint32_t job_cnt;
+	prio_snapshot_job_t *jobs;
+	uint32_t *job_ids;		/* IDs of jobs, sorted */
+} prio_snapshot_t;
+
+static prio_snapshot_t *prio_snapshot = NULL;
+static uint32_t prio_snapshot_version = 1; /* incremented when a job's
+					    * priority is set, or a job
+					    * enters or leaves the snapshot */
+static pthread_mutex_t prio_snapshot_lock = PTHREAD_MUTEX_INITIALIZER;
 
 extern void priority_p_set_assoc_usage(slurmdb_association_rec_t *assoc);
 extern double priority_p_calc_fs_factor(long double usage_efctv,
@@ -246,6 +302,7 @@ static int _reset_usage(void)
 		qos->usage->grp_used_wall = 0;
 	}
 	list_iterator_destroy(itr);
+	usage_changed = 1;
 	assoc_mgr_unlock(&locks);
 
 	return SLURM_SUCCESS;
@@ -446,6 +503,30 @@ static int _set_children_usage_efctv(List children_list)
 	return SLURM_SUCCESS;
 }
 
+/* Set the effective usage of the associations again if any usage was
+ * added or reset or any association changed since it was last set.
+ * Decay alone multiplies the usage of every association, root included,
+ * by the same factor which leaves their normalized and effective usage
+ * as they were, so the effective usage of users which was set since is
+ * kept as well.
+ *
+ * NOTE: acct_mgr_association_lock must be locked before this is called.
+ */
+static void _update_usage_efctv(bool force)
+{
+	if (!force && !usage_changed
+	    && (usage_assoc_update_cnt == assoc_mgr_assoc_update_cnt)) {
+		if (priority_debug)
+			info("No usage or association change, keeping "
+			     "effective usage");
+		return;
+	}
+
+	_set_children_usage_efctv(assoc_mgr_root_assoc->usage->children_list);
+	usage_changed = 0;
+	usage_assoc_update_cnt = assoc_mgr_assoc_update_cnt;
+}
+
 
 /* Distribute the tickets to child nodes recursively.
  *
@@ -502,10 +583,29 @@ static int _distribute_tickets(List children_list, uint32_t tickets)
 }
 
 
+/* Return the association whose usage gives the job's fair share.
+ * The association manager lock should be held on entry. */
+static slurmdb_association_rec_t *_get_fs_assoc(struct job_record *job_ptr)
+{
+	slurmdb_association_rec_t *fs_assoc =
+		(slurmdb_association_rec_t *)job_ptr->assoc_ptr;
+
+	/* Use values from parent when FairShare=SLURMDB_FS_USE_PARENT */
+	while ((fs_assoc->shares_raw == SLURMDB_FS_USE_PARENT)
+	       && fs_assoc->usage->parent_assoc_ptr
+	       && (fs_assoc != assoc_mgr_root_assoc)) {
+		fs_assoc = fs_assoc->usage->parent_assoc_ptr;
+	}
+	return fs_assoc;
+}
+
 /* job_ptr should already have the partition priority and such added
  * here before had we will be adding to it
+ * IN assoc_locked - if set the association manager lock is held and
+ *	the effective usage of the job's association has been set
  */
-static double _get_fairshare_priority( struct job_record *job_ptr)
+static double _get_fairshare_priority(struct job_record *job_ptr,
+				      bool assoc_locked)
 {
 	slurmdb_association_rec_t *job_assoc =
 		(slurmdb_association_rec_t *)job_ptr->assoc_ptr;
@@ -523,16 +623,10 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 		return 0;
 	}
 
-	fs_assoc = job_assoc;
+	if (!assoc_locked)
+		assoc_mgr_lock(&locks);
 
-	assoc_mgr_lock(&locks);
-
-	/* Use values from parent when FairShare=SLURMDB_FS_USE_PARENT */
-	while ((fs_assoc->shares_raw == SLURMDB_FS_USE_PARENT)
-	       && fs_assoc->usage->parent_assoc_ptr
-	       && (fs_assoc != assoc_mgr_root_assoc)) {
-		fs_assoc = fs_assoc->usage->parent_assoc_ptr;
-	}
+	fs_assoc = _get_fs_assoc(job_ptr);
 
 	if (fuzzy_equal(fs_assoc->usage->usage_efctv, NO_VAL))
 		priority_p_set_assoc_usage(fs_assoc);
@@ -563,23 +657,21 @@ static double _get_fairshare_priority( struct job_record *job_ptr)
 			     fs_assoc->usage->shares_norm, priority_fs);
 		}
 	}
-	assoc_mgr_unlock(&locks);
+	if (!assoc_locked)
+		assoc_mgr_unlock(&locks);
 
 	return priority_fs;
 }
 
-static void _get_priority_factors(time_t start_time, struct job_record *job_ptr)
+static void _get_priority_factors(time_t start_time, struct job_record *job_ptr,
+				  priority_factors_object_t *factors,
+				  bool assoc_locked)
 {
 	slurmdb_qos_rec_t *qos_ptr = NULL;
 
 	xassert(job_ptr);
 
-	if (!job_ptr->prio_factors)
-		job_ptr->prio_factors =
-			xmalloc(sizeof(priority_factors_object_t));
-	else
-		memset(job_ptr->prio_factors, 0,
-		       sizeof(priority_factors_object_t));
+	memset(factors, 0, sizeof(priority_factors_object_t));
 
 	qos_ptr = (slurmdb_qos_rec_t *)job_ptr->qos_ptr;
 
@@ -600,22 +692,22 @@ static void _get_priority_factors(time_t start_time, struct job_record *job_ptr)
 
 		if (job_ptr->details->begin_time) {
 			if (diff < max_age) {
-				job_ptr->prio_factors->priority_age =
+				factors->priority_age =
 					(double)diff / (double)max_age;
 			} else
-				job_ptr->prio_factors->priority_age = 1.0;
+				factors->priority_age = 1.0;
 		} else if (flags & PRIORITY_FLAGS_ACCRUE_ALWAYS) {
 			if (diff < max_age) {
-				job_ptr->prio_factors->priority_age =
+				factors->priority_age =
 					(double)diff / (double)max_age;
 			} else
-				job_ptr->prio_factors->priority_age = 1.0;
+				factors->priority_age = 1.0;
 		}
 	}
 
 	if (job_ptr->assoc_ptr && weight_fs) {
-		job_ptr->prio_factors->priority_fs =
-			_get_fairshare_priority(job_ptr);
+		factors->priority_fs =
+			_get_fairshare_priority(job_ptr, assoc_locked);
 	}
 
 	if (weight_js) {
@@ -637,12 +729,12 @@ static void _get_priority_factors(time_t start_time, struct job_record *job_ptr)
 		if (flags & PRIORITY_FLAGS_SIZE_RELATIVE) {
 			uint32_t time_limit = 1;
 			/* Job size in CPUs (based upon average CPUs/Node */
-			job_ptr->prio_factors->priority_js =
+			factors->priority_js =
 				(double)min_nodes *
 				(double)cluster_cpus /
 				(double)node_record_count;
-			if (cpu_cnt > job_ptr->prio_factors->priority_js) {
-				job_ptr->prio_factors->priority_js =
+			if (cpu_cnt > factors->priority_js) {
+				factors->priority_js =
 					(double)cpu_cnt;
 			}
 			/* Divide by job time limit */
@@ -650,88 +742,81 @@ static void _get_priority_factors(time_t start_time, struct job_record *job_ptr)
 				time_limit = job_ptr->time_limit;
 			else if (job_ptr->part_ptr)
 				time_limit = job_ptr->part_ptr->max_time;
-			job_ptr->prio_factors->priority_js /= time_limit;
+			factors->priority_js /= time_limit;
 			/* Normalize to max value of 1.0 */
-			job_ptr->prio_factors->priority_js /= cluster_cpus;
+			factors->priority_js /= cluster_cpus;
 			if (favor_small) {
-				job_ptr->prio_factors->priority_js =
+				factors->priority_js =
 					(double) 1.0 -
-					job_ptr->prio_factors->priority_js;
+					factors->priority_js;
 			}
 		} else if (favor_small) {
-			job_ptr->prio_factors->priority_js =
+			factors->priority_js =
 				(double)(node_record_count - min_nodes)
 				/ (double)node_record_count;
 			if (cpu_cnt) {
-				job_ptr->prio_factors->priority_js +=
+				factors->priority_js +=
 					(double)(cluster_cpus - cpu_cnt)
 					/ (double)cluster_cpus;
-				job_ptr->prio_factors->priority_js /= 2;
+				factors->priority_js /= 2;
 			}
 		} else {	/* favor large */
-			job_ptr->prio_factors->priority_js =
+			factors->priority_js =
 				(double)min_nodes / (double)node_record_count;
 			if (cpu_cnt) {
-				job_ptr->prio_factors->priority_js +=
+				factors->priority_js +=
 					(double)cpu_cnt / (double)cluster_cpus;
-				job_ptr->prio_factors->priority_js /= 2;
+				factors->priority_js /= 2;
 			}
 		}
-		if (job_ptr->prio_factors->priority_js < .0)
-			job_ptr->prio_factors->priority_js = 0.0;
-		else if (job_ptr->prio_factors->priority_js > 1.0)
-			job_ptr->prio_factors->priority_js = 1.0;
+		if (factors->priority_js < .0)
+			factors->priority_js = 0.0;
+		else if (factors->priority_js > 1.0)
+			factors->priority_js = 1.0;
 	}
 
 	if (job_ptr->part_ptr && job_ptr->part_ptr->priority && weight_part) {
-		job_ptr->prio_factors->priority_part =
+		factors->priority_part =
 			job_ptr->part_ptr->norm_priority;
 	}
 
 	if (qos_ptr && qos_ptr->priority && weight_qos) {
-		job_ptr->prio_factors->priority_qos =
+		factors->priority_qos =
 			qos_ptr->usage->norm_priority;
 	}
 
 	if (job_ptr->details)
-		job_ptr->prio_factors->nice = job_ptr->details->nice;
+		factors->nice = job_ptr->details->nice;
 	else
-		job_ptr->prio_factors->nice = NICE_OFFSET;
+		factors->nice = NICE_OFFSET;
 }
 
-static uint32_t _get_priority_internal(time_t start_time,
-				       struct job_record *job_ptr)
+/* Compute a job's priority, its weighted factors and priority in each of
+ * its partitions without changing the job record.
+ * IN assoc_locked - see _get_fairshare_priority() */
+static uint32_t _calc_priority(time_t start_time, struct job_record *job_ptr,
+			       priority_factors_object_t *factors,
+			       uint32_t **priority_array, bool assoc_locked)
 {
 	double priority		= 0.0;
 	priority_factors_object_t pre_factors;
 
-	if (job_ptr->direct_set_prio && (job_ptr->priority > 0))
-		return job_ptr->priority;
-
-	if (!job_ptr->details) {
-		error("_get_priority_internal: job %u does not have a "
-		      "details symbol set, can't set priority",
-		      job_ptr->job_id);
-		return 0;
-	}
-
 	/* figure out the priority */
-	_get_priority_factors(start_time, job_ptr);
-	memcpy(&pre_factors, job_ptr->prio_factors,
-	       sizeof(priority_factors_object_t));
-
-	job_ptr->prio_factors->priority_age  *= (double)weight_age;
-	job_ptr->prio_factors->priority_fs   *= (double)weight_fs;
-	job_ptr->prio_factors->priority_js   *= (double)weight_js;
-	job_ptr->prio_factors->priority_part *= (double)weight_part;
-	job_ptr->prio_factors->priority_qos  *= (double)weight_qos;
-
-	priority = job_ptr->prio_factors->priority_age
-		+ job_ptr->prio_factors->priority_fs
-		+ job_ptr->prio_factors->priority_js
-		+ job_ptr->prio_factors->priority_part
-		+ job_ptr->prio_factors->priority_qos
-		- (double)(job_ptr->prio_factors->nice - NICE_OFFSET);
+	_get_priority_factors(start_time, job_ptr, factors, assoc_locked);
+	memcpy(&pre_factors, factors, sizeof(priority_factors_object_t));
+
+	factors->priority_age  *= (double)weight_age;
+	factors->priority_fs   *= (double)weight_fs;
+	factors->priority_js   *= (double)weight_js;
+	factors->priority_part *= (double)weight_part;
+	factors->priority_qos  *= (double)weight_qos;
+
+	priority = factors->priority_age
+		+ factors->priority_fs
+		+ factors->priority_js
+		+ factors->priority_part
+		+ factors->priority_qos
+		- (double)(factors->nice - NICE_OFFSET);
 
 	if (job_ptr->part_ptr_list) {
 		struct part_record *part_ptr;
@@ -739,9 +824,9 @@ static uint32_t _get_priority_internal(time_t start_time,
 		ListIterator part_iterator;
 		int i = 0;
 
-		if (!job_ptr->priority_array) {
-			job_ptr->priority_array = xmalloc(sizeof(uint32_t) *
-			                                  (list_count(job_ptr->part_ptr_list) + 1));
+		if (!*priority_array) {
+			*priority_array = xmalloc(sizeof(uint32_t) *
+			                          (list_count(job_ptr->part_ptr_list) + 1));
 		}
 		part_iterator = list_iterator_create(job_ptr->part_ptr_list);
 		while ((part_ptr = (struct part_record *)
@@ -749,17 +834,17 @@ static uint32_t _get_priority_internal(time_t start_time,
 			priority_part = part_ptr->priority /
 					(double)part_max_priority *
 					(double)weight_part;
-			job_ptr->priority_array[i] = (uint32_t)
-					(job_ptr->prio_factors->priority_age
-					+ job_ptr->prio_factors->priority_fs
-					+ job_ptr->prio_factors->priority_js
+			(*priority_array)[i] = (uint32_t)
+					(factors->priority_age
+					+ factors->priority_fs
+					+ factors->priority_js
 					+ priority_part
-					+ job_ptr->prio_factors->priority_qos
-					- (double)(job_ptr->prio_factors->nice
+					+ factors->priority_qos
+					- (double)(factors->nice
 					- NICE_OFFSET));
 			debug("Job %u has more than one partition (%s)(%u)",
 			      job_ptr->job_id, part_ptr->name,
-			      job_ptr->priority_array[i]);
+			      (*priority_array)[i]);
 			i++;
 		}
 	}
@@ -770,32 +855,346 @@ static uint32_t _get_priority_internal(time_t start_time,
 	if (priority_debug) {
 		info("Weighted Age priority is %f * %u = %.2f",
 		     pre_factors.priority_age, weight_age,
-		     job_ptr->prio_factors->priority_age);
+		     factors->priority_age);
 		info("Weighted Fairshare priority is %f * %u = %.2f",
 		     pre_factors.priority_fs, weight_fs,
-		     job_ptr->prio_factors->priority_fs);
+		     factors->priority_fs);
 		info("Weighted JobSize priority is %f * %u = %.2f",
 		     pre_factors.priority_js, weight_js,
-		     job_ptr->prio_factors->priority_js);
+		     factors->priority_js);
 		info("Weighted Partition priority is %f * %u = %.2f",
 		     pre_factors.priority_part, weight_part,
-		     job_ptr->prio_factors->priority_part);
+		     factors->priority_part);
 		info("Weighted QOS priority is %f * %u = %.2f",
 		     pre_factors.priority_qos, weight_qos,
-		     job_ptr->prio_factors->priority_qos);
+		     factors->priority_qos);
 		info("Job %u priority: %.2f + %.2f + %.2f + %.2f + %.2f - %d "
 		     "= %.2f",
-		     job_ptr->job_id, job_ptr->prio_factors->priority_age,
-		     job_ptr->prio_factors->priority_fs,
-		     job_ptr->prio_factors->priority_js,
-		     job_ptr->prio_factors->priority_part,
-		     job_ptr->prio_factors->priority_qos,
-		     (job_ptr->prio_factors->nice - NICE_OFFSET),
+		     job_ptr->job_id, factors->priority_age,
+		     factors->priority_fs,
+		     factors->priority_js,
+		     factors->priority_part,
+		     factors->priority_qos,
+		     (factors->nice - NICE_OFFSET),
 		     priority);
 	}
 	return (uint32_t)priority;
 }
 
+static uint32_t _get_priority_internal(time_t start_time,
+				       struct job_record *job_ptr)
+{
+	if (job_ptr->direct_set_prio && (job_ptr->priority > 0))
+		return job_ptr->priority;
+
+	if (!job_ptr->details) {
+		error("_get_priority_internal: job %u does not have a "
+		      "details symbol set, can't set priority",
+		      job_ptr->job_id);
+		return 0;
+	}
+
+	if (!job_ptr->prio_factors)
+		job_ptr->prio_factors =
+			xmalloc(sizeof(priority_factors_object_t));
+	return _calc_priority(start_time, job_ptr, job_ptr->prio_factors,
+			      &job_ptr->priority_array, false);
+}
+
+
+static void *_prio_thread(void *arg)
+{
+	prio_thread_t *thread = (prio_thread_t *) arg;
+	prio_calc_t *calc;
+	uint32_t i;
+
+	for (i = 0; i < thread->calc_cnt; i++) {
+		calc = &thread->calc[i];
+		if (!calc->job_ptr->details) {
+			error("_prio_thread: job %u does not have a "
+			      "details symbol set, can't set priority",
+			      calc->job_id);
+			calc->priority = 0;
+			continue;
+		}
+		calc->priority = _calc_priority(thread->start_time,
+						calc->job_ptr, &calc->factors,
+						&calc->priority_array, true);
+	}
+	return NULL;
+}
+
+static void _free_prio_snapshot(prio_snapshot_t *snapshot)
+{
+	uint32_t i;
+
+	for (i = 0; i < snapshot->job_cnt; i++)
+		xfree(snapshot->jobs[i].account);
+	xfree(snapshot->jobs);
+	xfree(snapshot->job_ids);
+	xfree(snapshot);
+}
+
+static void _release_prio_snapshot(prio_snapshot_t *snapshot)
+{
+	bool last;
+
+	slurm_mutex_lock(&prio_snapshot_lock);
+	last = (--snapshot->ref_cnt == 0);
+	slurm_mutex_unlock(&prio_snapshot_lock);
+	if (last)
+		_free_prio_snapshot(snapshot);
+}
+
+/* Invalidate the priority factors snapshot once a job's priority is set
+ * outside of the decay thread */
+static void _stale_prio_snapshot(void)
+{
+	slurm_mutex_lock(&prio_snapshot_lock);
+	prio_snapshot_version++;
+	slurm_mutex_unlock(&prio_snapshot_lock);
+}
+
+static int _cmp_job_id(const void *x, const void *y)
+{
+	uint32_t a = *(uint32_t *) x, b = *(uint32_t *) y;
+
+	if (a < b)
+		return -1;
+	return (a > b);
+}
+
+/* Return true if a job's priority factors belong in the snapshot */
+static bool _prio_snapshot_job(struct job_record *job_ptr)
+{
+	/*
+	 * We are only looking for pending jobs whose
+	 * priority was not held (0) or set elsewhere
+	 * (e.g. by SlurmUser)
+	 */
+	if (!IS_JOB_PENDING(job_ptr) ||
+	    (job_ptr->priority == 0) ||
+	    job_ptr->direct_set_prio ||
+	    !job_ptr->details || !job_ptr->prio_factors)
+		return false;
+	return true;
+}
+
+/* Copy the priority factors of the pending jobs into a new snapshot and
+ * make it the current one unless a newer one was published meanwhile.
+ * At least the job read lock must be held.
+ * RET the snapshot, with a reference held for the caller */
+static prio_snapshot_t *_build_prio_snapshot(void)
+{
+	prio_snapshot_t *snapshot, *old_snapshot = NULL;
+	prio_snapshot_job_t *snap_job;
+	struct job_record *job_ptr;
+	ListIterator itr;
+	uint32_t i;
+
+	snapshot = xmalloc(sizeof(prio_snapshot_t));
+	snapshot->ref_cnt = 1;
+	/* jobs' priorities are only set under the job write lock */
+	slurm_mutex_lock(&prio_snapshot_lock);
+	snapshot->version = prio_snapshot_version;
+	slurm_mutex_unlock(&prio_snapshot_lock);
+
+	if (job_list && list_count(job_list)) {
+		snapshot->jobs = xmalloc(sizeof(prio_snapshot_job_t) *
+					 list_count(job_list));
+		itr = list_iterator_create(job_list);
+		while ((job_ptr = list_next(itr))) {
+			if (!_prio_snapshot_job(job_ptr))
+				continue;
+
+			snap_job = &snapshot->jobs[snapshot->job_cnt++];
+			snap_job->job_id = job_ptr->job_id;
+			snap_job->user_id = job_ptr->user_id;
+			snap_job->account = xstrdup(job_ptr->account);
+			snap_job->begin_time = job_ptr->details->begin_time;
+			memcpy(&snap_job->factors, job_ptr->prio_factors,
+			       sizeof(priority_factors_object_t));
+		}
+		list_iterator_destroy(itr);
+	}
+	if (snapshot->job_cnt) {
+		snapshot->job_ids = xmalloc(sizeof(uint32_t) *
+					    snapshot->job_cnt);
+		for (i = 0; i < snapshot->job_cnt; i++)
+			snapshot->job_ids[i] = snapshot->jobs[i].job_id;
+		qsort(snapshot->job_ids, snapshot->job_cnt, sizeof(uint32_t),
+		      _cmp_job_id);
+	}
+
+	slurm_mutex_lock(&prio_snapshot_lock);
+	if (!prio_snapshot || (prio_snapshot->version <= snapshot->version)) {
+		old_snapshot = prio_snapshot;
+		prio_snapshot = snapshot;
+		snapshot->ref_cnt++;
+	}
+	slurm_mutex_unlock(&prio_snapshot_lock);
+	if (old_snapshot)
+		_release_prio_snapshot(old_snapshot);
+
+	return snapshot;
+}
+
+/* Get a reference on the current priority factors snapshot, building it
+ * first if a job's priority was set since */
+static prio_snapshot_t *_get_prio_snapshot(void)
+{
+	/* Read lock on jobs, nodes, and partitions */
+	slurmctld_lock_t job_read_lock =
+		{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
+	prio_snapshot_t *snapshot = NULL;
+
+	slurm_mutex_lock(&prio_snapshot_lock);
+	if (prio_snapshot &&
+	    (prio_snapshot->version == prio_snapshot_version)) {
+		snapshot = prio_snapshot;
+		snapshot->ref_cnt++;
+	}
+	slurm_mutex_unlock(&prio_snapshot_lock);
+	if (snapshot)
+		return snapshot;
+
+	lock_slurmctld(job_read_lock);
+	snapshot = _build_prio_snapshot();
+	unlock_slurmctld(job_read_lock);
+
+	return snapshot;
+}
+
+/* Set the priority of every pending job which is not held and whose
+ * priority was not set directly. The priorities are computed by several
+ * threads if there are many jobs, holding only read locks on the jobs.
+ * The effective usage of the associations is set first and the
+ * association write lock held until the threads end, so it can not be
+ * reset and the threads only read it. The job write lock is then taken
+ * just to set the priorities, on the jobs whose priority was not changed
+ * meanwhile. */
+static void _set_pending_priorities(time_t start_time)
+{
+	/* Read lock on jobs, nodes, and partitions */
+	slurmctld_lock_t job_read_lock =
+		{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
+	/* Write lock on jobs, read lock on nodes and partitions */
+	slurmctld_lock_t job_write_lock =
+		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+	/* Write lock on associations, read lock on QOS */
+	assoc_mgr_lock_t assoc_write_lock = { WRITE_LOCK, NO_LOCK,
+					      READ_LOCK, NO_LOCK, NO_LOCK };
+	struct job_record *job_ptr;
+	slurmdb_association_rec_t *fs_assoc;
+	ListIterator itr;
+	prio_calc_t *calc_array, *calc;
+	prio_thread_t thread[PRIO_MAX_THREADS];
+	pthread_t thread_id[PRIO_MAX_THREADS];
+	pthread_attr_t attr;
+	uint32_t calc_cnt = 0, done_cnt = 0, i, thread_cnt;
+
+	lock_slurmctld(job_read_lock);
+	calc_array = xmalloc(sizeof(prio_calc_t) *
+			     MAX(list_count(job_list), 1));
+
+	/* Set the effective usage of the associations giving the fair
+	 * share of the jobs now, so the threads need only read it. It is
+	 * only reset under the association write lock, held until the
+	 * threads end. */
+	assoc_mgr_lock(&assoc_write_lock);
+	itr = list_iterator_create(job_list);
+	while ((job_ptr = list_next(itr))) {
+		/*
+		 * Priority 0 is reserved for held
+		 * jobs. Also skip priority
+		 * calculation for non-pending jobs.
+		 */
+		if ((job_ptr->priority == 0) || !IS_JOB_PENDING(job_ptr))
+			continue;
+		if (job_ptr->direct_set_prio)
+			continue;
+
+		calc = &calc_array[calc_cnt++];
+		calc->job_id = job_ptr->job_id;
+		calc->job_ptr = job_ptr;
+		calc->old_priority = job_ptr->priority;
+		if (job_ptr->prio_factors) {
+			memcpy(&calc->old_factors, job_ptr->prio_factors,
+			       sizeof(priority_factors_object_t));
+		}
+
+		if (calc_fairshare && weight_fs && job_ptr->assoc_ptr) {
+			fs_assoc = _get_fs_assoc(job_ptr);
+			if (fuzzy_equal(fs_assoc->usage->usage_efctv, NO_VAL))
+				priority_p_set_assoc_usage(fs_assoc);
+		}
+	}
+	list_iterator_destroy(itr);
+
+	thread_cnt = (calc_cnt + PRIO_THREAD_JOBS - 1) / PRIO_THREAD_JOBS;
+	thread_cnt = MAX(MIN(thread_cnt, PRIO_MAX_THREADS), 1);
+	slurm_attr_init(&attr);
+	for (i = 0; i < thread_cnt; i++) {
+		thread[i].start_time = start_time;
+		thread[i].calc = calc_array + done_cnt;
+		thread[i].calc_cnt = (calc_cnt - done_cnt) / (thread_cnt - i);
+		done_cnt += thread[i].calc_cnt;
+		thread_id[i] = 0;
+		if ((i == 0) || pthread_create(&thread_id[i], &attr,
+					       _prio_thread, &thread[i]))
+			thread_id[i] = 0;
+	}
+	slurm_attr_destroy(&attr);
+	/* the first part, and any for which no thread could be created */
+	for (i = 0; i < thread_cnt; i++) {
+		if (!thread_id[i])
+			_prio_thread(&thread[i]);
+	}
+	for (i = 0; i < thread_cnt; i++) {
+		if (thread_id[i])
+			pthread_join(thread_id[i], NULL);
+	}
+	assoc_mgr_unlock(&assoc_write_lock);
+	unlock_slurmctld(job_read_lock);
+
+	lock_slurmctld(job_write_lock);
+	for (i = 0; i < calc_cnt; i++) {
+		calc = &calc_array[i];
+		job_ptr = find_job_record(calc->job_id);
+		/* skip jobs ended, held or whose priority was set again
+		 * while the locks were released */
+		if (!job_ptr || !IS_JOB_PENDING(job_ptr) ||
+		    job_ptr->direct_set_prio ||
+		    (job_ptr->priority != calc->old_priority) ||
+		    (job_ptr->prio_factors &&
+		     memcmp(job_ptr->prio_factors, &calc->old_factors,
+			    sizeof(priority_factors_object_t)))) {
+			xfree(calc->priority_array);
+			continue;
+		}
+
+		if (job_ptr->details) {
+			if (!job_ptr->prio_factors)
+				job_ptr->prio_factors = xmalloc(
+					sizeof(priority_factors_object_t));
+			memcpy(job_ptr->prio_factors, &calc->factors,
+			       sizeof(priority_factors_object_t));
+		}
+		if (calc->priority_array) {
+			xfree(job_ptr->priority_array);
+			job_ptr->priority_array = calc->priority_array;
+		}
+		job_ptr->priority = calc->priority;
+		debug2("priority for job %u is now %u",
+		       job_ptr->job_id, job_ptr->priority);
+	}
+	if (calc_cnt)
+		last_job_update = time(NULL);
+	_release_prio_snapshot(_build_prio_snapshot());
+	unlock_slurmctld(job_write_lock);
+
+	xfree(calc_array);
+}
 
 /* Mark an association and its parents as active (i.e. it may be given
  * tickets) during the current scheduling cycle.  The association
@@ -985,12 +1384,14 @@ static void _init_grp_used_cpu_run_secs(time_t last_ran)
 }
 
 /* If the job is running then apply decay to the job.
+ * IN assoc_locked - if set the association and QOS write locks are held
  *
  * Return 0 if we don't need to process the job any further, 1 if
  * futher processing is needed.
  */
 static int _apply_new_usage(struct job_record *job_ptr,
-			    time_t start_period, time_t end_period)
+			    time_t start_period, time_t end_period,
+			    bool assoc_locked)
 {
 	slurmdb_qos_rec_t *qos;
 	slurmdb_association_rec_t *assoc;
@@ -1054,7 +1455,8 @@ static int _apply_new_usage(struct job_record *job_ptr,
 
 	real_decay = run_decay * (double)job_ptr->total_cpus;
 
-	assoc_mgr_lock(&locks);
+	if (!assoc_locked)
+		assoc_mgr_lock(&locks);
 	/* Just to make sure we don't make a
 	   window where the qos_ptr could of
 	   changed make sure we get it again
@@ -1132,7 +1534,10 @@ static int _apply_new_usage(struct job_record *job_ptr,
 			     assoc->usage->grp_used_cpu_run_secs/60);
 		assoc = assoc->usage->parent_assoc_ptr;
 	}
-	assoc_mgr_unlock(&locks);
+	if (real_decay && job_ptr->assoc_ptr)
+		usage_changed = 1;
+	if (!assoc_locked)
+		assoc_mgr_unlock(&locks);
 	return 1;
 }
 
@@ -1146,11 +1551,14 @@ static void *_decay_thread(void *no_data)
 	double decay_hl = (double)slurm_get_priority_decay_hl();
 	uint16_t reset_period = slurm_get_priority_reset_period();
 
-	/* Write lock on jobs, read lock on nodes and partitions */
-	slurmctld_lock_t job_write_lock =
-		{ NO_LOCK, WRITE_LOCK, READ_LOCK, READ_LOCK };
+	/* Read lock on jobs, nodes, and partitions */
+	slurmctld_lock_t job_read_lock =
+		{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
 	assoc_mgr_lock_t locks = { WRITE_LOCK, NO_LOCK,
 				   NO_LOCK, NO_LOCK, NO_LOCK };
+	assoc_mgr_lock_t usage_locks = { WRITE_LOCK, NO_LOCK,
+					 WRITE_LOCK, NO_LOCK, NO_LOCK };
+	bool force_efctv = false;
 
 	/*
 	 * DECAY_FACTOR DESCRIPTION:
@@ -1221,6 +1629,8 @@ static void *_decay_thread(void *no_data)
 			else
 				decay_factor = 1;
 
+			/* PriorityFlags may have changed */
+			force_efctv = true;
 			reconfig = 0;
 		}
 
@@ -1254,9 +1664,9 @@ static void *_decay_thread(void *no_data)
 
 		/* now calculate all the normalized usage here */
 		assoc_mgr_lock(&locks);
-		_set_children_usage_efctv(
-			assoc_mgr_root_assoc->usage->children_list);
+		_update_usage_efctv(force_efctv);
 		assoc_mgr_unlock(&locks);
+		force_efctv = false;
 
 		if (!g_last_ran)
 			goto get_usage;
@@ -1284,7 +1694,8 @@ static void *_decay_thread(void *no_data)
 		}
 
 		if (!(flags & PRIORITY_FLAGS_TICKET_BASED)) {
-			lock_slurmctld(job_write_lock);
+			lock_slurmctld(job_read_lock);
+			assoc_mgr_lock(&usage_locks);
 			itr = list_iterator_create(job_list);
 			while ((job_ptr = list_next(itr))) {
 				/* Don't need to handle finished jobs. */
@@ -1293,38 +1704,19 @@ static void *_decay_thread(void *no_data)
 					continue;
 				/* apply new usage */
 				if (!IS_JOB_PENDING(job_ptr) &&
-				    job_ptr->start_time && job_ptr->assoc_ptr) {
-					if (!_apply_new_usage(
-						    job_ptr,
-						    g_last_ran, start_time))
-						continue;
-				}
-
-				/*
-				 * Priority 0 is reserved for held
-				 * jobs. Also skip priority
-				 * calculation for non-pending jobs.
-				 */
-				if ((job_ptr->priority == 0)
-				    || !IS_JOB_PENDING(job_ptr))
-					continue;
-
-				job_ptr->priority = _get_priority_internal(
-					start_time, job_ptr);
-				last_job_update = time(NULL);
-				debug2("priority for job %u is now %u",
-				       job_ptr->job_id, job_ptr->priority);
+				    job_ptr->start_time && job_ptr->assoc_ptr)
+					_apply_new_usage(job_ptr, g_last_ran,
+							 start_time, true);
 			}
 			list_iterator_destroy(itr);
-			unlock_slurmctld(job_write_lock);
+			assoc_mgr_unlock(&usage_locks);
+			unlock_slurmctld(job_read_lock);
+
+			_set_pending_priorities(start_time);
 		}
 
 	get_usage:
 		if (flags & PRIORITY_FLAGS_TICKET_BASED) {
-			/* Read lock on jobs, nodes, and partitions */
-			slurmctld_lock_t job_read_lock =
-				{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
-
 			/* Multifactor Ticket Based core algo
 			 * 1/3. Iterate through all jobs, mark parent
 			 * associations with the current
@@ -1335,12 +1727,11 @@ static void *_decay_thread(void *no_data)
 			 */
 
 			lock_slurmctld(job_read_lock);
-			assoc_mgr_lock(&locks);
+			assoc_mgr_lock(&usage_locks);
 			/* seqno 0 is a special invalid value. */
 			assoc_mgr_root_assoc->usage->active_seqno++;
 			if (!assoc_mgr_root_assoc->usage->active_seqno)
 				assoc_mgr_root_assoc->usage->active_seqno++;
-			assoc_mgr_unlock(&locks);
 			itr = list_iterator_create(job_list);
 			while ((job_ptr = list_next(itr))) {
 				/* Don't need to handle finished jobs. */
@@ -1353,16 +1744,14 @@ static void *_decay_thread(void *no_data)
 				    && g_last_ran)
 					_apply_new_usage(job_ptr,
 							 g_last_ran,
-							 start_time);
+							 start_time, true);
 
 				if (IS_JOB_PENDING(job_ptr)
-				    && job_ptr->assoc_ptr) {
-					assoc_mgr_lock(&locks);
+				    && job_ptr->assoc_ptr)
 					_mark_assoc_active(job_ptr);
-					assoc_mgr_unlock(&locks);
-				}
 			}
 			list_iterator_destroy(itr);
+			assoc_mgr_unlock(&usage_locks);
 			unlock_slurmctld(job_read_lock);
 
 			/* Multifactor Ticket Based core algo
@@ -1384,27 +1773,7 @@ static void *_decay_thread(void *no_data)
 			 * list again, give priorities proportional to the
 			 * maximum number of tickets given to any user.
 			 */
-			lock_slurmctld(job_write_lock);
-			itr = list_iterator_create(job_list);
-			while ((job_ptr = list_next(itr))) {
-				/*
-				 * Priority 0 is reserved for held
-				 * jobs. Also skip priority
-				 * calculation for non-pending jobs.
-				 */
-				if ((job_ptr->priority == 0)
-				    || !IS_JOB_PENDING(job_ptr))
-					continue;
-
-				job_ptr->priority = _get_priority_internal(
-					start_time, job_ptr);
-				last_job_update = time(NULL);
-				debug2("priority for job %u is now %u",
-				       job_ptr->job_id, job_ptr->priority);
-			}
-			list_iterator_destroy(itr);
-			unlock_slurmctld(job_write_lock);
-
+			_set_pending_priorities(start_time);
 		}
 
 		g_last_ran = start_time;
@@ -1430,7 +1799,7 @@ static void *_decay_thread(void *no_data)
 /* Selects the specific jobs that the user wanted to see
  * Requests that include job id(s) and user id(s) must match both to be passed.
  * Returns 1 if job should be omitted */
-static int _filter_job(struct job_record *job_ptr, List req_job_list,
+static int _filter_job(prio_snapshot_job_t *snap_job, List req_job_list,
 		       List req_user_list)
 {
 	int filter = 0;
@@ -1442,7 +1811,7 @@ static int _filter_job(struct job_record *job_ptr, List req_job_list,
 		filter = 1;
 		iterator = list_iterator_create(req_job_list);
 		while ((job_id = list_next(iterator))) {
-			if (*job_id == job_ptr->job_id) {
+			if (*job_id == snap_job->job_id) {
 				filter = 0;
 				break;
 			}
@@ -1457,7 +1826,7 @@ static int _filter_job(struct job_record *job_ptr, List req_job_list,
 		filter = 1;
 		iterator = list_iterator_create(req_user_list);
 		while ((user_id = list_next(iterator))) {
-			if (*user_id == job_ptr->user_id) {
+			if (*user_id == snap_job->user_id) {
 				filter = 0;
 				break;
 			}
@@ -1589,6 +1958,12 @@ int fini ( void )
 
 	slurm_mutex_unlock(&decay_lock);
 
+	slurm_mutex_lock(&prio_snapshot_lock);
+	if (prio_snapshot && (--prio_snapshot->ref_cnt == 0))
+		_free_prio_snapshot(prio_snapshot);
+	prio_snapshot = NULL;
+	slurm_mutex_unlock(&prio_snapshot_lock);
+
 	return SLURM_SUCCESS;
 }
 
@@ -1597,6 +1972,7 @@ extern uint32_t priority_p_set(uint32_t last_prio, struct job_record *job_ptr)
 	uint32_t priority = _get_priority_internal(time(NULL), job_ptr);
 
 	debug2("initial priority for job %u is %u", job_ptr->job_id, priority);
+	_stale_prio_snapshot();
 
 	return priority;
 }
@@ -1614,6 +1990,7 @@ extern void priority_p_reconfig(bool assoc_clear)
 	 */
 	if (assoc_clear)
 		_init_grp_used_cpu_run_secs(g_last_ran);
+	_stale_prio_snapshot();
 	debug2("%s reconfigured", plugin_name);
 
 	return;
@@ -1820,74 +2197,53 @@ extern List priority_p_get_priority_factors_list(
 	List req_job_list;
 	List req_user_list;
 	List ret_list = NULL;
-	ListIterator itr;
 	priority_factors_object_t *obj = NULL;
-	struct job_record *job_ptr = NULL;
+	prio_snapshot_t *snapshot;
+	prio_snapshot_job_t *snap_job;
 	time_t start_time = time(NULL);
+	uint32_t i;
 
 	xassert(req_msg);
 	req_job_list = req_msg->job_id_list;
 	req_user_list = req_msg->uid_list;
 
-	/* Read lock on jobs, nodes, and partitions */
-	slurmctld_lock_t job_read_lock =
-		{ NO_LOCK, READ_LOCK, READ_LOCK, READ_LOCK };
-
-	lock_slurmctld(job_read_lock);
-	if (job_list && list_count(job_list)) {
+	/* No slurmctld locks are needed to read the snapshot */
+	snapshot = _get_prio_snapshot();
+	if (snapshot->job_cnt) {
 		ret_list = list_create(slurm_destroy_priority_factors_object);
-		itr = list_iterator_create(job_list);
-		while ((job_ptr = list_next(itr))) {
-			/*
-			 * We are only looking for pending jobs
-			 */
-			if (!IS_JOB_PENDING(job_ptr))
-				continue;
-
+		for (i = 0; i < snapshot->job_cnt; i++) {
+			snap_job = &snapshot->jobs[i];
 			/*
 			 * This means the job is not eligible yet
 			 */
-			if (!job_ptr->details->begin_time
-			    || (job_ptr->details->begin_time > start_time))
+			if (!snap_job->begin_time
+			    || (snap_job->begin_time > start_time))
 				continue;
 
-			/*
-			 * 0 means the job is held
-			 */
-			if (job_ptr->priority == 0)
-				continue;
-
-			/*
-			 * Priority has been set elsewhere (e.g. by SlurmUser)
-			 */
-			if (job_ptr->direct_set_prio)
-				continue;
-
-			if (_filter_job(job_ptr, req_job_list, req_user_list))
+			if (_filter_job(snap_job, req_job_list, req_user_list))
 				continue;
 
 			if ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS)
-			    && (job_ptr->user_id != uid)
+			    && (snap_job->user_id != uid)
 			    && !validate_operator(uid)
 			    && !assoc_mgr_is_user_acct_coord(
 				    acct_db_conn, uid,
-				    job_ptr->account))
+				    snap_job->account))
 				continue;
 
 			obj = xmalloc(sizeof(priority_factors_object_t));
-			memcpy(obj, job_ptr->prio_factors,
+			memcpy(obj, &snap_job->factors,
 			       sizeof(priority_factors_object_t));
-			obj->job_id = job_ptr->job_id;
-			obj->user_id = job_ptr->user_id;
+			obj->job_id = snap_job->job_id;
+			obj->user_id = snap_job->user_id;
 			list_append(ret_list, obj);
 		}
-		list_iterator_destroy(itr);
 		if (!list_count(ret_list)) {
 			list_destroy(ret_list);
 			ret_list = NULL;
 		}
 	}
-	unlock_slurmctld(job_read_lock);
+	_release_prio_snapshot(snapshot);
 
 	return ret_list;
 }
@@ -1899,5 +2255,22 @@ extern void priority_p_job_end(struct job_record *job_ptr)
 	if (priority_debug)
 		info("priority_p_job_end: called for job %u", job_ptr->job_id);
 
-	_apply_new_usage(job_ptr, g_last_ran, time(NULL));
+	_apply_new_usage(job_ptr, g_last_ran, time(NULL), false);
+}
+
+/* Invalidate the snapshot if the job is reported by it, as it may no longer
+ * be pending or its factors changed, or if the job now belongs in it.
+ * Other jobs, e.g. running jobs which end, leave the snapshot current. */
+extern void priority_p_job_changed(struct job_record *job_ptr)
+{
+	slurm_mutex_lock(&prio_snapshot_lock);
+	if (prio_snapshot &&
+	    (prio_snapshot->version == prio_snapshot_version) &&
+	    (_prio_snapshot_job(job_ptr) ||
+	     (prio_snapshot->job_cnt &&
+	      bsearch(&job_ptr->job_id, prio_snapshot->job_ids,
+		      prio_snapshot->job_cnt, sizeof(uint32_t),
+		      _cmp_job_id))))
+		prio_snapshot_version++;
+	slurm_mutex_unlock(&prio_snapshot_lock);
 }
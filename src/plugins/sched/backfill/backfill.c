@@ -104,6 +104,9 @@
 
 #define SLURMCTLD_THREAD_LIMIT	5
 
+/* Records are kept in time order, so they can be located by a binary search
+ * on end_time (see _node_space_after). Splitting a record moves the records
+ * which follow it. */
 typedef struct node_space_map {
 	time_t begin_time;
 	time_t end_time;
@@ -111,6 +114,107 @@ typedef struct node_space_map {
 	int next;	/* next record, by time, zero termination */
 } node_space_map_t;
 
+/* Result of testing a pending job, replayed by later backfill cycles while
+ * the job and the resources it may use do not change */
+typedef struct bf_plan_rec {
+	uint32_t job_id;
+	struct part_record *part_ptr;
+	uint64_t job_sum;	/* checksum of job's scheduling parameters */
+	time_t start_time;	/* expected start time */
+	bool window_end;	/* start_time is end of backfill window */
+	uint32_t end_reserve;
+	bitstr_t *resv_bitmap;	/* nodes not reserved for the job,
+				 * NULL if job has no reservation */
+	time_t expire;		/* time the result could change, or zero */
+} bf_plan_rec_t;
+
+/* Results of testing a group's jobs in priority order */
+typedef struct bf_plan {
+	uint64_t key;		/* identifies the group's partitions */
+	bf_plan_rec_t *recs;
+	int rec_cnt;
+	int rec_size;		/* elements allocated in recs */
+	bool ended;		/* results of later jobs not recorded */
+	time_t expire;		/* time a replayed result could change */
+} bf_plan_t;
+
+/* Resources which all pending jobs' test results depend upon */
+typedef struct bf_resources {
+	uint64_t job_sum;	/* checksum of active jobs' allocations */
+	bitstr_t *avail_bitmap;
+	bitstr_t *up_bitmap;
+	time_t conf_update;
+	time_t part_update;
+	time_t resv_update;
+	time_t resv_event;	/* next reservation start or end time */
+} bf_resources_t;
+
+/* Pending jobs whose partitions share no nodes with those of other groups,
+ * and the node space map for them. Groups are tested independently. */
+typedef struct bf_group {
+	List job_queue;		/* job_queue_rec_t records */
+	node_space_map_t *node_space;
+	int node_space_recs;
+	bitstr_t *avail_bitmap;
+	bitstr_t *exc_core_bitmap;
+	bitstr_t *resv_bitmap;
+	uint32_t reject_array_job_id;
+	/* Job being tested when time to yield locks was reached */
+	struct job_record *resume_job_ptr;
+	uint32_t resume_job_id;
+	struct part_record *resume_part_ptr;
+	time_t resume_later_start;
+	bool counted;		/* current job counted in depth_try */
+	bool done;		/* all jobs tested or testing stopped */
+	int job_test_count;	/* jobs tested since locks last yielded */
+	uint32_t depth;
+	uint32_t depth_try;
+	time_t now;
+	uint64_t key;		/* identifies the group's partitions */
+	bf_plan_t plan;		/* results of this cycle */
+	bf_plan_t *prev_plan;	/* results of previous cycle to replay,
+				 * NULL once a job's test differs */
+	int prev_inx;		/* next record of prev_plan */
+	uint32_t reused;	/* jobs whose results were replayed */
+} bf_group_t;
+
+/* State of one backfill scheduling cycle, shared by its threads */
+typedef struct bf_cycle {
+	bool filter_root;
+	time_t sched_start;	/* reset when locks are yielded */
+	int sched_timeout;
+	int threads;		/* configured thread count */
+	int last_threads;	/* most threads used in this cycle */
+	bf_group_t *groups;
+	int group_cnt;
+	int next_group;		/* next group for a thread to test */
+	uint64_t work_usec;	/* sum of thread run times */
+	pthread_mutex_t group_mutex;	/* next_group and work_usec */
+	struct part_record **part_ptr;
+	int *part_jobs;		/* jobs tested, by partition */
+	int part_cnt;
+	uint32_t *uid;		/* jobs tested, by user */
+	uint16_t *njobs;
+	uint32_t nuser;
+	pthread_mutex_t user_mutex;	/* uid, njobs and nuser */
+	bool parallel;		/* threads testing groups concurrently */
+	pthread_mutex_t state_mutex;	/* job, node and select plugin state */
+	pthread_cond_t state_cond;
+	int state_readers;
+	int state_wait;		/* waiting exclusive lock requests */
+	bool state_writer;
+	uint32_t state_gen;	/* jobs started or cancelled */
+	pthread_mutex_t select_mutex;	/* select plugin calls and job start
+					 * time estimates */
+} bf_cycle_t;
+
+/* Results of testing a job */
+#define BF_JOB_NEXT	0	/* test the group's next job */
+#define BF_JOB_STOP	1	/* stop testing the group */
+#define BF_JOB_YIELD	2	/* time to yield locks, resume job later */
+
+#define BF_SUM_INIT	14695981039346656037ULL
+
 /* Diag statistics */
 extern diag_stats_t slurmctld_diag_stats;
 int bf_last_yields = 0;
@@ -129,6 +233,13 @@ static int max_backfill_job_cnt = 100;
 static int max_backfill_job_per_part = 0;
 static int max_backfill_job_per_user = 0;
 static bool backfill_continue = false;
+static int backfill_threads = 1;
+static bool backfill_incremental = false;
+
+/* Results of the previous cycle, for bf_incremental */
+static bf_plan_t *bf_plans = NULL;
+static int bf_plan_cnt = 0;
+static bf_resources_t bf_plan_resources;
 
 /*********************** local functions *********************/
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
@@ -142,12 +253,15 @@ static bool _many_pending_rpcs(void);
 static bool _more_work(time_t last_backfill_time);
 static void _my_sleep(int secs);
 static int  _num_feature_count(struct job_record *job_ptr);
+static int  _node_space_after(node_space_map_t *node_space,
+			      int node_space_recs, time_t when);
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
-				  node_space_map_t *node_space);
+				  node_space_map_t *node_space,
+				  int node_space_recs);
 static int  _start_job(struct job_record *job_ptr, bitstr_t *avail_bitmap);
 static bool _test_resv_overlap(node_space_map_t *node_space,
-			       bitstr_t *use_bitmap, uint32_t start_time,
-			       uint32_t end_reserve);
+			       int node_space_recs, bitstr_t *use_bitmap,
+			       uint32_t start_time, uint32_t end_reserve);
 static int  _try_sched(struct job_record *job_ptr, bitstr_t **avail_bitmap,
 		       uint32_t min_nodes, uint32_t max_nodes,
 		       uint32_t req_nodes, bitstr_t *exc_core_bitmap);
@@ -469,6 +583,18 @@ static void _load_config(void)
 		backfill_continue = true;
 	}
 
+	if (sched_params && (strstr(sched_params, "bf_incremental")))
+		backfill_incremental = true;
+	else
+		backfill_incremental = false;
+
+	if (sched_params && (tmp_ptr=strstr(sched_params, "bf_threads=")))
+		backfill_threads = atoi(tmp_ptr + 11);
+	if (backfill_threads < 1) {
+		fatal("Invalid backfill scheduler bf_threads: %d",
+		      backfill_threads);
+	}
+
 	xfree(sched_params);
 }
 
@@ -567,31 +693,1083 @@ static int _yield_locks(int secs)
 		return 1;
 }
 
-static int _attempt_backfill(void)
+/* Serialize changes to shared state between the backfill worker threads.
+ * Testing jobs takes a shared lock, starting jobs or other changes beyond
+ * the job being tested takes an exclusive lock. Waiting exclusive lock
+ * requests have priority. Nothing to do unless running multiple threads. */
+static void _bf_state_lock(bf_cycle_t *cycle, bool exclusive)
+{
+	if (!cycle->parallel)
+		return;
+	slurm_mutex_lock(&cycle->state_mutex);
+	if (exclusive) {
+		cycle->state_wait++;
+		while (cycle->state_readers || cycle->state_writer) {
+			pthread_cond_wait(&cycle->state_cond,
+					  &cycle->state_mutex);
+		}
+		cycle->state_wait--;
+		cycle->state_writer = true;
+	} else {
+		while (cycle->state_writer || cycle->state_wait) {
+			pthread_cond_wait(&cycle->state_cond,
+					  &cycle->state_mutex);
+		}
+		cycle->state_readers++;
+	}
+	slurm_mutex_unlock(&cycle->state_mutex);
+}
+
+static void _bf_state_unlock(bf_cycle_t *cycle, bool exclusive)
+{
+	if (!cycle->parallel)
+		return;
+	slurm_mutex_lock(&cycle->state_mutex);
+	if (exclusive)
+		cycle->state_writer = false;
+	else
+		cycle->state_readers--;
+	pthread_cond_broadcast(&cycle->state_cond);
+	slurm_mutex_unlock(&cycle->state_mutex);
+}
+
+/* Record that a job was started or cancelled, call with the exclusive state
+ * lock held */
+static void _bf_state_changed(bf_cycle_t *cycle)
+{
+	cycle->state_gen++;
+}
+
+/* Trade a shared state lock for an exclusive one or back. Other threads
+ * may take the exclusive lock in between.
+ * RET false if another thread started or cancelled jobs in between, results
+ *	found under the shared lock must then be tested again */
+static bool _bf_state_upgrade(bf_cycle_t *cycle)
+{
+	uint32_t state_gen;
+
+	if (!cycle->parallel)
+		return true;
+	/* Only changed by exclusive lock holders */
+	state_gen = cycle->state_gen;
+	_bf_state_unlock(cycle, false);
+	_bf_state_lock(cycle, true);
+	return (state_gen == cycle->state_gen);
+}
+static void _bf_state_downgrade(bf_cycle_t *cycle)
+{
+	_bf_state_unlock(cycle, true);
+	_bf_state_lock(cycle, false);
+}
+
+static void _job_queue_rec_del(void *x)
+{
+	xfree(x);
+}
+
+/* Find a partition's index in cycle->part_ptr, -1 if not found */
+static int _bf_part_inx(bf_cycle_t *cycle, struct part_record *part_ptr)
+{
+	int i;
+
+	for (i = 0; i < cycle->part_cnt; i++) {
+		if (cycle->part_ptr[i] == part_ptr)
+			return i;
+	}
+	return -1;
+}
+
+static int _bf_part_root(int *parent, int inx)
+{
+	while (parent[inx] != inx)
+		inx = parent[inx] = parent[parent[inx]];
+	return inx;
+}
+
+static void _bf_part_union(int *parent, int inx1, int inx2)
+{
+	inx1 = _bf_part_root(parent, inx1);
+	inx2 = _bf_part_root(parent, inx2);
+	if (inx1 < inx2)
+		parent[inx2] = inx1;
+	else if (inx2 < inx1)
+		parent[inx1] = inx2;
+}
+
+/* Add data to a checksum (64-bit FNV-1a) */
+static uint64_t _bf_sum(uint64_t sum, const void *data, size_t size)
+{
+	const unsigned char *ptr = (const unsigned char *) data;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		sum ^= ptr[i];
+		sum *= 1099511628211ULL;
+	}
+	return sum;
+}
+
+static uint64_t _bf_sum_str(uint64_t sum, char *str)
+{
+	if (!str)
+		return _bf_sum(sum, "", 1);
+	return _bf_sum(sum, str, strlen(str) + 1);
+}
+
+/* Checksum of the parameters which determine when and where a pending job
+ * can run in some partition */
+static uint64_t _bf_job_sum(struct job_record *job_ptr,
+			    struct part_record *part_ptr)
+{
+	struct job_details *detail_ptr = job_ptr->details;
+	uint64_t sum = BF_SUM_INIT;
+
+	sum = _bf_sum(sum, &part_ptr, sizeof(part_ptr));
+	sum = _bf_sum(sum, &job_ptr->qos_ptr, sizeof(job_ptr->qos_ptr));
+	sum = _bf_sum(sum, &job_ptr->resv_ptr, sizeof(job_ptr->resv_ptr));
+	sum = _bf_sum(sum, &job_ptr->time_limit, sizeof(uint32_t));
+	sum = _bf_sum(sum, &job_ptr->time_min, sizeof(uint32_t));
+	sum = _bf_sum(sum, &job_ptr->req_switch, sizeof(uint32_t));
+	sum = _bf_sum(sum, &job_ptr->wait4switch, sizeof(uint32_t));
+	sum = _bf_sum_str(sum, job_ptr->gres);
+	sum = _bf_sum_str(sum, job_ptr->licenses);
+	sum = _bf_sum_str(sum, job_ptr->network);
+
+	sum = _bf_sum(sum, &detail_ptr->contiguous, sizeof(uint16_t));
+	sum = _bf_sum(sum, &detail_ptr->core_spec, sizeof(uint16_t));
+	sum = _bf_sum(sum, &detail_ptr->cpus_per_task, sizeof(uint16_t));
+	sum = _bf_sum(sum, &detail_ptr->max_cpus, sizeof(uint32_t));
+	sum = _bf_sum(sum, &detail_ptr->max_nodes, sizeof(uint32_t));
+	sum = _bf_sum(sum, &detail_ptr->min_cpus, sizeof(uint32_t));
+	sum = _bf_sum(sum, &detail_ptr->min_nodes, sizeof(uint32_t));
+	sum = _bf_sum(sum, &detail_ptr->ntasks_per_node, sizeof(uint16_t));
+	sum = _bf_sum(sum, &detail_ptr->num_tasks, sizeof(uint32_t));
+	sum = _bf_sum(sum, &detail_ptr->overcommit, sizeof(uint8_t));
+	sum = _bf_sum(sum, &detail_ptr->plane_size, sizeof(uint16_t));
+	sum = _bf_sum(sum, &detail_ptr->pn_min_cpus, sizeof(uint32_t));
+	sum = _bf_sum(sum, &detail_ptr->pn_min_memory, sizeof(uint32_t));
+	sum = _bf_sum(sum, &detail_ptr->pn_min_tmp_disk, sizeof(uint32_t));
+	sum = _bf_sum(sum, &detail_ptr->shared, sizeof(uint16_t));
+	sum = _bf_sum(sum, &detail_ptr->task_dist, sizeof(uint16_t));
+	sum = _bf_sum_str(sum, detail_ptr->features);
+	sum = _bf_sum_str(sum, detail_ptr->req_nodes);
+	sum = _bf_sum_str(sum, detail_ptr->exc_nodes);
+	if (detail_ptr->mc_ptr) {
+		sum = _bf_sum(sum, detail_ptr->mc_ptr,
+			      sizeof(multi_core_data_t));
+	}
+	return sum;
+}
+
+/* Record the resources used by active jobs and the nodes available */
+static void _bf_resources_get(bf_resources_t *res, time_t now)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	uint64_t job_sum;
+
+	res->job_sum = 0;
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		if (!IS_JOB_RUNNING(job_ptr) && !IS_JOB_SUSPENDED(job_ptr) &&
+		    !IS_JOB_COMPLETING(job_ptr))
+			continue;
+		job_sum = _bf_sum(BF_SUM_INIT, &job_ptr->job_id,
+				  sizeof(uint32_t));
+		job_sum = _bf_sum(job_sum, &job_ptr->job_state,
+				  sizeof(uint16_t));
+		job_sum = _bf_sum(job_sum, &job_ptr->end_time,
+				  sizeof(time_t));
+		job_sum = _bf_sum(job_sum, &job_ptr->node_cnt,
+				  sizeof(uint32_t));
+		/* Independent of job_list order */
+		res->job_sum += job_sum;
+	}
+	list_iterator_destroy(job_iterator);
+
+	res->avail_bitmap = bit_copy(avail_node_bitmap);
+	res->up_bitmap    = bit_copy(up_node_bitmap);
+	res->conf_update  = slurmctld_conf.last_update;
+	res->part_update  = last_part_update;
+	res->resv_update  = last_resv_update;
+	res->resv_event   = find_resv_next_event(now);
+}
+
+static bool _bf_resources_equal(bf_resources_t *res1, bf_resources_t *res2)
+{
+	if ((res1->job_sum     != res2->job_sum)     ||
+	    (res1->conf_update != res2->conf_update) ||
+	    (res1->part_update != res2->part_update) ||
+	    (res1->resv_update != res2->resv_update) ||
+	    !res1->avail_bitmap || !res2->avail_bitmap ||
+	    !bit_equal(res1->avail_bitmap, res2->avail_bitmap) ||
+	    !bit_equal(res1->up_bitmap, res2->up_bitmap))
+		return false;
+	return true;
+}
+
+static void _bf_resources_free(bf_resources_t *res)
+{
+	FREE_NULL_BITMAP(res->avail_bitmap);
+	FREE_NULL_BITMAP(res->up_bitmap);
+}
+
+static void _bf_plan_free(bf_plan_t *plan)
+{
+	int i;
+
+	for (i = 0; i < plan->rec_cnt; i++)
+		FREE_NULL_BITMAP(plan->recs[i].resv_bitmap);
+	xfree(plan->recs);
+	memset(plan, 0, sizeof(bf_plan_t));
+}
+
+/*
+ * Record the result of testing a job in the group's plan
+ * IN resv_bitmap - nodes not reserved for the job, NULL if no reservation
+ * IN end_reserve - end of the job's reservation
+ * IN window_end - job's start_time was set to the end of the backfill window
+ * IN expire - time at which the result could change, zero if never
+ */
+static void _bf_plan_add(bf_group_t *group, struct job_record *job_ptr,
+			 struct part_record *part_ptr, uint64_t job_sum,
+			 bitstr_t *resv_bitmap, uint32_t end_reserve,
+			 bool window_end, time_t expire)
+{
+	bf_plan_t *plan = &group->plan;
+	bf_plan_rec_t *rec;
+
+	if (!backfill_incremental || plan->ended)
+		return;
+	if (plan->rec_cnt >= plan->rec_size) {
+		plan->rec_size = MAX(plan->rec_size * 2, 64);
+		xrealloc(plan->recs, sizeof(bf_plan_rec_t) * plan->rec_size);
+	}
+	rec = &plan->recs[plan->rec_cnt++];
+	rec->job_id      = job_ptr->job_id;
+	rec->part_ptr    = part_ptr;
+	rec->job_sum     = job_sum;
+	rec->start_time  = job_ptr->start_time;
+	rec->window_end  = window_end;
+	rec->end_reserve = end_reserve;
+	rec->expire      = expire;
+	if (resv_bitmap)
+		rec->resv_bitmap = bit_copy(resv_bitmap);
+	else
+		rec->resv_bitmap = NULL;
+	if (expire && (!plan->expire || (expire < plan->expire)))
+		plan->expire = expire;
+}
+
+/* The result of testing this job was not recorded, later results in the
+ * group's plan could not be replayed */
+static void _bf_plan_end(bf_group_t *group)
+{
+	group->plan.ended = true;
+}
+
+/*
+ * Replay the result of testing a job in the previous cycle if it is the next
+ *	job tested in that cycle and its scheduling parameters are unchanged
+ * RET true if the result was replayed
+ */
+static bool _bf_plan_replay(bf_cycle_t *cycle, bf_group_t *group,
+			    struct job_record *job_ptr,
+			    struct part_record *part_ptr, uint64_t job_sum)
+{
+	bf_plan_rec_t *rec;
+
+	if (!group->prev_plan)
+		return false;
+	rec = &group->prev_plan->recs[group->prev_inx];
+	if ((rec->job_id   != job_ptr->job_id) ||
+	    (rec->part_ptr != part_ptr) ||
+	    (rec->job_sum  != job_sum)) {
+		/* Node space differs from here, test all later jobs */
+		if (debug_flags & DEBUG_FLAG_BACKFILL) {
+			info("backfill: job %u differs from previous cycle, "
+			     "testing all later jobs", job_ptr->job_id);
+		}
+		group->prev_plan = NULL;
+		return false;
+	}
+	if (++group->prev_inx >= group->prev_plan->rec_cnt)
+		group->prev_plan = NULL;
+	group->reused++;
+
+	if (rec->window_end)
+		job_ptr->start_time = cycle->sched_start + backfill_window;
+	else
+		job_ptr->start_time = rec->start_time;
+	if (rec->resv_bitmap) {
+		group->reject_array_job_id = 0;
+		_add_reservation(rec->start_time, rec->end_reserve,
+				 rec->resv_bitmap, group->node_space,
+				 &group->node_space_recs);
+	}
+	if (debug_flags & DEBUG_FLAG_BACKFILL)
+		info("backfill: reused test result for job %u", job_ptr->job_id);
+	_bf_plan_add(group, job_ptr, part_ptr, job_sum, rec->resv_bitmap,
+		     rec->end_reserve, rec->window_end, rec->expire);
+	return true;
+}
+
+/* Find the results of the previous cycle to replay for each group, if the
+ * resources available to the pending jobs have not changed since then */
+static void _bf_plan_attach(bf_cycle_t *cycle, bf_resources_t *res)
+{
+	bf_plan_t *plan;
+	int i, j;
+
+	if (!backfill_incremental || (bf_plan_cnt == 0))
+		return;
+	if (!_bf_resources_equal(res, &bf_plan_resources) ||
+	    (bf_plan_resources.resv_event &&
+	     (cycle->sched_start >= bf_plan_resources.resv_event))) {
+		if (debug_flags & DEBUG_FLAG_BACKFILL)
+			info("backfill: resources changed, testing all jobs");
+		return;
+	}
+	for (i = 0; i < cycle->group_cnt; i++) {
+		for (j = 0; j < bf_plan_cnt; j++) {
+			plan = &bf_plans[j];
+			if (plan->key != cycle->groups[i].key)
+				continue;
+			if (plan->rec_cnt &&
+			    (!plan->expire ||
+			     (cycle->sched_start < plan->expire)))
+				cycle->groups[i].prev_plan = plan;
+			break;
+		}
+	}
+}
+
+/* Keep the results of this cycle for the next one if the resources
+ * available to the pending jobs did not change while testing them */
+static void _bf_plan_save(bf_cycle_t *cycle, bf_resources_t *res)
+{
+	bf_resources_t res_end;
+	int i;
+
+	for (i = 0; i < bf_plan_cnt; i++)
+		_bf_plan_free(&bf_plans[i]);
+	xfree(bf_plans);
+	bf_plan_cnt = 0;
+	_bf_resources_free(&bf_plan_resources);
+	if (!backfill_incremental)
+		return;
+
+	memset(&res_end, 0, sizeof(bf_resources_t));
+	_bf_resources_get(&res_end, time(NULL));
+	if (_bf_resources_equal(res, &res_end)) {
+		bf_plans = xmalloc(sizeof(bf_plan_t) * cycle->group_cnt);
+		for (i = 0; i < cycle->group_cnt; i++) {
+			bf_plans[i] = cycle->groups[i].plan;
+			bf_plans[i].key = cycle->groups[i].key;
+			memset(&cycle->groups[i].plan, 0, sizeof(bf_plan_t));
+		}
+		bf_plan_cnt = cycle->group_cnt;
+		bf_plan_resources = *res;
+		memset(res, 0, sizeof(bf_resources_t));
+	}
+	_bf_resources_free(&res_end);
+}
+
+/* Create a group with an empty node space map */
+static void _bf_group_init(bf_group_t *group, time_t sched_start,
+			   List job_queue)
+{
+	group->job_queue = job_queue;
+	group->node_space = xmalloc(sizeof(node_space_map_t) *
+				    (max_backfill_job_cnt + 3));
+	group->node_space[0].begin_time = sched_start;
+	group->node_space[0].end_time = sched_start + backfill_window;
+	group->node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
+	group->node_space[0].next = 0;
+	group->node_space_recs = 1;
+	group->now = sched_start;
+	group->key = BF_SUM_INIT;
+}
+
+static void _bf_group_fini(bf_group_t *group)
+{
+	int i;
+
+	FREE_NULL_BITMAP(group->avail_bitmap);
+	FREE_NULL_BITMAP(group->exc_core_bitmap);
+	FREE_NULL_BITMAP(group->resv_bitmap);
+	for (i = 0; ; ) {
+		FREE_NULL_BITMAP(group->node_space[i].avail_bitmap);
+		if ((i = group->node_space[i].next) == 0)
+			break;
+	}
+	xfree(group->node_space);
+	if (group->job_queue)
+		list_destroy(group->job_queue);
+	_bf_plan_free(&group->plan);
+}
+
+/*
+ * Split the pending jobs into groups which share no nodes. Partitions with
+ * overlapping nodes, or both requested by one job, are in the same group.
+ * With one thread all jobs are placed in a single group.
+ * IN/OUT cycle - groups and group_cnt set
+ * IN job_queue - pending jobs, moved to the groups
+ */
+static void _bf_build_groups(bf_cycle_t *cycle, List job_queue)
 {
-	DEF_TIMERS;
-	bool filter_root = false;
-	List job_queue;
 	job_queue_rec_t *job_queue_rec;
+	struct part_record *part_ptr;
+	ListIterator iter;
+	int *parent, *group_inx, i, j;
+
+	if ((cycle->threads <= 1) || (cycle->part_cnt <= 1)) {
+		cycle->group_cnt = 1;
+		cycle->groups = xmalloc(sizeof(bf_group_t));
+		_bf_group_init(&cycle->groups[0], cycle->sched_start,
+			       job_queue);
+		return;
+	}
+
+	parent = xmalloc(sizeof(int) * cycle->part_cnt);
+	for (i = 0; i < cycle->part_cnt; i++) {
+		parent[i] = i;
+		if (!cycle->part_ptr[i]->node_bitmap)
+			continue;
+		for (j = 0; j < i; j++) {
+			if (cycle->part_ptr[j]->node_bitmap &&
+			    bit_overlap_any(cycle->part_ptr[i]->node_bitmap,
+					    cycle->part_ptr[j]->node_bitmap))
+				_bf_part_union(parent, i, j);
+		}
+	}
+	iter = list_iterator_create(job_queue);
+	while ((job_queue_rec = (job_queue_rec_t *) list_next(iter))) {
+		ListIterator part_iter;
+		if (!job_queue_rec->job_ptr->part_ptr_list)
+			continue;
+		i = _bf_part_inx(cycle, job_queue_rec->part_ptr);
+		part_iter = list_iterator_create(
+				job_queue_rec->job_ptr->part_ptr_list);
+		while ((part_ptr = (struct part_record *)
+				   list_next(part_iter))) {
+			j = _bf_part_inx(cycle, part_ptr);
+			if ((i >= 0) && (j >= 0))
+				_bf_part_union(parent, i, j);
+		}
+		list_iterator_destroy(part_iter);
+	}
+	list_iterator_destroy(iter);
+
+	/* Number the groups by their lowest partition index, so the result
+	 * does not depend upon the order of the job queue */
+	group_inx = xmalloc(sizeof(int) * cycle->part_cnt);
+	cycle->groups = xmalloc(sizeof(bf_group_t) * cycle->part_cnt);
+	for (i = 0; i < cycle->part_cnt; i++) {
+		j = _bf_part_root(parent, i);
+		if (j == i) {
+			group_inx[i] = cycle->group_cnt++;
+			_bf_group_init(&cycle->groups[group_inx[i]],
+				       cycle->sched_start,
+				       list_create(_job_queue_rec_del));
+		} else
+			group_inx[i] = group_inx[j];
+		cycle->groups[group_inx[i]].key =
+			_bf_sum(cycle->groups[group_inx[i]].key,
+				&cycle->part_ptr[i], sizeof(cycle->part_ptr[i]));
+	}
+	while ((job_queue_rec = (job_queue_rec_t *) list_pop(job_queue))) {
+		i = _bf_part_inx(cycle, job_queue_rec->part_ptr);
+		if (i < 0) {
+			xfree(job_queue_rec);
+			continue;
+		}
+		list_append(cycle->groups[group_inx[i]].job_queue,
+			    job_queue_rec);
+	}
+	list_destroy(job_queue);
+	xfree(group_inx);
+	xfree(parent);
+}
+
+/* Test if the backfill scheduler should yield its locks */
+static bool _bf_timeout(bf_cycle_t *cycle)
+{
+	return ((time(NULL) - cycle->sched_start) >= cycle->sched_timeout);
+}
+
+/*
+ * Test whether one pending job can start now or when, starting it or
+ *	adding a reservation for it to the group's node space map
+ * IN cycle - backfill cycle information
+ * IN group - group of the job
+ * IN job_ptr, part_ptr - job to test and partition to test it in
+ * IN later_start - earliest time to test, zero to start with now
+ * IN resumed - job test interrupted by a timeout earlier, not counted again
+ * RET BF_JOB_NEXT to test the next job, BF_JOB_STOP to end testing the
+ *	group or BF_JOB_YIELD if interrupted by the timeout
+ * NOTE: with multiple threads, call with a shared state lock held
+ */
+static int _bf_test_job(bf_cycle_t *cycle, bf_group_t *group,
+			struct job_record *job_ptr,
+			struct part_record *part_ptr, time_t later_start,
+			bool resumed)
+{
 	slurmdb_qos_rec_t *qos_ptr = NULL;
-	int i, j, node_space_recs;
-	struct job_record *job_ptr;
-	struct part_record *part_ptr, **bf_part_ptr = NULL;
 	uint32_t end_time, end_reserve;
 	uint32_t time_limit, comp_time_limit, orig_time_limit, part_time_limit;
 	uint32_t min_nodes, max_nodes, req_nodes;
-	bitstr_t *avail_bitmap = NULL, *resv_bitmap = NULL;
-	bitstr_t *exc_core_bitmap = NULL;
-	time_t now, sched_start, later_start, start_res, resv_end;
-	node_space_map_t *node_space;
+	time_t start_res, resv_end;
+	uint64_t job_sum;
+	bool independent;
+	int j;
+
+	orig_time_limit = job_ptr->time_limit;
+	if (!IS_JOB_PENDING(job_ptr))
+		return BF_JOB_NEXT;	/* started in other partition */
+	if (!avail_front_end(job_ptr))
+		return BF_JOB_NEXT;	/* No available frontend for this job */
+	if ((job_ptr->array_task_id != NO_VAL) && !resumed) {
+		if (group->reject_array_job_id == job_ptr->array_job_id)
+			return BF_JOB_NEXT;  /* already rejected array element */
+		/* assume reject whole array for now, clear if OK */
+		group->reject_array_job_id = job_ptr->array_job_id;
+	}
+	job_ptr->part_ptr = part_ptr;
+
+	if (debug_flags & DEBUG_FLAG_BACKFILL)
+		info("backfill test for job %u", job_ptr->job_id);
+
+	if (!resumed)
+		group->depth++;
+
+	if (max_backfill_job_per_part && !resumed) {
+		/* Partitions belong to one group, no lock needed */
+		j = _bf_part_inx(cycle, job_ptr->part_ptr);
+		if ((j >= 0) &&
+		    (cycle->part_jobs[j]++ >= max_backfill_job_per_part)) {
+			if (debug_flags & DEBUG_FLAG_BACKFILL)
+				debug("backfill: have already "
+				      "checked %u jobs for "
+				      "partition %s; skipping "
+				      "job %u",
+				      max_backfill_job_per_part,
+				      job_ptr->part_ptr->name,
+				      job_ptr->job_id);
+			return BF_JOB_NEXT;
+		}
+	}
+	if (max_backfill_job_per_user && !resumed) {
+		bool skip_job = false;
+		slurm_mutex_lock(&cycle->user_mutex);
+		for (j = 0; j < cycle->nuser; j++) {
+			if (job_ptr->user_id == cycle->uid[j]) {
+				cycle->njobs[j]++;
+				if (debug_flags & DEBUG_FLAG_BACKFILL)
+					debug("backfill: user %u: "
+					      "#jobs %u",
+					      cycle->uid[j], cycle->njobs[j]);
+				break;
+			}
+		}
+		if (j == cycle->nuser) { /* user not found */
+			static bool bf_max_user_msg = true;
+			if (cycle->nuser < BF_MAX_USERS) {
+				cycle->uid[j] = job_ptr->user_id;
+				cycle->njobs[j] = 1;
+				cycle->nuser++;
+			} else if (bf_max_user_msg) {
+				bf_max_user_msg = false;
+				error("backfill: too many users in "
+				      "queue. Consider increasing "
+				      "BF_MAX_USERS");
+			}
+			if (debug_flags & DEBUG_FLAG_BACKFILL)
+				debug2("backfill: found new user %u. "
+				       "Total #users now %u",
+				       job_ptr->user_id, cycle->nuser);
+		} else if (cycle->njobs[j] > max_backfill_job_per_user) {
+			/* skip job */
+			if (debug_flags & DEBUG_FLAG_BACKFILL)
+				debug("backfill: have already "
+				      "checked %u jobs for "
+				      "user %u; skipping "
+				      "job %u",
+				      max_backfill_job_per_user,
+				      job_ptr->user_id,
+				      job_ptr->job_id);
+			skip_job = true;
+		}
+		slurm_mutex_unlock(&cycle->user_mutex);
+		if (skip_job)
+			return BF_JOB_NEXT;
+	}
+
+	if (((part_ptr->state_up & PARTITION_SCHED) == 0) ||
+	    (part_ptr->node_bitmap == NULL))
+		return BF_JOB_NEXT;
+	if ((part_ptr->flags & PART_FLAG_ROOT_ONLY) && cycle->filter_root)
+		return BF_JOB_NEXT;
+
+	/* Testing a job's eligibility changes only that job, unless it has a
+	 * dependency which can never be satisfied and must be cancelled */
+	if (cycle->parallel && job_ptr->details->depend_list &&
+	    (test_job_dependency(job_ptr) == 2)) {
+		(void) _bf_state_upgrade(cycle);
+		independent = job_independent(job_ptr, 0);
+		if (!IS_JOB_PENDING(job_ptr))
+			_bf_state_changed(cycle);
+		_bf_state_downgrade(cycle);
+	} else
+		independent = job_independent(job_ptr, 0);
+	if (!independent ||
+	    (license_job_test(job_ptr, time(NULL)) != SLURM_SUCCESS))
+		return BF_JOB_NEXT;
+
+	/* Determine minimum and maximum node counts */
+	min_nodes = MAX(job_ptr->details->min_nodes,
+			part_ptr->min_nodes);
+	if (job_ptr->details->max_nodes == 0)
+		max_nodes = part_ptr->max_nodes;
+	else
+		max_nodes = MIN(job_ptr->details->max_nodes,
+				part_ptr->max_nodes);
+	max_nodes = MIN(max_nodes, 500000);     /* prevent overflows */
+	if (job_ptr->details->max_nodes)
+		req_nodes = max_nodes;
+	else
+		req_nodes = min_nodes;
+	if (min_nodes > max_nodes) {
+		/* job's min_nodes exceeds partition's max_nodes */
+		return BF_JOB_NEXT;
+	}
+
+	job_sum = _bf_job_sum(job_ptr, part_ptr);
+	if (!resumed &&
+	    _bf_plan_replay(cycle, group, job_ptr, part_ptr, job_sum))
+		return BF_JOB_NEXT;
+
+	/* Determine job's expected completion time */
+	if (part_ptr->max_time == INFINITE)
+		part_time_limit = 365 * 24 * 60; /* one year */
+	else
+		part_time_limit = part_ptr->max_time;
+	if (job_ptr->time_limit == NO_VAL) {
+		time_limit = part_time_limit;
+	} else {
+		if (part_ptr->max_time == INFINITE)
+			time_limit = job_ptr->time_limit;
+		else
+			time_limit = MIN(job_ptr->time_limit,
+					 part_time_limit);
+	}
+	comp_time_limit = time_limit;
+	qos_ptr = job_ptr->qos_ptr;
+	if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE) &&
+	    slurm_get_preempt_mode())
+		time_limit = job_ptr->time_limit = 1;
+	else if (job_ptr->time_min && (job_ptr->time_min < time_limit))
+		time_limit = job_ptr->time_limit = job_ptr->time_min;
+
+	/* Determine impact of any resource reservations */
+	if (later_start == 0)
+		later_start = group->now;
+ TRY_LATER:
+	if (_bf_timeout(cycle)) {
+		/* Resume testing this job after yielding locks */
+		job_ptr->time_limit = orig_time_limit;
+		group->resume_job_ptr    = job_ptr;
+		group->resume_job_id     = job_ptr->job_id;
+		group->resume_part_ptr   = part_ptr;
+		group->resume_later_start = later_start;
+		return BF_JOB_YIELD;
+	}
+
+	FREE_NULL_BITMAP(group->avail_bitmap);
+	FREE_NULL_BITMAP(group->exc_core_bitmap);
+	start_res   = later_start;
+	later_start = 0;
+	j = job_test_resv(job_ptr, &start_res, true, &group->avail_bitmap,
+			  &group->exc_core_bitmap);
+	if (j != SLURM_SUCCESS) {
+		job_ptr->time_limit = orig_time_limit;
+		_bf_plan_add(group, job_ptr, part_ptr, job_sum, NULL, 0,
+			     false, 0);
+		return BF_JOB_NEXT;
+	}
+	if (start_res > group->now)
+		end_time = (time_limit * 60) + start_res;
+	else
+		end_time = (time_limit * 60) + group->now;
+	resv_end = find_resv_end(start_res);
+	/* Identify usable nodes for this job */
+	bit_and(group->avail_bitmap, part_ptr->node_bitmap);
+	bit_and(group->avail_bitmap, up_node_bitmap);
+	for (j = _node_space_after(group->node_space, group->node_space_recs,
+				   start_res);
+	     j < group->node_space_recs; j++) {
+		node_space_map_t *node_space = group->node_space;
+		if (node_space[j].next && (later_start == 0))
+			later_start = node_space[j].end_time;
+		if (node_space[j].begin_time <= end_time) {
+			bit_and(group->avail_bitmap,
+				node_space[j].avail_bitmap);
+		} else
+			break;
+	}
+	if ((resv_end++) &&
+	    ((later_start == 0) || (resv_end < later_start))) {
+		later_start = resv_end;
+	}
+
+	if (job_ptr->details->exc_node_bitmap) {
+		/* Use a copy, other threads may read the job's bitmap */
+		bitstr_t *exc_bitmap =
+			bit_copy(job_ptr->details->exc_node_bitmap);
+		bit_not(exc_bitmap);
+		bit_and(group->avail_bitmap, exc_bitmap);
+		FREE_NULL_BITMAP(exc_bitmap);
+	}
+
+	/* Test if insufficient nodes remain OR
+	 *	required nodes missing OR
+	 *	nodes lack features */
+	if ((bit_set_count(group->avail_bitmap) < min_nodes) ||
+	    ((job_ptr->details->req_node_bitmap) &&
+	     (!bit_super_set(job_ptr->details->req_node_bitmap,
+			     group->avail_bitmap))) ||
+	    (job_req_node_filter(job_ptr, group->avail_bitmap))) {
+		if (later_start) {
+			job_ptr->start_time = 0;
+			goto TRY_LATER;
+		}
+		/* Job can not start until too far in the future */
+		job_ptr->time_limit = orig_time_limit;
+		job_ptr->start_time = cycle->sched_start + backfill_window;
+		_bf_plan_add(group, job_ptr, part_ptr, job_sum, NULL, 0,
+			     true, cycle->sched_start + backfill_resolution);
+		return BF_JOB_NEXT;
+	}
+
+	/* Identify nodes which are definitely off limits */
+	FREE_NULL_BITMAP(group->resv_bitmap);
+	group->resv_bitmap = bit_copy(group->avail_bitmap);
+	bit_not(group->resv_bitmap);
+
+	/* this is the time consuming operation */
+	debug2("backfill: entering _try_sched for job %u.",
+	       job_ptr->job_id);
+
+	if (!group->counted) {
+		group->depth_try++;
+		group->counted = true;
+	}
+
+	if (debug_flags & DEBUG_FLAG_BACKFILL)
+		_dump_job_test(job_ptr, group->avail_bitmap);
+	/* The select plugins and gres keep static scratch state, so test
+	 * one job at a time */
+	if (cycle->parallel)
+		slurm_mutex_lock(&cycle->select_mutex);
+	j = _try_sched(job_ptr, &group->avail_bitmap, min_nodes, max_nodes,
+		       req_nodes, group->exc_core_bitmap);
+
+	group->now = time(NULL);
+	if (j != SLURM_SUCCESS) {
+		job_ptr->start_time = 0;
+	} else if (start_res > job_ptr->start_time) {
+		job_ptr->start_time = start_res;
+		last_job_update = group->now;
+	}
+	if (cycle->parallel)
+		slurm_mutex_unlock(&cycle->select_mutex);
+	if (j != SLURM_SUCCESS) {
+		job_ptr->time_limit = orig_time_limit;
+		_bf_plan_add(group, job_ptr, part_ptr, job_sum, NULL, 0,
+			     false, 0);
+		return BF_JOB_NEXT;	/* not runable */
+	}
+
+	if (job_ptr->start_time <= group->now) {
+		uint32_t save_time_limit = job_ptr->time_limit;
+		int rc;
+		if (!_bf_state_upgrade(cycle)) {
+			/* Another thread started or changed jobs since the
+			 * job was tested, the job or its nodes may no
+			 * longer be available. Test it again. */
+			_bf_state_downgrade(cycle);
+			job_ptr->start_time = 0;
+			if (!IS_JOB_PENDING(job_ptr) ||
+			    (job_ptr->priority == 0)) {
+				job_ptr->time_limit = orig_time_limit;
+				return BF_JOB_NEXT;
+			}
+			later_start = group->now;
+			goto TRY_LATER;
+		}
+		rc = _start_job(job_ptr, group->resv_bitmap);
+		_bf_state_changed(cycle);
+		if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE)) {
+			if (orig_time_limit == NO_VAL)
+				job_ptr->time_limit = comp_time_limit;
+			else
+				job_ptr->time_limit = orig_time_limit;
+			job_ptr->end_time = job_ptr->start_time +
+					    (job_ptr->time_limit * 60);
+		} else if ((rc == SLURM_SUCCESS) && job_ptr->time_min) {
+			/* Set time limit as high as possible */
+			job_ptr->time_limit = comp_time_limit;
+			job_ptr->end_time = job_ptr->start_time +
+					    (comp_time_limit * 60);
+			_reset_job_time_limit(job_ptr, group->now,
+					      group->node_space,
+					      group->node_space_recs);
+			time_limit = job_ptr->time_limit;
+		} else {
+			job_ptr->time_limit = orig_time_limit;
+		}
+		if ((rc == SLURM_SUCCESS) &&
+		    (save_time_limit != job_ptr->time_limit)) {
+			/* Update the database if job time limit changed */
+			jobacct_storage_g_job_start(acct_db_conn, job_ptr);
+		}
+		_bf_state_downgrade(cycle);
+		_bf_plan_end(group);
+		if (rc == ESLURM_ACCOUNTING_POLICY) {
+			/* Unknown future start time, just skip job */
+			job_ptr->start_time = 0;
+			return BF_JOB_NEXT;
+		} else if (rc != SLURM_SUCCESS) {
+			/* Planned to start job, but something bad
+			 * happended. */
+			job_ptr->start_time = 0;
+			return BF_JOB_STOP;
+		} else {
+			/* Started this job, move to next one */
+			group->reject_array_job_id = 0;
+			return BF_JOB_NEXT;
+		}
+	} else
+		job_ptr->time_limit = orig_time_limit;
+
+	if (later_start && (job_ptr->start_time > later_start)) {
+		/* Try later when some nodes currently reserved for
+		 * pending jobs are free */
+		job_ptr->start_time = 0;
+		goto TRY_LATER;
+	}
+
+	if (job_ptr->start_time > (cycle->sched_start + backfill_window)) {
+		/* Starts too far in the future to worry about */
+		_bf_plan_add(group, job_ptr, part_ptr, job_sum, NULL, 0,
+			     false, job_ptr->start_time - backfill_window);
+		return BF_JOB_NEXT;
+	}
+
+	if (group->node_space_recs >= max_backfill_job_cnt) {
+		/* Already have too many jobs to deal with */
+		_bf_plan_end(group);
+		return BF_JOB_STOP;
+	}
+
+	end_reserve = job_ptr->start_time + (time_limit * 60);
+	if (_test_resv_overlap(group->node_space, group->node_space_recs,
+			       group->avail_bitmap, job_ptr->start_time,
+			       end_reserve)) {
+		/* This job overlaps with an existing reservation for
+		 * job to be backfill scheduled, which the sched
+		 * plugin does not know about. Try again later. */
+		later_start = job_ptr->start_time;
+		job_ptr->start_time = 0;
+		goto TRY_LATER;
+	}
+
+	/*
+	 * Add reservation to scheduling table if appropriate
+	 */
+	if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE)) {
+		_bf_plan_add(group, job_ptr, part_ptr, job_sum, NULL, 0,
+			     false, job_ptr->start_time);
+		return BF_JOB_NEXT;
+	}
+	group->reject_array_job_id = 0;
+	if (debug_flags & DEBUG_FLAG_BACKFILL)
+		_dump_job_sched(job_ptr, end_reserve, group->avail_bitmap);
+	bit_not(group->avail_bitmap);
+	_add_reservation(job_ptr->start_time, end_reserve,
+			 group->avail_bitmap, group->node_space,
+			 &group->node_space_recs);
+	_bf_plan_add(group, job_ptr, part_ptr, job_sum, group->avail_bitmap,
+		     end_reserve, false, job_ptr->start_time);
+	if (debug_flags & DEBUG_FLAG_BACKFILL)
+		_dump_node_space_table(group->node_space);
+	return BF_JOB_NEXT;
+}
+
+/*
+ * Test the pending jobs of a group in priority order until all are tested
+ *	or the time to yield locks is reached
+ * RET true if the group's testing has ended
+ */
+static bool _bf_test_group(bf_cycle_t *cycle, bf_group_t *group)
+{
+	job_queue_rec_t *job_queue_rec;
+	struct job_record *job_ptr;
+	struct part_record *part_ptr;
+	time_t later_start;
+	bool resumed;
+	int rc;
+
+	while (!group->done) {
+		if (group->resume_job_ptr) {
+			/* With bf_continue configured, the original job
+			 * could have been scheduled or cancelled and purged
+			 * while locks were yielded. Validate pointer here. */
+			job_ptr = group->resume_job_ptr;
+			part_ptr = group->resume_part_ptr;
+			later_start = group->resume_later_start;
+			group->resume_job_ptr = NULL;
+			if ((job_ptr->magic  != JOB_MAGIC) ||
+			    (job_ptr->job_id != group->resume_job_id))
+				continue;
+			resumed = true;
+			group->job_test_count++;
+		} else {
+			if (_bf_timeout(cycle))
+				return false;
+			job_queue_rec = (job_queue_rec_t *)
+				list_pop_bottom(group->job_queue,
+						sort_job_queue2);
+			if (!job_queue_rec) {
+				group->done = true;
+				break;
+			}
+			job_ptr  = job_queue_rec->job_ptr;
+			part_ptr = job_queue_rec->part_ptr;
+			/* With bf_continue configured, the original job
+			 * could have been cancelled and purged. Validate
+			 * pointer here. */
+			if ((job_ptr->magic  != JOB_MAGIC) ||
+			    (job_ptr->job_id != job_queue_rec->job_id)) {
+				xfree(job_queue_rec);
+				continue;
+			}
+			xfree(job_queue_rec);
+			later_start = 0;
+			resumed = false;
+			group->counted = false;
+			group->job_test_count++;
+		}
+
+		_bf_state_lock(cycle, false);
+		rc = _bf_test_job(cycle, group, job_ptr, part_ptr,
+				  later_start, resumed);
+		_bf_state_unlock(cycle, false);
+		if (rc == BF_JOB_YIELD)
+			return false;
+		if (rc == BF_JOB_STOP)
+			group->done = true;
+	}
+	return true;
+}
+
+/* Backfill worker thread, test groups until all are done or the time to
+ * yield locks is reached */
+static void *_bf_worker(void *arg)
+{
+	bf_cycle_t *cycle = (bf_cycle_t *) arg;
+	bf_group_t *group;
+	struct timeval tv1, tv2;
+	uint64_t work_usec;
+	int i;
+
+	gettimeofday(&tv1, NULL);
+	while (1) {
+		slurm_mutex_lock(&cycle->group_mutex);
+		for (i = cycle->next_group; i < cycle->group_cnt; i++) {
+			if (!cycle->groups[i].done)
+				break;
+		}
+		cycle->next_group = i + 1;
+		slurm_mutex_unlock(&cycle->group_mutex);
+		if (i >= cycle->group_cnt)
+			break;
+		group = &cycle->groups[i];
+		if (!_bf_test_group(cycle, group))
+			break;	/* time to yield locks */
+	}
+	gettimeofday(&tv2, NULL);
+
+	work_usec = (tv2.tv_sec - tv1.tv_sec) * 1000000;
+	work_usec += tv2.tv_usec - tv1.tv_usec;
+	slurm_mutex_lock(&cycle->group_mutex);
+	cycle->work_usec += work_usec;
+	slurm_mutex_unlock(&cycle->group_mutex);
+	return NULL;
+}
+
+/* Test groups until all are done or the time to yield locks is reached,
+ * with multiple threads if configured and there are multiple groups
+ * RET true if all groups are done */
+static bool _bf_test_groups(bf_cycle_t *cycle)
+{
+	pthread_attr_t attr;
+	pthread_t *thread_id;
+	int i, thread_cnt;
+
+	cycle->next_group = 0;
+	thread_cnt = MIN(cycle->threads, cycle->group_cnt);
+	cycle->parallel = (thread_cnt > 1);
+	if (!cycle->parallel) {
+		_bf_worker(cycle);
+	} else {
+		thread_id = xmalloc(sizeof(pthread_t) * thread_cnt);
+		slurm_attr_init(&attr);
+		for (i = 0; i < thread_cnt; i++) {
+			if (pthread_create(&thread_id[i], &attr, _bf_worker,
+					   cycle)) {
+				error("backfill: pthread_create: %m");
+				thread_id[i] = 0;
+			}
+		}
+		slurm_attr_destroy(&attr);
+		for (i = 0; i < thread_cnt; i++) {
+			if (thread_id[i])
+				pthread_join(thread_id[i], NULL);
+		}
+		xfree(thread_id);
+		/* Test any groups left if threads could not be created */
+		cycle->parallel = false;
+		cycle->next_group = 0;
+		if (!_bf_timeout(cycle))
+			_bf_worker(cycle);
+	}
+	cycle->last_threads = MAX(cycle->last_threads, thread_cnt);
+
+	slurmctld_diag_stats.bf_last_depth = 0;
+	slurmctld_diag_stats.bf_last_depth_try = 0;
+	slurmctld_diag_stats.bf_last_reused = 0;
+	for (i = 0; i < cycle->group_cnt; i++) {
+		slurmctld_diag_stats.bf_last_depth += cycle->groups[i].depth;
+		slurmctld_diag_stats.bf_last_depth_try +=
+			cycle->groups[i].depth_try;
+		slurmctld_diag_stats.bf_last_reused +=
+			cycle->groups[i].reused;
+		if (!cycle->groups[i].done)
+			return false;
+	}
+	return true;
+}
+
+static int _attempt_backfill(void)
+{
+	DEF_TIMERS;
+	List job_queue;
+	bf_cycle_t cycle;
+	bf_resources_t resources;
 	struct timeval bf_time1, bf_time2;
-	int sched_timeout = 2, yield_sleep = 1;
+	int i, yield_sleep = 1;
 	int rc = 0;
-	int job_test_count = 0;
-	uint32_t *uid = NULL, nuser = 0, bf_parts = 0, *bf_part_jobs = NULL;
-	uint16_t *njobs = NULL;
-	bool already_counted;
-	uint32_t reject_array_job_id = 0;
 	time_t config_update = slurmctld_conf.last_update;
 	time_t part_update = last_part_update;
 
@@ -621,10 +1799,13 @@ static int _attempt_backfill(void)
 		info("backfill: beginning");
 	else
 		debug("backfill: beginning");
-	sched_start = now = time(NULL);
 
+	memset(&cycle, 0, sizeof(bf_cycle_t));
+	cycle.sched_start = time(NULL);
+	cycle.sched_timeout = 2;
+	cycle.threads = backfill_threads;
 	if (slurm_get_root_filter())
-		filter_root = true;
+		cycle.filter_root = true;
 
 	job_queue = build_job_queue(true, true);
 	if (list_count(job_queue) == 0) {
@@ -640,449 +1821,98 @@ static int _attempt_backfill(void)
 						 bf_queue_len;
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
-	slurmctld_diag_stats.bf_when_last_cycle = now;
+	slurmctld_diag_stats.bf_last_reused = 0;
+	slurmctld_diag_stats.bf_when_last_cycle = cycle.sched_start;
 	slurmctld_diag_stats.bf_active = 1;
 
-	node_space = xmalloc(sizeof(node_space_map_t) *
-			     (max_backfill_job_cnt + 3));
-	node_space[0].begin_time = sched_start;
-	node_space[0].end_time = sched_start + backfill_window;
-	node_space[0].avail_bitmap = bit_copy(avail_node_bitmap);
-	node_space[0].next = 0;
-	node_space_recs = 1;
-	if (debug_flags & DEBUG_FLAG_BACKFILL)
-		_dump_node_space_table(node_space);
-
-	if (max_backfill_job_per_part) {
+	if (max_backfill_job_per_part || (cycle.threads > 1)) {
 		ListIterator part_iterator;
 		struct part_record *part_ptr;
-		bf_parts = list_count(part_list);
-		bf_part_ptr  = xmalloc(sizeof(struct part_record *) * bf_parts);
-		bf_part_jobs = xmalloc(sizeof(int) * bf_parts);
+		cycle.part_cnt = list_count(part_list);
+		cycle.part_ptr  = xmalloc(sizeof(struct part_record *) *
+					  cycle.part_cnt);
+		cycle.part_jobs = xmalloc(sizeof(int) * cycle.part_cnt);
 		part_iterator = list_iterator_create(part_list);
 		i = 0;
 		while ((part_ptr = (struct part_record *)
 				   list_next(part_iterator))) {
-			bf_part_ptr[i++] = part_ptr;
+			cycle.part_ptr[i++] = part_ptr;
 		}
 		list_iterator_destroy(part_iterator);
 	}
 	if (max_backfill_job_per_user) {
-		uid = xmalloc(BF_MAX_USERS * sizeof(uint32_t));
-		njobs = xmalloc(BF_MAX_USERS * sizeof(uint16_t));
+		cycle.uid = xmalloc(BF_MAX_USERS * sizeof(uint32_t));
+		cycle.njobs = xmalloc(BF_MAX_USERS * sizeof(uint16_t));
+	}
+	slurm_mutex_init(&cycle.group_mutex);
+	slurm_mutex_init(&cycle.user_mutex);
+	slurm_mutex_init(&cycle.state_mutex);
+	pthread_cond_init(&cycle.state_cond, NULL);
+	slurm_mutex_init(&cycle.select_mutex);
+
+	_bf_build_groups(&cycle, job_queue);
+	memset(&resources, 0, sizeof(bf_resources_t));
+	if (backfill_incremental) {
+		_bf_resources_get(&resources, cycle.sched_start);
+		_bf_plan_attach(&cycle, &resources);
+	}
+	if (debug_flags & DEBUG_FLAG_BACKFILL) {
+		info("backfill: testing %u jobs in %d groups",
+		     slurmctld_diag_stats.bf_queue_len, cycle.group_cnt);
+		_dump_node_space_table(cycle.groups[0].node_space);
 	}
-	while ((job_queue_rec = (job_queue_rec_t *)
-				list_pop_bottom(job_queue, sort_job_queue2))) {
-		if ((time(NULL) - sched_start) >= sched_timeout) {
-			if (debug_flags & DEBUG_FLAG_BACKFILL) {
-				END_TIMER;
-				info("backfill: completed yielding locks "
-				     "after testing %d jobs, %s",
-				     job_test_count, TIME_STR);
-			}
-			if ((_yield_locks(yield_sleep) && !backfill_continue) ||
-			    (slurmctld_conf.last_update != config_update) ||
-			    (last_part_update != part_update)) {
-				if (debug_flags & DEBUG_FLAG_BACKFILL) {
-					info("backfill: system state changed, "
-					     "breaking out after testing %d "
-					     "jobs", job_test_count);
-				}
-				rc = 1;
-				break;
-			}
-			/* Reset backfill scheduling timers, resume testing */
-			sched_start = time(NULL);
-			job_test_count = 0;
-			START_TIMER;
-		}
-
-		job_ptr  = job_queue_rec->job_ptr;
-		/* With bf_continue configured, the original job could have
-		 * been cancelled and purged. Validate pointer here. */
-		if ((job_ptr->magic  != JOB_MAGIC) ||
-		    (job_ptr->job_id != job_queue_rec->job_id))
-			continue;
-		orig_time_limit = job_ptr->time_limit;
-		part_ptr = job_queue_rec->part_ptr;
-		job_test_count++;
-
-		xfree(job_queue_rec);
-		if (!IS_JOB_PENDING(job_ptr))
-			continue;	/* started in other partition */
-		if (!avail_front_end(job_ptr))
-			continue;	/* No available frontend for this job */
-		if (job_ptr->array_task_id != NO_VAL) {
-			if (reject_array_job_id == job_ptr->array_job_id)
-				continue;  /* already rejected array element */
-			/* assume reject whole array for now, clear if OK */
-			reject_array_job_id = job_ptr->array_job_id;
-		}
-		job_ptr->part_ptr = part_ptr;
-
-		if (debug_flags & DEBUG_FLAG_BACKFILL)
-			info("backfill test for job %u", job_ptr->job_id);
-
-		slurmctld_diag_stats.bf_last_depth++;
-		already_counted = false;
-
-		if (max_backfill_job_per_part) {
-			bool skip_job = false;
-			for (j = 0; j < bf_parts; j++) {
-				if (bf_part_ptr[j] != job_ptr->part_ptr)
-					continue;
-				if (bf_part_jobs[j]++ >=
-				    max_backfill_job_per_part)
-					skip_job = true;
-				break;
-			}
-			if (skip_job) {
-				if (debug_flags & DEBUG_FLAG_BACKFILL)
-					debug("backfill: have already "
-					      "checked %u jobs for "
-					      "partition %s; skipping "
-					      "job %u",
-					      max_backfill_job_per_part,
-					      job_ptr->part_ptr->name,
-					      job_ptr->job_id);
-				continue;
-			}
-		}
-		if (max_backfill_job_per_user) {
-			for (j = 0; j < nuser; j++) {
-				if (job_ptr->user_id == uid[j]) {
-					njobs[j]++;
-					if (debug_flags & DEBUG_FLAG_BACKFILL)
-						debug("backfill: user %u: "
-						      "#jobs %u",
-						      uid[j], njobs[j]);
-					break;
-				}
-			}
-			if (j == nuser) { /* user not found */
-				static bool bf_max_user_msg = true;
-				if (nuser < BF_MAX_USERS) {
-					uid[j] = job_ptr->user_id;
-					njobs[j] = 1;
-					nuser++;
-				} else if (bf_max_user_msg) {
-					bf_max_user_msg = false;
-					error("backfill: too many users in "
-					      "queue. Consider increasing "
-					      "BF_MAX_USERS");
-				}
-				if (debug_flags & DEBUG_FLAG_BACKFILL)
-					debug2("backfill: found new user %u. "
-					       "Total #users now %u",
-					       job_ptr->user_id, nuser);
-			} else {
-				if (njobs[j] > max_backfill_job_per_user) {
-					/* skip job */
-					if (debug_flags & DEBUG_FLAG_BACKFILL)
-						debug("backfill: have already "
-						      "checked %u jobs for "
-						      "user %u; skipping "
-						      "job %u",
-						      max_backfill_job_per_user,
-						      job_ptr->user_id,
-						      job_ptr->job_id);
-					continue;
-				}
-			}
-		}
-
-		if (((part_ptr->state_up & PARTITION_SCHED) == 0) ||
-		    (part_ptr->node_bitmap == NULL))
-		 	continue;
-		if ((part_ptr->flags & PART_FLAG_ROOT_ONLY) && filter_root)
-			continue;
-
-		if ((!job_independent(job_ptr, 0)) ||
-		    (license_job_test(job_ptr, time(NULL)) != SLURM_SUCCESS))
-			continue;
 
-		/* Determine minimum and maximum node counts */
-		min_nodes = MAX(job_ptr->details->min_nodes,
-				part_ptr->min_nodes);
-		if (job_ptr->details->max_nodes == 0)
-			max_nodes = part_ptr->max_nodes;
-		else
-			max_nodes = MIN(job_ptr->details->max_nodes,
-					part_ptr->max_nodes);
-		max_nodes = MIN(max_nodes, 500000);     /* prevent overflows */
-		if (job_ptr->details->max_nodes)
-			req_nodes = max_nodes;
-		else
-			req_nodes = min_nodes;
-		if (min_nodes > max_nodes) {
-			/* job's min_nodes exceeds partition's max_nodes */
-			continue;
+	while (!_bf_test_groups(&cycle)) {
+		int job_test_count = 0;
+		for (i = 0; i < cycle.group_cnt; i++) {
+			job_test_count += cycle.groups[i].job_test_count;
+			cycle.groups[i].job_test_count = 0;
 		}
-
-		/* Determine job's expected completion time */
-		if (part_ptr->max_time == INFINITE)
-			part_time_limit = 365 * 24 * 60; /* one year */
-		else
-			part_time_limit = part_ptr->max_time;
-		if (job_ptr->time_limit == NO_VAL) {
-			time_limit = part_time_limit;
-		} else {
-			if (part_ptr->max_time == INFINITE)
-				time_limit = job_ptr->time_limit;
-			else
-				time_limit = MIN(job_ptr->time_limit,
-						 part_time_limit);
+		if (debug_flags & DEBUG_FLAG_BACKFILL) {
+			END_TIMER;
+			info("backfill: completed yielding locks "
+			     "after testing %d jobs, %s",
+			     job_test_count, TIME_STR);
 		}
-		comp_time_limit = time_limit;
-		qos_ptr = job_ptr->qos_ptr;
-		if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE) &&
-		    slurm_get_preempt_mode())
-			time_limit = job_ptr->time_limit = 1;
-		else if (job_ptr->time_min && (job_ptr->time_min < time_limit))
-			time_limit = job_ptr->time_limit = job_ptr->time_min;
-
-		/* Determine impact of any resource reservations */
-		later_start = now;
- TRY_LATER:
-		if ((time(NULL) - sched_start) >= sched_timeout) {
-			uint32_t save_job_id = job_ptr->job_id;
-			uint32_t save_time_limit = job_ptr->time_limit;
-			job_ptr->time_limit = orig_time_limit;
+		if ((_yield_locks(yield_sleep) && !backfill_continue) ||
+		    (slurmctld_conf.last_update != config_update) ||
+		    (last_part_update != part_update)) {
 			if (debug_flags & DEBUG_FLAG_BACKFILL) {
-				END_TIMER;
-				info("backfill: completed yielding locks 2"
-				     "after testing %d jobs, %s",
-				     job_test_count, TIME_STR);
-			}
-			if ((_yield_locks(yield_sleep) && !backfill_continue) ||
-			    (slurmctld_conf.last_update != config_update) ||
-			    (last_part_update != part_update)) {
-				if (debug_flags & DEBUG_FLAG_BACKFILL) {
-					info("backfill: system state changed, "
-					     "breaking out after testing %d "
-					     "jobs", job_test_count);
-				}
-				rc = 1;
-				break;
-			}
-
-			/* With bf_continue configured, the original job could
-			 * have been scheduled or cancelled and purged.
-			 * Revalidate job the record here. */
-			if ((job_ptr->magic  != JOB_MAGIC) ||
-			    (job_ptr->job_id != save_job_id))
-				continue;
-			if (!IS_JOB_PENDING(job_ptr))
-				continue;
-			if (!avail_front_end(job_ptr))
-				continue;	/* No available frontend */
-
-			job_ptr->time_limit = save_time_limit;
-			/* Reset backfill scheduling timers, resume testing */
-			sched_start = time(NULL);
-			job_test_count = 1;
-			START_TIMER;
-		}
-
-		FREE_NULL_BITMAP(avail_bitmap);
-		FREE_NULL_BITMAP(exc_core_bitmap);
-		start_res   = later_start;
-		later_start = 0;
-		j = job_test_resv(job_ptr, &start_res, true, &avail_bitmap,
-				  &exc_core_bitmap);
-		if (j != SLURM_SUCCESS) {
-			job_ptr->time_limit = orig_time_limit;
-			continue;
-		}
-		if (start_res > now)
-			end_time = (time_limit * 60) + start_res;
-		else
-			end_time = (time_limit * 60) + now;
-		resv_end = find_resv_end(start_res);
-		/* Identify usable nodes for this job */
-		bit_and(avail_bitmap, part_ptr->node_bitmap);
-		bit_and(avail_bitmap, up_node_bitmap);
-		for (j=0; ; ) {
-			if ((node_space[j].end_time > start_res) &&
-			     node_space[j].next && (later_start == 0))
-				later_start = node_space[j].end_time;
-			if (node_space[j].end_time <= start_res)
-				;
-			else if (node_space[j].begin_time <= end_time) {
-				bit_and(avail_bitmap,
-					node_space[j].avail_bitmap);
-			} else
-				break;
-			if ((j = node_space[j].next) == 0)
-				break;
-		}
-		if ((resv_end++) &&
-		    ((later_start == 0) || (resv_end < later_start))) {
-			later_start = resv_end;
-		}
-
-		if (job_ptr->details->exc_node_bitmap) {
-			bit_not(job_ptr->details->exc_node_bitmap);
-			bit_and(avail_bitmap,
-				job_ptr->details->exc_node_bitmap);
-			bit_not(job_ptr->details->exc_node_bitmap);
-		}
-
-		/* Test if insufficient nodes remain OR
-		 *	required nodes missing OR
-		 *	nodes lack features */
-		if ((bit_set_count(avail_bitmap) < min_nodes) ||
-		    ((job_ptr->details->req_node_bitmap) &&
-		     (!bit_super_set(job_ptr->details->req_node_bitmap,
-				     avail_bitmap))) ||
-		    (job_req_node_filter(job_ptr, avail_bitmap))) {
-			if (later_start) {
-				job_ptr->start_time = 0;
-				goto TRY_LATER;
+				info("backfill: system state changed, "
+				     "breaking out after testing %d "
+				     "jobs", job_test_count);
 			}
-			/* Job can not start until too far in the future */
-			job_ptr->time_limit = orig_time_limit;
-			job_ptr->start_time = sched_start + backfill_window;
-			continue;
-		}
-
-		/* Identify nodes which are definitely off limits */
-		FREE_NULL_BITMAP(resv_bitmap);
-		resv_bitmap = bit_copy(avail_bitmap);
-		bit_not(resv_bitmap);
-
-		/* this is the time consuming operation */
-		debug2("backfill: entering _try_sched for job %u.",
-		       job_ptr->job_id);
-
-		if (!already_counted) {
-			slurmctld_diag_stats.bf_last_depth_try++;
-			already_counted = true;
-		}
-
-		if (debug_flags & DEBUG_FLAG_BACKFILL)
-			_dump_job_test(job_ptr, avail_bitmap);
-		j = _try_sched(job_ptr, &avail_bitmap, min_nodes, max_nodes,
-			       req_nodes, exc_core_bitmap);
-
-		now = time(NULL);
-		if (j != SLURM_SUCCESS) {
-			job_ptr->time_limit = orig_time_limit;
-			job_ptr->start_time = 0;
-			continue;	/* not runable */
-		}
-
-		if (start_res > job_ptr->start_time) {
-			job_ptr->start_time = start_res;
-			last_job_update = now;
-		}
-		if (job_ptr->start_time <= now) {
-			uint32_t save_time_limit = job_ptr->time_limit;
-			int rc = _start_job(job_ptr, resv_bitmap);
-			if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE)) {
-				if (orig_time_limit == NO_VAL)
-					job_ptr->time_limit = comp_time_limit;
-				else
-					job_ptr->time_limit = orig_time_limit;
-				job_ptr->end_time = job_ptr->start_time +
-						    (job_ptr->time_limit * 60);
-			} else if ((rc == SLURM_SUCCESS) && job_ptr->time_min) {
-				/* Set time limit as high as possible */
-				job_ptr->time_limit = comp_time_limit;
-				job_ptr->end_time = job_ptr->start_time +
-						    (comp_time_limit * 60);
-				_reset_job_time_limit(job_ptr, now,
-						      node_space);
-				time_limit = job_ptr->time_limit;
-			} else {
-				job_ptr->time_limit = orig_time_limit;
-			}
-			if (rc == ESLURM_ACCOUNTING_POLICY) {
-				/* Unknown future start time, just skip job */
-				job_ptr->start_time = 0;
-				continue;
-			} else if (rc != SLURM_SUCCESS) {
-				/* Planned to start job, but something bad
-				 * happended. */
-				job_ptr->start_time = 0;
-				break;
-			} else {
-				/* Started this job, move to next one */
-				reject_array_job_id = 0;
-
-				/* Update the database if job time limit
-				 * changed and move to next job */
-				if (save_time_limit != job_ptr->time_limit)
-					jobacct_storage_g_job_start(acct_db_conn,
-								    job_ptr);
-				continue;
-			}
-		} else
-			job_ptr->time_limit = orig_time_limit;
-
-		if (later_start && (job_ptr->start_time > later_start)) {
-			/* Try later when some nodes currently reserved for
-			 * pending jobs are free */
-			job_ptr->start_time = 0;
-			goto TRY_LATER;
-		}
-
-		if (job_ptr->start_time > (sched_start + backfill_window)) {
-			/* Starts too far in the future to worry about */
-			continue;
-		}
-
-		if (node_space_recs >= max_backfill_job_cnt) {
-			/* Already have too many jobs to deal with */
+			rc = 1;
 			break;
 		}
+		/* Reset backfill scheduling timers, resume testing */
+		cycle.sched_start = time(NULL);
+		START_TIMER;
+	}
 
-		end_reserve = job_ptr->start_time + (time_limit * 60);
-		if (_test_resv_overlap(node_space, avail_bitmap,
-				       job_ptr->start_time, end_reserve)) {
-			/* This job overlaps with an existing reservation for
-			 * job to be backfill scheduled, which the sched
-			 * plugin does not know about. Try again later. */
-			later_start = job_ptr->start_time;
-			job_ptr->start_time = 0;
-			goto TRY_LATER;
-		}
+	_bf_plan_save(&cycle, &resources);
+	_bf_resources_free(&resources);
+	for (i = 0; i < cycle.group_cnt; i++)
+		_bf_group_fini(&cycle.groups[i]);
+	xfree(cycle.groups);
+	xfree(cycle.part_jobs);
+	xfree(cycle.part_ptr);
+	xfree(cycle.uid);
+	xfree(cycle.njobs);
+	slurm_mutex_destroy(&cycle.group_mutex);
+	slurm_mutex_destroy(&cycle.user_mutex);
+	slurm_mutex_destroy(&cycle.state_mutex);
+	pthread_cond_destroy(&cycle.state_cond);
+	slurm_mutex_destroy(&cycle.select_mutex);
 
-		/*
-		 * Add reservation to scheduling table if appropriate
-		 */
-		if (qos_ptr && (qos_ptr->flags & QOS_FLAG_NO_RESERVE))
-			continue;
-		reject_array_job_id = 0;
-		if (debug_flags & DEBUG_FLAG_BACKFILL)
-			_dump_job_sched(job_ptr, end_reserve, avail_bitmap);
-		bit_not(avail_bitmap);
-		_add_reservation(job_ptr->start_time, end_reserve,
-				 avail_bitmap, node_space, &node_space_recs);
-		if (debug_flags & DEBUG_FLAG_BACKFILL)
-			_dump_node_space_table(node_space);
-	}
-	xfree(bf_part_jobs);
-	xfree(bf_part_ptr);
-	xfree(uid);
-	xfree(njobs);
-	FREE_NULL_BITMAP(avail_bitmap);
-	FREE_NULL_BITMAP(exc_core_bitmap);
-	FREE_NULL_BITMAP(resv_bitmap);
-
-	for (i=0; ; ) {
-		FREE_NULL_BITMAP(node_space[i].avail_bitmap);
-		if ((i = node_space[i].next) == 0)
-			break;
-	}
-	xfree(node_space);
-	list_destroy(job_queue);
 	gettimeofday(&bf_time2, NULL);
+	slurmctld_diag_stats.bf_last_threads = MAX(cycle.last_threads, 1);
+	slurmctld_diag_stats.bf_last_work_time = cycle.work_usec;
 	_do_diag_stats(&bf_time1, &bf_time2, yield_sleep);
 	if (debug_flags & DEBUG_FLAG_BACKFILL) {
 		END_TIMER;
-		info("backfill: completed testing %d jobs, %s",
-		     job_test_count, TIME_STR);
+		info("backfill: completed testing %u jobs, %s",
+		     slurmctld_diag_stats.bf_last_depth, TIME_STR);
 	}
 	return rc;
 }
@@ -1147,12 +1977,15 @@ static int _start_job(struct job_record *job_ptr, bitstr_t *resv_bitmap)
  *	Avoid using resources reserved for pending jobs or in resource
  *	reservations */
 static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
-				  node_space_map_t *node_space)
+				  node_space_map_t *node_space,
+				  int node_space_recs)
 {
 	int32_t j, resv_delay;
 	uint32_t orig_time_limit = job_ptr->time_limit;
 
-	for (j=0; ; ) {
+	for (j = 0; j < node_space_recs; j++) {
+		if (j && (node_space[j].begin_time >= job_ptr->end_time))
+			break;	/* later records begin later */
 		if ((node_space[j].begin_time != now) &&
 		    (node_space[j].begin_time < job_ptr->end_time) &&
 		    (!bit_super_set(job_ptr->node_bitmap,
@@ -1163,8 +1996,6 @@ static void _reset_job_time_limit(struct job_record *job_ptr, time_t now,
 			if (resv_delay < job_ptr->time_limit)
 				job_ptr->time_limit = resv_delay;
 		}
-		if ((j = node_space[j].next) == 0)
-			break;
 	}
 	job_ptr->time_limit = MAX(job_ptr->time_min, job_ptr->time_limit);
 	job_ptr->end_time = job_ptr->start_time + (job_ptr->time_limit * 60);
@@ -1192,13 +2023,48 @@ static bool _more_work (time_t last_backfill_time)
 	return rc;
 }
 
+/* Return the index of the first node space record ending after some time,
+ * node_space_recs if none */
+static int _node_space_after(node_space_map_t *node_space,
+			     int node_space_recs, time_t when)
+{
+	int lo = 0, hi = node_space_recs, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (node_space[mid].end_time > when)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return lo;
+}
+
+/* Split a node space record at some time, the new record following it */
+static void _node_space_split(node_space_map_t *node_space,
+			      int *node_space_recs, int inx, time_t when)
+{
+	int i, recs = *node_space_recs;
+
+	memmove(&node_space[inx + 2], &node_space[inx + 1],
+		sizeof(node_space_map_t) * (recs - inx - 1));
+	node_space[inx + 1].begin_time = when;
+	node_space[inx + 1].end_time = node_space[inx].end_time;
+	node_space[inx + 1].avail_bitmap =
+		bit_copy(node_space[inx].avail_bitmap);
+	node_space[inx].end_time = when;
+	recs++;
+	for (i = inx; i < recs; i++)
+		node_space[i].next = ((i + 1) < recs) ? (i + 1) : 0;
+	*node_space_recs = recs;
+}
+
 /* Create a reservation for a job in the future */
 static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 			     bitstr_t *res_bitmap,
 			     node_space_map_t *node_space,
 			     int *node_space_recs)
 {
-	bool placed = false;
 	int i, j;
 
 	/* If we decrease the resolution of our timing information, this can
@@ -1206,51 +2072,26 @@ static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
 	start_time = (start_time / backfill_resolution) * backfill_resolution;
 	end_reserve = (end_reserve / backfill_resolution) * backfill_resolution;
 
-	for (j=0; ; ) {
-		if (node_space[j].end_time > start_time) {
-			/* insert start entry record */
-			i = *node_space_recs;
-			node_space[i].begin_time = start_time;
-			node_space[i].end_time = node_space[j].end_time;
-			node_space[j].end_time = start_time;
-			node_space[i].avail_bitmap =
-				bit_copy(node_space[j].avail_bitmap);
-			node_space[i].next = node_space[j].next;
-			node_space[j].next = i;
-			(*node_space_recs)++;
-			placed = true;
-		}
-		if (node_space[j].end_time == start_time) {
-			/* no need to insert new start entry record */
-			placed = true;
-		}
-		if (placed == true) {
-			j = node_space[j].next;
-			if (j && (end_reserve < node_space[j].end_time)) {
-				/* insert end entry record */
-				i = *node_space_recs;
-				node_space[i].begin_time = end_reserve;
-				node_space[i].end_time = node_space[j].
-							 end_time;
-				node_space[j].end_time = end_reserve;
-				node_space[i].avail_bitmap =
-					bit_copy(node_space[j].avail_bitmap);
-				node_space[i].next = node_space[j].next;
-				node_space[j].next = i;
-				(*node_space_recs)++;
-			}
-			break;
-		}
-		if ((j = node_space[j].next) == 0)
-			break;
+	/* Find the record ending at or after start_time */
+	i = _node_space_after(node_space, *node_space_recs,
+			      (time_t) start_time - 1);
+	if (i >= *node_space_recs)
+		return;
+	if (node_space[i].end_time > start_time) {
+		/* insert start entry record */
+		_node_space_split(node_space, node_space_recs, i, start_time);
+	}
+	j = i + 1;
+	if ((j < *node_space_recs) && (end_reserve < node_space[j].end_time)) {
+		/* insert end entry record */
+		_node_space_split(node_space, node_space_recs, j, end_reserve);
 	}
 
-	for (j=0; ; ) {
+	for (j = i; j < *node_space_recs; j++) {
 		if ((node_space[j].begin_time >= start_time) &&
 		    (node_space[j].end_time <= end_reserve))
 			bit_and(node_space[j].avail_bitmap, res_bitmap);
-		if ((node_space[j].begin_time >= end_reserve) ||
-		    ((j = node_space[j].next) == 0))
+		if (node_space[j].begin_time >= end_reserve)
 			break;
 	}
 }
@@ -1259,26 +2100,26 @@ static void _add_reservation(uint32_t start_time, uint32_t end_reserve,
  * Determine if the resource specification for a new job overlaps with a
  *	reservation that the backfill scheduler has made for a job to be
  *	started in the future.
+ * IN node_space_recs - count of records in node_space
  * IN use_bitmap - nodes to be allocated
  * IN start_time - start time of job
  * IN end_reserve - end time of job
  */
 static bool _test_resv_overlap(node_space_map_t *node_space,
-			       bitstr_t *use_bitmap, uint32_t start_time,
-			       uint32_t end_reserve)
+			       int node_space_recs, bitstr_t *use_bitmap,
+			       uint32_t start_time, uint32_t end_reserve)
 {
 	bool overlap = false;
 	int j;
 
-	for (j=0; ; ) {
-		if ((node_space[j].end_time   > start_time) &&
-		    (node_space[j].begin_time < end_reserve) &&
-		    (!bit_super_set(use_bitmap, node_space[j].avail_bitmap))) {
+	for (j = _node_space_after(node_space, node_space_recs, start_time);
+	     j < node_space_recs; j++) {
+		if (node_space[j].begin_time >= end_reserve)
+			break;
+		if (!bit_super_set(use_bitmap, node_space[j].avail_bitmap)) {
 			overlap = true;
 			break;
 		}
-		if ((j = node_space[j].next) == 0)
-			break;
 	}
 	return overlap;
 }
@@ -98,6 +98,36 @@ static int _get_info(void)
 	return rc;
 }
 
+/* Sort lock call sites by decreasing hold time */
+static int _sort_lock_site_by_hold(const void *x, const void *y)
+{
+	const lock_site_stats_info_t *site1 = x, *site2 = y;
+
+	if (site1->hold_total > site2->hold_total)
+		return -1;
+	if (site1->hold_total < site2->hold_total)
+		return 1;
+	return 0;
+}
+
+/* Print the non-empty buckets of a lock time or SlurmDBD agent histogram,
+ * bucket i counts values under 10^(i+1) and the last one all larger ones */
+static void _print_lock_hist(uint32_t *hist, uint32_t hist_cnt)
+{
+	uint64_t limit = 10;
+	int i;
+
+	for (i = 0; i < hist_cnt; i++, limit *= 10) {
+		if (!hist[i])
+			continue;
+		if (i == (hist_cnt - 1))
+			printf(" >=%"PRIu64":%u", limit / 10, hist[i]);
+		else
+			printf(" <%"PRIu64":%u", limit, hist[i]);
+	}
+	printf("\n");
+}
+
 static int _print_info(void)
 {
 	if (!buf) {
@@ -154,6 +184,10 @@ static int _print_info(void)
 	}
 	printf("\tLast depth cycle: %u\n", buf->bf_last_depth);
 	printf("\tLast depth cycle (try sched): %u\n", buf->bf_last_depth_try);
+	if (buf->bf_last_reused) {
+		printf("\tLast depth cycle (reused): %u\n",
+		       buf->bf_last_reused);
+	}
 	if (buf->bf_cycle_counter > 0) {
 		printf("\tDepth Mean: %u\n",
 		       buf->bf_depth_sum / buf->bf_cycle_counter);
@@ -165,6 +199,112 @@ static int _print_info(void)
 		printf("\tQueue length mean: %u\n",
 		       buf->bf_queue_len_sum / buf->bf_cycle_counter);
 	}
+	if (buf->bf_last_threads) {
+		printf("\tLast cycle threads: %u\n", buf->bf_last_threads);
+		if (buf->bf_cycle_last > 0) {
+			printf("\tLast cycle jobs tested per second: %u\n",
+			       (uint32_t) ((uint64_t) buf->bf_last_depth *
+					   1000000 / buf->bf_cycle_last));
+			printf("\tLast cycle speedup: %.2f\n",
+			       (double) buf->bf_last_work_time /
+			       buf->bf_cycle_last);
+		}
+	}
+
+	printf("\nJob information cache\n");
+	printf("\tHits:   %u\n", buf->job_info_cache_hits);
+	printf("\tMisses: %u\n", buf->job_info_cache_misses);
+	if ((buf->job_info_cache_hits + buf->job_info_cache_misses) > 0) {
+		printf("\tHit rate: %u%%\n",
+		       (uint32_t) ((uint64_t) buf->job_info_cache_hits * 100 /
+				   (buf->job_info_cache_hits +
+				    buf->job_info_cache_misses)));
+	}
+
+	if (buf->job_save_cnt) {
+		printf("\nJob state save (microseconds)\n");
+		printf("\tTotal saves: %u\n", buf->job_save_cnt);
+		printf("\tLast save:   %u\n", buf->job_save_last);
+		printf("\tMax save:    %u\n", buf->job_save_max);
+		printf("\tMean save:   %"PRIu64"\n",
+		       buf->job_save_sum / buf->job_save_cnt);
+		printf("\tLast save lock hold: %u\n",
+		       buf->job_save_lock_last);
+		printf("\tMax save lock hold:  %u\n",
+		       buf->job_save_lock_max);
+	}
+
+	if (buf->dbd_agent_batch_cnt || buf->dbd_agent_queue_size) {
+		printf("\nSlurmDBD agent\n");
+		printf("\tQueue size: %u\n", buf->dbd_agent_queue_size);
+		printf("\tMax queue size: %u\n", buf->dbd_agent_queue_max);
+		printf("\tMessages sent: %u\n", buf->dbd_agent_msg_cnt);
+		printf("\tBatches sent: %u\n", buf->dbd_agent_batch_cnt);
+		printf("\tMax batch size: %u\n", buf->dbd_agent_batch_max);
+		printf("\tMax batches in flight: %u\n",
+		       buf->dbd_agent_inflight_max);
+		printf("\tBatch size histogram:");
+		_print_lock_hist(buf->dbd_agent_batch_hist,
+				 buf->dbd_agent_hist_cnt);
+		if (buf->dbd_agent_batch_cnt) {
+			printf("\tMean round trip: %"PRIu64" usec\n",
+			       buf->dbd_agent_rtt_total /
+			       buf->dbd_agent_batch_cnt);
+		}
+		printf("\tMax round trip: %"PRIu64" usec\n",
+		       buf->dbd_agent_rtt_max);
+		printf("\tRound trip histogram (usec):");
+		_print_lock_hist(buf->dbd_agent_rtt_hist,
+				 buf->dbd_agent_hist_cnt);
+	}
+
+	if (buf->lock_stats_cnt) {
+		int i;
+		printf("\nLock statistics (microseconds):\n");
+		printf("\t%-10s %10s %12s %12s %10s %12s %12s\n",
+		       "Lock", "Reads", "Read wait", "Read hold",
+		       "Writes", "Write wait", "Write hold");
+		for (i = 0; i < buf->lock_stats_cnt; i++) {
+			lock_stats_info_t *lock_ptr = &buf->lock_stats[i];
+			printf("\t%-10s %10u %12"PRIu64" %12"PRIu64
+			       " %10u %12"PRIu64" %12"PRIu64"\n",
+			       lock_ptr->name, lock_ptr->read_cnt,
+			       lock_ptr->read_wait, lock_ptr->read_hold,
+			       lock_ptr->write_cnt, lock_ptr->write_wait,
+			       lock_ptr->write_hold);
+		}
+		for (i = 0; i < buf->lock_stats_cnt; i++) {
+			lock_stats_info_t *lock_ptr = &buf->lock_stats[i];
+			if (lock_ptr->site_drops) {
+				printf("\t%s locks from callers not "
+				       "recorded: %u\n", lock_ptr->name,
+				       lock_ptr->site_drops);
+			}
+		}
+	}
+
+	if (buf->lock_site_cnt) {
+		int i;
+		qsort(buf->lock_site_stats, buf->lock_site_cnt,
+		      sizeof(lock_site_stats_info_t), _sort_lock_site_by_hold);
+		printf("\nLock statistics by caller (microseconds):\n");
+		for (i = 0; i < buf->lock_site_cnt; i++) {
+			lock_site_stats_info_t *site_ptr =
+				&buf->lock_site_stats[i];
+			printf("\t%s %s %s lock count:%u\n",
+			       site_ptr->caller, site_ptr->lock_name,
+			       site_ptr->write_lock ? "write" : "read",
+			       site_ptr->count);
+			printf("\t\twait total:%"PRIu64" max:%"PRIu64,
+			       site_ptr->wait_total, site_ptr->wait_max);
+			_print_lock_hist(site_ptr->wait_hist,
+					 site_ptr->hist_cnt);
+			printf("\t\thold total:%"PRIu64" max:%"PRIu64,
+			       site_ptr->hold_total, site_ptr->hold_max);
+			_print_lock_hist(site_ptr->hold_hist,
+					 site_ptr->hist_cnt);
+		}
+	}
 	return 0;
 }
 
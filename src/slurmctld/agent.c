@@ -66,16 +66,20 @@
 #endif
 
 #include <errno.h>
+#include <poll.h>
 #include <pthread.h>
 #include <pwd.h>
 #include <signal.h>
 #include <string.h>
 #include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <stdlib.h>
 
+#include "src/common/fd.h"
 #include "src/common/forward.h"
 #include "src/common/list.h"
 #include "src/common/log.h"
@@ -153,6 +157,14 @@ typedef struct task_info {
 	void *msg_args_ptr;		/* ptr to RPC data to be used */
 } task_info_t;
 
+typedef struct mux_conn {
+	int fd;				/* connection, connect in progress
+					 * until sent is set */
+	int inx;			/* index of node's thd_t */
+	uint32_t sent;			/* bytes of message sent */
+	time_t deadline;		/* fail if not sent by this time */
+} mux_conn_t;
+
 typedef struct queued_request {
 	agent_arg_t* agent_arg_ptr;	/* The queued request */
 	time_t       first_attempt;	/* Time of first check for batch
@@ -179,6 +191,7 @@ static void _queue_agent_retry(agent_info_t * agent_info_ptr, int count);
 static int _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
 			  int count, int *spot);
 static void _spawn_retry_agent(agent_arg_t * agent_arg_ptr);
+static void _send_multiplex(agent_info_t *agent_ptr);
 static void *_thread_per_group_rpc(void *args);
 static int   _valid_agent_arg(agent_arg_t *agent_arg_ptr);
 static void *_wdog(void *args);
@@ -255,6 +268,16 @@ void *agent(void *args)
 	agent_info_ptr = _make_agent_info(agent_arg_ptr);
 	thread_ptr = agent_info_ptr->thread_struct;
 
+	/* Messages sent to each node without a reply are sent from this
+	 * thread without a thread per node, then the results are processed
+	 * as by the watchdog */
+	if (!agent_info_ptr->get_reply && !agent_arg_ptr->addr &&
+	    (agent_info_ptr->thread_count > 1)) {
+		_send_multiplex(agent_info_ptr);
+		(void) _wdog(agent_info_ptr);
+		goto done;
+	}
+
 	/* start the watchdog thread */
 	slurm_attr_init(&attr_wdog);
 	if (pthread_attr_setdetachstate
@@ -316,6 +339,7 @@ void *agent(void *args)
 
 	/* wait for termination of remaining threads */
 	pthread_join(thread_wdog, NULL);
+done:
 	delay = (int) difftime(time(NULL), begin_time);
 	if (delay > (slurm_get_msg_timeout() * 2)) {
 		info("agent msg_type=%u ran for %d seconds",
@@ -1039,6 +1063,195 @@ cleanup:
 	return (void *) NULL;
 }
 
+/* Start a non-blocking connection to a node for _send_multiplex()
+ * RET file descriptor or -1 on error */
+static int _mux_connect(char *node_name)
+{
+	slurm_addr_t addr;
+	int fd;
+
+	if (slurm_conf_get_addr(node_name, &addr) == SLURM_ERROR) {
+		error("_send_multiplex: can't find address for host %s, "
+		      "check slurm.conf", node_name);
+		return -1;
+	}
+	if ((fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
+		error("_send_multiplex: socket: %m");
+		return -1;
+	}
+	fd_set_close_on_exec(fd);
+	fd_set_nonblocking(fd);
+	if ((connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) &&
+	    (errno != EINPROGRESS)) {
+		debug2("_send_multiplex: connect to %s: %m", node_name);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/* Progress a connection of _send_multiplex() which poll reports ready
+ * RET 1 if the message is sent, 0 if more is to be sent, -1 on error */
+static int _mux_send(mux_conn_t *conn, char *data, uint32_t size)
+{
+	int err = 0;
+	socklen_t len = sizeof(err);
+	ssize_t rc;
+
+	if ((conn->sent == 0) &&
+	    (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 ||
+	     err)) {
+		if (err)
+			errno = err;
+		return -1;
+	}
+	while (conn->sent < size) {
+		rc = send(conn->fd, data + conn->sent, size - conn->sent, 0);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			return -1;
+		}
+		conn->sent += rc;
+	}
+	return 1;
+}
+
+/*
+ * _send_multiplex - send an RPC which needs no reply to every node of an
+ *	agent, with up to AGENT_MULTIPLEX_CNT non-blocking connections in
+ *	progress at once rather than a thread per node. Each node's thd_t
+ *	state is set to DSH_DONE or DSH_NO_RESP as by _thread_per_group_rpc().
+ * IN/OUT agent_ptr - agent with one node per thd_t
+ */
+static void _send_multiplex(agent_info_t *agent_ptr)
+{
+	thd_t *thread_ptr = agent_ptr->thread_struct;
+	slurm_msg_t msg;
+	Buf buffer;
+	char *data;
+	uint32_t size, nsize;
+	mux_conn_t *conn;
+	struct pollfd *pfd;
+	int *failed, *fail_errno, fail_cnt = 0;
+	int conn_cnt = 0, next = 0, timeout, i, j, rc;
+	time_t now;
+	/* Lock: Read node */
+	slurmctld_lock_t node_read_lock = {
+		NO_LOCK, NO_LOCK, READ_LOCK, NO_LOCK };
+
+	slurm_msg_t_init(&msg);
+	msg.msg_type = agent_ptr->msg_type;
+	msg.data     = *agent_ptr->msg_args_pptr;
+	buffer = slurm_pack_node_msg(&msg);
+	destroy_forward(&msg.forward);
+	if (!buffer) {
+		error("_send_multiplex: can't pack msg_type=%u: %m",
+		      agent_ptr->msg_type);
+		for (i = 0; i < agent_ptr->thread_count; i++)
+			thread_ptr[i].state = DSH_NO_RESP;
+		return;
+	}
+
+	/* Every node gets the same message length and data */
+	size  = get_buf_offset(buffer) + sizeof(nsize);
+	nsize = htonl(get_buf_offset(buffer));
+	data  = xmalloc(size);
+	memcpy(data, &nsize, sizeof(nsize));
+	memcpy(data + sizeof(nsize), get_buf_data(buffer),
+	       get_buf_offset(buffer));
+	free_buf(buffer);
+
+	timeout = MIN(slurm_get_msg_timeout(), COMMAND_TIMEOUT);
+	i = MIN(agent_ptr->thread_count, AGENT_MULTIPLEX_CNT);
+	conn   = xmalloc(sizeof(mux_conn_t) * i);
+	pfd    = xmalloc(sizeof(struct pollfd) * i);
+	failed = xmalloc(sizeof(int) * agent_ptr->thread_count);
+	fail_errno = xmalloc(sizeof(int) * agent_ptr->thread_count);
+
+	while ((next < agent_ptr->thread_count) || conn_cnt) {
+		now = time(NULL);
+		while ((next < agent_ptr->thread_count) &&
+		       (conn_cnt < AGENT_MULTIPLEX_CNT)) {
+			thd_t *thd = &thread_ptr[next];
+			thd->start_time = now;
+			thd->state = DSH_ACTIVE;
+			if ((conn[conn_cnt].fd =
+			     _mux_connect(thd->nodelist)) < 0) {
+				thd->state = DSH_NO_RESP;
+				fail_errno[fail_cnt] = errno;
+				failed[fail_cnt++] = next++;
+				continue;
+			}
+			conn[conn_cnt].inx = next++;
+			conn[conn_cnt].sent = 0;
+			conn[conn_cnt].deadline = now + timeout;
+			conn_cnt++;
+		}
+		if (conn_cnt == 0)
+			continue;
+
+		/* Connections are kept in the order started, and all have the
+		 * same timeout, so the first one expires first */
+		for (i = 0; i < conn_cnt; i++) {
+			pfd[i].fd = conn[i].fd;
+			pfd[i].events = POLLOUT;
+			pfd[i].revents = 0;
+		}
+		rc = poll(pfd, conn_cnt,
+			  MAX(conn[0].deadline - now, 0) * 1000 + 100);
+		if ((rc < 0) && (errno != EINTR))
+			error("_send_multiplex: poll: %m");
+
+		now = time(NULL);
+		for (i = 0, j = 0; i < conn_cnt; i++) {
+			thd_t *thd = &thread_ptr[conn[i].inx];
+			rc = 0;
+			if (pfd[i].revents)
+				rc = _mux_send(&conn[i], data, size);
+			if ((rc == 0) && (now >= conn[i].deadline)) {
+				errno = ETIMEDOUT;
+				rc = -1;
+			}
+			if (rc == 0) {
+				conn[j++] = conn[i];
+				continue;
+			}
+			if (rc > 0) {
+				thd->state = DSH_DONE;
+			} else {
+				debug2("_send_multiplex: msg_type=%u to %s: %m",
+				       agent_ptr->msg_type, thd->nodelist);
+				thd->state = DSH_NO_RESP;
+				fail_errno[fail_cnt] = errno;
+				failed[fail_cnt++] = conn[i].inx;
+			}
+			thd->end_time = (time_t) difftime(now,
+							  thd->start_time);
+			close(conn[i].fd);
+		}
+		conn_cnt = j;
+	}
+
+	if (fail_cnt) {
+		lock_slurmctld(node_read_lock);
+		for (i = 0; i < fail_cnt; i++) {
+			errno = fail_errno[i];
+			_comm_err(thread_ptr[failed[i]].nodelist,
+				  agent_ptr->msg_type);
+		}
+		unlock_slurmctld(node_read_lock);
+	}
+
+	xfree(conn);
+	xfree(pfd);
+	xfree(failed);
+	xfree(fail_errno);
+	xfree(data);
+}
+
 /*
  * Signal handler.  We are really interested in interrupting hung communictions
  * and causing them to return EINTR. Multiple interupts might be required.
@@ -46,6 +46,8 @@
 
 #define AGENT_THREAD_COUNT	10	/* maximum active threads per agent */
 #define COMMAND_TIMEOUT 	30	/* command requeue or error, seconds */
+#define AGENT_MULTIPLEX_CNT	512	/* maximum connections in progress by
+					 * one agent sending without threads */
 #define MAX_AGENT_CNT		(MAX_SERVER_THREADS / (AGENT_THREAD_COUNT + 2))
 					/* maximum simultaneous agents, note
 					 *   total thread count is product of
@@ -51,6 +51,7 @@
 
 #include <grp.h>
 #include <errno.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -118,6 +119,8 @@
 				 * 2 = recover state saved from last shutdown */
 #define MIN_CHECKIN_TIME  3	/* Nodes have this number of seconds to
 				 * check-in before we ping them */
+#define RPC_ARENA_SIZE    (16 * 1024) /* Memory allocated at a time to unpack
+				 * RPCs, see _rpc_worker() */
 #define SHUTDOWN_WAIT     2	/* Time to wait for backup server shutdown */
 
 #if (0)
@@ -176,10 +179,21 @@ static int	debug_level = 0;
 static char	*debug_logfile = NULL;
 static bool     dump_core = false;
 static uint32_t max_server_threads = MAX_SERVER_THREADS;
+static uint32_t max_rpc_conns = MAX_RPC_CONNS;
 static int	new_nice = 0;
 static char	node_name[MAX_SLURM_NAME];
 static int	recover   = DEFAULT_RECOVER;
 static pthread_cond_t server_thread_cond = PTHREAD_COND_INITIALIZER;
+
+/* RPC queue priority lanes, see _rpc_lane() */
+#define RPC_LANE_HIGH	0	/* node registration, job completion, etc. */
+#define RPC_LANE_NORMAL	1
+#define RPC_LANE_LOW	2	/* bulk information requests */
+#define RPC_LANE_CNT	3
+
+/* Count of RPCs taken in a row from a lane while a lower priority lane
+ * has queued RPCs, prevents starvation of the lower priority lanes */
+static const int rpc_lane_burst[RPC_LANE_CNT] = { 16, 4, 1 };
 static pid_t	slurmctld_pid;
 static char    *slurm_conf_filename;
 static int      primary = 1 ;
@@ -209,7 +223,6 @@ static void         _remove_qos(slurmdb_qos_rec_t *rec);
 static void         _update_assoc(slurmdb_association_rec_t *rec);
 static void         _update_qos(slurmdb_qos_rec_t *rec);
 inline static int   _report_locks_set(void);
-static void *       _service_connection(void *arg);
 static void         _set_work_dir(void);
 static int          _shutdown_backup_controller(int wait_time);
 static void *       _slurmctld_background(void *no_data);
@@ -220,12 +233,34 @@ inline static void  _update_cred_key(void);
 static void         _update_nice(void);
 inline static void  _usage(char *prog_name);
 static bool         _valid_controller(void);
-static bool         _wait_for_server_thread(void);
 
 typedef struct connection_arg {
 	int newsockfd;
+	time_t start_time;	/* time connection was accepted */
+	uint32_t msg_len;	/* message length, once fully read */
+	int len_read;		/* bytes of message length read */
+	char *msg_buf;		/* message data */
+	uint32_t msg_alloc;	/* bytes allocated to msg_buf */
+	uint32_t msg_read;	/* bytes of message data read */
+	struct connection_arg *next;	/* next RPC in queue lane */
 } connection_arg_t;
 
+static pthread_mutex_t  rpc_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   rpc_queue_cond = PTHREAD_COND_INITIALIZER;
+static connection_arg_t *rpc_queue_head[RPC_LANE_CNT];
+static connection_arg_t *rpc_queue_tail[RPC_LANE_CNT];
+static int              rpc_lane_served[RPC_LANE_CNT];
+static bool             rpc_queue_shutdown = false;
+
+static void         _free_conn(connection_arg_t *conn);
+static int          _read_conn_msg(connection_arg_t *conn);
+static void         _rpc_enqueue(connection_arg_t *conn);
+static connection_arg_t *_rpc_dequeue(void);
+static int          _rpc_lane(connection_arg_t *conn);
+static void *       _rpc_worker(void *no_data);
+static void         _service_connection(connection_arg_t *conn,
+					xarena_t *arena);
+
 time_t last_proc_req_start = 0;
 time_t next_stats_reset = 0;
 
@@ -883,7 +918,8 @@ static void _sig_handler(int signal)
 {
 }
 
-/* _slurmctld_rpc_mgr - Read incoming RPCs and create pthread for each */
+/* _slurmctld_rpc_mgr - Read incoming RPCs and queue them for processing
+ *	by a pool of _rpc_worker threads */
 static void *_slurmctld_rpc_mgr(void *no_data)
 {
 	slurm_fd_t newsockfd;
@@ -893,10 +929,12 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	char ip[32];
 	pthread_t thread_id_rpc_req;
 	pthread_attr_t thread_attr_rpc_req;
-	int no_thread;
-	int fd_next = 0, i, nports;
-	fd_set rfds;
-	connection_arg_t *conn_arg = NULL;
+	int i, j, nports, nfds, rc, worker_cnt, conn_cnt = 0, timeout;
+	struct pollfd *ufds;
+	connection_arg_t **conns;
+	time_t now, last_print_time = 0;
+	bool busy;
+	int msg_timeout = slurm_get_msg_timeout();
 	/* Locks: Read config */
 	slurmctld_lock_t config_read_lock = {
 		READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK };
@@ -943,13 +981,28 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 			return NULL;	/* Fix CLANG false positive */
 		}
 		fd_set_close_on_exec(sockfd[i]);
+		fd_set_nonblocking(sockfd[i]);
 		slurm_get_stream_addr(sockfd[i], &srv_addr);
 		slurm_get_ip_str(&srv_addr, &port, ip, sizeof(ip));
 		debug2("slurmctld listening on %s:%d", ip, ntohs(port));
 	}
 	unlock_slurmctld(config_read_lock);
 
-	/* Prepare to catch SIGUSR1 to interrupt accept().
+	/* start the pool of threads which process queued RPCs */
+	rpc_queue_shutdown = false;
+	worker_cnt = MIN(max_server_threads, MAX_RPC_WORKERS);
+	for (i = 0; i < worker_cnt; i++) {
+		while (pthread_create(&thread_id_rpc_req,
+				      &thread_attr_rpc_req,
+				      _rpc_worker, NULL)) {
+			error("pthread_create: %m");
+			sleep(1);
+		}
+	}
+	ufds  = xmalloc(sizeof(struct pollfd) * (nports + max_rpc_conns));
+	conns = xmalloc(sizeof(connection_arg_t *) * max_rpc_conns);
+
+	/* Prepare to catch SIGUSR1 to interrupt poll().
 	 * This signal is generated by the slurmctld signal
 	 * handler thread upon receipt of SIGABRT, SIGINT,
 	 * or SIGTERM. That thread does all processing of
@@ -960,61 +1013,130 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	/*
 	 * Process incoming RPCs until told to shutdown
 	 */
-	while (_wait_for_server_thread()) {
-		int max_fd = -1;
-		FD_ZERO(&rfds);
-		for (i=0; i<nports; i++) {
-			FD_SET(sockfd[i], &rfds);
-			max_fd = MAX(sockfd[i], max_fd);
-		}
-		if (select(max_fd+1, &rfds, NULL, NULL, NULL) == -1) {
-			if (errno != EINTR)
-				error("slurm_accept_msg_conn select: %m");
-			_free_server_thread();
+	while (!slurmctld_config.shutdown_time) {
+		/* Connections being read plus RPCs queued or in progress
+		 * are limited to max_rpc_conns. Stop accepting new
+		 * connections at that limit. */
+		slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+		busy = ((slurmctld_config.server_thread_count + conn_cnt) >=
+			max_rpc_conns);
+		if (busy && (conn_cnt == 0)) {
+			/* wait for state change and retry,
+			 * just a delay and not an error.
+			 * This can happen when the epilog completes
+			 * on a bunch of nodes at the same time, which
+			 * can easily happen for highly parallel jobs. */
+			now = time(NULL);
+			if (difftime(now, last_print_time) > 2) {
+				verbose("server_thread_count over "
+					"limit (%d), waiting",
+					slurmctld_config.server_thread_count);
+				last_print_time = now;
+			}
+			pthread_cond_wait(&server_thread_cond,
+					  &slurmctld_config.thread_count_lock);
+			slurm_mutex_unlock(&slurmctld_config.
+					   thread_count_lock);
 			continue;
 		}
-		/* find one to process */
-		for (i=0; i<nports; i++) {
-			if (FD_ISSET(sockfd[(fd_next+i) % nports], &rfds)) {
-				i = (fd_next + i) % nports;
-				break;
+		slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+
+		nfds = 0;
+		if (!busy) {
+			for (i = 0; i < nports; i++) {
+				ufds[nfds].fd = sockfd[i];
+				ufds[nfds].events = POLLIN;
+				nfds++;
 			}
 		}
-		fd_next = (i + 1) % nports;
-
-		/*
-		 * accept needed for stream implementation is a no-op in
-		 * message implementation that just passes sockfd to newsockfd
-		 */
-		if ((newsockfd = slurm_accept_msg_conn(sockfd[i],
-						       &cli_addr)) ==
-		    SLURM_SOCKET_ERROR) {
+		for (i = 0; i < conn_cnt; i++) {
+			ufds[nfds].fd = conns[i]->newsockfd;
+			ufds[nfds].events = POLLIN;
+			nfds++;
+		}
+		/* Poll briefly if at the limit so new connections can be
+		 * accepted as soon as RPCs complete */
+		timeout = busy ? 100 : 1000;
+		if ((rc = poll(ufds, nfds, timeout)) == -1) {
 			if (errno != EINTR)
-				error("slurm_accept_msg_conn: %m");
-			_free_server_thread();
+				error("slurmctld poll: %m");
+			continue;
+		}
+		now = time(NULL);
+
+		/* read data of pending connections, queue complete RPCs */
+		for (i = 0, j = busy ? 0 : nports; i < conn_cnt; j++) {
+			if (ufds[j].revents)
+				rc = _read_conn_msg(conns[i]);
+			else if (difftime(now, conns[i]->start_time) >
+				 msg_timeout) {
+				error("slurmctld: timeout reading RPC on "
+				      "fd %d", conns[i]->newsockfd);
+				rc = -1;
+			} else
+				rc = 0;
+			if (rc == 0) {
+				i++;
+				continue;
+			}
+			if (rc > 0) {
+				_rpc_enqueue(conns[i]);
+			} else {
+				slurm_close_accepted_conn(conns[i]->newsockfd);
+				_free_conn(conns[i]);
+			}
+			conns[i] = conns[--conn_cnt];
+			/* conns[i] now holds the last connection, which is
+			 * polled at the last ufds index */
+			ufds[j--] = ufds[nfds - 1];
+			nfds--;
 			continue;
 		}
-		fd_set_close_on_exec(newsockfd);
-		conn_arg = xmalloc(sizeof(connection_arg_t));
-		conn_arg->newsockfd = newsockfd;
-		if (slurmctld_config.shutdown_time)
-			no_thread = 1;
-		else if (pthread_create(&thread_id_rpc_req,
-					&thread_attr_rpc_req,
-					_service_connection,
-					(void *) conn_arg)) {
-			error("pthread_create: %m");
-			no_thread = 1;
-		} else
-			no_thread = 0;
 
-		if (no_thread) {
-			slurmctld_diag_stats.proc_req_raw++;
-		       	_service_connection((void *) conn_arg);
-	       	}
+		/* accept new connections */
+		for (i = 0; !busy && (i < nports); i++) {
+			if (!ufds[i].revents)
+				continue;
+			while ((slurmctld_config.server_thread_count +
+				conn_cnt) < max_rpc_conns) {
+				/*
+				 * accept needed for stream implementation is
+				 * a no-op in message implementation that just
+				 * passes sockfd to newsockfd
+				 */
+				newsockfd = slurm_accept_msg_conn(sockfd[i],
+								  &cli_addr);
+				if (newsockfd == SLURM_SOCKET_ERROR) {
+					if ((errno != EAGAIN) &&
+					    (errno != EWOULDBLOCK) &&
+					    (errno != EINTR))
+						error("slurm_accept_msg_conn: "
+						      "%m");
+					break;
+				}
+				fd_set_close_on_exec(newsockfd);
+				fd_set_nonblocking(newsockfd);
+				conns[conn_cnt] =
+					xmalloc(sizeof(connection_arg_t));
+				conns[conn_cnt]->newsockfd = newsockfd;
+				conns[conn_cnt]->start_time = now;
+				conn_cnt++;
+			}
+		}
 	}
 
 	debug3("_slurmctld_rpc_mgr shutting down");
+	for (i = 0; i < conn_cnt; i++) {
+		slurm_close_accepted_conn(conns[i]->newsockfd);
+		_free_conn(conns[i]);
+	}
+	xfree(conns);
+	xfree(ufds);
+	/* workers exit once the RPCs already queued are processed */
+	slurm_mutex_lock(&rpc_queue_lock);
+	rpc_queue_shutdown = true;
+	pthread_cond_broadcast(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_lock);
 	slurm_attr_destroy(&thread_attr_rpc_req);
 	for (i=0; i<nports; i++)
 		(void) slurm_shutdown_msg_engine(sockfd[i]);
@@ -1024,29 +1146,233 @@ static void *_slurmctld_rpc_mgr(void *no_data)
 	return NULL;
 }
 
+static void _free_conn(connection_arg_t *conn)
+{
+	xfree(conn->msg_buf);
+	xfree(conn);
+}
+
+/* Read the data available for a connection's RPC without blocking.
+ * RET 1 if the RPC has been fully read, 0 if more data is needed,
+ *	-1 on error or end of file */
+static int _read_conn_msg(connection_arg_t *conn)
+{
+	ssize_t len;
+	char *ptr;
+	size_t size;
+
+	while (1) {
+		if (conn->len_read < sizeof(conn->msg_len)) {
+			ptr  = (char *) &conn->msg_len + conn->len_read;
+			size = sizeof(conn->msg_len) - conn->len_read;
+		} else if (conn->msg_read < conn->msg_len) {
+			/* The length is not authenticated, so only grow the
+			 * buffer as data actually arrives */
+			if (conn->msg_read == conn->msg_alloc) {
+				conn->msg_alloc = MIN(conn->msg_alloc * 2,
+						      conn->msg_len);
+				xrealloc(conn->msg_buf, conn->msg_alloc);
+			}
+			ptr  = conn->msg_buf + conn->msg_read;
+			size = conn->msg_alloc - conn->msg_read;
+		} else
+			return 1;
+
+		len = read(conn->newsockfd, ptr, size);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return 0;
+			error("slurmctld: read RPC on fd %d: %m",
+			      conn->newsockfd);
+			return -1;
+		} else if (len == 0) {
+			debug("slurmctld: connection on fd %d closed before "
+			      "RPC was read", conn->newsockfd);
+			return -1;
+		}
+
+		if (conn->len_read < sizeof(conn->msg_len)) {
+			conn->len_read += len;
+			if (conn->len_read < sizeof(conn->msg_len))
+				continue;
+			conn->msg_len = ntohl(conn->msg_len);
+			if (conn->msg_len > SLURM_PROTOCOL_MAX_MSG_SIZE) {
+				error("slurmctld: %s on fd %d",
+				      slurm_strerror(
+					      SLURM_PROTOCOL_INSANE_MSG_LENGTH),
+				      conn->newsockfd);
+				return -1;
+			}
+			conn->msg_alloc = MIN(conn->msg_len, BUF_SIZE);
+			conn->msg_buf = xmalloc(conn->msg_alloc);
+		} else
+			conn->msg_read += len;
+	}
+}
+
+/* Return the priority lane for a fully read RPC */
+static int _rpc_lane(connection_arg_t *conn)
+{
+	uint16_t version, flags, msg_type;
+	Buf buffer;
+	int lane = RPC_LANE_NORMAL;
+
+	/* The message type follows the protocol version and flags in the
+	 * message header, see pack_header() */
+	buffer = create_buf(conn->msg_buf, conn->msg_len);
+	if (unpack16(&version, buffer) || unpack16(&flags, buffer) ||
+	    unpack16(&msg_type, buffer))
+		msg_type = 0;
+	buffer->head = NULL;	/* data still belongs to conn */
+	free_buf(buffer);
+
+	switch (msg_type) {
+	case MESSAGE_NODE_REGISTRATION_STATUS:
+	case MESSAGE_EPILOG_COMPLETE:
+	case REQUEST_COMPLETE_BATCH_SCRIPT:
+	case REQUEST_COMPLETE_JOB_ALLOCATION:
+	case REQUEST_COMPLETE_PROLOG:
+	case REQUEST_STEP_COMPLETE:
+	case REQUEST_CONTROL:
+	case REQUEST_TAKEOVER:
+	case REQUEST_SHUTDOWN:
+	case REQUEST_SHUTDOWN_IMMEDIATE:
+	case REQUEST_PING:
+		lane = RPC_LANE_HIGH;
+		break;
+	case REQUEST_BUILD_INFO:
+	case REQUEST_JOB_INFO:
+	case REQUEST_JOB_INFO_DELTA:
+	case REQUEST_JOB_INFO_SINGLE:
+	case REQUEST_JOB_USER_INFO:
+	case REQUEST_JOB_STEP_INFO:
+	case REQUEST_NODE_INFO:
+	case REQUEST_NODE_INFO_SINGLE:
+	case REQUEST_PARTITION_INFO:
+	case REQUEST_RESERVATION_INFO:
+	case REQUEST_FRONT_END_INFO:
+	case REQUEST_BLOCK_INFO:
+	case REQUEST_LICENSE_INFO:
+	case REQUEST_SHARE_INFO:
+	case REQUEST_PRIORITY_FACTORS:
+	case REQUEST_TOPO_INFO:
+	case REQUEST_TRIGGER_GET:
+	case REQUEST_STATS_INFO:
+		lane = RPC_LANE_LOW;
+		break;
+	}
+	return lane;
+}
+
+/* Queue a fully read RPC for processing by an _rpc_worker thread.
+ * It counts as a server thread until processed. */
+static void _rpc_enqueue(connection_arg_t *conn)
+{
+	int lane = _rpc_lane(conn);
+
+	/* RPC processing uses blocking I/O */
+	fd_set_blocking(conn->newsockfd);
+
+	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
+	slurmctld_config.server_thread_count++;
+	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
+
+	slurm_mutex_lock(&rpc_queue_lock);
+	conn->next = NULL;
+	if (rpc_queue_tail[lane])
+		rpc_queue_tail[lane]->next = conn;
+	else
+		rpc_queue_head[lane] = conn;
+	rpc_queue_tail[lane] = conn;
+	pthread_cond_signal(&rpc_queue_cond);
+	slurm_mutex_unlock(&rpc_queue_lock);
+}
+
+/* Return the next RPC to process, waiting for one if needed.
+ * Higher priority lanes are served first, but at most rpc_lane_burst RPCs
+ * in a row while a lower priority lane has queued RPCs.
+ * RET NULL once shutdown is in progress and the queue is empty */
+static connection_arg_t *_rpc_dequeue(void)
+{
+	connection_arg_t *conn = NULL;
+	int lane, lower;
+
+	slurm_mutex_lock(&rpc_queue_lock);
+	while (1) {
+		for (lane = 0; lane < RPC_LANE_CNT; lane++) {
+			if (!rpc_queue_head[lane])
+				continue;
+			if (rpc_lane_served[lane] < rpc_lane_burst[lane])
+				break;
+			for (lower = lane + 1; lower < RPC_LANE_CNT; lower++) {
+				if (rpc_queue_head[lower])
+					break;
+			}
+			if (lower == RPC_LANE_CNT)
+				break;
+		}
+		if (lane < RPC_LANE_CNT)
+			break;
+		if (rpc_queue_shutdown) {
+			slurm_mutex_unlock(&rpc_queue_lock);
+			return NULL;
+		}
+		pthread_cond_wait(&rpc_queue_cond, &rpc_queue_lock);
+	}
+
+	conn = rpc_queue_head[lane];
+	rpc_queue_head[lane] = conn->next;
+	if (!rpc_queue_head[lane])
+		rpc_queue_tail[lane] = NULL;
+	rpc_lane_served[lane]++;
+	for (lower = 0; lower < lane; lower++)
+		rpc_lane_served[lower] = 0;
+	slurm_mutex_unlock(&rpc_queue_lock);
+
+	return conn;
+}
+
+/* _rpc_worker - process queued RPCs until shutdown
+ * The data of common RPCs is unpacked into an arena which is reset after
+ * each RPC rather than freeing its strings and arrays one at a time */
+static void *_rpc_worker(void *no_data)
+{
+	connection_arg_t *conn;
+	xarena_t *arena = xarena_create(RPC_ARENA_SIZE);
+
+	while ((conn = _rpc_dequeue()))
+		_service_connection(conn, arena);
+
+	xarena_destroy(arena);
+	return NULL;
+}
+
 /*
  * _service_connection - service the RPC
- * IN/OUT arg - really just the connection's file descriptor, freed
+ * IN/OUT conn - connection and the RPC read from it, freed
  *	upon completion
- * RET - NULL
+ * IN arena - arena to unpack the RPC into, reset upon completion
  */
-static void *_service_connection(void *arg)
+static void _service_connection(connection_arg_t *conn, xarena_t *arena)
 {
-	connection_arg_t *conn = (connection_arg_t *) arg;
-	void *return_code = NULL;
 	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
 
-	slurm_msg_t_init(msg);
 	/*
-	 * slurm_receive_msg sets msg connection fd to accepted fd. This allows
-	 * possibility for slurmctld_req() to close accepted connection.
+	 * slurm_unpack_received_msg sets msg connection fd to accepted fd.
+	 * This allows possibility for slurmctld_req() to close accepted
+	 * connection.
 	 */
-	if (slurm_receive_msg(conn->newsockfd, msg, 0) != 0) {
+	if (slurm_unpack_received_msg(msg, conn->newsockfd, conn->msg_buf,
+				      conn->msg_len, arena) != 0) {
+		conn->msg_buf = NULL;
 		error("slurm_receive_msg: %m");
 		/* close the new socket */
 		slurm_close_accepted_conn(conn->newsockfd);
 		goto cleanup;
 	}
+	conn->msg_buf = NULL;
 
 	if (errno != SLURM_SUCCESS) {
 		if (errno == SLURM_PROTOCOL_VERSION_ERROR) {
@@ -1063,52 +1389,9 @@ static void *_service_connection(void *arg)
 
 cleanup:
 	slurm_free_msg(msg);
-	xfree(arg);
+	xarena_reset(arena);
+	_free_conn(conn);
 	_free_server_thread();
-	return return_code;
-}
-
-/* Increment slurmctld_config.server_thread_count and don't return
- * until its value is no larger than MAX_SERVER_THREADS,
- * RET true unless shutdown in progress */
-static bool _wait_for_server_thread(void)
-{
-	bool print_it = true;
-	bool rc = true;
-
-	slurm_mutex_lock(&slurmctld_config.thread_count_lock);
-	while (1) {
-		if (slurmctld_config.shutdown_time) {
-			rc = false;
-			break;
-		}
-		if (slurmctld_config.server_thread_count < max_server_threads) {
-			slurmctld_config.server_thread_count++;
-			break;
-		} else {
-			/* wait for state change and retry,
-			 * just a delay and not an error.
-			 * This can happen when the epilog completes
-			 * on a bunch of nodes at the same time, which
-			 * can easily happen for highly parallel jobs. */
-			if (print_it) {
-				static time_t last_print_time = 0;
-				time_t now = time(NULL);
-				if (difftime(now, last_print_time) > 2) {
-					verbose("server_thread_count over "
-						"limit (%d), waiting",
-						slurmctld_config.
-						server_thread_count);
-					last_print_time = now;
-				}
-				print_it = false;
-			}
-			pthread_cond_wait(&server_thread_cond,
-					  &slurmctld_config.thread_count_lock);
-		}
-	}
-	slurm_mutex_unlock(&slurmctld_config.thread_count_lock);
-	return rc;
 }
 
 static void _free_server_thread(void)
@@ -2200,6 +2483,8 @@ static void *_assoc_cache_mgr(void *no_data)
 	}
 	list_iterator_destroy(itr);
 	unlock_slurmctld(job_write_lock);
+	/* QOS names packed with the cached job information may differ */
+	purge_job_info_cache();
 	/* This needs to be after the lock and after we update the
 	   jobs so if we need to send them we are set. */
 	_accounting_cluster_ready();
@@ -2281,13 +2566,22 @@ static void _test_thread_limit(void)
 #ifdef RLIMIT_NOFILE
 {
 	struct rlimit rlim[1];
-	if (getrlimit(RLIMIT_NOFILE, rlim) < 0)
+	if (getrlimit(RLIMIT_NOFILE, rlim) < 0) {
 		error("Unable to get file count limit");
-	else if ((rlim->rlim_cur != RLIM_INFINITY) &&
-		 (max_server_threads > rlim->rlim_cur)) {
-		max_server_threads = rlim->rlim_cur;
-		info("Reducing max_server_thread to %u due to file count limit "
-		     "of %u", max_server_threads, max_server_threads);
+	} else if (rlim->rlim_cur != RLIM_INFINITY) {
+		if (max_server_threads > rlim->rlim_cur) {
+			max_server_threads = rlim->rlim_cur;
+			info("Reducing max_server_thread to %u due to file "
+			     "count limit of %u",
+			     max_server_threads, max_server_threads);
+		}
+		/* Leave half of the files for agents and state files */
+		if (max_rpc_conns > (rlim->rlim_cur / 2)) {
+			max_rpc_conns = MAX((rlim->rlim_cur / 2), 1);
+			info("Reducing max_rpc_conns to %u due to file count "
+			     "limit of %u",
+			     max_rpc_conns, (uint32_t) rlim->rlim_cur);
+		}
 	}
 }
 #endif
@@ -1,7 +1,7 @@
 /*****************************************************************************\
  *  job_mgr.c - manage the job information of slurm
  *	Note: there is a global job list (job_list), time stamp
- *	(last_job_update), and hash table (job_hash)
+ *	(last_job_update), and hash tables (job_id_hash, job_array_hash)
  *****************************************************************************
  *  Copyright (C) 2002-2007 The Regents of the University of California.
  *  Copyright (C) 2008-2010 Lawrence Livermore National Security.
@@ -102,18 +102,68 @@
 #define STEP_FLAG 0xbbbb
 #define TOP_PRIORITY 0xffff0000	/* large, but leave headroom for higher */
 
-#define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
+/* Job hash tables are kept at most this full, larger ones are grown and
+ * tables which become less than 1/8 full are shrunk */
+#define JOB_HASH_LOAD(_size)	(((_size) / 4) * 3)
+#define JOB_HASH_MIN_SIZE	64
+/* Multiplier for Fibonacci hashing of job hash keys, spreads sequential
+ * job IDs evenly over the table */
+#define JOB_HASH_MULT		0x9e3779b97f4a7c15ULL
+/* Key of a job array task, or of the first task with NO_VAL as task ID */
+#define JOB_ARRAY_KEY(_job_id, _task_id) \
+	((((uint64_t) (_job_id)) << 32) | (uint64_t) (_task_id))
 
 /* Change JOB_STATE_VERSION value when changing the state save format */
-#define JOB_STATE_VERSION       "VER015"
-#define JOB_14_03_STATE_VERSION "VER015"	/* SLURM version 14.03 */
+#define JOB_STATE_VERSION       "VER016"
+#define JOB_14_03_STATE_VERSION "VER016"	/* SLURM version 14.03 */
+#define JOB_14_03_PRE_STATE_VERSION "VER015"	/* SLURM version 14.03.0pre5,
+						 * job records not framed */
 #define JOB_2_6_STATE_VERSION   "VER014"	/* SLURM version 2.6 */
 #define JOB_2_5_STATE_VERSION   "VER013"	/* SLURM version 2.5 */
 
+/* Job state journal record types, see _dump_job_journal() */
+#define JOURNAL_JOB_UPDATE	1
+#define JOURNAL_JOB_PURGE	2
+
+/* Rewrite job_state rather than append to its journal once the journal
+ * grows to be this large and also as large as the last job_state file */
+#define JOURNAL_MIN_COMPACT_SIZE (1024 * 1024)
+
+/* Jobs checked for the job_state journal per job read lock, which is
+ * released between groups so writers are not held off for a full pass */
+#define JOURNAL_JOBS_PER_LOCK	256
+
+/* Maximum count of packed REQUEST_JOB_INFO responses kept, one is needed for
+ * each combination of protocol version, show flags and partition visibility
+ * in active use */
+#define JOB_INFO_CACHE_SIZE	8
+/* Users recorded per cached job information record, see
+ * pack_all_jobs_snapshot() */
+#define JOB_INFO_CACHE_UIDS	16
+
+/* Seconds to remember the IDs of purged jobs for job information delta
+ * requests, older cursors get the full job table */
+#define JOB_TOMBSTONE_AGE	600
+
 #define JOB_CKPT_VERSION      "JOB_CKPT_002"
 #define JOB_2_2_CKPT_VERSION  "JOB_CKPT_002"	/* SLURM version 2.2 */
 #define JOB_2_1_CKPT_VERSION  "JOB_CKPT_001"	/* SLURM version 2.1 */
 
+/* Open addressing hash table of job records with linear probing. The key
+ * is kept with the record pointer so probes do not touch the job records */
+typedef struct {
+	uint64_t key;
+	struct job_record *job_ptr;	/* NULL if slot is empty */
+} job_hash_slot_t;
+
+typedef struct {
+	job_hash_slot_t *slot;
+	uint32_t size;			/* slot count, a power of two */
+	uint32_t count;			/* slots in use */
+	uint32_t min_size;		/* never shrink below this size */
+	int      shift;			/* 64 - log2(size) */
+} job_hash_t;
+
 /* Global variables */
 List   job_list = NULL;		/* job_record list */
 time_t last_job_update;		/* time of last update to job records */
@@ -121,15 +171,88 @@ time_t last_job_update;		/* time of last update to job records */
 /* Local variables */
 static uint32_t highest_prio = 0;
 static uint32_t lowest_prio  = TOP_PRIORITY;
-static int      hash_table_size = 0;
 static int      job_count = 0;		/* job's in the system */
 static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
-static struct   job_record **job_hash = NULL;
+static job_hash_t job_id_hash;		/* job records by job_id */
+static job_hash_t job_array_hash;	/* job array tasks by array_job_id and
+					 * array_task_id, see JOB_ARRAY_KEY */
+static uint32_t job_pack_size = 0;	/* mean bytes per job packed by last
+					 * pack_all_jobs(), to size buffer */
 static bool     wiki_sched = false;
 static bool     wiki2_sched = false;
 static bool     wiki_sched_test = false;
+static uint32_t job_state_gen = 0;	/* generation of job_state file */
+static bool     job_journal_valid = false; /* journal matches job_state */
+static uint32_t job_journal_size = 0;	/* bytes in job_state.journal */
+static uint32_t job_journal_id_seq = 0;	/* job_id_sequence last journaled */
+static uint32_t job_snapshot_size = 0;	/* bytes in job_state */
+static List     job_purge_list = NULL;	/* IDs of saved jobs since purged */
+static List     job_tombstone_list = NULL; /* purged jobs, job_tombstone_t */
+static time_t   job_tombstone_horizon = 0; /* purged jobs before this time
+					    * are not in job_tombstone_list */
+static time_t   job_info_scan_time = 0;	/* last update of job info_update */
+static time_t   job_info_scan_expire = 0; /* pending job begin time reached,
+					   * info_update must be rescanned */
+static uint32_t job_info_scan_seq = 0;	/* job_save_seq at the last scan */
+static uint32_t job_save_seq = 0;	/* job state saves completed */
+static time_t   job_save_time = 0;	/* start of the last job state save */
+
+/* Job state journal record, see _load_job_journal() */
+typedef struct job_journal_rec {
+	uint32_t job_id;
+	uint16_t type;		/* JOURNAL_JOB_* */
+	uint32_t offset;	/* offset of job state in journal buffer */
+	bool     used;		/* loaded in place of a job_state record */
+	int      next;		/* index of next record in hash chain */
+} job_journal_rec_t;
+
+typedef struct job_journal {
+	Buf buffer;			/* journal file contents */
+	job_journal_rec_t *rec;		/* latest record for each job,
+					 * in order of first appearance */
+	int rec_cnt;
+	int *hash;			/* index of first record by job ID */
+	int hash_size;
+	uint32_t job_id_sequence;	/* from last complete batch */
+} job_journal_t;
+
+/* Purged job record, see pack_jobs_delta() */
+typedef struct job_tombstone {
+	uint32_t job_id;
+	time_t   purge_time;
+} job_tombstone_t;
+
+/* Packed REQUEST_JOB_INFO response, see pack_all_jobs_cached() */
+typedef struct job_info_cache {
+	uint16_t protocol_version;
+	uint16_t show_flags;
+	bitstr_t *hidden_parts;		/* partitions hidden from the requester,
+					 * NULL if no partition filtering */
+	time_t   job_update;		/* last_job_update when packed */
+	time_t   part_update;		/* last_part_update when packed */
+	time_t   conf_update;		/* slurmctld_conf.last_update */
+	time_t   expire;		/* time when a job's begin time is
+					 * reached or it becomes too old to
+					 * report, 0 if never */
+	char    *data;
+	int      size;
+	int      ref_cnt;		/* cache plus responders using data */
+	uid_t    uids[JOB_INFO_CACHE_UIDS];	/* users known to see this
+						 * partition visibility */
+	int      uid_cnt;
+	struct job_info_cache *next;
+} job_info_cache_t;
+
+static job_info_cache_t *job_info_cache = NULL;
+static uint32_t job_info_cache_gen = 0;	/* incremented by
+					 * purge_job_info_cache() */
+/* Serializes job info_update scans and job_tombstone_list purges, which are
+ * made under the job read lock, see pack_jobs_delta() */
+static pthread_mutex_t job_info_scan_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t job_info_cache_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /* Local functions */
+static void _add_job_array_hash(struct job_record *job_ptr);
 static void _add_job_hash(struct job_record *job_ptr);
 static int  _checkpoint_job_record (struct job_record *job_ptr,
 				    char *image_dir);
@@ -143,16 +266,28 @@ static int  _copy_job_desc_to_job_record(job_desc_msg_t * job_desc,
 static job_desc_msg_t * _copy_job_record_to_job_desc(
 				struct job_record *job_ptr);
 static char *_copy_nodelist_no_dup(char *node_list);
+static int  _create_job_journal(uint32_t gen);
 static void _del_batch_list_rec(void *x);
+static void _del_job_tombstone(void *x);
 static void _delete_job_desc_files(uint32_t job_id);
 static slurmdb_qos_rec_t *_determine_and_validate_qos(
 	char *resv_name, slurmdb_association_rec_t *assoc_ptr,
 	bool admin, slurmdb_qos_rec_t *qos_rec,	int *error_code);
 static void _dump_job_details(struct job_details *detail_ptr,
 			      Buf buffer);
+static int  _dump_job_journal(uint32_t *lock_usec);
+static uint32_t _dump_job_purges(Buf buffer);
+static int  _dump_job_snapshot(uint32_t *lock_usec);
 static void _dump_job_state(struct job_record *dump_job_ptr, Buf buffer);
+static bool _dump_job_state_rec(struct job_record *job_ptr, Buf buffer);
 static int  _find_batch_dir(void *x, void *key);
+static job_journal_rec_t *_find_journal_rec(job_journal_t *journal,
+					    uint32_t job_id);
+static void _free_job_journal(job_journal_t *journal);
+static void _free_job_info_cache(job_info_cache_t *cache_ptr);
 static void _get_batch_job_dir_ids(List batch_dirs);
+static void _job_save_lock_held(struct timeval *lock_time,
+				uint32_t *hold_max);
 static void _job_timed_out(struct job_record *job_ptr);
 static int  _job_create(job_desc_msg_t * job_specs, int allocate, int will_run,
 			struct job_record **job_rec_ptr, uid_t submit_uid,
@@ -162,12 +297,19 @@ static int  _list_find_job_id(void *job_entry, void *key);
 static int  _list_find_job_old(void *job_entry, void *key);
 static int  _load_job_details(struct job_record *job_ptr, Buf buffer,
 			      uint16_t protocol_version);
+static job_journal_t *_load_job_journal(uint32_t gen, uint32_t *disk_gen);
+static int  _load_journal_job(job_journal_t *journal,
+			      job_journal_rec_t *rec_ptr);
 static int  _load_job_state(Buf buffer,	uint16_t protocol_version);
 static uint32_t _max_switch_wait(uint32_t input_wait);
 static void _notify_srun_missing_step(struct job_record *job_ptr, int node_inx,
 				      time_t now, time_t node_boot_time);
+static uint64_t _job_state_sum(char *data, uint32_t size);
 static int  _open_job_state_file(char **state_file);
 static void _pack_job_for_ckpt (struct job_record *job_ptr, Buf buffer);
+static void _pack_all_jobs(char **buffer_ptr, int *buffer_size,
+			   uint16_t show_flags, uid_t uid, uint32_t filter_uid,
+			   uint16_t protocol_version, time_t *expire);
 static void _pack_default_job_details(struct job_record *job_ptr,
 				      Buf buffer,
 				      uint16_t protocol_version);
@@ -175,13 +317,17 @@ static void _pack_pending_job_details(struct job_details *detail_ptr,
 				      Buf buffer,
 				      uint16_t protocol_version);
 static int  _purge_job_record(uint32_t job_id);
+static void _purge_job_info_cache(time_t now, bool purge_all);
 static void _purge_missing_jobs(int node_inx, time_t now);
+static void _purge_job_tombstones(time_t now);
+static void _scan_job_info(time_t now);
 static void _read_data_array_from_file(char *file_name, char ***data,
 				       uint32_t * size,
  				       struct job_record *job_ptr);
 static void _read_data_from_file(char *file_name, char **data);
 static char *_read_job_ckpt_file(char *ckpt_file, int *size_ptr);
 static void _remove_defunct_batch_dirs(List batch_dirs);
+static void _remove_job_array_hash(struct job_record *job_ptr);
 static int  _reset_detail_bitmaps(struct job_record *job_ptr);
 static void _reset_step_bitmaps(struct job_record *job_ptr);
 static int  _resume_job_nodes(struct job_record *job_ptr, bool indf_susp);
@@ -206,6 +352,7 @@ static int  _validate_job_desc(job_desc_msg_t * job_desc_msg, int allocate,
                                List part_list);
 static void _validate_job_files(List batch_dirs);
 static int  _write_data_to_file(char *file_name, char *data);
+static int  _write_job_state_data(int fd, Buf buffer, char *file_name);
 static int  _write_data_array_to_file(char *file_name, char **data,
 				      uint32_t size);
 static void _xmit_new_end_time(struct job_record *job_ptr);
@@ -432,8 +579,214 @@ static slurmdb_qos_rec_t *_determine_and_validate_qos(
  * dump_all_job_state - save the state of all jobs to file for checkpoint
  *	Changes here should be reflected in load_last_job_id() and
  *	load_all_job_state().
+ *	Normally only the records of jobs which changed or were purged since
+ *	the last save are appended to the job_state.journal file. The full
+ *	job_state file is rewritten and a new journal started after slurmctld
+ *	starts, after any error writing the journal, or once the journal
+ *	grows as large as the job_state file.
  * RET 0 or error code */
 int dump_all_job_state(void)
+{
+	int error_code;
+	uint32_t lock_usec = 0;
+	DEF_TIMERS;
+
+	START_TIMER;
+	slurm_mutex_lock(&job_info_scan_lock);
+	job_save_time = time(NULL);
+	slurm_mutex_unlock(&job_info_scan_lock);
+	if (!job_journal_valid ||
+	    ((job_journal_size >= JOURNAL_MIN_COMPACT_SIZE) &&
+	     (job_journal_size >= job_snapshot_size)))
+		error_code = _dump_job_snapshot(&lock_usec);
+	else
+		error_code = _dump_job_journal(&lock_usec);
+	END_TIMER2("dump_all_job_state");
+
+	/* The jobs' state_save_sum may have changed, see _scan_job_info() */
+	slurm_mutex_lock(&job_info_scan_lock);
+	job_save_seq++;
+	slurm_mutex_unlock(&job_info_scan_lock);
+
+	slurmctld_diag_stats.job_save_cnt++;
+	slurmctld_diag_stats.job_save_last = DELTA_TIMER;
+	slurmctld_diag_stats.job_save_sum += DELTA_TIMER;
+	if (slurmctld_diag_stats.job_save_max < DELTA_TIMER)
+		slurmctld_diag_stats.job_save_max = DELTA_TIMER;
+	slurmctld_diag_stats.job_save_lock_last = lock_usec;
+	if (slurmctld_diag_stats.job_save_lock_max < lock_usec)
+		slurmctld_diag_stats.job_save_lock_max = lock_usec;
+	return error_code;
+}
+
+/* Record in hold_max the time in microseconds since the job lock was taken
+ * at lock_time, if longer */
+static void _job_save_lock_held(struct timeval *lock_time, uint32_t *hold_max)
+{
+	struct timeval now;
+	uint32_t hold;
+
+	gettimeofday(&now, NULL);
+	hold = (now.tv_sec - lock_time->tv_sec) * 1000000 +
+	       (now.tv_usec - lock_time->tv_usec);
+	if (*hold_max < hold)
+		*hold_max = hold;
+}
+
+/* Write a buffer's data to a state save file, return 0 or error code */
+static int _write_job_state_data(int fd, Buf buffer, char *file_name)
+{
+	int pos = 0, nwrite, amount;
+	char *data;
+
+	nwrite = get_buf_offset(buffer);
+	data = (char *)get_buf_data(buffer);
+	while (nwrite > 0) {
+		amount = write(fd, &data[pos], nwrite);
+		if ((amount < 0) && (errno != EINTR)) {
+			error("Error writing file %s, %m", file_name);
+			return errno;
+		}
+		nwrite -= amount;
+		pos    += amount;
+	}
+	return SLURM_SUCCESS;
+}
+
+/*
+ * _dump_job_state_rec - dump the state of a specific job to a buffer as a
+ *	record of job ID, byte count and _dump_job_state() data, and record
+ *	its checksum in the job's state_save_sum
+ * IN job_ptr - pointer to job for which information is requested
+ * IN/OUT buffer - location to store data, pointers automatically advanced
+ * RET true if the job's state differs from that last saved
+ */
+static bool _dump_job_state_rec(struct job_record *job_ptr, Buf buffer)
+{
+	uint32_t size_offset, start_offset, end_offset;
+	uint64_t sum;
+
+	pack32(job_ptr->job_id, buffer);
+	size_offset = get_buf_offset(buffer);
+	pack32((uint32_t) 0, buffer);	/* place holder for byte count */
+	start_offset = get_buf_offset(buffer);
+	_dump_job_state(job_ptr, buffer);
+	end_offset = get_buf_offset(buffer);
+
+	set_buf_offset(buffer, size_offset);
+	pack32(end_offset - start_offset, buffer);
+	set_buf_offset(buffer, end_offset);
+
+	sum = _job_state_sum(get_buf_data(buffer) + start_offset,
+			     end_offset - start_offset);
+	if (sum == job_ptr->state_save_sum)
+		return false;
+	job_ptr->state_save_sum = sum;
+	return true;
+}
+
+/*
+ * _job_state_sum - compute a checksum of a job's packed state (64-bit
+ *	MurmurHash64A), used to identify jobs which changed since last saved
+ * RET checksum, never zero
+ */
+static uint64_t _job_state_sum(char *data, uint32_t size)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ULL;
+	const int r = 47;
+	uint64_t h = 0x8445d61a4e774912ULL ^ ((uint64_t) size * m);
+	uint64_t k;
+	unsigned char *tail;
+	char *end = data + (size & ~7);
+
+	while (data != end) {
+		memcpy(&k, data, sizeof(k));
+		data += sizeof(k);
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+
+	tail = (unsigned char *) data;
+	switch (size & 7) {
+	case 7: h ^= (uint64_t) tail[6] << 48;
+	case 6: h ^= (uint64_t) tail[5] << 40;
+	case 5: h ^= (uint64_t) tail[4] << 32;
+	case 4: h ^= (uint64_t) tail[3] << 24;
+	case 3: h ^= (uint64_t) tail[2] << 16;
+	case 2: h ^= (uint64_t) tail[1] << 8;
+	case 1: h ^= (uint64_t) tail[0];
+		h *= m;
+	}
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+	if (h == 0)
+		h = 1;
+	return h;
+}
+
+/*
+ * _create_job_journal - create an empty job_state.journal file for the
+ *	job_state file of the specified generation
+ * NOTE: Call with state files locked
+ * RET 0 or error code
+ */
+static int _create_job_journal(uint32_t gen)
+{
+	int error_code = 0, log_fd, rc;
+	char *new_file, *reg_file;
+	Buf buffer = init_buf(BUF_SIZE);
+
+	/* write header: version, generation */
+	packstr(JOB_STATE_VERSION, buffer);
+	pack32(gen, buffer);
+
+	reg_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(reg_file, "/job_state.journal");
+	new_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(new_file, "/job_state.journal.new");
+
+	log_fd = creat(new_file, 0600);
+	if (log_fd < 0) {
+		error("Can't save state, create file %s error %m",
+		      new_file);
+		error_code = errno;
+	} else {
+		fd_set_close_on_exec(log_fd);
+		error_code = _write_job_state_data(log_fd, buffer, new_file);
+		rc = fsync_and_close(log_fd, "job journal");
+		if (rc && !error_code)
+			error_code = rc;
+	}
+	if (error_code)
+		(void) unlink(new_file);
+	else {			/* file shuffle */
+		(void) unlink(reg_file);
+		if (link(new_file, reg_file))
+			debug4("unable to create link for %s -> %s: %m",
+			       new_file, reg_file);
+		(void) unlink(new_file);
+		job_journal_size = get_buf_offset(buffer);
+		job_journal_valid = true;
+	}
+	xfree(reg_file);
+	xfree(new_file);
+	free_buf(buffer);
+
+	return error_code;
+}
+
+/*
+ * _dump_job_snapshot - save the state of all jobs to a new job_state file
+ *	and start a new, empty journal for it
+ * OUT lock_usec - set to the time the job lock was held, in microseconds
+ * RET 0 or error code
+ */
+static int _dump_job_snapshot(uint32_t *lock_usec)
 {
 	/* Save high-water mark to avoid buffer growth with copies */
 	static int high_buffer_size = (1024 * 1024);
@@ -447,9 +800,17 @@ int dump_all_job_state(void)
 	struct job_record *job_ptr;
 	Buf buffer = init_buf(high_buffer_size);
 	time_t min_age = 0, now = time(NULL);
-	DEF_TIMERS;
+	uint32_t disk_gen = 0, gen;
+	struct timeval lock_time;
+
+	/* The new generation must not match that of any journal on disk,
+	 * else a crash before its replacement would replay stale records */
+	if (job_state_gen == 0)
+		_free_job_journal(_load_job_journal(0, &disk_gen));
+	gen = MAX((uint32_t) now, MAX(job_state_gen, disk_gen) + 1);
+	job_state_gen = gen;
+	job_journal_valid = false;
 
-	START_TIMER;
 	/* write header: version, time */
 	packstr(JOB_STATE_VERSION, buffer);
 	pack_time(now, buffer);
@@ -463,22 +824,34 @@ int dump_all_job_state(void)
 	 * slurmctld is restarted.
 	 */
 	pack32( job_id_sequence, buffer);
+	job_journal_id_seq = job_id_sequence;
 
 	debug3("Writing job id %u to header record of job_state file",
 	       job_id_sequence);
 
-	/* write individual job records */
+	/* write header: generation, identifies the matching journal */
+	pack32(gen, buffer);
+
+	/* write individual job records, all under one lock since the file
+	 * can not record jobs purged meanwhile */
 	lock_slurmctld(job_read_lock);
+	gettimeofday(&lock_time, NULL);
 	job_iterator = list_iterator_create(job_list);
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		xassert (job_ptr->magic == JOB_MAGIC);
 		if ((min_age > 0) && (job_ptr->end_time < min_age) &&
-		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr))
-			continue;	/* job ready for purging, don't dump */
+		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr)) {
+			/* job ready for purging, don't dump */
+			job_ptr->state_save_sum = 0;
+			continue;
+		}
 
-		_dump_job_state(job_ptr, buffer);
+		(void) _dump_job_state_rec(job_ptr, buffer);
 	}
 	list_iterator_destroy(job_iterator);
+	/* Jobs purged to this point are absent from the new job_state */
+	if (job_purge_list)
+		list_flush(job_purge_list);
 
 	/* write the buffer to file */
 	old_file = xstrdup(slurmctld_conf.state_save_location);
@@ -487,6 +860,7 @@ int dump_all_job_state(void)
 	xstrcat(reg_file, "/job_state");
 	new_file = xstrdup(slurmctld_conf.state_save_location);
 	xstrcat(new_file, "/job_state.new");
+	_job_save_lock_held(&lock_time, lock_usec);
 	unlock_slurmctld(job_read_lock);
 
 	if (stat(reg_file, &stat_buf) == 0) {
@@ -511,23 +885,12 @@ int dump_all_job_state(void)
 		      new_file);
 		error_code = errno;
 	} else {
-		int pos = 0, nwrite, amount, rc;
-		char *data;
+		int rc;
 
 		fd_set_close_on_exec(log_fd);
-		nwrite = get_buf_offset(buffer);
-		data = (char *)get_buf_data(buffer);
-		high_buffer_size = MAX(nwrite, high_buffer_size);
-		while (nwrite > 0) {
-			amount = write(log_fd, &data[pos], nwrite);
-			if ((amount < 0) && (errno != EINTR)) {
-				error("Error writing file %s, %m", new_file);
-				error_code = errno;
-				break;
-			}
-			nwrite -= amount;
-			pos    += amount;
-		}
+		high_buffer_size = MAX(get_buf_offset(buffer),
+				       high_buffer_size);
+		error_code = _write_job_state_data(log_fd, buffer, new_file);
 
 		rc = fsync_and_close(log_fd, "job");
 		if (rc && !error_code)
@@ -545,6 +908,8 @@ int dump_all_job_state(void)
 			debug4("unable to create link for %s -> %s: %m",
 			       new_file, reg_file);
 		(void) unlink(new_file);
+		job_snapshot_size = get_buf_offset(buffer);
+		error_code = _create_job_journal(gen);
 	}
 	xfree(old_file);
 	xfree(reg_file);
@@ -552,7 +917,159 @@ int dump_all_job_state(void)
 	unlock_state_files();
 
 	free_buf(buffer);
-	END_TIMER2("dump_all_job_state");
+	return error_code;
+}
+
+/* Pack a purge record for each job in job_purge_list, emptying it
+ * RET count of records packed */
+static uint32_t _dump_job_purges(Buf buffer)
+{
+	uint32_t *job_id_ptr, rec_cnt = 0;
+
+	while (job_purge_list && (job_id_ptr = list_pop(job_purge_list))) {
+		pack16((uint16_t) JOURNAL_JOB_PURGE, buffer);
+		pack32(*job_id_ptr, buffer);
+		pack32((uint32_t) 0, buffer);
+		xfree(job_id_ptr);
+		rec_cnt++;
+	}
+	return rec_cnt;
+}
+
+/*
+ * _dump_job_journal - append to the job_state.journal file a batch of
+ *	records for jobs whose state changed or which were purged since the
+ *	last save. The job IDs are copied first, then the jobs are checked in
+ *	groups of JOURNAL_JOBS_PER_LOCK, each under its own job read lock.
+ * OUT lock_usec - set to the longest time the job lock was held, in
+ *	microseconds
+ * RET 0 or error code
+ */
+static int _dump_job_journal(uint32_t *lock_usec)
+{
+	int error_code = 0, log_fd, rc;
+	char *journal_file;
+	/* Locks: Read config and job */
+	slurmctld_lock_t job_read_lock =
+		{ READ_LOCK, READ_LOCK, NO_LOCK, NO_LOCK };
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+	Buf buffer = init_buf(BUF_SIZE);
+	uint32_t *job_ids, job_cnt = 0, i = 0, j;
+	uint32_t id_seq = 0, rec_cnt = 0;
+	uint32_t seq_offset, rec_offset, batch_size;
+	time_t min_age = 0, now = time(NULL);
+	struct timeval lock_time;
+
+	if (slurmctld_conf.min_job_age > 0)
+		min_age = now  - slurmctld_conf.min_job_age;
+
+	/* write batch header: byte count, time, job id, record count */
+	pack32((uint32_t) 0, buffer);	/* place holder for byte count */
+	pack_time(now, buffer);
+	seq_offset = get_buf_offset(buffer);
+	pack32((uint32_t) 0, buffer);	/* place holder for job id */
+	pack32((uint32_t) 0, buffer);	/* place holder for record count */
+
+	lock_slurmctld(job_read_lock);
+	gettimeofday(&lock_time, NULL);
+	job_ids = xmalloc(sizeof(uint32_t) * (list_count(job_list) + 1));
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator)))
+		job_ids[job_cnt++] = job_ptr->job_id;
+	list_iterator_destroy(job_iterator);
+	_job_save_lock_held(&lock_time, lock_usec);
+	unlock_slurmctld(job_read_lock);
+
+	while (1) {
+		lock_slurmctld(job_read_lock);
+		gettimeofday(&lock_time, NULL);
+
+		/* Purge records precede update records so that a job ID
+		 * re-used after its purge is recovered */
+		rec_cnt += _dump_job_purges(buffer);
+
+		for (j = 0; (j < JOURNAL_JOBS_PER_LOCK) && (i < job_cnt);
+		     i++, j++) {
+			/* NULL if purged since, see job_purge_list */
+			if (!(job_ptr = find_job_record(job_ids[i])))
+				continue;
+			xassert (job_ptr->magic == JOB_MAGIC);
+			if ((min_age > 0) && (job_ptr->end_time < min_age) &&
+			    (! IS_JOB_COMPLETING(job_ptr)) &&
+			    IS_JOB_FINISHED(job_ptr)) {
+				/* job ready for purging, don't dump */
+				if (job_ptr->state_save_sum) {
+					pack16((uint16_t) JOURNAL_JOB_PURGE,
+					       buffer);
+					pack32(job_ptr->job_id, buffer);
+					pack32((uint32_t) 0, buffer);
+					job_ptr->state_save_sum = 0;
+					rec_cnt++;
+				}
+				continue;
+			}
+
+			rec_offset = get_buf_offset(buffer);
+			pack16((uint16_t) JOURNAL_JOB_UPDATE, buffer);
+			if (_dump_job_state_rec(job_ptr, buffer))
+				rec_cnt++;
+			else	/* unchanged since last saved */
+				set_buf_offset(buffer, rec_offset);
+		}
+		/* taken last, so it is at least every job ID recorded */
+		if (i >= job_cnt)
+			id_seq = job_id_sequence;
+
+		_job_save_lock_held(&lock_time, lock_usec);
+		unlock_slurmctld(job_read_lock);
+		if (i >= job_cnt)
+			break;
+	}
+	xfree(job_ids);
+
+	if ((rec_cnt == 0) && (id_seq == job_journal_id_seq)) {
+		free_buf(buffer);
+		return SLURM_SUCCESS;
+	}
+
+	batch_size = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack32(batch_size - sizeof(uint32_t), buffer);
+	set_buf_offset(buffer, seq_offset);
+	pack32(id_seq, buffer);
+	pack32(rec_cnt, buffer);
+	set_buf_offset(buffer, batch_size);
+
+	journal_file = xstrdup(slurmctld_conf.state_save_location);
+	xstrcat(journal_file, "/job_state.journal");
+	lock_state_files();
+	log_fd = open(journal_file, O_WRONLY | O_APPEND);
+	if (log_fd < 0) {
+		error("Can't save state, open file %s error %m",
+		      journal_file);
+		error_code = errno;
+	} else {
+		fd_set_close_on_exec(log_fd);
+		error_code = _write_job_state_data(log_fd, buffer,
+						   journal_file);
+		rc = fsync_and_close(log_fd, "job journal");
+		if (rc && !error_code)
+			error_code = rc;
+	}
+	if (error_code) {
+		/* The journal may now end with a partial batch, which is
+		 * ignored on recovery. Rewrite job_state on the next save. */
+		job_journal_valid = false;
+	} else {
+		job_journal_size += batch_size;
+		job_journal_id_seq = id_seq;
+	}
+	unlock_state_files();
+	xfree(journal_file);
+
+	debug3("Appended %u job records to job_state journal", rec_cnt);
+	free_buf(buffer);
 	return error_code;
 }
 
@@ -599,10 +1116,18 @@ extern int load_all_job_state(void)
 	char *data = NULL, *state_file;
 	Buf buffer;
 	time_t buf_time;
-	uint32_t saved_job_id;
+	uint32_t saved_job_id, gen = 0, disk_gen = 0, job_id, rec_size;
+	uint32_t rec_end = 0;
 	char *ver_str = NULL;
 	uint32_t ver_str_len;
 	uint16_t protocol_version = (uint16_t)NO_VAL;
+	bool framed = false;
+	job_journal_t *journal = NULL;
+	job_journal_rec_t *rec_ptr;
+	int i;
+
+	/* Rewrite job_state on the first save after recovery */
+	job_journal_valid = false;
 
 	/* read the file */
 	lock_state_files();
@@ -643,7 +1168,10 @@ extern int load_all_job_state(void)
 	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
 	debug3("Version string in job_state header is %s", ver_str);
 	if (ver_str) {
-		if (!strcmp(ver_str, JOB_STATE_VERSION))
+		if (!strcmp(ver_str, JOB_STATE_VERSION)) {
+			protocol_version = SLURM_PROTOCOL_VERSION;
+			framed = true;
+		} else if (!strcmp(ver_str, JOB_14_03_PRE_STATE_VERSION))
 			protocol_version = SLURM_PROTOCOL_VERSION;
 		else if (!strcmp(ver_str, JOB_2_6_STATE_VERSION))
 			protocol_version = SLURM_2_6_PROTOCOL_VERSION;
@@ -666,14 +1194,54 @@ extern int load_all_job_state(void)
 	job_id_sequence = MAX(saved_job_id, job_id_sequence);
 	debug3("Job id in job_state header is %u", saved_job_id);
 
+	if (framed) {
+		safe_unpack32(&gen, buffer);
+		journal = _load_job_journal(gen, &disk_gen);
+		job_state_gen = MAX(gen, disk_gen);
+		if (journal) {
+			job_id_sequence = MAX(journal->job_id_sequence,
+					      job_id_sequence);
+		}
+	}
+
 	while (remaining_buf(buffer) > 0) {
+		if (framed) {
+			safe_unpack32(&job_id, buffer);
+			safe_unpack32(&rec_size, buffer);
+			if (rec_size > remaining_buf(buffer))
+				goto unpack_error;
+			rec_end = get_buf_offset(buffer) + rec_size;
+			rec_ptr = _find_journal_rec(journal, job_id);
+			if (rec_ptr) {
+				/* Journal has the job's latest state */
+				rec_ptr->used = true;
+				set_buf_offset(buffer, rec_end);
+				if ((rec_ptr->type == JOURNAL_JOB_UPDATE) &&
+				    (_load_journal_job(journal, rec_ptr) ==
+				     SLURM_SUCCESS))
+					job_cnt++;
+				continue;
+			}
+		}
 		error_code = _load_job_state(buffer, protocol_version);
 		if (error_code != SLURM_SUCCESS)
 			goto unpack_error;
+		if (framed)
+			set_buf_offset(buffer, rec_end);
 		job_cnt++;
 	}
+
+	/* Load jobs submitted since job_state was written */
+	for (i = 0; journal && (i < journal->rec_cnt); i++) {
+		rec_ptr = &journal->rec[i];
+		if (rec_ptr->used || (rec_ptr->type != JOURNAL_JOB_UPDATE))
+			continue;
+		if (_load_journal_job(journal, rec_ptr) == SLURM_SUCCESS)
+			job_cnt++;
+	}
 	debug3("Set job_id_sequence to %u", job_id_sequence);
 
+	_free_job_journal(journal);
 	free_buf(buffer);
 	info("Recovered information about %d jobs", job_cnt);
 	return error_code;
@@ -681,6 +1249,7 @@ extern int load_all_job_state(void)
 unpack_error:
 	error("Incomplete job data checkpoint file");
 	info("Recovered information about %d jobs", job_cnt);
+	_free_job_journal(journal);
 	free_buf(buffer);
 	return SLURM_FAILURE;
 }
@@ -699,8 +1268,10 @@ extern int load_last_job_id( void )
 	Buf buffer;
 	time_t buf_time;
 	char *ver_str = NULL;
-	uint32_t ver_str_len;
+	uint32_t ver_str_len, gen, disk_gen;
 	uint16_t protocol_version = (uint16_t)NO_VAL;
+	bool framed = false;
+	job_journal_t *journal;
 
 	/* read the file */
 	state_file = slurm_get_state_save_location();
@@ -742,7 +1313,10 @@ extern int load_last_job_id( void )
 	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
 	debug3("Version string in job_state header is %s", ver_str);
 	if (ver_str) {
-		if (!strcmp(ver_str, JOB_STATE_VERSION))
+		if (!strcmp(ver_str, JOB_STATE_VERSION)) {
+			protocol_version = SLURM_PROTOCOL_VERSION;
+			framed = true;
+		} else if (!strcmp(ver_str, JOB_14_03_PRE_STATE_VERSION))
 			protocol_version = SLURM_PROTOCOL_VERSION;
 		else if (!strcmp(ver_str, JOB_2_6_STATE_VERSION))
 			protocol_version = SLURM_2_6_PROTOCOL_VERSION;
@@ -763,6 +1337,17 @@ extern int load_last_job_id( void )
 	safe_unpack32( &job_id_sequence, buffer);
 	debug3("Job ID in job_state header is %u", job_id_sequence);
 
+	/* Jobs may have been submitted since job_state was written */
+	if (framed) {
+		safe_unpack32(&gen, buffer);
+		journal = _load_job_journal(gen, &disk_gen);
+		if (journal) {
+			job_id_sequence = MAX(journal->job_id_sequence,
+					      job_id_sequence);
+			_free_job_journal(journal);
+		}
+	}
+
 	/* Ignore the state for individual jobs stored here */
 
 	free_buf(buffer);
@@ -774,6 +1359,185 @@ unpack_error:
 	return SLURM_FAILURE;
 }
 
+/*
+ * _load_job_journal - read the job_state.journal file and index the latest
+ *	record of each job in it
+ * IN gen - generation of the job_state file being recovered, a journal of
+ *	any other generation is stale and ignored
+ * OUT disk_gen - generation of the journal file, zero if none
+ * RET journal or NULL if none, free with _free_job_journal()
+ */
+static job_journal_t *_load_job_journal(uint32_t gen, uint32_t *disk_gen)
+{
+	int data_allocated, data_read = 0;
+	uint32_t data_size = 0;
+	int state_fd, i;
+	char *data = NULL, *state_file;
+	Buf buffer;
+	time_t batch_time;
+	char *ver_str = NULL;
+	uint32_t ver_str_len, journal_gen, batch_size, batch_end;
+	uint32_t data_start, data_end, job_id_seq, rec_cnt, total_cnt = 0;
+	uint32_t job_id, rec_size;
+	uint16_t type;
+	job_journal_t *journal = NULL;
+	job_journal_rec_t *rec_ptr;
+
+	*disk_gen = 0;
+
+	/* read the file */
+	state_file = slurm_get_state_save_location();
+	xstrcat(state_file, "/job_state.journal");
+	lock_state_files();
+	state_fd = open(state_file, O_RDONLY);
+	if (state_fd < 0) {
+		debug("No job state journal (%s) to recover", state_file);
+		xfree(state_file);
+		unlock_state_files();
+		return NULL;
+	}
+	data_allocated = BUF_SIZE;
+	data = xmalloc(data_allocated);
+	while (1) {
+		data_read = read(state_fd, &data[data_size], BUF_SIZE);
+		if (data_read < 0) {
+			if (errno == EINTR)
+				continue;
+			else {
+				error("Read error on %s: %m", state_file);
+				break;
+			}
+		} else if (data_read == 0)	/* eof */
+			break;
+		data_size      += data_read;
+		data_allocated += data_read;
+		xrealloc(data, data_allocated);
+	}
+	close(state_fd);
+	xfree(state_file);
+	unlock_state_files();
+
+	buffer = create_buf(data, data_size);
+	safe_unpackstr_xmalloc(&ver_str, &ver_str_len, buffer);
+	safe_unpack32(&journal_gen, buffer);
+	*disk_gen = journal_gen;
+	if (!ver_str || strcmp(ver_str, JOB_STATE_VERSION) ||
+	    (journal_gen != gen)) {
+		debug("Ignoring job state journal of generation %u, "
+		      "job_state generation is %u", journal_gen, gen);
+		xfree(ver_str);
+		free_buf(buffer);
+		return NULL;
+	}
+	xfree(ver_str);
+
+	journal = xmalloc(sizeof(job_journal_t));
+	journal->buffer = buffer;
+
+	/* Find the last complete batch, a crash while appending can leave
+	 * a partial one at the end */
+	data_start = data_end = get_buf_offset(buffer);
+	while (remaining_buf(buffer) >= sizeof(uint32_t)) {
+		safe_unpack32(&batch_size, buffer);
+		if (batch_size > remaining_buf(buffer))
+			break;
+		batch_end = get_buf_offset(buffer) + batch_size;
+		safe_unpack_time(&batch_time, buffer);
+		safe_unpack32(&job_id_seq, buffer);
+		safe_unpack32(&rec_cnt, buffer);
+		/* each record has at least a type, job ID and byte count */
+		if (rec_cnt > (batch_size / 10))
+			goto unpack_error;
+		total_cnt += rec_cnt;
+		journal->job_id_sequence = job_id_seq;
+		set_buf_offset(buffer, batch_end);
+		data_end = batch_end;
+	}
+	if (remaining_buf(buffer))
+		error("Ignoring incomplete record in job state journal");
+
+	journal->hash_size = MAX(total_cnt, 1);
+	journal->hash = xmalloc(sizeof(int) * journal->hash_size);
+	for (i = 0; i < journal->hash_size; i++)
+		journal->hash[i] = -1;
+	journal->rec = xmalloc(sizeof(job_journal_rec_t) * journal->hash_size);
+
+	set_buf_offset(buffer, data_start);
+	while (get_buf_offset(buffer) < data_end) {
+		safe_unpack32(&batch_size, buffer);
+		safe_unpack_time(&batch_time, buffer);
+		safe_unpack32(&job_id_seq, buffer);
+		safe_unpack32(&rec_cnt, buffer);
+		for (i = 0; i < rec_cnt; i++) {
+			safe_unpack16(&type, buffer);
+			safe_unpack32(&job_id, buffer);
+			safe_unpack32(&rec_size, buffer);
+			if (rec_size > remaining_buf(buffer))
+				goto unpack_error;
+			rec_ptr = _find_journal_rec(journal, job_id);
+			if (rec_ptr == NULL) {
+				int inx = job_id % journal->hash_size;
+				rec_ptr = &journal->rec[journal->rec_cnt];
+				rec_ptr->job_id = job_id;
+				rec_ptr->next = journal->hash[inx];
+				journal->hash[inx] = journal->rec_cnt++;
+			}
+			rec_ptr->type = type;
+			rec_ptr->offset = get_buf_offset(buffer);
+			set_buf_offset(buffer, rec_ptr->offset + rec_size);
+		}
+	}
+	debug3("Recovered %u records for %d jobs from job state journal",
+	       total_cnt, journal->rec_cnt);
+	return journal;
+
+unpack_error:
+	error("Invalid job state journal, ignoring remaining records");
+	xfree(ver_str);
+	if (journal == NULL) {
+		free_buf(buffer);
+	} else if (journal->hash == NULL) {
+		_free_job_journal(journal);
+		journal = NULL;
+	}
+	return journal;
+}
+
+/* Find a job's latest record in the journal, NULL if none */
+static job_journal_rec_t *_find_journal_rec(job_journal_t *journal,
+					    uint32_t job_id)
+{
+	int i;
+
+	if (journal == NULL)
+		return NULL;
+
+	for (i = journal->hash[job_id % journal->hash_size]; i >= 0;
+	     i = journal->rec[i].next) {
+		if (journal->rec[i].job_id == job_id)
+			return &journal->rec[i];
+	}
+	return NULL;
+}
+
+/* Load a job's state from its journal record */
+static int _load_journal_job(job_journal_t *journal,
+			     job_journal_rec_t *rec_ptr)
+{
+	set_buf_offset(journal->buffer, rec_ptr->offset);
+	return _load_job_state(journal->buffer, SLURM_PROTOCOL_VERSION);
+}
+
+static void _free_job_journal(job_journal_t *journal)
+{
+	if (journal == NULL)
+		return;
+	free_buf(journal->buffer);
+	xfree(journal->hash);
+	xfree(journal->rec);
+	xfree(journal);
+}
+
 /*
  * _dump_job_state - dump the state of a specific job, its details, and
  *	steps to a buffer
@@ -1461,8 +2225,10 @@ static int _load_job_state(Buf buffer, uint16_t protocol_version)
 	alloc_node             = NULL;	/* reused, nothing left to free */
 	job_ptr->alloc_resp_port = alloc_resp_port;
 	job_ptr->alloc_sid    = alloc_sid;
+	_remove_job_array_hash(job_ptr);
 	job_ptr->array_job_id = array_job_id;
 	job_ptr->array_task_id = array_task_id;
+	_add_job_array_hash(job_ptr);
 	job_ptr->assoc_id     = assoc_id;
 	job_ptr->batch_flag   = batch_flag;
 	xfree(job_ptr->batch_host);
@@ -2014,29 +2780,151 @@ static int _load_job_details(struct job_record *job_ptr, Buf buffer,
 
 	return SLURM_SUCCESS;
 
-unpack_error:
+unpack_error:
+
+/*	for (i=0; i<argc; i++)
+	xfree(argv[i]);  Don't trust this on unpack error */
+	xfree(acctg_freq);
+	xfree(argv);
+	xfree(cpu_bind);
+	xfree(dependency);
+	xfree(orig_dependency);
+/*	for (i=0; i<env_cnt; i++)
+	xfree(env_sup[i]);  Don't trust this on unpack error */
+	xfree(env_sup);
+	xfree(err);
+	xfree(exc_nodes);
+	xfree(features);
+	xfree(in);
+	xfree(mem_bind);
+	xfree(out);
+	xfree(req_nodes);
+	xfree(work_dir);
+	xfree(ckpt_dir);
+	xfree(restart_dir);
+	return SLURM_FAILURE;
+}
+
+/* Size a job hash table to hold at least cnt records, rehashing any
+ * records already in it */
+static void _job_hash_resize(job_hash_t *hash, uint32_t cnt)
+{
+	job_hash_slot_t *old_slot = hash->slot;
+	uint32_t old_size = hash->size, i, inx, mask;
+	uint32_t size = JOB_HASH_MIN_SIZE;
+	int shift = 64 - 6;	/* JOB_HASH_MIN_SIZE == (1 << 6) */
+
+	while (((size < hash->min_size) || (JOB_HASH_LOAD(size) < cnt)) &&
+	       (size < 0x80000000)) {
+		size <<= 1;
+		shift--;
+	}
+	if (size == old_size)
+		return;
+
+	hash->slot  = xmalloc(size * sizeof(job_hash_slot_t));
+	hash->size  = size;
+	hash->shift = shift;
+	mask = size - 1;
+	for (i = 0; i < old_size; i++) {
+		if (!old_slot[i].job_ptr)
+			continue;
+		inx = (uint32_t) ((old_slot[i].key * JOB_HASH_MULT) >> shift);
+		while (hash->slot[inx].job_ptr)
+			inx = (inx + 1) & mask;
+		hash->slot[inx] = old_slot[i];
+	}
+	xfree(old_slot);
+}
+
+/* Return the slot index of key in a job hash table, -1 if not found */
+static int _job_hash_inx(job_hash_t *hash, uint64_t key)
+{
+	uint32_t inx, mask;
+
+	if (hash->count == 0)
+		return -1;
+	mask = hash->size - 1;
+	inx = (uint32_t) ((key * JOB_HASH_MULT) >> hash->shift);
+	while (hash->slot[inx].job_ptr) {
+		if (hash->slot[inx].key == key)
+			return (int) inx;
+		inx = (inx + 1) & mask;
+	}
+	return -1;
+}
+
+static struct job_record *_job_hash_find(job_hash_t *hash, uint64_t key)
+{
+	int inx = _job_hash_inx(hash, key);
+
+	if (inx < 0)
+		return NULL;
+	return hash->slot[inx].job_ptr;
+}
+
+/* Add a job record to a job hash table, replacing any record with the same
+ * key. The table is grown as needed. */
+static void _job_hash_insert(job_hash_t *hash, uint64_t key,
+			     struct job_record *job_ptr)
+{
+	uint32_t inx, mask;
+
+	if (hash->count >= JOB_HASH_LOAD(hash->size))
+		_job_hash_resize(hash, hash->count + 1);
+	mask = hash->size - 1;
+	inx = (uint32_t) ((key * JOB_HASH_MULT) >> hash->shift);
+	while (hash->slot[inx].job_ptr) {
+		if (hash->slot[inx].key == key) {
+			hash->slot[inx].job_ptr = job_ptr;
+			return;
+		}
+		inx = (inx + 1) & mask;
+	}
+	hash->slot[inx].key = key;
+	hash->slot[inx].job_ptr = job_ptr;
+	hash->count++;
+}
+
+/* Remove a job record from a job hash table. Records which follow it in the
+ * same probe sequence are moved back so lookups need no deleted markers.
+ * RET false if the key is not mapped to this job record */
+static bool _job_hash_remove(job_hash_t *hash, uint64_t key,
+			     struct job_record *job_ptr)
+{
+	uint32_t i, j, home, mask;
+	int inx = _job_hash_inx(hash, key);
+
+	if ((inx < 0) || (hash->slot[inx].job_ptr != job_ptr))
+		return false;
+
+	mask = hash->size - 1;
+	i = j = (uint32_t) inx;
+	while (1) {
+		j = (j + 1) & mask;
+		if (!hash->slot[j].job_ptr)
+			break;
+		home = (uint32_t) ((hash->slot[j].key * JOB_HASH_MULT) >>
+				   hash->shift);
+		/* Leave the record if its home slot is cyclically in (i, j] */
+		if ((i <= j) ? ((i < home) && (home <= j)) :
+			       ((i < home) || (home <= j)))
+			continue;
+		hash->slot[i] = hash->slot[j];
+		i = j;
+	}
+	hash->slot[i].job_ptr = NULL;
+	hash->count--;
+
+	if ((hash->size > hash->min_size) && (hash->count < (hash->size / 8)))
+		_job_hash_resize(hash, hash->count * 2);
+	return true;
+}
 
-/*	for (i=0; i<argc; i++)
-	xfree(argv[i]);  Don't trust this on unpack error */
-	xfree(acctg_freq);
-	xfree(argv);
-	xfree(cpu_bind);
-	xfree(dependency);
-	xfree(orig_dependency);
-/*	for (i=0; i<env_cnt; i++)
-	xfree(env_sup[i]);  Don't trust this on unpack error */
-	xfree(env_sup);
-	xfree(err);
-	xfree(exc_nodes);
-	xfree(features);
-	xfree(in);
-	xfree(mem_bind);
-	xfree(out);
-	xfree(req_nodes);
-	xfree(work_dir);
-	xfree(ckpt_dir);
-	xfree(restart_dir);
-	return SLURM_FAILURE;
+static void _job_hash_free(job_hash_t *hash)
+{
+	xfree(hash->slot);
+	memset(hash, 0, sizeof(job_hash_t));
 }
 
 /* _add_job_hash - add a job hash entry for given job record, job_id must
@@ -2046,11 +2934,77 @@ unpack_error:
  */
 void _add_job_hash(struct job_record *job_ptr)
 {
-	int inx;
+	_job_hash_insert(&job_id_hash, job_ptr->job_id, job_ptr);
+}
+
+/* _add_job_array_hash - add a job array hash entry for given job record and
+ *	append it to the list of its job array's tasks, array_job_id and
+ *	array_task_id must already be set
+ * IN job_ptr - pointer to job record
+ * Globals: job array hash table updated
+ */
+static void _add_job_array_hash(struct job_record *job_ptr)
+{
+	struct job_record *first_ptr;
+
+	if (job_ptr->array_task_id == NO_VAL)
+		return;
+
+	_job_hash_insert(&job_array_hash,
+			 JOB_ARRAY_KEY(job_ptr->array_job_id,
+				       job_ptr->array_task_id), job_ptr);
+	job_ptr->array_next = NULL;
+	first_ptr = _job_hash_find(&job_array_hash,
+				   JOB_ARRAY_KEY(job_ptr->array_job_id,
+						 NO_VAL));
+	if (first_ptr == NULL) {
+		job_ptr->array_prev = job_ptr;
+		_job_hash_insert(&job_array_hash,
+				 JOB_ARRAY_KEY(job_ptr->array_job_id, NO_VAL),
+				 job_ptr);
+	} else {
+		job_ptr->array_prev = first_ptr->array_prev;
+		first_ptr->array_prev->array_next = job_ptr;
+		first_ptr->array_prev = job_ptr;
+	}
+}
+
+/* _remove_job_array_hash - remove a job array hash entry for given job
+ *	record, if any, and remove it from the list of its job array's tasks
+ * IN job_ptr - pointer to job record
+ * Globals: job array hash table updated
+ */
+static void _remove_job_array_hash(struct job_record *job_ptr)
+{
+	struct job_record *first_ptr;
+	uint64_t first_key;
 
-	inx = JOB_HASH_INX(job_ptr->job_id);
-	job_ptr->job_next = job_hash[inx];
-	job_hash[inx] = job_ptr;
+	if ((job_ptr->array_task_id == NO_VAL) ||
+	    !_job_hash_remove(&job_array_hash,
+			      JOB_ARRAY_KEY(job_ptr->array_job_id,
+					    job_ptr->array_task_id), job_ptr))
+		return;
+
+	first_key = JOB_ARRAY_KEY(job_ptr->array_job_id, NO_VAL);
+	first_ptr = _job_hash_find(&job_array_hash, first_key);
+	if (first_ptr == job_ptr) {
+		if (job_ptr->array_next) {
+			job_ptr->array_next->array_prev = job_ptr->array_prev;
+			_job_hash_insert(&job_array_hash, first_key,
+					 job_ptr->array_next);
+		} else {
+			(void) _job_hash_remove(&job_array_hash, first_key,
+						job_ptr);
+		}
+	} else if (first_ptr) {
+		job_ptr->array_prev->array_next = job_ptr->array_next;
+		if (job_ptr->array_next)
+			job_ptr->array_next->array_prev = job_ptr->array_prev;
+		else
+			first_ptr->array_prev = job_ptr->array_prev;
+	}
+	job_ptr->array_next = NULL;
+	job_ptr->array_prev = NULL;
 }
 
 /*
@@ -2063,27 +3017,26 @@ void _add_job_hash(struct job_record *job_ptr)
 extern struct job_record *find_job_array_rec(uint32_t array_job_id,
 					     uint32_t array_task_id)
 {
-	ListIterator job_iterator;
 	struct job_record *job_ptr, *match_job_ptr = NULL;
 
 	if (array_task_id == NO_VAL)
 		return find_job_record(array_job_id);
 
-	job_iterator = list_iterator_create(job_list);
-	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
-		if (job_ptr->array_job_id != array_job_id)
-			continue;
+	if (array_task_id != INFINITE) {
+		return _job_hash_find(&job_array_hash,
+				      JOB_ARRAY_KEY(array_job_id,
+						    array_task_id));
+	}
 
-		if (array_task_id == INFINITE) {
-			match_job_ptr = job_ptr;
-			if (!IS_JOB_FINISHED(job_ptr))
-				break;
-		} else if (job_ptr->array_task_id == array_task_id) {
-			match_job_ptr = job_ptr;
+	/* Return an active task of the job array if there is one */
+	job_ptr = _job_hash_find(&job_array_hash,
+				 JOB_ARRAY_KEY(array_job_id, NO_VAL));
+	while (job_ptr) {
+		match_job_ptr = job_ptr;
+		if (!IS_JOB_FINISHED(job_ptr))
 			break;
-		}
+		job_ptr = job_ptr->array_next;
 	}
-	list_iterator_destroy(job_iterator);
 	return match_job_ptr;
 }
 
@@ -2094,16 +3047,7 @@ extern struct job_record *find_job_array_rec(uint32_t array_job_id,
  */
 struct job_record *find_job_record(uint32_t job_id)
 {
-	struct job_record *job_ptr;
-
-	job_ptr = job_hash[JOB_HASH_INX(job_id)];
-	while (job_ptr) {
-		if (job_ptr->job_id == job_id)
-			return job_ptr;
-		job_ptr = job_ptr->job_next;
-	}
-
-	return NULL;
+	return _job_hash_find(&job_id_hash, job_id);
 }
 
 /* rebuild a job's partition name list based upon the contents of its
@@ -2875,6 +3819,12 @@ int init_job_conf(void)
 		job_count = 0;
 		job_list = list_create(_list_delete_job);
 	}
+	if (job_purge_list == NULL)
+		job_purge_list = list_create(slurm_destroy_uint32_ptr);
+	if (job_tombstone_list == NULL) {
+		job_tombstone_list = list_create(_del_job_tombstone);
+		job_tombstone_horizon = time(NULL);
+	}
 
 	last_job_update = time(NULL);
 	return SLURM_SUCCESS;
@@ -2886,17 +3836,16 @@ int init_job_conf(void)
  */
 extern void rehash_jobs(void)
 {
-	if (job_hash == NULL) {
-		hash_table_size = slurmctld_conf.max_job_cnt;
-		job_hash = (struct job_record **)
-			xmalloc(hash_table_size * sizeof(struct job_record *));
-	} else if (hash_table_size < (slurmctld_conf.max_job_cnt / 2)) {
-		/* If the MaxJobCount grows by too much, the hash table will
-		 * be ineffective without rebuilding. We don't presently bother
-		 * to rebuild the hash table, but cut MaxJobCount back as
-		 * needed. */
-		error ("MaxJobCount reset too high, restart slurmctld");
-		slurmctld_conf.max_job_cnt = hash_table_size;
+	/* The tables grow as needed, but size them for MaxJobCount up front
+	 * so they need not be rebuilt while jobs are submitted. The job
+	 * array table starts small as few jobs are normally array tasks. */
+	job_id_hash.min_size = 0;
+	_job_hash_resize(&job_id_hash,
+			 MAX(slurmctld_conf.max_job_cnt, job_id_hash.count));
+	job_id_hash.min_size = job_id_hash.size;
+	if (job_array_hash.slot == NULL) {
+		_job_hash_resize(&job_array_hash, 0);
+		job_array_hash.min_size = job_array_hash.size;
 	}
 }
 
@@ -2904,7 +3853,7 @@ extern void rehash_jobs(void)
  * Assumes the job has no resource allocaiton */
 struct job_record *_job_rec_copy(struct job_record *job_ptr)
 {
-	struct job_record *job_ptr_new = NULL, *save_job_next;
+	struct job_record *job_ptr_new = NULL;
 	struct job_details *job_details, *details_new, *save_details;
 	uint32_t save_job_id;
 	priority_factors_object_t *save_prio_factors;
@@ -2926,13 +3875,13 @@ struct job_record *_job_rec_copy(struct job_record *job_ptr)
 	/* Copy most of original job data.
 	 * This could be done in parallel, but performance was worse. */
 	save_job_id   = job_ptr_new->job_id;
-	save_job_next = job_ptr_new->job_next;
 	save_details  = job_ptr_new->details;
 	save_prio_factors = job_ptr_new->prio_factors;
 	save_step_list = job_ptr_new->step_list;
 	memcpy(job_ptr_new, job_ptr, sizeof(struct job_record));
 	job_ptr_new->job_id   = save_job_id;
-	job_ptr_new->job_next = save_job_next;
+	job_ptr_new->array_next = NULL;	/* task list set by caller */
+	job_ptr_new->array_prev = NULL;
 	job_ptr_new->details  = save_details;
 	job_ptr_new->prio_factors = save_prio_factors;
 	job_ptr_new->step_list = save_step_list;
@@ -3079,6 +4028,7 @@ static void _create_job_array(struct job_record *job_ptr,
 	}
 	job_ptr->array_job_id  = job_ptr->job_id;
 	job_ptr->array_task_id = i_first;
+	_add_job_array_hash(job_ptr);
 
 	i_last = bit_fls(job_specs->array_bitmap);
 	for (i = (i_first + 1); i <= i_last; i++) {
@@ -3089,6 +4039,7 @@ static void _create_job_array(struct job_record *job_ptr,
 			break;
 		job_ptr_new->array_job_id  = job_ptr->job_id;
 		job_ptr_new->array_task_id = i;
+		_add_job_array_hash(job_ptr_new);
 	}
 }
 
@@ -5920,29 +6871,36 @@ _validate_min_mem_partition(job_desc_msg_t *job_desc_msg,
  * IN job_entry - pointer to job_record to delete
  * global: job_list - pointer to global job list
  *	job_count - count of job list entries
- *	job_hash - hash table into job records
+ *	job_id_hash, job_array_hash - hash tables into job records
  */
 static void _list_delete_job(void *job_entry)
 {
 	struct job_record *job_ptr = (struct job_record *) job_entry;
-	struct job_record **job_pptr;
 	int i;
 
 	xassert(job_entry);
 	xassert (job_ptr->magic == JOB_MAGIC);
 	job_ptr->magic = 0;	/* make sure we don't delete record twice */
 
-	/* Remove the record from the hash table */
-	job_pptr = &job_hash[JOB_HASH_INX(job_ptr->job_id)];
-	while ((job_pptr != NULL) &&
-	       ((job_ptr = *job_pptr) != (struct job_record *) job_entry)) {
-		job_pptr = &job_ptr->job_next;
+	/* Record purge of a saved job for the job state journal */
+	if (job_ptr->state_save_sum && job_purge_list) {
+		uint32_t *job_id_ptr = xmalloc(sizeof(uint32_t));
+		*job_id_ptr = job_ptr->job_id;
+		list_append(job_purge_list, job_id_ptr);
 	}
-	if (job_pptr == NULL) {
-		fatal("job hash error");
-		return;	/* Fix CLANG false positive error */
+
+	/* Record purge for job information delta requests */
+	if (job_tombstone_list) {
+		job_tombstone_t *tomb_ptr = xmalloc(sizeof(job_tombstone_t));
+		tomb_ptr->job_id = job_ptr->job_id;
+		tomb_ptr->purge_time = time(NULL);
+		list_append(job_tombstone_list, tomb_ptr);
 	}
-	*job_pptr = job_ptr->job_next;
+
+	/* Remove the record from the hash table */
+	if (!_job_hash_remove(&job_id_hash, job_ptr->job_id, job_ptr))
+		fatal("job hash error");
+	_remove_job_array_hash(job_ptr);
 
 /*
  * NOTE: Anything you free here also needs to be allocated memory copied
@@ -6086,17 +7044,32 @@ static bool _hide_job(struct job_record *job_ptr, uid_t uid)
 extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid, uint32_t filter_uid,
 			  uint16_t protocol_version)
+{
+	_pack_all_jobs(buffer_ptr, buffer_size, show_flags, uid, filter_uid,
+		       protocol_version, NULL);
+}
+
+/* As pack_all_jobs(). If expire is set, then set it to the earliest time at
+ * which the packed data becomes stale without any job being updated (a
+ * pending job's begin time or a finished job's MinJobAge), 0 if never */
+static void _pack_all_jobs(char **buffer_ptr, int *buffer_size,
+			   uint16_t show_flags, uid_t uid, uint32_t filter_uid,
+			   uint16_t protocol_version, time_t *expire)
 {
 	ListIterator job_iterator;
 	struct job_record *job_ptr;
 	uint32_t jobs_packed = 0, tmp_offset;
+	uint64_t est_size;
 	Buf buffer;
-	time_t min_age = 0, now = time(NULL);
+	time_t min_age = 0, now = time(NULL), stale;
 
 	buffer_ptr[0] = NULL;
 	*buffer_size = 0;
 
 	buffer = init_buf(BUF_SIZE);
+	est_size = (uint64_t) list_count(job_list) * job_pack_size;
+	if ((filter_uid == NO_VAL) && (est_size < MAX_BUF_SIZE))
+		reserve_buf(buffer, est_size);
 
 	/* write message body header : size and time */
 	/* put in a place holder job record count of 0 for now */
@@ -6105,6 +7078,8 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 
 	if (slurmctld_conf.min_job_age > 0)
 		min_age = now  - slurmctld_conf.min_job_age;
+	if (expire)
+		*expire = 0;
 
 	/* write individual job records */
 	part_filter_set(uid);
@@ -6129,9 +7104,467 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 
 		pack_job(job_ptr, show_flags, buffer, protocol_version, uid);
 		jobs_packed++;
+
+		if (!expire)
+			continue;
+		stale = 0;
+		if (job_ptr->details && (job_ptr->start_time == 0) &&
+		    (job_ptr->details->begin_time > now))
+			stale = job_ptr->details->begin_time;
+		else if ((min_age > 0) && IS_JOB_FINISHED(job_ptr))
+			stale = job_ptr->end_time +
+				slurmctld_conf.min_job_age + 1;
+		if (stale && ((*expire == 0) || (stale < *expire)))
+			*expire = stale;
+	}
+	part_filter_clear();
+	list_iterator_destroy(job_iterator);
+
+	/* put the real record count in the message body header */
+	tmp_offset = get_buf_offset(buffer);
+	set_buf_offset(buffer, 0);
+	pack32(jobs_packed, buffer);
+	set_buf_offset(buffer, tmp_offset);
+	if (jobs_packed)
+		job_pack_size = tmp_offset / jobs_packed;
+
+	*buffer_size = get_buf_offset(buffer);
+	buffer_ptr[0] = xfer_buf_data(buffer);
+}
+
+/* Return a bitmap of partitions hidden from a user by pack_all_jobs(),
+ * NULL if none. Must be called between part_filter_set() and
+ * part_filter_clear() */
+static bitstr_t *_hidden_part_bitmap(uint16_t show_flags, uid_t uid)
+{
+	ListIterator part_iterator;
+	struct part_record *part_ptr;
+	bitstr_t *hidden = NULL;
+	int part_cnt, i = 0;
+
+	if ((show_flags & SHOW_ALL) || (uid == 0))
+		return NULL;
+
+	part_cnt = list_count(part_list);
+	part_iterator = list_iterator_create(part_list);
+	while ((part_ptr = (struct part_record *) list_next(part_iterator))) {
+		if (part_ptr->flags & PART_FLAG_HIDDEN) {
+			if (!hidden)
+				hidden = bit_alloc(part_cnt);
+			bit_set(hidden, i);
+		}
+		i++;
+	}
+	list_iterator_destroy(part_iterator);
+
+	return hidden;
+}
+
+/* Record a user whose partition visibility matches a cached record.
+ * job_info_cache_lock must be locked by the caller */
+static void _add_job_info_cache_uid(job_info_cache_t *cache_ptr, uid_t uid)
+{
+	int i;
+
+	for (i = 0; i < cache_ptr->uid_cnt; i++) {
+		if (cache_ptr->uids[i] == uid)
+			return;
+	}
+	if (cache_ptr->uid_cnt < JOB_INFO_CACHE_UIDS)
+		cache_ptr->uids[cache_ptr->uid_cnt++] = uid;
+}
+
+static void _free_job_info_cache(job_info_cache_t *cache_ptr)
+{
+	FREE_NULL_BITMAP(cache_ptr->hidden_parts);
+	xfree(cache_ptr->data);
+	xfree(cache_ptr);
+}
+
+/* Remove stale records from the job info cache, or all records if purge_all
+ * is set. Records still in use by a responder are freed upon release.
+ * job_info_cache_lock must be locked by the caller */
+static void _purge_job_info_cache(time_t now, bool purge_all)
+{
+	job_info_cache_t *cache_ptr, **cache_pptr = &job_info_cache;
+
+	while ((cache_ptr = *cache_pptr)) {
+		if (!purge_all &&
+		    (cache_ptr->job_update  == last_job_update) &&
+		    (cache_ptr->part_update == last_part_update) &&
+		    (cache_ptr->conf_update == slurmctld_conf.last_update) &&
+		    ((cache_ptr->expire == 0) || (cache_ptr->expire > now))) {
+			cache_pptr = &cache_ptr->next;
+			continue;
+		}
+		*cache_pptr = cache_ptr->next;
+		if (--cache_ptr->ref_cnt == 0)
+			_free_job_info_cache(cache_ptr);
+	}
+}
+
+/*
+ * pack_all_jobs_cached - dump all job information as pack_all_jobs() for a
+ *	REQUEST_JOB_INFO with no user filter. The packed data is cached and
+ *	shared with other requests of the same protocol version, show flags
+ *	and partition visibility until a job, partition or configuration
+ *	change occurs. Requests for a user's private data are not cached.
+ * OUT buffer_ptr - the pointer is set to the packed data
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * RET handle for the data, pass to pack_all_jobs_release() once sent
+ * NOTE: the buffer at *buffer_ptr must NOT be xfreed by the caller
+ */
+extern void *pack_all_jobs_cached(char **buffer_ptr, int *buffer_size,
+				  uint16_t show_flags, uid_t uid,
+				  uint16_t protocol_version)
+{
+	job_info_cache_t *cache_ptr, *last_ptr = NULL;
+	bitstr_t *hidden;
+	time_t now = time(NULL);
+	int cache_cnt = 0;
+	uint32_t cache_gen;
+
+	cache_ptr = xmalloc(sizeof(job_info_cache_t));
+	cache_ptr->ref_cnt = 1;
+	if ((show_flags & SHOW_DETAIL2) ||
+	    ((slurmctld_conf.private_data & PRIVATE_DATA_JOBS) &&
+	     !validate_operator(uid))) {
+		/* Content specific to this user, do not cache */
+		pack_all_jobs(&cache_ptr->data, &cache_ptr->size, show_flags,
+			      uid, NO_VAL, protocol_version);
+		goto fini;
 	}
+
+	part_filter_set(uid);
+	hidden = _hidden_part_bitmap(show_flags, uid);
 	part_filter_clear();
+
+	slurm_mutex_lock(&job_info_cache_lock);
+	_purge_job_info_cache(now, false);
+	cache_gen = job_info_cache_gen;
+	for (last_ptr = job_info_cache; last_ptr; last_ptr = last_ptr->next) {
+		cache_cnt++;
+		if ((last_ptr->protocol_version != protocol_version) ||
+		    (last_ptr->show_flags != show_flags))
+			continue;
+		if ((hidden || last_ptr->hidden_parts) &&
+		    (!hidden || !last_ptr->hidden_parts ||
+		     !bit_equal(hidden, last_ptr->hidden_parts)))
+			continue;
+		last_ptr->ref_cnt++;
+		_add_job_info_cache_uid(last_ptr, uid);
+		slurmctld_diag_stats.job_info_cache_hits++;
+		slurm_mutex_unlock(&job_info_cache_lock);
+		FREE_NULL_BITMAP(hidden);
+		xfree(cache_ptr);
+		cache_ptr = last_ptr;
+		goto fini;
+	}
+	slurmctld_diag_stats.job_info_cache_misses++;
+	slurm_mutex_unlock(&job_info_cache_lock);
+
+	cache_ptr->protocol_version = protocol_version;
+	cache_ptr->show_flags  = show_flags;
+	cache_ptr->hidden_parts = hidden;
+	_add_job_info_cache_uid(cache_ptr, uid);
+	cache_ptr->job_update  = last_job_update;
+	cache_ptr->part_update = last_part_update;
+	cache_ptr->conf_update = slurmctld_conf.last_update;
+	_pack_all_jobs(&cache_ptr->data, &cache_ptr->size, show_flags, uid,
+		       NO_VAL, protocol_version, &cache_ptr->expire);
+
+	/* A job or partition updated later in this same second would not
+	 * change its update time, so only cache data packed after it */
+	if ((now <= last_job_update) || (now <= last_part_update))
+		goto fini;
+
+	slurm_mutex_lock(&job_info_cache_lock);
+	if (cache_gen != job_info_cache_gen) {
+		/* QOS records changed while packing */
+		slurm_mutex_unlock(&job_info_cache_lock);
+		goto fini;
+	}
+	if (cache_cnt >= JOB_INFO_CACHE_SIZE) {
+		/* Evict the oldest record, at the end of the list */
+		job_info_cache_t **cache_pptr = &job_info_cache;
+		while ((*cache_pptr)->next)
+			cache_pptr = &(*cache_pptr)->next;
+		last_ptr = *cache_pptr;
+		*cache_pptr = NULL;
+		if (--last_ptr->ref_cnt == 0)
+			_free_job_info_cache(last_ptr);
+	}
+	cache_ptr->ref_cnt++;
+	cache_ptr->next = job_info_cache;
+	job_info_cache = cache_ptr;
+	slurm_mutex_unlock(&job_info_cache_lock);
+
+fini:	*buffer_ptr  = cache_ptr->data;
+	*buffer_size = cache_ptr->size;
+	return cache_ptr;
+}
+
+/*
+ * pack_all_jobs_snapshot - return job information previously packed by
+ *	pack_all_jobs_cached() for the same request if no job, partition or
+ *	configuration change has occurred since. Unlike pack_all_jobs_cached()
+ *	this needs no slurmctld locks, so readers of unchanged job information
+ *	do not wait for threads holding or waiting on write locks.
+ * OUT buffer_ptr - the pointer is set to the packed data
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * RET handle for the data, pass to pack_all_jobs_release() once sent, or
+ *	NULL if no current snapshot exists
+ * NOTE: the buffer at *buffer_ptr must NOT be xfreed by the caller
+ */
+extern void *pack_all_jobs_snapshot(char **buffer_ptr, int *buffer_size,
+				    uint16_t show_flags, uid_t uid,
+				    uint16_t protocol_version)
+{
+	job_info_cache_t *cache_ptr;
+	bool all_parts = (show_flags & SHOW_ALL) || (uid == 0);
+	int i;
+
+	/* Checking for operators needs locks, leave private data to
+	 * pack_all_jobs_cached() */
+	if ((show_flags & SHOW_DETAIL2) ||
+	    (slurmctld_conf.private_data & PRIVATE_DATA_JOBS))
+		return NULL;
+
+	slurm_mutex_lock(&job_info_cache_lock);
+	_purge_job_info_cache(time(NULL), false);
+	for (cache_ptr = job_info_cache; cache_ptr;
+	     cache_ptr = cache_ptr->next) {
+		if ((cache_ptr->protocol_version != protocol_version) ||
+		    (cache_ptr->show_flags != show_flags))
+			continue;
+		if (all_parts && !cache_ptr->hidden_parts)
+			break;
+		for (i = 0; i < cache_ptr->uid_cnt; i++) {
+			if (cache_ptr->uids[i] == uid)
+				break;
+		}
+		if (i < cache_ptr->uid_cnt)
+			break;
+	}
+	if (cache_ptr) {
+		cache_ptr->ref_cnt++;
+		slurmctld_diag_stats.job_info_cache_hits++;
+		*buffer_ptr  = cache_ptr->data;
+		*buffer_size = cache_ptr->size;
+	}
+	slurm_mutex_unlock(&job_info_cache_lock);
+
+	return cache_ptr;
+}
+
+/* pack_all_jobs_release - release data from pack_all_jobs_cached()
+ * IN cache_ref - handle returned by pack_all_jobs_cached() */
+extern void pack_all_jobs_release(void *cache_ref)
+{
+	job_info_cache_t *cache_ptr = (job_info_cache_t *) cache_ref;
+
+	if (!cache_ptr)
+		return;
+	slurm_mutex_lock(&job_info_cache_lock);
+	if (--cache_ptr->ref_cnt == 0)
+		_free_job_info_cache(cache_ptr);
+	slurm_mutex_unlock(&job_info_cache_lock);
+}
+
+/* purge_job_info_cache - discard all packed job information from
+ *	pack_all_jobs_cached(). Used for changes which do not update any
+ *	job's last_update, such as QOS records whose names are packed. */
+extern void purge_job_info_cache(void)
+{
+	slurm_mutex_lock(&job_info_cache_lock);
+	_purge_job_info_cache(0, true);
+	job_info_cache_gen++;
+	slurm_mutex_unlock(&job_info_cache_lock);
+}
+
+static void _del_job_tombstone(void *x)
+{
+	xfree(x);
+}
+
+/* Remove purged job records older than JOB_TOMBSTONE_AGE */
+static void _purge_job_tombstones(time_t now)
+{
+	job_tombstone_t *tomb_ptr;
+	time_t horizon = now - JOB_TOMBSTONE_AGE;
+
+	if (horizon <= job_tombstone_horizon)
+		return;
+	/* Records are appended in order of purge time */
+	while ((tomb_ptr = list_peek(job_tombstone_list)) &&
+	       (tomb_ptr->purge_time < horizon))
+		_del_job_tombstone(list_pop(job_tombstone_list));
+	job_tombstone_horizon = horizon;
+}
+
+/* Set info_update of each job whose saved state has changed since the last
+ * scan, as found from the checksums recorded by the job state save, or
+ * whose begin time was reached since (which changes its reported start
+ * time). Jobs are not packed again for this, so a change is reported once
+ * the job state is saved, requested here if jobs changed since the last
+ * save began.
+ * NOTE: the caller must hold job_info_scan_lock */
+static void _scan_job_info(time_t now)
+{
+	ListIterator job_iterator;
+	struct job_record *job_ptr;
+
+	if (last_job_update >= job_save_time)
+		schedule_job_save();
+	if ((job_info_scan_seq == job_save_seq) &&
+	    ((job_info_scan_expire == 0) || (job_info_scan_expire > now)))
+		return;
+
+	job_info_scan_seq = job_save_seq;
+	job_info_scan_expire = 0;
+	job_iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
+		if (job_ptr->state_save_sum != job_ptr->info_sum) {
+			job_ptr->info_sum = job_ptr->state_save_sum;
+			job_ptr->info_update = now;
+		}
+
+		if (!job_ptr->details || (job_ptr->start_time != 0))
+			continue;
+		if (job_ptr->details->begin_time > now) {
+			if ((job_info_scan_expire == 0) ||
+			    (job_ptr->details->begin_time <
+			     job_info_scan_expire))
+				job_info_scan_expire =
+					job_ptr->details->begin_time;
+		} else if (job_ptr->details->begin_time > job_info_scan_time)
+			job_ptr->info_update = now;
+	}
 	list_iterator_destroy(job_iterator);
+	job_info_scan_time = now;
+}
+
+/*
+ * pack_jobs_delta - dump job information for jobs changed since a client's
+ *	last request in machine independent form (for network transmission).
+ *	The data has the format of pack_all_jobs() followed by the IDs of
+ *	jobs purged or hidden from the user since the last request. If the
+ *	purged jobs are not known (last_update is too old or zero) or the
+ *	partitions or configuration changed, all jobs are packed and the
+ *	JOB_DELTA_FULL flag is set. Jobs changed are found from the job
+ *	state save, see _scan_job_info().
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN last_update - time of client's latest data (its cursor)
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * RET SLURM_SUCCESS or SLURM_NO_CHANGE_IN_DATA if nothing to send
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ * NOTE: change _unpack_job_info_delta_msg() in common/slurm_protocol_pack.c
+ *	whenever the data format changes
+ */
+extern int pack_jobs_delta(char **buffer_ptr, int *buffer_size,
+			   time_t last_update, uint16_t show_flags, uid_t uid,
+			   uint16_t protocol_version)
+{
+	ListIterator iterator;
+	struct job_record *job_ptr;
+	job_tombstone_t *tomb_ptr;
+	uint32_t jobs_packed = 0, purged_cnt = 0, tmp_offset;
+	uint16_t flags = 0;
+	Buf buffer, purged;
+	time_t min_age = 0, now = time(NULL);
+
+	buffer_ptr[0] = NULL;
+	*buffer_size = 0;
+
+	slurm_mutex_lock(&job_info_scan_lock);
+	_scan_job_info(now);
+	_purge_job_tombstones(now);
+	if ((last_update <= job_tombstone_horizon) ||
+	    (last_update <= last_part_update) ||
+	    (last_update <= slurmctld_conf.last_update))
+		flags |= JOB_DELTA_FULL;
+
+	buffer = init_buf(BUF_SIZE);
+	purged = init_buf(BUF_SIZE);
+
+	/* write message body header : size and time */
+	/* put in a place holder job record count of 0 for now */
+	pack32(jobs_packed, buffer);
+	pack_time(now, buffer);
+
+	if (slurmctld_conf.min_job_age > 0)
+		min_age = now  - slurmctld_conf.min_job_age;
+
+	/* write individual job records, note jobs which the user can no
+	 * longer see */
+	part_filter_set(uid);
+	iterator = list_iterator_create(job_list);
+	while ((job_ptr = (struct job_record *) list_next(iterator))) {
+		xassert (job_ptr->magic == JOB_MAGIC);
+
+		if (((show_flags & SHOW_ALL) == 0) && (uid != 0) &&
+		    (job_ptr->part_ptr) &&
+		    (job_ptr->part_ptr->flags & PART_FLAG_HIDDEN)) {
+			if (job_ptr->info_update >= last_update)
+				goto hidden;
+			continue;
+		}
+
+		if (_hide_job(job_ptr, uid))
+			continue;
+
+		if ((min_age > 0) && (job_ptr->end_time < min_age) &&
+		    (! IS_JOB_COMPLETING(job_ptr)) && IS_JOB_FINISHED(job_ptr)) {
+			/* job ready for purging, don't dump */
+			if ((job_ptr->end_time + slurmctld_conf.min_job_age) >=
+			    (last_update - 1))
+				goto hidden;
+			continue;
+		}
+
+		if ((flags & JOB_DELTA_FULL) ||
+		    (job_ptr->info_update >= last_update)) {
+			pack_job(job_ptr, show_flags, buffer, protocol_version,
+				 uid);
+			jobs_packed++;
+		}
+		continue;
+
+hidden:		if ((flags & JOB_DELTA_FULL) == 0) {
+			pack32(job_ptr->job_id, purged);
+			purged_cnt++;
+		}
+	}
+	part_filter_clear();
+	list_iterator_destroy(iterator);
+
+	if ((flags & JOB_DELTA_FULL) == 0) {
+		iterator = list_iterator_create(job_tombstone_list);
+		while ((tomb_ptr = list_next(iterator))) {
+			if (tomb_ptr->purge_time < last_update)
+				continue;
+			pack32(tomb_ptr->job_id, purged);
+			purged_cnt++;
+		}
+		list_iterator_destroy(iterator);
+	}
+	slurm_mutex_unlock(&job_info_scan_lock);
+
+	if (((flags & JOB_DELTA_FULL) == 0) &&
+	    (jobs_packed == 0) && (purged_cnt == 0)) {
+		free_buf(buffer);
+		free_buf(purged);
+		return SLURM_NO_CHANGE_IN_DATA;
+	}
 
 	/* put the real record count in the message body header */
 	tmp_offset = get_buf_offset(buffer);
@@ -6139,8 +7572,14 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 	pack32(jobs_packed, buffer);
 	set_buf_offset(buffer, tmp_offset);
 
+	pack16(flags, buffer);
+	pack32(purged_cnt, buffer);
+	packmem_array(get_buf_data(purged), get_buf_offset(purged), buffer);
+	free_buf(purged);
+
 	*buffer_size = get_buf_offset(buffer);
 	buffer_ptr[0] = xfer_buf_data(buffer);
+	return SLURM_SUCCESS;
 }
 
 /*
@@ -7324,8 +8763,8 @@ static bool _top_priority(struct job_record *job_ptr)
 				top = false;
 				break;
 			}
-			if (bit_overlap(job_ptr->part_ptr->node_bitmap,
-					job_ptr2->part_ptr->node_bitmap) == 0)
+			if (bit_overlap_any(job_ptr->part_ptr->node_bitmap,
+					    job_ptr2->part_ptr->node_bitmap) == 0)
 				continue;   /* no node overlap in partitions */
 			if ((job_ptr2->part_ptr->priority >
 			     job_ptr ->part_ptr->priority) ||
@@ -8258,6 +9697,7 @@ int update_job(job_desc_msg_t * job_specs, uid_t uid)
 			     "job_id %u", job_ptr->priority,
 			     job_specs->job_id);
 			update_accounting = true;
+			priority_g_job_changed(job_ptr);
 			if (job_ptr->priority == 0) {
 				if ((job_ptr->user_id == uid) ||
 				    (job_specs->alloc_sid ==
@@ -8290,6 +9730,7 @@ int update_job(job_desc_msg_t * job_specs, uid_t uid)
 			new_prio -= job_specs->nice;
 			job_ptr->priority = MAX(new_prio, 2);
 			job_ptr->details->nice = job_specs->nice;
+			priority_g_job_changed(job_ptr);
 			info("sched: update_job: setting priority to %u for "
 			     "job_id %u", job_ptr->priority,
 			     job_specs->job_id);
@@ -9818,7 +11259,13 @@ void job_fini (void)
 		list_destroy(job_list);
 		job_list = NULL;
 	}
-	xfree(job_hash);
+	FREE_NULL_LIST(job_purge_list);
+	FREE_NULL_LIST(job_tombstone_list);
+	slurm_mutex_lock(&job_info_cache_lock);
+	_purge_job_info_cache(0, true);
+	slurm_mutex_unlock(&job_info_cache_lock);
+	_job_hash_free(&job_id_hash);
+	_job_hash_free(&job_array_hash);
 }
 
 /* log the completion of the specified job */
@@ -9828,6 +11275,8 @@ extern void job_completion_logger(struct job_record  *job_ptr, bool requeue)
 
 	xassert(job_ptr);
 
+	priority_g_job_changed(job_ptr);
+
 #ifdef HAVE_BG
 	/* If on a bluegene system we want to remove the job_resrcs so
 	 * we don't get an error message about them already existing
@@ -566,8 +566,8 @@ next_part:		part_ptr = (struct part_record *)
 			continue;
 		}
 
-		if (bit_overlap(avail_node_bitmap,
-				job_ptr->part_ptr->node_bitmap) == 0) {
+		if (bit_overlap_any(avail_node_bitmap,
+				    job_ptr->part_ptr->node_bitmap) == 0) {
 			/* This node DRAIN or DOWN */
 			continue;
 		}
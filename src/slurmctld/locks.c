@@ -47,72 +47,227 @@
 
 #include <errno.h>
 #include <string.h>
+#include <sys/time.h>
 #include <sys/types.h>
 
+#include "src/common/xmalloc.h"
 #include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 
-static pthread_mutex_t locks_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t locks_cond = PTHREAD_COND_INITIALIZER;
+/* Call sites tracked per data type, well above the count of
+ * lock_slurmctld() calls. Locks from further sites are only counted in
+ * lock_stats_t.site_drops */
+#define LOCK_SITE_CNT	512
+
+/* Locks of one data type a thread may hold at once with their hold time
+ * recorded, further nested locks are not */
+#define LOCK_NEST_MAX	4
+
+/* Locks held by a thread, used to record hold times by call site */
+typedef struct {
+	int depth[ENTITY_COUNT];		/* locks held */
+	uint64_t start[ENTITY_COUNT][LOCK_NEST_MAX]; /* time lock granted */
+	lock_site_stats_t *site[ENTITY_COUNT][LOCK_NEST_MAX]; /* NULL if
+							       * not recorded */
+} lock_thread_t;
+
+/* Each data type has its own mutex and condition variable, so releasing
+ * one lock only wakes threads waiting on that same data type */
+static pthread_mutex_t locks_mutex[ENTITY_COUNT];
+static pthread_cond_t locks_cond[ENTITY_COUNT];
 static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 static slurmctld_lock_flags_t slurmctld_locks;
 static int kill_thread = 0;
 
-static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock);
+/* Lock usage statistics, protected by locks_mutex of the data type */
+static lock_stats_t lock_stats[ENTITY_COUNT];
+static uint64_t read_start[ENTITY_COUNT];	/* first read lock granted */
+static uint64_t write_start[ENTITY_COUNT];	/* write lock granted */
+static lock_site_stats_t lock_sites[ENTITY_COUNT][LOCK_SITE_CNT];
+static pthread_key_t lock_thread_key;
+
+static char *lock_names[ENTITY_COUNT] = {
+	"config", "job", "node", "partition" };
+
+static void _lock_granted(lock_datatype_t datatype, lock_level_t level,
+			  const char *caller, uint64_t now, uint64_t wait);
+static void _lock_released(lock_datatype_t datatype, uint64_t now);
+static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock,
+		       const char *caller);
 static void _wr_rdunlock(lock_datatype_t datatype);
-static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock);
+static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock,
+		       const char *caller);
 static void _wr_wrunlock(lock_datatype_t datatype);
 
+static void _lock_thread_free(void *thread_ptr)
+{
+	xfree(thread_ptr);
+}
+
 /* init_locks - create locks used for slurmctld data structure access
  *	control */
 void init_locks(void)
 {
+	int i;
+
 	/* just clear all semaphores */
 	memset((void *) &slurmctld_locks, 0, sizeof(slurmctld_locks));
+	memset((void *) lock_stats, 0, sizeof(lock_stats));
+	memset((void *) lock_sites, 0, sizeof(lock_sites));
+	pthread_key_create(&lock_thread_key, _lock_thread_free);
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_init(&locks_mutex[i]);
+		pthread_cond_init(&locks_cond[i], NULL);
+	}
+}
+
+/* Return the current time in microseconds */
+static uint64_t _lock_usec(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return ((uint64_t) tv.tv_sec * 1000000) + tv.tv_usec;
+}
+
+/* Return the histogram bucket of a time in microseconds */
+static int _lock_hist_inx(uint64_t usec)
+{
+	int inx;
+
+	for (inx = 0; (inx < (LOCK_HIST_CNT - 1)) && (usec >= 10); inx++)
+		usec /= 10;
+	return inx;
+}
+
+/* Find or add the statistics record of a call site
+ * locks_mutex of the data type must be locked by the caller
+ * RET the record or NULL if the table is full */
+static lock_site_stats_t *_lock_site(lock_datatype_t datatype,
+				     lock_level_t level, const char *caller)
+{
+	lock_site_stats_t *site_ptr;
+	int i, inx;
+
+	inx = (((unsigned long) caller >> 3) + level) % LOCK_SITE_CNT;
+	for (i = 0; i < LOCK_SITE_CNT; i++) {
+		site_ptr = &lock_sites[datatype][inx];
+		if (!site_ptr->caller) {
+			site_ptr->caller   = caller;
+			site_ptr->datatype = datatype;
+			site_ptr->level    = level;
+			return site_ptr;
+		}
+		if ((site_ptr->caller == caller) && (site_ptr->level == level))
+			return site_ptr;
+		inx = (inx + 1) % LOCK_SITE_CNT;
+	}
+	return NULL;
+}
+
+/* Record a granted lock against its call site and remember the site for
+ * the hold time when the thread releases the lock
+ * locks_mutex of the data type must be locked by the caller */
+static void _lock_granted(lock_datatype_t datatype, lock_level_t level,
+			  const char *caller, uint64_t now, uint64_t wait)
+{
+	lock_thread_t *thread_ptr;
+	lock_site_stats_t *site_ptr;
+	int depth;
+
+	if (!(thread_ptr = pthread_getspecific(lock_thread_key))) {
+		thread_ptr = xmalloc(sizeof(lock_thread_t));
+		pthread_setspecific(lock_thread_key, thread_ptr);
+	}
+	site_ptr = _lock_site(datatype, level, caller);
+	if (!site_ptr)
+		lock_stats[datatype].site_drops++;
+	depth = thread_ptr->depth[datatype]++;
+	if (depth < LOCK_NEST_MAX) {
+		thread_ptr->start[datatype][depth] = now;
+		thread_ptr->site[datatype][depth]  = site_ptr;
+	}
+	if (!site_ptr)
+		return;
+
+	site_ptr->count++;
+	site_ptr->wait_total += wait;
+	if (site_ptr->wait_max < wait)
+		site_ptr->wait_max = wait;
+	site_ptr->wait_hist[_lock_hist_inx(wait)]++;
+}
+
+/* Record the hold time of a lock released by this thread, nested locks
+ * of a data type being released in the reverse order they were granted
+ * locks_mutex of the data type must be locked by the caller */
+static void _lock_released(lock_datatype_t datatype, uint64_t now)
+{
+	lock_thread_t *thread_ptr;
+	lock_site_stats_t *site_ptr;
+	uint64_t hold;
+	int depth;
+
+	if (!(thread_ptr = pthread_getspecific(lock_thread_key)) ||
+	    (thread_ptr->depth[datatype] == 0))
+		return;
+	depth = --thread_ptr->depth[datatype];
+	if ((depth >= LOCK_NEST_MAX) ||
+	    !(site_ptr = thread_ptr->site[datatype][depth]))
+		return;
+	thread_ptr->site[datatype][depth] = NULL;
+
+	hold = now - thread_ptr->start[datatype][depth];
+	site_ptr->hold_total += hold;
+	if (site_ptr->hold_max < hold)
+		site_ptr->hold_max = hold;
+	site_ptr->hold_hist[_lock_hist_inx(hold)]++;
 }
 
-/* lock_slurmctld - Issue the required lock requests in a well defined order */
-extern void lock_slurmctld(slurmctld_lock_t lock_levels)
+/* lock_slurmctld - Issue the required lock requests in a well defined order
+ *	Lock statistics are recorded for the calling function */
+extern void lock_slurmctld_caller(slurmctld_lock_t lock_levels,
+				  const char *caller)
 {
 	if (lock_levels.config == READ_LOCK)
-		(void) _wr_rdlock(CONFIG_LOCK, true);
+		(void) _wr_rdlock(CONFIG_LOCK, true, caller);
 	else if (lock_levels.config == WRITE_LOCK)
-		(void) _wr_wrlock(CONFIG_LOCK, true);
+		(void) _wr_wrlock(CONFIG_LOCK, true, caller);
 
 	if (lock_levels.job == READ_LOCK)
-		(void) _wr_rdlock(JOB_LOCK, true);
+		(void) _wr_rdlock(JOB_LOCK, true, caller);
 	else if (lock_levels.job == WRITE_LOCK)
-		(void) _wr_wrlock(JOB_LOCK, true);
+		(void) _wr_wrlock(JOB_LOCK, true, caller);
 
 	if (lock_levels.node == READ_LOCK)
-		(void) _wr_rdlock(NODE_LOCK, true);
+		(void) _wr_rdlock(NODE_LOCK, true, caller);
 	else if (lock_levels.node == WRITE_LOCK)
-		(void) _wr_wrlock(NODE_LOCK, true);
+		(void) _wr_wrlock(NODE_LOCK, true, caller);
 
 	if (lock_levels.partition == READ_LOCK)
-		(void) _wr_rdlock(PART_LOCK, true);
+		(void) _wr_rdlock(PART_LOCK, true, caller);
 	else if (lock_levels.partition == WRITE_LOCK)
-		(void) _wr_wrlock(PART_LOCK, true);
+		(void) _wr_wrlock(PART_LOCK, true, caller);
 }
 
 /* try_lock_slurmctld - equivalent to lock_slurmctld() except 
  * RET 0 on success or -1 if the locks are currently not available */
-extern int try_lock_slurmctld (slurmctld_lock_t lock_levels)
+extern int try_lock_slurmctld_caller (slurmctld_lock_t lock_levels,
+				      const char *caller)
 {
 	bool success = true;
 
 	if (lock_levels.config == READ_LOCK)
-		success = _wr_rdlock(CONFIG_LOCK, false);
+		success = _wr_rdlock(CONFIG_LOCK, false, caller);
 	else if (lock_levels.config == WRITE_LOCK)
-		success = _wr_wrlock(CONFIG_LOCK, false);
+		success = _wr_wrlock(CONFIG_LOCK, false, caller);
 	if (!success)
 		return -1;
 		
 	if (lock_levels.job == READ_LOCK)
-		success = _wr_rdlock(JOB_LOCK, false);
+		success = _wr_rdlock(JOB_LOCK, false, caller);
 	else if (lock_levels.job == WRITE_LOCK)
-		success = _wr_wrlock(JOB_LOCK, false);
+		success = _wr_wrlock(JOB_LOCK, false, caller);
 	if (!success) {
 		if (lock_levels.config == READ_LOCK)
 			_wr_rdunlock(CONFIG_LOCK);
@@ -122,9 +277,9 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels)
 	}
 
 	if (lock_levels.node == READ_LOCK)
-		success = _wr_rdlock(NODE_LOCK, false);
+		success = _wr_rdlock(NODE_LOCK, false, caller);
 	else if (lock_levels.node == WRITE_LOCK)
-		success = _wr_wrlock(NODE_LOCK, false);
+		success = _wr_wrlock(NODE_LOCK, false, caller);
 	if (!success) {
 		if (lock_levels.job == READ_LOCK)
 			_wr_rdunlock(JOB_LOCK);
@@ -138,9 +293,9 @@ extern int try_lock_slurmctld (slurmctld_lock_t lock_levels)
 	}
 
 	if (lock_levels.partition == READ_LOCK)
-		success = _wr_rdlock(PART_LOCK, false);
+		success = _wr_rdlock(PART_LOCK, false, caller);
 	else if (lock_levels.partition == WRITE_LOCK)
-		success = _wr_wrlock(PART_LOCK, false);
+		success = _wr_wrlock(PART_LOCK, false, caller);
 	if (!success) {
 		if (lock_levels.node == READ_LOCK)
 			_wr_rdunlock(NODE_LOCK);
@@ -193,11 +348,13 @@ extern void unlock_slurmctld(slurmctld_lock_t lock_levels)
  *	read locks. To prevent this, read locks were permitted to be satisified
  *	after 10 consecutive write locks. This prevented starvation, but
  *	deadlock has been observed with some values for the count. */
-static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
+static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock,
+		       const char *caller)
 {
 	bool success = true;
+	uint64_t wait_start = 0, wait = 0, now;
 
-	slurm_mutex_lock(&locks_mutex);
+	slurm_mutex_lock(&locks_mutex[datatype]);
 	while (1) {
 #if 1
 		if ((slurmctld_locks.entity[write_lock(datatype)] == 0) &&
@@ -208,6 +365,14 @@ static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 		    ((slurmctld_locks.entity[write_wait_lock(datatype)] == 0) ||
 		     (slurmctld_locks.entity[write_cnt_lock(datatype)] > 10))) {
 #endif
+			now = _lock_usec();
+			if (wait_start)
+				wait = now - wait_start;
+			if (!slurmctld_locks.entity[read_lock(datatype)])
+				read_start[datatype] = now;
+			lock_stats[datatype].read_wait += wait;
+			lock_stats[datatype].read_cnt++;
+			_lock_granted(datatype, READ_LOCK, caller, now, wait);
 			slurmctld_locks.entity[read_lock(datatype)]++;
 			slurmctld_locks.entity[write_cnt_lock(datatype)] = 0;
 			break;
@@ -215,35 +380,51 @@ static bool _wr_rdlock(lock_datatype_t datatype, bool wait_lock)
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			pthread_cond_wait(&locks_cond, &locks_mutex);
+			if (!wait_start)
+				wait_start = _lock_usec();
+			pthread_cond_wait(&locks_cond[datatype],
+					  &locks_mutex[datatype]);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_mutex_unlock(&locks_mutex[datatype]);
 	return success;
 }
 
 /* _wr_rdunlock - Issue a read unlock on the specified data type */
 static void _wr_rdunlock(lock_datatype_t datatype)
 {
-	slurm_mutex_lock(&locks_mutex);
-	slurmctld_locks.entity[read_lock(datatype)]--;
-	pthread_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	uint64_t now = _lock_usec();
+
+	slurm_mutex_lock(&locks_mutex[datatype]);
+	if (--slurmctld_locks.entity[read_lock(datatype)] == 0)
+		lock_stats[datatype].read_hold += now - read_start[datatype];
+	_lock_released(datatype, now);
+	pthread_cond_broadcast(&locks_cond[datatype]);
+	slurm_mutex_unlock(&locks_mutex[datatype]);
 }
 
 /* _wr_wrlock - Issue a write lock on the specified data type */
-static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
+static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock,
+		       const char *caller)
 {
 	bool success = true;
+	uint64_t wait_start = 0, wait = 0;
 
-	slurm_mutex_lock(&locks_mutex);
+	slurm_mutex_lock(&locks_mutex[datatype]);
 	slurmctld_locks.entity[write_wait_lock(datatype)]++;
 
 	while (1) {
 		if ((slurmctld_locks.entity[read_lock(datatype)] == 0) &&
 		    (slurmctld_locks.entity[write_lock(datatype)] == 0)) {
+			write_start[datatype] = _lock_usec();
+			if (wait_start)
+				wait = write_start[datatype] - wait_start;
+			lock_stats[datatype].write_wait += wait;
+			lock_stats[datatype].write_cnt++;
+			_lock_granted(datatype, WRITE_LOCK, caller,
+				      write_start[datatype], wait);
 			slurmctld_locks.entity[write_lock(datatype)]++;
 			slurmctld_locks.entity[write_wait_lock(datatype)]--;
 			slurmctld_locks.entity[write_cnt_lock(datatype)]++;
@@ -253,22 +434,29 @@ static bool _wr_wrlock(lock_datatype_t datatype, bool wait_lock)
 			success = false;
 			break;
 		} else {	/* wait for state change and retry */
-			pthread_cond_wait(&locks_cond, &locks_mutex);
+			if (!wait_start)
+				wait_start = _lock_usec();
+			pthread_cond_wait(&locks_cond[datatype],
+					  &locks_mutex[datatype]);
 			if (kill_thread)
 				pthread_exit(NULL);
 		}
 	}
-	slurm_mutex_unlock(&locks_mutex);
+	slurm_mutex_unlock(&locks_mutex[datatype]);
 	return success;
 }
 
 /* _wr_wrunlock - Issue a write unlock on the specified data type */
 static void _wr_wrunlock(lock_datatype_t datatype)
 {
-	slurm_mutex_lock(&locks_mutex);
+	uint64_t now = _lock_usec();
+
+	slurm_mutex_lock(&locks_mutex[datatype]);
+	lock_stats[datatype].write_hold += now - write_start[datatype];
+	_lock_released(datatype, now);
 	slurmctld_locks.entity[write_lock(datatype)]--;
-	pthread_cond_broadcast(&locks_cond);
-	slurm_mutex_unlock(&locks_mutex);
+	pthread_cond_broadcast(&locks_cond[datatype]);
+	slurm_mutex_unlock(&locks_mutex[datatype]);
 }
 
 /* get_lock_values - Get the current value of all locks
@@ -280,11 +468,92 @@ void get_lock_values(slurmctld_lock_flags_t * lock_flags)
 	       sizeof(slurmctld_locks));
 }
 
+/* get_lock_stats - Get lock usage statistics of each data type
+ * OUT stats - filled with ENTITY_COUNT records, indexed by lock_datatype_t */
+extern void get_lock_stats(lock_stats_t *stats)
+{
+	int i;
+
+	xassert(stats);
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&locks_mutex[i]);
+		memcpy(&stats[i], &lock_stats[i], sizeof(lock_stats_t));
+		slurm_mutex_unlock(&locks_mutex[i]);
+	}
+}
+
+/* get_lock_site_stats - Get lock usage statistics of each call site
+ * OUT stats - set to an array of records, call xfree() to release
+ * RET count of records in the array */
+extern int get_lock_site_stats(lock_site_stats_t **stats)
+{
+	lock_site_stats_t *site_ptr;
+	int i, j, cnt = 0, site_cnt;
+
+	xassert(stats);
+	*stats = NULL;
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&locks_mutex[i]);
+		site_cnt = 0;
+		for (j = 0; j < LOCK_SITE_CNT; j++) {
+			if (lock_sites[i][j].count)
+				site_cnt++;
+		}
+		xrealloc(*stats, sizeof(lock_site_stats_t) *
+				 (cnt + site_cnt));
+		for (j = 0; j < LOCK_SITE_CNT; j++) {
+			site_ptr = &lock_sites[i][j];
+			if (!site_ptr->caller || !site_ptr->count)
+				continue;
+			memcpy(&(*stats)[cnt++], site_ptr,
+			       sizeof(lock_site_stats_t));
+		}
+		slurm_mutex_unlock(&locks_mutex[i]);
+	}
+	return cnt;
+}
+
+/* get_lock_name - Return the name of a lock data type (e.g. "job") */
+extern char *get_lock_name(lock_datatype_t datatype)
+{
+	if ((int) datatype >= ENTITY_COUNT)
+		return "unknown";
+	return lock_names[datatype];
+}
+
+/* reset_lock_stats - Clear lock usage statistics */
+extern void reset_lock_stats(void)
+{
+	lock_site_stats_t *site_ptr;
+	int i, j;
+
+	for (i = 0; i < ENTITY_COUNT; i++) {
+		slurm_mutex_lock(&locks_mutex[i]);
+		memset(&lock_stats[i], 0, sizeof(lock_stats_t));
+		/* Keep the call sites, a thread may still hold a lock
+		 * recorded against one */
+		for (j = 0; j < LOCK_SITE_CNT; j++) {
+			site_ptr = &lock_sites[i][j];
+			site_ptr->count = 0;
+			site_ptr->wait_total = site_ptr->wait_max = 0;
+			site_ptr->hold_total = site_ptr->hold_max = 0;
+			memset(site_ptr->wait_hist, 0,
+			       sizeof(site_ptr->wait_hist));
+			memset(site_ptr->hold_hist, 0,
+			       sizeof(site_ptr->hold_hist));
+		}
+		slurm_mutex_unlock(&locks_mutex[i]);
+	}
+}
+
 /* kill_locked_threads - Kill all threads waiting on semaphores */
 extern void kill_locked_threads(void)
 {
+	int i;
+
 	kill_thread = 1;
-	pthread_cond_broadcast(&locks_cond);
+	for (i = 0; i < ENTITY_COUNT; i++)
+		pthread_cond_broadcast(&locks_cond[i]);
 }
 
 /* un/lock semaphore used for saving state of slurmctld */
@@ -87,6 +87,8 @@
 #ifndef _SLURMCTLD_LOCKS_H
 #define _SLURMCTLD_LOCKS_H
 
+#include <inttypes.h>
+
 /* levels of locking required for each data structure */
 typedef enum {
 	NO_LOCK,
@@ -128,11 +130,54 @@ typedef struct {
 	int entity[ENTITY_COUNT * 4];
 }	slurmctld_lock_flags_t;
 
+/* Lock usage statistics of one data type, times in microseconds */
+typedef struct {
+	uint32_t read_cnt;	/* read locks granted */
+	uint32_t write_cnt;	/* write locks granted */
+	uint64_t read_wait;	/* time spent waiting for read locks */
+	uint64_t write_wait;	/* time spent waiting for write locks */
+	uint64_t read_hold;	/* time with one or more read locks held */
+	uint64_t write_hold;	/* time with a write lock held */
+	uint32_t site_drops;	/* locks granted to call sites not recorded
+				 * in lock_site_stats_t, the table being
+				 * full */
+}	lock_stats_t;
+
+/* Histogram buckets of lock_site_stats_t: bucket i counts times under
+ * 10^(i+1) microseconds, the last bucket counts all longer times */
+#define LOCK_HIST_CNT	8
+
+/* Lock usage statistics of one call site, data type and lock level,
+ * times in microseconds */
+typedef struct {
+	const char *caller;		/* function acquiring the lock */
+	lock_datatype_t datatype;
+	lock_level_t level;		/* READ_LOCK or WRITE_LOCK */
+	uint32_t count;			/* locks granted */
+	uint64_t wait_total;		/* time spent waiting for the lock */
+	uint64_t wait_max;
+	uint64_t hold_total;		/* time the lock was held */
+	uint64_t hold_max;
+	uint32_t wait_hist[LOCK_HIST_CNT];
+	uint32_t hold_hist[LOCK_HIST_CNT];
+}	lock_site_stats_t;
 
 /* get_lock_values - Get the current value of all locks
  * OUT lock_flags - a copy of the current lock values */
 extern void get_lock_values (slurmctld_lock_flags_t *lock_flags);
 
+/* get_lock_name - Return the name of a lock data type (e.g. "job") */
+extern char *get_lock_name (lock_datatype_t datatype);
+
+/* get_lock_site_stats - Get lock usage statistics of each call site
+ * OUT stats - set to an array of records, call xfree() to release
+ * RET count of records in the array */
+extern int get_lock_site_stats (lock_site_stats_t **stats);
+
+/* get_lock_stats - Get lock usage statistics of each data type
+ * OUT stats - filled with ENTITY_COUNT records, indexed by lock_datatype_t */
+extern void get_lock_stats (lock_stats_t *stats);
+
 /* init_locks - create locks used for slurmctld data structure access
  *	control */
 extern void init_locks ( void );
@@ -140,12 +185,22 @@ extern void init_locks ( void );
 /* kill_locked_threads - Kill all threads waiting on semaphores */
 extern void kill_locked_threads ( void );
 
-/* lock_slurmctld - Issue the required lock requests in a well defined order */
-extern void lock_slurmctld (slurmctld_lock_t lock_levels);
+/* lock_slurmctld - Issue the required lock requests in a well defined order
+ *	Lock statistics are recorded for the calling function */
+#define lock_slurmctld(lock_levels) \
+	lock_slurmctld_caller(lock_levels, __func__)
+extern void lock_slurmctld_caller (slurmctld_lock_t lock_levels,
+				   const char *caller);
+
+/* reset_lock_stats - Clear lock usage statistics */
+extern void reset_lock_stats ( void );
 
 /* try_lock_slurmctld - equivalent to lock_slurmctld() except 
  * RET 0 on success or -1 if the locks are currently not available */
-extern int try_lock_slurmctld (slurmctld_lock_t lock_levels);
+#define try_lock_slurmctld(lock_levels) \
+	try_lock_slurmctld_caller(lock_levels, __func__)
+extern int try_lock_slurmctld_caller (slurmctld_lock_t lock_levels,
+				      const char *caller);
 
 /* unlock_slurmctld - Issue the required unlock requests in a well
  *	defined order */
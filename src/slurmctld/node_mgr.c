@@ -98,6 +98,10 @@ bitstr_t *power_node_bitmap = NULL;	/* bitmap of powered down nodes */
 bitstr_t *share_node_bitmap = NULL;  	/* bitmap of sharable nodes */
 bitstr_t *up_node_bitmap    = NULL;  	/* bitmap of non-down nodes */
 
+/* Local variables */
+static uint32_t node_pack_size = 0;	/* mean bytes per node packed by last
+					 * pack_all_node(), to size buffer */
+
 static void 	_dump_node_state (struct node_record *dump_node_ptr,
 				  Buf buffer);
 static front_end_record_t * _front_end_reg(
@@ -641,6 +645,7 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 	*buffer_size = 0;
 
 	buffer = init_buf (BUF_SIZE*16);
+	reserve_buf(buffer, node_record_count * node_pack_size);
 	nodes_packed = 0;
 
 	if (protocol_version >= SLURM_2_5_PROTOCOL_VERSION) {
@@ -696,6 +701,8 @@ extern void pack_all_node (char **buffer_ptr, int *buffer_size,
 	set_buf_offset (buffer, 0);
 	pack32  (nodes_packed, buffer);
 	set_buf_offset (buffer, tmp_offset);
+	if (nodes_packed)
+		node_pack_size = tmp_offset / nodes_packed;
 
 	*buffer_size = get_buf_offset (buffer);
 	buffer_ptr[0] = xfer_buf_data (buffer);
@@ -1103,7 +1103,7 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 					return ESLURM_NODES_BUSY;
 				}
 #ifndef HAVE_BG
-				if (bit_overlap(job_ptr->details->
+				if (bit_overlap_any(job_ptr->details->
 						req_node_bitmap,
 						cg_node_bitmap)) {
 					return ESLURM_NODES_BUSY;
@@ -1118,8 +1118,8 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 				/* Note: IDLE nodes are not COMPLETING */
 			}
 #ifndef HAVE_BG
-		} else if (bit_overlap(job_ptr->details->req_node_bitmap,
-				       cg_node_bitmap)) {
+		} else if (bit_overlap_any(job_ptr->details->req_node_bitmap,
+					   cg_node_bitmap)) {
 			return ESLURM_NODES_BUSY;
 #endif
 		}
@@ -1195,10 +1195,8 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 					bit_and(node_set_ptr[i].my_bitmap,
 						share_node_bitmap);
 #ifndef HAVE_BG
-					bit_not(cg_node_bitmap);
-					bit_and(node_set_ptr[i].my_bitmap,
-						cg_node_bitmap);
-					bit_not(cg_node_bitmap);
+					bit_and_not(node_set_ptr[i].my_bitmap,
+						    cg_node_bitmap);
 #endif
 				} else {
 					bit_and(node_set_ptr[i].my_bitmap,
@@ -1207,10 +1205,8 @@ _pick_best_nodes(struct node_set *node_set_ptr, int node_set_size,
 				}
 			} else {
 #ifndef HAVE_BG
-				bit_not(cg_node_bitmap);
-				bit_and(node_set_ptr[i].my_bitmap,
-					cg_node_bitmap);
-				bit_not(cg_node_bitmap);
+				bit_and_not(node_set_ptr[i].my_bitmap,
+					    cg_node_bitmap);
 #endif
 			}
 			if (!nodes_busy) {
@@ -1727,11 +1723,12 @@ extern int select_nodes(struct job_record *job_ptr, bool test_only,
 	configuring = IS_JOB_CONFIGURING(job_ptr);
 
 	job_ptr->job_state = JOB_RUNNING;
+	priority_g_job_changed(job_ptr);
 	if (nonstop_ops.job_begin)
 		(nonstop_ops.job_begin)(job_ptr);
 
 	if (configuring
-	    || bit_overlap(job_ptr->node_bitmap, power_node_bitmap))
+	    || bit_overlap_any(job_ptr->node_bitmap, power_node_bitmap))
 		job_ptr->job_state |= JOB_CONFIGURING;
 	if (select_g_select_nodeinfo_set(job_ptr) != SLURM_SUCCESS) {
 		error("select_g_select_nodeinfo_set(%u): %m", job_ptr->job_id);
@@ -2185,9 +2182,8 @@ static int _build_node_list(struct job_record *job_ptr,
 	node_set_ptr[node_set_inx+1].my_bitmap = NULL;
 	if (detail_ptr->exc_node_bitmap) {
 		if (usable_node_mask) {
-			bit_not(detail_ptr->exc_node_bitmap);
-			bit_and(usable_node_mask, detail_ptr->exc_node_bitmap);
-			bit_not(detail_ptr->exc_node_bitmap);
+			bit_and_not(usable_node_mask,
+				    detail_ptr->exc_node_bitmap);
 		} else {
 			usable_node_mask =
 				bit_copy(detail_ptr->exc_node_bitmap);
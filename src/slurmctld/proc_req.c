@@ -119,6 +119,7 @@ inline static void  _slurm_rpc_complete_prolog(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_conf(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_front_end(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_jobs(slurm_msg_t * msg);
+inline static void  _slurm_rpc_dump_jobs_delta(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_jobs_user(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_job_single(slurm_msg_t * msg);
 inline static void  _slurm_rpc_dump_nodes(slurm_msg_t * msg);
@@ -207,6 +208,10 @@ void slurmctld_req (slurm_msg_t * msg)
 		_slurm_rpc_dump_jobs(msg);
 		slurm_free_job_info_request_msg(msg->data);
 		break;
+	case REQUEST_JOB_INFO_DELTA:
+		_slurm_rpc_dump_jobs_delta(msg);
+		slurm_free_job_info_request_msg(msg->data);
+		break;
 	case REQUEST_JOB_USER_INFO:
 		_slurm_rpc_dump_jobs_user(msg);
 		slurm_free_job_user_id_msg(msg->data);
@@ -1048,6 +1053,7 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 	DEF_TIMERS;
 	char *dump;
 	int dump_size;
+	void *dump_ref;
 	slurm_msg_t response_msg;
 	job_info_request_msg_t *job_info_request_msg =
 		(job_info_request_msg_t *) msg->data;
@@ -1058,18 +1064,28 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 
 	START_TIMER;
 	debug3("Processing RPC: REQUEST_JOB_INFO from uid=%d", uid);
-	lock_slurmctld(job_read_lock);
+	/* Try data packed for an earlier request first, without locks, so
+	 * that queries of unchanged jobs do not wait for writers */
+	dump_ref = pack_all_jobs_snapshot(&dump, &dump_size,
+					  job_info_request_msg->show_flags,
+					  uid, msg->protocol_version);
+	if (!dump_ref)
+		lock_slurmctld(job_read_lock);
 
 	if ((job_info_request_msg->last_update - 1) >= last_job_update) {
-		unlock_slurmctld(job_read_lock);
+		if (dump_ref)
+			pack_all_jobs_release(dump_ref);
+		else
+			unlock_slurmctld(job_read_lock);
 		debug3("_slurm_rpc_dump_jobs, no change");
 		slurm_send_rc_msg(msg, SLURM_NO_CHANGE_IN_DATA);
 	} else {
-		pack_all_jobs(&dump, &dump_size,
-			      job_info_request_msg->show_flags,
-			      g_slurm_auth_get_uid(msg->auth_cred, NULL),
-			      NO_VAL, msg->protocol_version);
-		unlock_slurmctld(job_read_lock);
+		if (!dump_ref) {
+			dump_ref = pack_all_jobs_cached(&dump, &dump_size,
+					job_info_request_msg->show_flags,
+					uid, msg->protocol_version);
+			unlock_slurmctld(job_read_lock);
+		}
 		END_TIMER2("_slurm_rpc_dump_jobs");
 #if 0
 		info("_slurm_rpc_dump_jobs, size=%d %s", dump_size, TIME_STR);
@@ -1086,8 +1102,53 @@ static void _slurm_rpc_dump_jobs(slurm_msg_t * msg)
 
 		/* send message */
 		slurm_send_node_msg(msg->conn_fd, &response_msg);
-		xfree(dump);
+		pack_all_jobs_release(dump_ref);
+	}
+}
+
+/* _slurm_rpc_dump_jobs_delta - process RPC for job state information changed
+ *	since the client's last request */
+static void _slurm_rpc_dump_jobs_delta(slurm_msg_t * msg)
+{
+	DEF_TIMERS;
+	char *dump;
+	int dump_size, rc;
+	slurm_msg_t response_msg;
+	job_info_request_msg_t *job_info_request_msg =
+		(job_info_request_msg_t *) msg->data;
+	/* Locks: Read config job, write partition (for hiding) */
+	slurmctld_lock_t job_read_lock = {
+		READ_LOCK, READ_LOCK, NO_LOCK, WRITE_LOCK };
+	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
+
+	START_TIMER;
+	debug3("Processing RPC: REQUEST_JOB_INFO_DELTA from uid=%d", uid);
+	lock_slurmctld(job_read_lock);
+	rc = pack_jobs_delta(&dump, &dump_size,
+			     job_info_request_msg->last_update,
+			     job_info_request_msg->show_flags, uid,
+			     msg->protocol_version);
+	unlock_slurmctld(job_read_lock);
+	END_TIMER2("_slurm_rpc_dump_jobs_delta");
+
+	if (rc != SLURM_SUCCESS) {
+		debug3("_slurm_rpc_dump_jobs_delta, no change");
+		slurm_send_rc_msg(msg, rc);
+		return;
 	}
+
+	/* init response_msg structure */
+	slurm_msg_t_init(&response_msg);
+	response_msg.flags = msg->flags;
+	response_msg.protocol_version = msg->protocol_version;
+	response_msg.address = msg->address;
+	response_msg.msg_type = RESPONSE_JOB_INFO_DELTA;
+	response_msg.data = dump;
+	response_msg.data_size = dump_size;
+
+	/* send message */
+	slurm_send_node_msg(msg->conn_fd, &response_msg);
+	xfree(dump);
 }
 
 /* _slurm_rpc_dump_jobs - process RPC for job state information */
@@ -4500,6 +4561,9 @@ inline static void  _slurm_rpc_accounting_update_msg(slurm_msg_t *msg)
 	uid_t uid = g_slurm_auth_get_uid(msg->auth_cred, NULL);
 	accounting_update_msg_t *update_ptr =
 		(accounting_update_msg_t *) msg->data;
+	slurmdb_update_object_t *object;
+	ListIterator itr;
+	bool qos_update = false;
 	DEF_TIMERS;
 
 	START_TIMER;
@@ -4511,8 +4575,20 @@ inline static void  _slurm_rpc_accounting_update_msg(slurm_msg_t *msg)
 		slurm_send_rc_msg(msg, EACCES);
 		return;
 	}
-	if (update_ptr->update_list && list_count(update_ptr->update_list))
+	if (update_ptr->update_list && list_count(update_ptr->update_list)) {
+		itr = list_iterator_create(update_ptr->update_list);
+		while ((object = list_next(itr))) {
+			if ((object->type == SLURMDB_ADD_QOS) ||
+			    (object->type == SLURMDB_MODIFY_QOS) ||
+			    (object->type == SLURMDB_REMOVE_QOS))
+				qos_update = true;
+		}
+		list_iterator_destroy(itr);
 		rc = assoc_mgr_update(update_ptr->update_list);
+		/* Cached job information includes QOS names */
+		if (qos_update)
+			purge_job_info_cache();
+	}
 
 	END_TIMER2("_slurm_rpc_accounting_update_msg");
 
@@ -851,7 +851,7 @@ int read_slurm_conf(int recover, bool reconfig)
 	char *old_select_type     = xstrdup(slurmctld_conf.select_type);
 	char *old_switch_type     = xstrdup(slurmctld_conf.switch_type);
 	char *state_save_dir      = xstrdup(slurmctld_conf.state_save_location);
-	char *mpi_params;
+	char *mpi_params, *sched_params;
 	uint16_t old_select_type_p = slurmctld_conf.select_type_param;
 
 	/* initialization */
@@ -1017,6 +1017,13 @@ int read_slurm_conf(int recover, bool reconfig)
 	reserve_port_config(mpi_params);
 	xfree(mpi_params);
 
+	sched_params = slurm_get_sched_params();
+	slurm_persist_conn_enable(
+		(sched_params && strstr(sched_params, "slurmd_persist_conn")),
+		(slurmctld_conf.slurmd_timeout ?
+		 (slurmctld_conf.slurmd_timeout * 2) : PERSIST_CONN_IDLE));
+	xfree(sched_params);
+
 	license_free();
 	if (license_init(slurmctld_conf.licenses) != SLURM_SUCCESS)
 		fatal("Invalid Licenses value: %s", slurmctld_conf.licenses);
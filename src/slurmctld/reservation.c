@@ -69,6 +69,7 @@
 #include "src/common/pack.h"
 #include "src/common/parse_time.h"
 #include "src/common/slurm_accounting_storage.h"
+#include "src/common/slurm_priority.h"
 #include "src/common/uid.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
@@ -1471,7 +1472,7 @@ static bool _job_overlap(time_t start_time, uint16_t flags,
 	while ((job_ptr = (struct job_record *) list_next(job_iterator))) {
 		if (IS_JOB_RUNNING(job_ptr)		&&
 		    (job_ptr->end_time > start_time)	&&
-		    (bit_overlap(job_ptr->node_bitmap, node_bitmap) > 0)) {
+		    bit_overlap_any(job_ptr->node_bitmap, node_bitmap)) {
 			overlap = true;
 			break;
 		}
@@ -1508,7 +1509,7 @@ static bool _resv_overlap(time_t start_time, time_t end_time,
 			continue;	/* skip self */
 		if (resv_ptr->node_bitmap == NULL)
 			continue;	/* no specific nodes in reservation */
-		if (!bit_overlap(resv_ptr->node_bitmap, node_bitmap))
+		if (!bit_overlap_any(resv_ptr->node_bitmap, node_bitmap))
 			continue;	/* no overlap */
 		if (!resv_ptr->full_nodes)
 			continue;	
@@ -2881,7 +2882,7 @@ static int  _resize_resv(slurmctld_resv_t *resv_ptr, uint32_t node_cnt)
 		return SLURM_SUCCESS;
 
 	if (delta_node_cnt > 0) {	/* Must decrease node count */
-		if (bit_overlap(resv_ptr->node_bitmap, idle_node_bitmap)) {
+		if (bit_overlap_any(resv_ptr->node_bitmap, idle_node_bitmap)) {
 			/* Start by eliminating idle nodes from reservation */
 			tmp1_bitmap = bit_copy(resv_ptr->node_bitmap);
 			bit_and(tmp1_bitmap, idle_node_bitmap);
@@ -2889,16 +2890,13 @@ static int  _resize_resv(slurmctld_resv_t *resv_ptr, uint32_t node_cnt)
 			if (i > delta_node_cnt) {
 				tmp2_bitmap = bit_pick_cnt(tmp1_bitmap,
 							   delta_node_cnt);
-				bit_not(tmp2_bitmap);
-				bit_and(resv_ptr->node_bitmap, tmp2_bitmap);
+				bit_and_not(resv_ptr->node_bitmap, tmp2_bitmap);
 				FREE_NULL_BITMAP(tmp1_bitmap);
 				FREE_NULL_BITMAP(tmp2_bitmap);
 				delta_node_cnt = 0;	/* ALL DONE */
 			} else if (i) {
-				bit_not(idle_node_bitmap);
-				bit_and(resv_ptr->node_bitmap,
-					idle_node_bitmap);
-				bit_not(idle_node_bitmap);
+				bit_and_not(resv_ptr->node_bitmap,
+					    idle_node_bitmap);
 				resv_ptr->node_cnt = bit_set_count(
 						resv_ptr->node_bitmap);
 				delta_node_cnt = resv_ptr->node_cnt -
@@ -2993,9 +2991,7 @@ static int  _select_nodes(resv_desc_msg_t *resv_desc_ptr,
 				resv_ptr->full_nodes = 1;
 			}
 			if (resv_ptr->full_nodes) {
-				bit_not(resv_ptr->node_bitmap);
-				bit_and(node_bitmap, resv_ptr->node_bitmap);
-				bit_not(resv_ptr->node_bitmap);
+				bit_and_not(node_bitmap, resv_ptr->node_bitmap);
 			} else {
 				if (*core_bitmap == NULL)
 					_create_cluster_core_bitmap(core_bitmap);
@@ -3161,8 +3157,7 @@ static bitstr_t *_pick_idle_nodes(bitstr_t *avail_bitmap,
 			bit_or(ret_bitmap, tmp_bitmap);
 		else
 			ret_bitmap = bit_copy(tmp_bitmap);
-		bit_not(tmp_bitmap);
-		bit_and(avail_bitmap, tmp_bitmap);
+		bit_and_not(avail_bitmap, tmp_bitmap);
 		FREE_NULL_BITMAP(tmp_bitmap);
 	}
 
@@ -3286,9 +3281,7 @@ static bitstr_t *_pick_idle_node_cnt(bitstr_t *avail_bitmap,
 			continue;
 
 		if (!resv_desc_ptr->core_cnt) {
-			bit_not(job_ptr->node_bitmap);
-			bit_and(avail_bitmap, job_ptr->node_bitmap);
-			bit_not(job_ptr->node_bitmap);
+			bit_and_not(avail_bitmap, job_ptr->node_bitmap);
 		} else {
 			_check_job_compatibility(job_ptr, avail_bitmap,
 						 core_bitmap);
@@ -3690,8 +3683,10 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 			if ((now > resv_ptr->end_time) ||
 			    ((job_ptr->details) &&
 			     (job_ptr->details->begin_time >
-			      resv_ptr->end_time)))
+			      resv_ptr->end_time))) {
 				job_ptr->priority = 0;	/* admin hold */
+				priority_g_job_changed(job_ptr);
+			}
 			return ESLURM_RESERVATION_INVALID;
 		}
 		if (job_ptr->details->req_node_bitmap &&
@@ -3718,9 +3713,7 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 			    (res2_ptr->end_time   <= job_start_time) ||
 			    (!res2_ptr->full_nodes))
 				continue;
-			bit_not(res2_ptr->node_bitmap);
-			bit_and(*node_bitmap, res2_ptr->node_bitmap);
-			bit_not(res2_ptr->node_bitmap);
+			bit_and_not(*node_bitmap, res2_ptr->node_bitmap);
 		}
 		list_iterator_destroy(iter);
 
@@ -3785,9 +3778,8 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
 				info("reservation uses full nodes or job will "
 				     "not share nodes");
 #endif
-				bit_not(resv_ptr->node_bitmap);
-				bit_and(*node_bitmap, resv_ptr->node_bitmap);
-				bit_not(resv_ptr->node_bitmap);
+				bit_and_not(*node_bitmap,
+					    resv_ptr->node_bitmap);
 			} else {
 #if _DEBUG
 				info("job_test_resv: %s reservation uses "
@@ -3856,6 +3848,33 @@ extern time_t find_resv_end(time_t start_time)
 	return end_time;
 }
 
+/*
+ * Determine the time of the first reservation start or end after some time.
+ * IN when - look for reservations starting or ending after this time
+ * RET the reservation start or end time or zero of none found
+ */
+extern time_t find_resv_next_event(time_t when)
+{
+	ListIterator iter;
+	slurmctld_resv_t *resv_ptr;
+	time_t event_time = 0;
+
+	if (!resv_list)
+		return event_time;
+
+	iter = list_iterator_create(resv_list);
+	while ((resv_ptr = (slurmctld_resv_t *) list_next(iter))) {
+		if ((resv_ptr->start_time > when) &&
+		    ((event_time == 0) || (resv_ptr->start_time < event_time)))
+			event_time = resv_ptr->start_time;
+		if ((resv_ptr->end_time > when) &&
+		    ((event_time == 0) || (resv_ptr->end_time < event_time)))
+			event_time = resv_ptr->end_time;
+	}
+	list_iterator_destroy(iter);
+	return event_time;
+}
+
 /* Begin scan of all jobs for valid reservations */
 extern void begin_job_resv_check(void)
 {
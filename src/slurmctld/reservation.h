@@ -154,6 +154,13 @@ extern int job_test_resv(struct job_record *job_ptr, time_t *when,
  */
 extern time_t find_resv_end(time_t start_time);
 
+/*
+ * Determine the time of the first reservation start or end after some time.
+ * IN when - look for reservations starting or ending after this time
+ * RET the reservation start or end time or zero of none found
+ */
+extern time_t find_resv_next_event(time_t when);
+
 /*
  * Determine if a job can start now based only upon its reservations
  *	specification, if any
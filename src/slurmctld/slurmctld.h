@@ -97,6 +97,19 @@
 #define MAX_SERVER_THREADS 256
 #endif
 
+/* Count of threads which process queued RPCs (at most MAX_SERVER_THREADS) */
+#ifndef MAX_RPC_WORKERS
+#define MAX_RPC_WORKERS 64
+#endif
+
+/* Maximum incoming RPCs being read, queued or processed at one time.
+ * Each of these holds an open file, so the value is reduced to fit the
+ * file count limit. Keeping this well above MAX_RPC_WORKERS lets high
+ * priority RPCs be read and served ahead of a storm of queries. */
+#ifndef MAX_RPC_CONNS
+#define MAX_RPC_CONNS 1024
+#endif
+
 /* Perform full slurmctld's state every PERIODIC_CHECKPOINT seconds */
 #ifndef PERIODIC_CHECKPOINT
 #define	PERIODIC_CHECKPOINT	300
@@ -206,6 +219,17 @@ typedef struct diag_stats {
 	uint32_t bf_queue_len_sum;
 	time_t   bf_when_last_cycle;
 	uint32_t bf_active;
+	uint32_t bf_last_threads;
+	uint64_t bf_last_work_time;	/* usec, sum of all threads */
+	uint32_t bf_last_reused;	/* test results of previous cycle */
+	uint32_t job_info_cache_hits;
+	uint32_t job_info_cache_misses;
+	uint32_t job_save_cnt;		/* dump_all_job_state() calls */
+	uint32_t job_save_last;		/* usec */
+	uint32_t job_save_max;
+	uint64_t job_save_sum;
+	uint32_t job_save_lock_last;	/* usec, longest job lock hold */
+	uint32_t job_save_lock_max;
 } diag_stats_t;
 
 extern diag_stats_t slurmctld_diag_stats;
@@ -500,6 +524,9 @@ struct job_record {
 	uint32_t alloc_sid;		/* local sid making resource alloc */
 	uint32_t array_job_id;		/* job_id of a job array or 0 if N/A */
 	uint32_t array_task_id;		/* task_id of a job array */
+	struct job_record *array_next;	/* next task of the same job array */
+	struct job_record *array_prev;	/* previous task of the same job
+					 * array, last task for the first */
 	uint32_t assoc_id;              /* used for accounting plugins */
 	void    *assoc_ptr;		/* job's association record ptr, it is
 					 * void* because of interdependencies
@@ -548,7 +575,6 @@ struct job_record {
 					 * to be passed to slurmdbd */
 	uint32_t group_id;		/* group submitted under */
 	uint32_t job_id;		/* job ID */
-	struct job_record *job_next;	/* next entry with same hash index */
 	job_resources_t *job_resrcs;	/* details of allocated cores */
 	uint16_t job_state;		/* state of the job */
 	uint16_t kill_on_node_fail;	/* 1 if job should be killed on
@@ -624,6 +650,12 @@ struct job_record {
 	char *state_desc;		/* optional details for state_reason */
 	uint16_t state_reason;		/* reason job still pending or failed
 					 * see slurm.h:enum job_wait_reason */
+	uint64_t state_save_sum;	/* checksum of job state last written
+					 * to job_state or its journal,
+					 * zero if not yet saved */
+	uint64_t info_sum;		/* state_save_sum when last scanned,
+					 * see pack_jobs_delta() */
+	time_t info_update;		/* time of last info_sum change */
 	List step_list;			/* list of job's steps */
 	time_t suspend_time;		/* time job last suspended or resumed */
 	time_t time_last_active;	/* time of last job activity */
@@ -855,7 +887,8 @@ extern List depended_list_copy(List depend_list_src);
  */
 extern int drain_nodes ( char *nodes, char *reason, uint32_t reason_uid );
 
-/* dump_all_job_state - save the state of all jobs to file
+/* dump_all_job_state - save the state of all jobs to file, either as a
+ *	full snapshot or by appending changed job records to its journal
  * RET 0 or error code */
 extern int dump_all_job_state ( void );
 
@@ -1370,7 +1403,8 @@ extern int list_find_part (void *part_entry, void *key);
 
 /*
  * load_all_job_state - load the job state from file, recover from last
- *	checkpoint. Execute this after loading the configuration file data.
+ *	checkpoint and replay its journal. Execute this after loading the
+ *	configuration file data.
  * RET 0 or error code
  */
 extern int load_all_job_state ( void );
@@ -1483,6 +1517,66 @@ extern void pack_all_jobs(char **buffer_ptr, int *buffer_size,
 			  uint16_t show_flags, uid_t uid, uint32_t filter_uid,
 			  uint16_t protocol_version);
 
+/*
+ * pack_all_jobs_cached - dump all job information as pack_all_jobs() for a
+ *	REQUEST_JOB_INFO with no user filter, sharing previously packed data
+ *	until a job, partition or configuration change occurs
+ * OUT buffer_ptr - the pointer is set to the packed data
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * RET handle for the data, pass to pack_all_jobs_release() once sent
+ * NOTE: the buffer at *buffer_ptr must NOT be xfreed by the caller
+ */
+extern void *pack_all_jobs_cached(char **buffer_ptr, int *buffer_size,
+				  uint16_t show_flags, uid_t uid,
+				  uint16_t protocol_version);
+
+/* pack_all_jobs_release - release data from pack_all_jobs_cached()
+ * IN cache_ref - handle returned by pack_all_jobs_cached() */
+extern void pack_all_jobs_release(void *cache_ref);
+
+/* purge_job_info_cache - discard all packed job information from
+ *	pack_all_jobs_cached(), for changes to data packed with the jobs
+ *	which do not update last_job_update (e.g. QOS records) */
+extern void purge_job_info_cache(void);
+
+/*
+ * pack_all_jobs_snapshot - return job information previously packed by
+ *	pack_all_jobs_cached() for the same request if no job, partition or
+ *	configuration change has occurred since. Needs no slurmctld locks.
+ * OUT buffer_ptr - the pointer is set to the packed data
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * RET handle for the data, pass to pack_all_jobs_release() once sent, or
+ *	NULL if no current snapshot exists
+ * NOTE: the buffer at *buffer_ptr must NOT be xfreed by the caller
+ */
+extern void *pack_all_jobs_snapshot(char **buffer_ptr, int *buffer_size,
+				    uint16_t show_flags, uid_t uid,
+				    uint16_t protocol_version);
+
+/*
+ * pack_jobs_delta - dump job information for jobs changed since a client's
+ *	last request, followed by the IDs of jobs purged or hidden from the
+ *	user since then, in machine independent form (for network
+ *	transmission)
+ * OUT buffer_ptr - the pointer is set to the allocated buffer.
+ * OUT buffer_size - set to size of the buffer in bytes
+ * IN last_update - time of client's latest data
+ * IN show_flags - job filtering options
+ * IN uid - uid of user making request (for partition filtering)
+ * IN protocol_version - slurm protocol version of client
+ * RET SLURM_SUCCESS or SLURM_NO_CHANGE_IN_DATA if nothing to send
+ * NOTE: the buffer at *buffer_ptr must be xfreed by the caller
+ */
+extern int pack_jobs_delta(char **buffer_ptr, int *buffer_size,
+			   time_t last_update, uint16_t show_flags, uid_t uid,
+			   uint16_t protocol_version);
+
 /*
  * pack_all_node - dump all configuration and node information for all nodes
  *	in machine independent form (for network transmission)
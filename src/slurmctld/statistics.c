@@ -43,8 +43,10 @@
 #include <stdio.h>
 
 #include "src/slurmctld/agent.h"
+#include "src/slurmctld/locks.h"
 #include "src/slurmctld/slurmctld.h"
 #include "src/common/pack.h"
+#include "src/common/slurmdbd_defs.h"
 #include "src/common/xstring.h"
 #include "src/common/list.h"
 
@@ -59,6 +61,10 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 	Buf buffer;
 	int parts_packed;
 	int agent_queue_size;
+	lock_stats_t lock_stats[ENTITY_COUNT];
+	lock_site_stats_t *site_stats;
+	slurmdbd_agent_stats_t dbd_stats;
+	int i, site_cnt;
 	time_t now = time(NULL);
 
 	buffer_ptr[0] = NULL;
@@ -118,6 +124,85 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			pack32(slurmctld_diag_stats.bf_depth_try_sum, buffer);
 			pack32(slurmctld_diag_stats.bf_queue_len_sum, buffer);
 			pack32(slurmctld_diag_stats.bf_active,	 buffer);
+
+			if (protocol_version >= SLURM_14_03_PROTOCOL_VERSION) {
+				pack32(slurmctld_diag_stats.
+				       job_info_cache_hits, buffer);
+				pack32(slurmctld_diag_stats.
+				       job_info_cache_misses, buffer);
+				pack32(slurmctld_diag_stats.job_save_cnt,
+				       buffer);
+				pack32(slurmctld_diag_stats.job_save_last,
+				       buffer);
+				pack32(slurmctld_diag_stats.job_save_max,
+				       buffer);
+				pack64(slurmctld_diag_stats.job_save_sum,
+				       buffer);
+				pack32(slurmctld_diag_stats.job_save_lock_last,
+				       buffer);
+				pack32(slurmctld_diag_stats.job_save_lock_max,
+				       buffer);
+				pack32(slurmctld_diag_stats.bf_last_threads,
+				       buffer);
+				pack64(slurmctld_diag_stats.bf_last_work_time,
+				       buffer);
+				pack32(slurmctld_diag_stats.bf_last_reused,
+				       buffer);
+
+				get_lock_stats(lock_stats);
+				pack32(ENTITY_COUNT, buffer);
+				for (i = 0; i < ENTITY_COUNT; i++) {
+					packstr(get_lock_name(i), buffer);
+					pack32(lock_stats[i].read_cnt, buffer);
+					pack32(lock_stats[i].write_cnt, buffer);
+					pack64(lock_stats[i].read_wait, buffer);
+					pack64(lock_stats[i].write_wait,
+					       buffer);
+					pack64(lock_stats[i].read_hold, buffer);
+					pack64(lock_stats[i].write_hold,
+					       buffer);
+					pack32(lock_stats[i].site_drops,
+					       buffer);
+				}
+
+				site_cnt = get_lock_site_stats(&site_stats);
+				pack32(site_cnt, buffer);
+				for (i = 0; i < site_cnt; i++) {
+					lock_site_stats_t *site_ptr =
+						&site_stats[i];
+					packstr((char *) site_ptr->caller,
+						buffer);
+					packstr(get_lock_name(site_ptr->
+							      datatype),
+						buffer);
+					pack16((site_ptr->level == WRITE_LOCK),
+					       buffer);
+					pack32(site_ptr->count, buffer);
+					pack64(site_ptr->wait_total, buffer);
+					pack64(site_ptr->wait_max, buffer);
+					pack64(site_ptr->hold_total, buffer);
+					pack64(site_ptr->hold_max, buffer);
+					pack32_array(site_ptr->wait_hist,
+						     LOCK_HIST_CNT, buffer);
+					pack32_array(site_ptr->hold_hist,
+						     LOCK_HIST_CNT, buffer);
+				}
+				xfree(site_stats);
+
+				slurmdbd_get_agent_stats(&dbd_stats);
+				pack32(dbd_stats.queue_len, buffer);
+				pack32(dbd_stats.queue_max, buffer);
+				pack32(dbd_stats.batch_cnt, buffer);
+				pack32(dbd_stats.batch_max, buffer);
+				pack32(dbd_stats.inflight_max, buffer);
+				pack32(dbd_stats.msg_cnt, buffer);
+				pack64(dbd_stats.rtt_total, buffer);
+				pack64(dbd_stats.rtt_max, buffer);
+				pack32_array(dbd_stats.batch_hist,
+					     DBD_AGENT_HIST_CNT, buffer);
+				pack32_array(dbd_stats.rtt_hist,
+					     DBD_AGENT_HIST_CNT, buffer);
+			}
 		}
 	}
 
@@ -157,4 +242,17 @@ extern void reset_stats(int level)
 	slurmctld_diag_stats.bf_last_depth = 0;
 	slurmctld_diag_stats.bf_last_depth_try = 0;
 	slurmctld_diag_stats.bf_active = 0;
+	slurmctld_diag_stats.bf_last_threads = 0;
+	slurmctld_diag_stats.bf_last_work_time = 0;
+	slurmctld_diag_stats.bf_last_reused = 0;
+	slurmctld_diag_stats.job_info_cache_hits = 0;
+	slurmctld_diag_stats.job_info_cache_misses = 0;
+	slurmctld_diag_stats.job_save_cnt = 0;
+	slurmctld_diag_stats.job_save_last = 0;
+	slurmctld_diag_stats.job_save_max = 0;
+	slurmctld_diag_stats.job_save_sum = 0;
+	slurmctld_diag_stats.job_save_lock_last = 0;
+	slurmctld_diag_stats.job_save_lock_max = 0;
+	reset_lock_stats();
+	slurmdbd_reset_agent_stats();
 }
@@ -1257,8 +1257,7 @@ _pick_step_nodes (struct job_record  *job_ptr,
 				selected_nodes = NULL;
 			} else {
 				nodes_picked = bit_copy(selected_nodes);
-				bit_not(selected_nodes);
-				bit_and(nodes_avail, selected_nodes);
+				bit_and_not(nodes_avail, selected_nodes);
 				FREE_NULL_BITMAP(selected_nodes);
 			}
 		}
@@ -1461,8 +1460,7 @@ _pick_step_nodes (struct job_record  *job_ptr,
 				if (cpu_cnt == 0) {
 					/* Node not usable (memory insufficient
 					 * to allocate any CPUs, etc.) */
-					bit_not(node_tmp);
-					bit_and(nodes_avail, node_tmp);
+					bit_and_not(nodes_avail, node_tmp);
 					FREE_NULL_BITMAP(node_tmp);
 					continue;
 				}
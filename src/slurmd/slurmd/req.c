@@ -2099,6 +2099,7 @@ _rpc_ping(slurm_msg_t *msg)
 		ping_slurmd_resp_msg_t ping_resp;
 		get_cpu_load(&ping_resp.cpu_load);
 		slurm_msg_t_copy(&resp_msg, msg);
+		resp_msg.flags    = msg->flags & SLURM_PERSIST_ACK;
 		resp_msg.msg_type = RESPONSE_PING_SLURMD;
 		resp_msg.data     = &ping_resp;
 
@@ -2191,6 +2192,7 @@ _rpc_acct_gather_update(slurm_msg_t *msg)
 			ENERGY_DATA_STRUCT, acct_msg.energy);
 
 		slurm_msg_t_copy(&resp_msg, msg);
+		resp_msg.flags    = msg->flags & SLURM_PERSIST_ACK;
 		resp_msg.msg_type = RESPONSE_ACCT_GATHER_UPDATE;
 		resp_msg.data     = &acct_msg;
 
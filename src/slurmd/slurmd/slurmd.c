@@ -52,6 +52,7 @@
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <grp.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
@@ -59,6 +60,7 @@
 #include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/resource.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -113,6 +115,8 @@
 #endif
 
 #define MAX_THREADS		130
+#define MAX_PERSIST_CONN	4	/* kept open for slurmctld, see
+					 * slurm_persist_msg_type() */
 
 /* global, copied to STDERR_FILENO in tasks before the exec */
 int devnull = -1;
@@ -122,6 +126,7 @@ slurmd_conf_t * conf;
  * count of active threads
  */
 static int             active_threads = 0;
+static int             persist_conn_cnt = 0;
 static pthread_mutex_t active_mutex   = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  active_cond    = PTHREAD_COND_INITIALIZER;
 
@@ -156,6 +161,8 @@ static void      _init_conf(void);
 static void      _install_fork_handlers(void);
 static void 	 _kill_old_slurmd(void);
 static void      _msg_engine(void);
+static bool      _persist_conn_ok(slurm_msg_t *msg, bool *persist);
+static bool      _persist_conn_wait(slurm_fd_t fd);
 static void      _print_conf(void);
 static void      _print_config(void);
 static void      _process_cmdline(int ac, char **av);
@@ -542,25 +549,44 @@ _service_connection(void *arg)
 	conn_t *con = (conn_t *) arg;
 	slurm_msg_t *msg = xmalloc(sizeof(slurm_msg_t));
 	int rc = SLURM_SUCCESS;
+	bool keep, persist = false;
 
 	debug3("in the service_connection");
 	slurm_msg_t_init(msg);
-	if ((rc = slurm_receive_msg_and_forward(con->fd, con->cli_addr, msg, 0))
-	   != SLURM_SUCCESS) {
-		error("service_connection: slurm_receive_msg: %m");
-		/* if this fails we need to make sure the nodes we forward
-		   to are taken care of and sent back. This way the control
-		   also has a better idea what happened to us */
-		slurm_send_rc_msg(msg, rc);
-		goto cleanup;
+	while (1) {
+		if ((rc = slurm_receive_msg_and_forward(con->fd, con->cli_addr,
+							msg, 0))
+		    != SLURM_SUCCESS) {
+			error("service_connection: slurm_receive_msg: %m");
+			/* if this fails we need to make sure the nodes we
+			   forward to are taken care of and sent back. This
+			   way the control also has a better idea what
+			   happened to us */
+			slurm_send_rc_msg(msg, rc);
+			goto cleanup;
+		}
+		debug2("got this type of message %d", msg->msg_type);
+		/* The flag is returned in the response to tell the sender
+		 * it can send its next message on this connection */
+		if ((keep = _persist_conn_ok(msg, &persist)))
+			msg->flags |= SLURM_PERSIST_ACK;
+		slurmd_req(msg);
+		if (!keep || (msg->conn_fd < 0) || !_persist_conn_wait(con->fd))
+			break;
+		slurm_free_msg(msg);
+		msg = xmalloc(sizeof(slurm_msg_t));
+		slurm_msg_t_init(msg);
 	}
-	debug2("got this type of message %d", msg->msg_type);
-	slurmd_req(msg);
 
 cleanup:
 	if ((msg->conn_fd >= 0) && slurm_close_accepted_conn(msg->conn_fd) < 0)
 		error ("close(%d): %m", con->fd);
 
+	if (persist) {
+		slurm_mutex_lock(&active_mutex);
+		persist_conn_cnt--;
+		slurm_mutex_unlock(&active_mutex);
+	}
 	xfree(con->cli_addr);
 	xfree(con);
 	slurm_free_msg(msg);
@@ -568,6 +594,61 @@ cleanup:
 	return NULL;
 }
 
+/* Return true if the connection msg arrived on should be kept open for
+ * another message once this one is answered. At most MAX_PERSIST_CONN
+ * connections are kept, persist is set once this is one of them. */
+static bool
+_persist_conn_ok(slurm_msg_t *msg, bool *persist)
+{
+	if (!(msg->flags & SLURM_PERSIST_REQ) ||
+	    !slurm_persist_msg_type(msg->msg_type))
+		return false;
+	if (*persist)
+		return true;
+
+	slurm_mutex_lock(&active_mutex);
+	if (persist_conn_cnt < MAX_PERSIST_CONN) {
+		persist_conn_cnt++;
+		*persist = true;
+	}
+	slurm_mutex_unlock(&active_mutex);
+
+	return *persist;
+}
+
+/* Wait for the next message on a persistent connection. Return false if
+ * the connection was closed by the sender, has been idle for too long (see
+ * PERSIST_CONN_IDLE) or we are reconfiguring or shutting down. */
+static bool
+_persist_conn_wait(slurm_fd_t fd)
+{
+	struct pollfd pfd;
+	time_t start = time(NULL);
+	int idle = conf->slurmd_timeout ? (conf->slurmd_timeout * 2) :
+					  PERSIST_CONN_IDLE;
+	char c;
+	int rc;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while (!_shutdown && !_reconfig &&
+	       (difftime(time(NULL), start) < idle)) {
+		rc = poll(&pfd, 1, 1000);
+		if (rc == 0)
+			continue;
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		if (recv(fd, &c, 1, MSG_PEEK) <= 0)
+			return false;
+		return true;
+	}
+
+	return false;
+}
+
 extern int
 send_registration_msg(uint32_t status, bool startup)
 {
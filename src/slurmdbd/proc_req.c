@@ -3416,6 +3416,19 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 		*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
 					      ESLURM_ACCESS_DENIED, comment,
 					      DBD_SEND_MULT_MSG);
+		slurmdbd_conn->mult_msg_failed = true;
+		return SLURM_ERROR;
+	}
+
+	/* slurmctld may send several of these before reading the replies.
+	 * Once one failed, process no later message before slurmctld sends
+	 * the failed one again on a new connection. */
+	if (slurmdbd_conn->mult_msg_failed) {
+		comment = "DBD_SEND_MULT_MSG refused after a failed one";
+		debug("CONN:%u %s", slurmdbd_conn->newsockfd, comment);
+		*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
+					      SLURM_ERROR, comment,
+					      DBD_SEND_MULT_MSG);
 		return SLURM_ERROR;
 	}
 
@@ -3427,6 +3440,7 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 		*out_buffer = make_dbd_rc_msg(slurmdbd_conn->rpc_version,
 					      SLURM_ERROR, comment,
 					      DBD_SEND_MULT_MSG);
+		slurmdbd_conn->mult_msg_failed = true;
 		return SLURM_ERROR;
 	}
 
@@ -3439,8 +3453,10 @@ static int   _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn,
 			      size_buf(req_buf), 0, &ret_buf, uid);
 		if (ret_buf)
 			list_append(list_msg.my_list, ret_buf);
-		if (rc != SLURM_SUCCESS)
+		if (rc != SLURM_SUCCESS) {
+			slurmdbd_conn->mult_msg_failed = true;
 			break;
+		}
 	}
 	list_iterator_destroy(itr);
 
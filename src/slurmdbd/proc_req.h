@@ -52,6 +52,8 @@ typedef struct {
 	slurm_fd_t newsockfd; /* socket connection descriptor */
 	uint16_t orig_port;
 	uint16_t rpc_version; /* version of rpc */
+	bool mult_msg_failed; /* a DBD_SEND_MULT_MSG failed, refuse those
+			       * which follow it on this connection */
 } slurmdbd_conn_t;
 
 /* Process an incoming RPC
@@ -169,6 +169,8 @@ static int
 _print_job ( bool clear_old )
 {
 	static job_info_msg_t * old_job_ptr = NULL, * new_job_ptr;
+	static bool use_delta = true;
+	job_info_delta_msg_t *delta_ptr = NULL;
 	int error_code;
 	uint16_t show_flags = 0;
 
@@ -190,6 +192,30 @@ _print_job ( bool clear_old )
 			error_code = slurm_load_job_user(&new_job_ptr,
 							 params.user_id,
 							 show_flags);
+		} else if (use_delta) {
+			/* Only transfer jobs changed since the last
+			 * iteration and merge them into our table */
+			error_code = slurm_load_jobs_delta(
+				old_job_ptr->last_update,
+				&delta_ptr, show_flags);
+			if (error_code == SLURM_SUCCESS) {
+				new_job_ptr = old_job_ptr;
+				old_job_ptr = NULL;
+				error_code = slurm_merge_jobs_delta(
+					&new_job_ptr, delta_ptr);
+				slurm_free_job_info_delta_msg(delta_ptr);
+			} else if (slurm_get_errno() !=
+				   SLURM_NO_CHANGE_IN_DATA) {
+				/* Load all jobs, and stop asking for deltas
+				 * only if slurmctld does not support them */
+				if ((slurm_get_errno() == EINVAL) ||
+				    (slurm_get_errno() ==
+				     SLURM_PROTOCOL_VERSION_ERROR))
+					use_delta = false;
+				error_code = slurm_load_jobs(
+					old_job_ptr->last_update,
+					&new_job_ptr, show_flags);
+			}
 		} else {
 			error_code = slurm_load_jobs(
 				old_job_ptr->last_update,
@@ -3056,12 +3056,15 @@ extern int get_new_info_job(job_info_msg_t **info_ptr,
 			    int force)
 {
 	job_info_msg_t *new_job_ptr = NULL;
+	job_info_delta_msg_t *delta_ptr = NULL;
 	uint16_t show_flags = 0;
 	int error_code = SLURM_NO_CHANGE_IN_DATA;
 	time_t now = time(NULL);
 	static time_t last;
 	static bool changed = 0;
+	static bool use_delta = true;
 	static uint16_t last_flags = 0;
+	bool load_all;
 
 	if (g_job_info_ptr && !force
 	    && ((now - last) < working_sview_config.refresh_delay)) {
@@ -3079,8 +3082,34 @@ extern int get_new_info_job(job_info_msg_t **info_ptr,
 	if (g_job_info_ptr) {
 		if (show_flags != last_flags)
 			g_job_info_ptr->last_update = 0;
-		error_code = slurm_load_jobs(g_job_info_ptr->last_update,
-					     &new_job_ptr, show_flags);
+		load_all = !use_delta;
+		if (use_delta) {
+			/* Only transfer jobs changed since the last load and
+			 * merge them into our table */
+			error_code = slurm_load_jobs_delta(
+				g_job_info_ptr->last_update, &delta_ptr,
+				show_flags);
+			if (error_code == SLURM_SUCCESS) {
+				new_job_ptr = g_job_info_ptr;
+				g_job_info_ptr = NULL;
+				error_code = slurm_merge_jobs_delta(
+					&new_job_ptr, delta_ptr);
+				slurm_free_job_info_delta_msg(delta_ptr);
+			} else if (slurm_get_errno() !=
+				   SLURM_NO_CHANGE_IN_DATA) {
+				/* Load all jobs, and stop asking for deltas
+				 * only if slurmctld does not support them */
+				if ((slurm_get_errno() == EINVAL) ||
+				    (slurm_get_errno() ==
+				     SLURM_PROTOCOL_VERSION_ERROR))
+					use_delta = false;
+				load_all = true;
+			}
+		}
+		if (load_all)
+			error_code = slurm_load_jobs(
+				g_job_info_ptr->last_update, &new_job_ptr,
+				show_flags);
 		if (error_code == SLURM_SUCCESS) {
 			slurm_free_job_info_msg(g_job_info_ptr);
 			changed = 1;
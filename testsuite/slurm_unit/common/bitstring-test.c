@@ -196,6 +196,91 @@ main(int argc, char *argv[])
 		TEST(bit_equal(bs, bs2), "bitstring");
 	}
 
+	note("Testing word boundaries");
+	{
+		bitstr_t *bs = bit_alloc(100);
+		bitstr_t *bs2 = bit_alloc(100);
+
+		TEST(bit_fls(bs) == -1, "fls empty");
+		bit_set(bs, 31);
+		bit_set(bs, 32);
+		bit_set(bs, 64);
+		TEST(bit_ffs(bs) == 31, "ffs");
+		TEST(bit_fls(bs) == 64, "fls");
+		TEST(bit_set_count_range(bs, 32, 65) == 2, "set_count_range");
+		TEST(bit_set_count_range(bs, 33, 64) == 0, "set_count_range");
+		TEST(bit_get_bit_num(bs, 2) == 64, "get_bit_num");
+		TEST(bit_get_bit_num(bs, 3) == -1, "get_bit_num");
+		TEST(bit_get_pos_num(bs, 32) == 1, "get_pos_num");
+
+		bit_nset(bs, 0, 30);
+		TEST(bit_ffc(bs) == 33, "ffc");
+		bit_not(bs);		/* also sets bits past the end */
+		TEST(bit_fls(bs) == 99, "fls after not");
+		TEST(bit_set_count(bs) == 66, "set_count after not");
+		bit_nclear(bs, 33, 99);
+		TEST(bit_fls(bs) == -1, "fls ignores bits past end");
+		TEST(bit_set_count(bs) == 0, "set_count ignores bits past end");
+		TEST(bit_ffs(bs) == -1, "ffs ignores bits past end");
+
+		bit_set(bs, 63);
+		bit_set(bs, 64);
+		bit_set(bs2, 62);
+		bit_set(bs2, 65);
+		TEST(!bit_overlap_any(bs, bs2), "overlap_any across word");
+		bit_set(bs2, 64);
+		TEST(bit_overlap_any(bs, bs2), "overlap_any across word");
+		bit_and_not(bs, bs2);
+		TEST(bit_ffs(bs) == 63, "and_not across word");
+		TEST(bit_set_count(bs) == 1, "and_not across word");
+
+		bit_free(bs);
+		bit_free(bs2);
+	}
+
+	note("Testing bit_and_not/bit_overlap_any");
+	{
+		bitstr_t *bs1 = bit_alloc(200);
+		bitstr_t *bs2 = bit_alloc(200);
+
+		bit_nset(bs1, 10, 150);
+		bit_set(bs2, 5);
+		TEST(!bit_overlap_any(bs1, bs2), "overlap_any none");
+		bit_set(bs2, 150);
+		TEST(bit_overlap_any(bs1, bs2), "overlap_any");
+		TEST(bit_overlap(bs1, bs2) == 1, "overlap");
+		bit_nset(bs2, 20, 29);
+		bit_and_not(bs1, bs2);
+		TEST(bit_set_count(bs1) == 130, "and_not count");
+		TEST(!bit_test(bs1, 25), "and_not");
+		TEST(bit_test(bs1, 30), "and_not");
+		TEST(bit_fls(bs1) == 149, "and_not fls");
+		TEST(bit_set_count(bs2) == 12, "and_not leaves b2");
+		TEST(!bit_overlap_any(bs1, bs2), "overlap_any after and_not");
+
+		bit_free(bs1);
+		bit_free(bs2);
+	}
+
+	note("Testing bit_hash");
+	{
+		bitstr_t *bs1 = bit_alloc(200);
+		bitstr_t *bs2 = bit_alloc(200);
+		bitstr_t *bs3 = bit_alloc(201);
+
+		TEST(bit_hash(bs1) == bit_hash(bs2), "hash empty");
+		TEST(bit_hash(bs1) != bit_hash(bs3), "hash size");
+		bit_nset(bs1, 10, 150);
+		bit_nset(bs2, 10, 150);
+		TEST(bit_hash(bs1) == bit_hash(bs2), "hash equal");
+		bit_clear(bs2, 75);
+		TEST(bit_hash(bs1) != bit_hash(bs2), "hash differs");
+
+		bit_free(bs1);
+		bit_free(bs2);
+		bit_free(bs3);
+	}
+
 	totals();
 	return failed;
 }
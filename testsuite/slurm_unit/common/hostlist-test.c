@@ -0,0 +1,85 @@
+/* Test of src/common/hostlist.c
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <src/common/hostlist.h>
+#include <src/common/xmalloc.h>
+#include <testsuite/dejagnu.h>
+
+/* Test for failure:
+*/
+#define TEST(_tst, _msg) do {		\
+	if (! (_tst))			\
+		fail( _msg );		\
+	else				\
+		pass( _msg );		\
+} while (0)
+
+
+int
+main(int argc, char *argv[])
+{
+	note("Testing find in ordered hostlist");
+	{
+		hostlist_t hl = hostlist_create("a1,b[1-5,7,10-20],b30,c,d[001-009]");
+
+		TEST(hostlist_find(hl, "a1") == 0, "find a1");
+		TEST(hostlist_find(hl, "b1") == 1, "find b1");
+		TEST(hostlist_find(hl, "b7") == 6, "find b7");
+		TEST(hostlist_find(hl, "b15") == 12, "find b15");
+		TEST(hostlist_find(hl, "b30") == 18, "find b30");
+		TEST(hostlist_find(hl, "c") == 19, "find c");
+		TEST(hostlist_find(hl, "d009") == 28, "find d009");
+		TEST(hostlist_find(hl, "b6") == -1, "no b6");
+		TEST(hostlist_find(hl, "b21") == -1, "no b21");
+		TEST(hostlist_find(hl, "d9") == -1, "no d9");
+		TEST(hostlist_find(hl, "e") == -1, "no e");
+
+		hostlist_delete_host(hl, "b7");
+		TEST(hostlist_find(hl, "b7") == -1, "no b7 after delete");
+		TEST(hostlist_find(hl, "b15") == 11, "find b15 after delete");
+		hostlist_push_host(hl, "a2");
+		TEST(hostlist_find(hl, "a2") == 28, "find a2 after push");
+		hostlist_sort(hl);
+		TEST(hostlist_find(hl, "a2") == 1, "find a2 after sort");
+		TEST(hostlist_find(hl, "d001") == 20, "find d001 after sort");
+		hostlist_destroy(hl);
+	}
+
+	note("Testing find in unordered hostlist");
+	{
+		hostlist_t hl = hostlist_create("z[1-3],a[1-3],z2,m");
+
+		TEST(hostlist_find(hl, "a2") == 4, "find a2");
+		TEST(hostlist_find(hl, "z2") == 1, "find first z2");
+		TEST(hostlist_find(hl, "m") == 7, "find m");
+		TEST(hostlist_find(hl, "a4") == -1, "no a4");
+		hostlist_destroy(hl);
+	}
+
+	note("Testing large hostlist");
+	{
+		hostlist_t hl = hostlist_create(NULL);
+		char name[32], *str;
+		int i, errs = 0;
+
+		for (i = 0; i < 10000; i += 2) {
+			snprintf(name, sizeof(name), "n%d", i);
+			hostlist_push_host(hl, name);
+		}
+		for (i = 0; i < 10000; i++) {
+			snprintf(name, sizeof(name), "n%d", i);
+			if (hostlist_find(hl, name) != ((i & 1) ? -1 : i / 2))
+				errs++;
+		}
+		TEST(errs == 0, "find all hosts");
+		str = hostlist_ranged_string_xmalloc(hl);
+		TEST(!strncmp(str, "n[0,2,4,", 8), "ranged string start");
+		TEST(strlen(str) == 24447, "ranged string length");
+		xfree(str);
+		hostlist_destroy(hl);
+	}
+
+	totals();
+	return failed;
+}
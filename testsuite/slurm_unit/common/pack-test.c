@@ -41,7 +41,13 @@ int main (int argc, char *argv[])
 	int data_size;
 	long double test_double = 1340664754944.2132312, test_double2;
 	uint64_t test64;
+	uint32_t test_array[] = { 1, 2, 3 }, *out_array;
+	char *test_strings[] = { "first", "second" }, **out_strings;
+	char big[100];
+	xarena_t *arena;
+	int i;
 
+	memset(big, 'x', sizeof(big));
 	buffer = init_buf (0);
         pack16(test16, buffer);
         pack32(test32, buffer);
@@ -95,6 +101,51 @@ int main (int argc, char *argv[])
 	xfree(outstring);
 
 	free_buf(buffer);
+
+	/* Unpack strings and arrays into an arena */
+	arena = xarena_create(64);
+	buffer = init_buf(0);
+	packstr(teststring, buffer);
+	pack32_array(test_array, 3, buffer);
+	packstr_array(test_strings, 2, buffer);
+	for (i = 0; i < 4; i++)
+		packmem(big, sizeof(big), buffer);
+	data_size = get_buf_offset(buffer);
+	data = xfer_buf_data(buffer);
+	buffer = create_buf(data, data_size);
+	buffer->arena = arena;
+
+	unpackstr_xmalloc(&outstring, &byte_cnt, buffer);
+	TEST(strcmp(teststring, outstring) != 0, "unpackstr into arena");
+	TEST(xsize(outstring) != byte_cnt, "xsize of arena memory");
+	unpack32_array(&out_array, &out32, buffer);
+	TEST((out32 != 3) || (out_array[2] != test_array[2]),
+	     "unpack32_array into arena");
+	unpackstr_array(&out_strings, &out32, buffer);
+	TEST((out32 != 2) || strcmp(out_strings[1], test_strings[1]) ||
+	     out_strings[2], "unpackstr_array into arena");
+	for (i = 0; i < 4; i++) {
+		unpackmem_xmalloc(&outbytes, &byte_cnt, buffer);
+		if ((byte_cnt != sizeof(big)) ||
+		    memcmp(outbytes, big, sizeof(big)))
+			break;
+	}
+	TEST(i != 4, "unpack memory larger than arena chunk");
+	xfree(out_array);
+	TEST(out_array != NULL, "xfree of arena memory");
+	xrealloc(outstring, 64);
+	TEST(strcmp(teststring, outstring) != 0, "xrealloc of arena memory");
+	xfree(outstring);
+	xfree(out_strings[0]);
+	xfree(out_strings[1]);
+	xfree(out_strings);
+	buffer->arena = NULL;
+	free_buf(buffer);
+	xarena_reset(arena);
+	outbytes = xarena_alloc(arena, 10);
+	TEST(outbytes == NULL, "allocate from reset arena");
+	xarena_destroy(arena);
+
 	totals();
 	return failed;
 